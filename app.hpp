@@ -0,0 +1,178 @@
+/*
+ * app.hpp - from the Unicorn C(++) Examples collection
+ *
+ * The common shape of an example, so that several of them can live in one
+ * firmware image (see launcher.cpp) as well as each being built on its own.
+ *
+ * An app is handed a context holding the one display, graphics object and
+ * frame scheduler, which are shared by every app in the image; the network
+ * is shared too, simply by there only being one cyw43/lwIP stack to use.
+ *
+ *  - init() is called once, at startup, for every app; one-off setup (and
+ *    anything slow, like benchmarks) belongs here, so switching is quick.
+ *  - resume() is called whenever the app becomes current, and suspend()
+ *    when it stops being so; anything it changes in the shared context
+ *    (brightness, clipping) needs to be put right in those.
+ *  - update() and render() make up a frame; render() is also responsible for
+ *    presenting it, and for telling the scheduler when the next is due. An
+ *    app which starts its frame from a blank (or saved) buffer can have the
+ *    DMA do that during update(), and wait for it in render() (see
+ *    dma_surface.hpp).
+ *  - commands() offers a table of console commands (see console.hpp) while
+ *    the app is current; each handler is given the app itself.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef APP_HPP
+#define APP_HPP
+
+
+/* System headers. */
+
+#include "pico/stdlib.h"
+
+
+/* Local headers. */
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+#include "libraries/galactic_unicorn/galactic_unicorn.hpp"
+#include "instrument.hpp"
+#include "bench.hpp"
+#include "scheduler.hpp"
+#include "frame_monitor.hpp"
+#include "console.hpp"
+#include "dma_surface.hpp"
+
+
+/* Structs. */
+
+typedef struct
+{
+  pimoroni::GalacticUnicorn        *unicorn;
+  pimoroni::PicoGraphics_PenRGB565 *graphics;
+  FrameScheduler                   *scheduler;
+} appcontext_t;
+
+
+/* Classes. */
+
+class UnicornApp
+{
+  public:
+    virtual ~UnicornApp() {}
+
+    virtual void init( appcontext_t *p_context ) = 0;
+    virtual void resume( appcontext_t *p_context ) { return; }
+    virtual void update( appcontext_t *p_context ) = 0;
+    virtual void render( appcontext_t *p_context ) = 0;
+    virtual void suspend( appcontext_t *p_context ) { return; }
+    virtual const consolecommand_t *commands( void ) { return nullptr; }
+};
+
+
+/*
+ * AppRunner - sets up the shared context, and runs the frame loop for one or
+ *             more apps; with more than one, holding A and B together moves
+ *             onto the next app.
+ */
+
+class AppRunner
+{
+  private:
+    /* Only switch once per press, however long the buttons are held. */
+    static bool switch_pressed( appcontext_t *p_context )
+    {
+      static bool l_held = false;
+      bool        l_pressed;
+
+      l_pressed = p_context->unicorn->is_pressed( pimoroni::GalacticUnicorn::SWITCH_A ) &&
+                  p_context->unicorn->is_pressed( pimoroni::GalacticUnicorn::SWITCH_B );
+      if ( l_pressed && !l_held )
+      {
+        l_held = true;
+        return true;
+      }
+      l_held = l_pressed;
+      return false;
+    }
+
+  public:
+    static void run( UnicornApp **p_apps, uint_fast8_t p_count )
+    {
+      appcontext_t  l_context;
+      uint_fast8_t  l_index, l_current;
+      bool          l_on_time;
+
+      /*
+       * First thing to do is to create the Unicorn and Graphics objects.
+       * Pimoroni examples do this in variable declarations but I prefer it
+       * split out.
+       */
+      l_context.unicorn = new pimoroni::GalacticUnicorn();
+      l_context.graphics = new pimoroni::PicoGraphics_PenRGB565( pimoroni::GalacticUnicorn::WIDTH,
+                                                                 pimoroni::GalacticUnicorn::HEIGHT,
+                                                                 nullptr );
+      l_context.scheduler = new FrameScheduler();
+
+      /* Next up, we need to intialise both the Pico and the Unicorn. */
+      stdio_init_all();
+      l_context.unicorn->init();
+      Console::init();
+
+      /* Frame clears and copies go by DMA, if there's a channel to spare. */
+      DmaSurface::init();
+      DmaSurface::calibrate( l_context.graphics->frame_buffer, sizeof( uint16_t ) *
+                             pimoroni::GalacticUnicorn::WIDTH * pimoroni::GalacticUnicorn::HEIGHT );
+
+      /* Every app gets set up front, so that switching between them is quick. */
+      for ( l_index = 0; l_index < p_count; l_index++ )
+      {
+        p_apps[l_index]->init( &l_context );
+      }
+      BenchRun::finished();
+
+      /* From here on, a frame that wedges will get us reset by the watchdog. */
+      FrameMonitor::init();
+
+      /* If it's built in, the profiler samples from the first frame on. */
+      Profiler::start();
+      l_current = 0;
+      p_apps[l_current]->resume( &l_context );
+
+      /*
+       * All set up, so now we enter effectively an infinite loop.
+       */
+      while( true )
+      {
+        /* Switching happens before the frame, so the new app draws this one. */
+        if ( ( p_count > 1 ) && switch_pressed( &l_context ) )
+        {
+          p_apps[l_current]->suspend( &l_context );
+          l_current = ( l_current + 1 ) % p_count;
+          p_apps[l_current]->resume( &l_context );
+        }
+
+        /* Anything typed at us gets a slice of the frame, before the app. */
+        Console::poll( p_apps[l_current]->commands(), p_apps[l_current] );
+        Profiler::poll();
+
+        p_apps[l_current]->update( &l_context );
+        p_apps[l_current]->render( &l_context );
+        Instrument::frame();
+
+        /* And wait for the next frame, as asked for by the app. */
+        l_on_time = l_context.scheduler->wait();
+        FrameMonitor::frame( l_on_time );
+        Console::frame( l_on_time );
+      }
+    }
+};
+
+
+#endif /* APP_HPP */
+
+/* End of file app.hpp */
@@ -0,0 +1,103 @@
+/*
+ * bench.hpp - from the Unicorn C(++) Examples collection
+ *
+ * Machine-readable benchmark results; alongside their human-friendly output,
+ * the examples' startup benchmarks emit one line per kernel, as JSON, for
+ * tools/bench.py to collect from USB, add the image sizes to, and compare
+ * against a stored baseline.
+ *
+ *   BENCH {"suite":"rain","kernel":"dense_dual","ops":500,"ns_per_op":...}
+ *
+ * Each result covers a number of operations (frames, glyphs, generations);
+ * the time per op is given in nanoseconds and in cycles at the current clock,
+ * and any heap the run left allocated is noted too. Once every app has run
+ * its benchmarks, a closing line tells the collector it has everything.
+ *
+ * Like the rest of the instrumentation, this is only compiled in if
+ * UNICORN_INSTRUMENT is defined; otherwise it collapses to nothing.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+
+/* System headers. */
+
+#include <malloc.h>
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+
+
+/* Constants. */
+
+#define BENCH_PREFIX            "BENCH "
+
+
+/* Class. */
+
+class BenchRun
+{
+  private:
+    const char   *m_suite;
+    const char   *m_kernel;
+    uint64_t      m_start;
+    size_t        m_heap;
+
+    static size_t heap_used( void )
+    {
+#ifdef UNICORN_INSTRUMENT
+      return mallinfo().uordblks;
+#else
+      return 0;
+#endif
+    }
+
+  public:
+    /* Starts the clock (and notes the heap) for one kernel's run. */
+    BenchRun( const char *p_suite, const char *p_kernel )
+    {
+      m_suite = p_suite;
+      m_kernel = p_kernel;
+      m_heap = heap_used();
+      m_start = time_us_64();
+    }
+
+    /*
+     * end - stops the clock after the given number of operations, reports,
+     *       and hands back the elapsed time for the caller's own output.
+     */
+    uint64_t end( uint32_t p_ops )
+    {
+      uint64_t  l_elapsed = time_us_64() - m_start;
+#ifdef UNICORN_INSTRUMENT
+      uint64_t  l_ns = l_elapsed * 1000 / ( p_ops ? p_ops : 1 );
+      uint32_t  l_mhz = clock_get_hz( clk_sys ) / 1000000;
+
+      printf( BENCH_PREFIX "{\"suite\":\"%s\",\"kernel\":\"%s\",\"ops\":%lu,\"ns_per_op\":%llu,"
+              "\"cycles_per_op\":%llu,\"alloc_bytes\":%ld}\n",
+              m_suite, m_kernel, (unsigned long)p_ops, (unsigned long long)l_ns,
+              (unsigned long long)( l_ns * l_mhz / 1000 ), (long)( heap_used() - m_heap ) );
+#endif
+      return l_elapsed;
+    }
+
+    /* Everything's been run; the collector can stop listening. */
+    static void finished( void )
+    {
+#ifdef UNICORN_INSTRUMENT
+      printf( BENCH_PREFIX "{\"end\":true,\"mhz\":%lu}\n", (unsigned long)( clock_get_hz( clk_sys ) / 1000000 ) );
+#endif
+      return;
+    }
+};
+
+
+#endif /* BENCH_HPP */
+
+/* End of file bench.hpp */
@@ -16,6 +16,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "hardware/rtc.h"
 #include "pico/cyw43_arch.h"
@@ -32,6 +33,17 @@
 #include "libraries/pico_graphics/pico_graphics.hpp"
 #include "libraries/galactic_unicorn/galactic_unicorn.hpp"
 #include "numeric_font.hpp"
+#include "canvas.hpp"
+#include "linear_light.hpp"
+#include "pen_cache.hpp"
+#include "dither.hpp"
+#include "instrument.hpp"
+#include "bench.hpp"
+#include "fleet_time.hpp"
+#include "sntp_server.hpp"
+#include "night_blank.hpp"
+#include "telemetry.hpp"
+#include "app.hpp"
 
 
 /* Constants. */
@@ -40,7 +52,73 @@
 #define BC_NTP_FREQUENCY_SECS    3600LLU
 #define BC_USECS_IN_SEC          1000000LLU
 
+#define BC_ADJUST_USECS          2000000LLU
+#define BC_INPUT_REPEAT_USECS    250000LLU
+#define BC_TICK_SLACK_USECS      2000LLU
+
+/* Dithering needs a much faster refresh rate for the eye to blend levels. */
+#ifndef BC_DITHER
+#define BC_DITHER                0
+#endif
+#define BC_DITHER_FPS            60
+
+/* While we're busy (syncing time, finding the second), poll a bit faster. */
+#define BC_BUSY_FPS              20
+
+/* Changing digits roll into place; only then do we need a quick frame rate. */
+#define BC_ROLL_FPS              30
+#define BC_DIGITS                6
+
+#define BC_BENCHMARK_FRAMES      500
+
+/* Scaled glyphs are benchmarked on a wall two panels wide, tall enough for 3x. */
+#define BC_WALL_WIDTH            ( pimoroni::GalacticUnicorn::WIDTH * 2 )
+#define BC_WALL_HEIGHT           ( NUMERIC_FONT_HEIGHT * 3 )
+
+/* In a fleet, one clock does the NTP and the rest follow it (fleet_time.hpp). */
+#ifndef BC_FLEET
+#define BC_FLEET                 0
+#endif
+
+/* Once we have the time, we can serve it on to the LAN (sntp_server.hpp). */
+#ifndef BC_SNTP_SERVER
+#define BC_SNTP_SERVER           0
+#endif
+
+/* Blank the display and sleep overnight, or when it's dark (night_blank.hpp). */
+#ifndef BC_NIGHT_BLANK
+#define BC_NIGHT_BLANK           0
+#endif
+#ifndef BC_NIGHT_FROM
+#define BC_NIGHT_FROM            1
+#endif
+#ifndef BC_NIGHT_UNTIL
+#define BC_NIGHT_UNTIL           6
+#endif
+#ifndef BC_NIGHT_DARK
+#define BC_NIGHT_DARK            16
+#endif
+
+#if BC_NIGHT_BLANK && ( BC_FLEET || BC_SNTP_SERVER )
+#error "night blanking sleeps with the radio off, so can't be used in a fleet or to serve time"
+#endif
+
+/*
+ * Telemetry goes out with each NTP sync (or in a fleet follower's receive
+ * windows), if there's a collector to send it to.
+ */
+#ifndef BC_TELEMETRY_HOST
+#define BC_TELEMETRY_HOST        ""
+#endif
+#ifndef BC_TELEMETRY_PORT
+#define BC_TELEMETRY_PORT        8089
+#endif
+
+/* And the radio stays up a moment longer, to get it out of the door. */
+#define BC_TELEMETRY_LINGER_USECS 100000LLU
+
 #define NTP_SERVER               "pool.ntp.org"
+#define NTP_SERVER_MAX           64
 #define NTP_PORT                 123
 #define NTP_PACKET_LEN           48
 #define NTP_EPOCH_OFFSET         2208988800L
@@ -55,6 +133,35 @@
 #define MIDDAY_VALUE             0.8f
 #define MIDNIGHT_VALUE           0.3f
 
+/* The background is mirrored, so only the left half (and middle) is worked out. */
+#define BC_GRADIENT_COLUMNS      ( pimoroni::GalacticUnicorn::WIDTH / 2 + 1 )
+
+/* The background is kept drawn, for the DMA to copy in at each frame's start. */
+#define BC_FRAME_PIXELS          ( pimoroni::GalacticUnicorn::WIDTH * pimoroni::GalacticUnicorn::HEIGHT )
+#define BC_NO_MIX                ( LINEAR_LIGHT_MIX_ONE + 1 )
+
+
+/* Enums. */
+
+typedef enum
+{
+  BC_STAGE_UPDATE,
+  BC_STAGE_RENDER,
+  BC_STAGE_PRESENT,
+  BC_STAGE_NETWORK
+} bc_stage_t;
+
+typedef enum
+{
+  BC_METRIC_FRAME_US,
+  BC_METRIC_NTP_OFFSET,
+  BC_METRIC_WIFI_CONNECT,
+  BC_METRIC_BRIGHTNESS,
+  BC_METRIC_NTP_SYNCS,
+  BC_METRIC_NTP_FAILURES,
+  BC_METRICS
+} bc_metric_t;
+
 
 /* Structs. */
 
@@ -64,18 +171,71 @@ typedef struct
   struct udp_pcb *socket;
   bool            active_query;
   uint32_t        time;
+  uint8_t         stratum;
 } ntpstate_t;
 
+typedef struct
+{
+  ip_addr_t       server;
+  uint8_t         stratum;
+} ntpsource_t;
+
+/* Where checktime() is up to; kept out here, so it can be let go of. */
+typedef struct
+{
+  bool            active, connecting;
+  bool            kept, owned;
+  uint64_t        connect_tick, linger_until;
+  ntpstate_t      ntpstate;
+} ntpcheck_t;
+
+/* Each background column's colour at midnight and midday, in linear light. */
+typedef struct
+{
+  linearcolour_t  midnight[BC_GRADIENT_COLUMNS];
+  linearcolour_t  midday[BC_GRADIENT_COLUMNS];
+} bcgradient_t;
+
+
+/* Globals. */
+
+/* Whoever we last got the time from; if we serve it on, we say so. */
+static ntpsource_t g_ntp_source;
+
+/* Who we ask; this can be changed from the console. */
+static char g_ntp_server[NTP_SERVER_MAX] = NTP_SERVER;
+
+/* The sync in progress (or the link kept up after one). */
+static ntpcheck_t g_ntpcheck;
+
+/* The ends of the day's colour cycle; worked out once, at startup. */
+static bcgradient_t g_gradient;
+
+/* What we tell the collector about, in bc_metric_t order. */
+static const telemetrymetric_t g_metrics[BC_METRICS] = {
+  { "frame_us",        TELEMETRY_HISTOGRAM },
+  { "ntp_offset_s",    TELEMETRY_GAUGE },
+  { "wifi_connect_ms", TELEMETRY_HISTOGRAM },
+  { "brightness_pct",  TELEMETRY_GAUGE },
+  { "ntp_syncs",       TELEMETRY_COUNTER },
+  { "ntp_failures",    TELEMETRY_COUNTER }
+};
+static_assert( BC_METRICS <= TELEMETRY_METRICS_MAX, "too many metrics for the telemetry table" );
+
+static Telemetry g_telemetry;
+
 
 /* Functions. */
 
 /*
  * dimmer - applies a suitable dimmer / brightness adjustment, based on the
  *          requested base brightness and modified depending on the ambient
- *          lighting conditions.
+ *          lighting conditions. If we're dithering, the brightness is
+ *          applied by the dither stage rather than the Unicorn itself.
  */
 
-void dimmer( pimoroni::GalacticUnicorn *p_unicorn, float p_brightness )
+void dimmer( pimoroni::GalacticUnicorn *p_unicorn, TemporalDither *p_dither,
+             float p_brightness )
 {
   /* We adjust the desired brightness by the ambient light reading. */
   float l_brightness =  p_brightness / 2048 * ( p_unicorn->light() + 512 );
@@ -87,7 +247,12 @@ void dimmer( pimoroni::GalacticUnicorn *p_unicorn, float p_brightness )
   }
 
   /* Just set it then, and we're done. */
+  g_telemetry.record( BC_METRIC_BRIGHTNESS, l_brightness * 100 );
+#if BC_DITHER
+  p_dither->set_brightness( l_brightness );
+#else
   p_unicorn->set_brightness( l_brightness );
+#endif
 
   /* All done. */
   return;
@@ -104,6 +269,12 @@ void ntp_request( ntpstate_t *p_ntpstate )
   struct pbuf  *l_buffer;
   uint8_t      *l_payload; 
 
+  /* A lookup can come back after we've let go of the socket. */
+  if ( p_ntpstate->socket == nullptr )
+  {
+    return;
+  }
+
   /* Calls into lwIP need to be correctly locked. */
   cyw43_arch_lwip_begin();
 
@@ -140,6 +311,7 @@ void ntpcb_recv( void *p_ntpstate, struct udp_pcb *p_socket, struct pbuf *p_buff
   ntpstate_t *l_ntpstate = (ntpstate_t *)p_ntpstate;
   uint8_t     l_mode, l_stratum;
   uint8_t     l_ntptime[4];
+  InstrumentScope l_scope( BC_STAGE_NETWORK );
 
   /* Called whenever a packet is received; all we really need to do here is  */
   /* to make sure it looks like an NTP message and decode the provided time. */
@@ -152,6 +324,7 @@ void ntpcb_recv( void *p_ntpstate, struct udp_pcb *p_socket, struct pbuf *p_buff
     /* Looks valid; just extract the time value. */
     pbuf_copy_partial( p_buffer, l_ntptime, sizeof( l_ntptime ), 40 );
     l_ntpstate->time = l_ntptime[0] << 24 | l_ntptime[1] << 16 | l_ntptime[2] << 8 | l_ntptime[3];
+    l_ntpstate->stratum = l_stratum;
   }
 
   /* All done. */
@@ -161,6 +334,7 @@ void ntpcb_recv( void *p_ntpstate, struct udp_pcb *p_socket, struct pbuf *p_buff
 void ntpcb_dns( const char *p_name, const ip_addr_t *p_addr, void *p_ntpstate )
 {
   ntpstate_t *l_ntpstate = (ntpstate_t *)p_ntpstate;
+  InstrumentScope l_scope( BC_STAGE_NETWORK );
 
   /* Called when we get an answer back from the DNS lookup. Save it and kick */
   /* off the actual NTP request.                                             */
@@ -251,97 +425,161 @@ datetime_t *rtc_add_hours( const datetime_t *p_rtctime, int8_t p_offset )
 }
 
 
+/*
+ * rtc_to_ntp - the reverse of ntp_apply_timezone; takes a (local) RTC time
+ *              and turns it back into UTC seconds since 1900, with the same
+ *              mktime() bodge as above.
+ */
+
+uint32_t rtc_to_ntp( const datetime_t *p_rtctime, int8_t p_timezone )
+{
+  struct tm         l_tmstruct;
+
+  memset( &l_tmstruct, 0, sizeof( l_tmstruct ) );
+  l_tmstruct.tm_year = p_rtctime->year;
+  l_tmstruct.tm_mon  = p_rtctime->month;
+  l_tmstruct.tm_mday = p_rtctime->day;
+  l_tmstruct.tm_hour = p_rtctime->hour;
+  l_tmstruct.tm_min  = p_rtctime->min;
+  l_tmstruct.tm_sec  = p_rtctime->sec;
+
+  return mktime( &l_tmstruct ) + NTP_EPOCH_OFFSET - ( 3600 * p_timezone );
+}
+
+
 /*
  * checktime - attempts to fetch the time via NTP, and set the RP2040's clock
  *             appropriately. Will only return TRUE once it has successfully
  *             done this, so that it can handle the (potentially long) process
  *             without interrupting updates.
+ *
+ *             Normally it brings the WiFi up, and down again afterwards; a
+ *             fleet leader already has it up, so says it doesn't own the link.
+ *             If we're serving time on to the LAN, we keep it up once it is.
+ *             Either way, with the link up, it's when the telemetry goes out.
  */
 
-bool checktime( int8_t p_timezone )
+bool checktime( int8_t p_timezone, bool p_own_link = true )
 {
-  static bool       l_active = false;
-  static bool       l_connecting = false;
+  ntpcheck_t       *l_check = &g_ntpcheck;
   int               l_link_status, l_error;
-  static ntpstate_t l_ntpstate;
   time_t            l_timet;
   struct tm        *l_tmstruct;
   datetime_t        l_rtctime;
 
+  /* A link we kept up may have dropped since; if so, start again. */
+  if ( !l_check->active && l_check->kept &&
+       ( cyw43_tcpip_link_status( &cyw43_state, CYW43_ITF_STA ) != CYW43_LINK_UP ) )
+  {
+    cyw43_arch_deinit();
+    l_check->kept = l_check->owned = false;
+  }
+
   /* If the wireless isn't currently active, we need to kick that off. */
-  if ( !l_active )
+  if ( !l_check->active )
   {
-    /* Initialise the WiFi. */
-    cyw43_arch_init();
-    cyw43_arch_enable_sta_mode();
-    cyw43_arch_wifi_connect_async( WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK );
-    l_connecting = true;
-    l_active = true;
+    /* Initialise the WiFi, unless someone else already has (or we kept it). */
+    if ( p_own_link && !l_check->kept )
+    {
+      l_check->connect_tick = time_us_64();
+      cyw43_arch_init();
+      cyw43_arch_enable_sta_mode();
+      cyw43_arch_wifi_connect_async( WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK );
+      l_check->owned = true;
+    }
+    l_check->connecting = p_own_link && !l_check->kept;
+    l_check->active = true;
 
     /* And reset the NTP state object. */
-    if ( l_ntpstate.socket != nullptr )
+    if ( l_check->ntpstate.socket != nullptr )
     {
-      udp_remove( l_ntpstate.socket );
-      l_ntpstate.socket = nullptr;
+      udp_remove( l_check->ntpstate.socket );
+      l_check->ntpstate.socket = nullptr;
     }
-    l_ntpstate.active_query = false;
-    l_ntpstate.time = 0;
+    l_check->ntpstate.active_query = false;
+    l_check->ntpstate.time = 0;
+    l_check->ntpstate.stratum = 0;
   }
 
   /* We'll need to know the link status, whatever else we do. */
   l_link_status = cyw43_tcpip_link_status( &cyw43_state, CYW43_ITF_STA );
 
   /* So, if we're connecting we wait to see if it's up! */
-  if ( l_connecting )
+  if ( l_check->connecting )
   {
     /* If it's failed hard, disconnect and we'll try again. */
     if ( ( l_link_status == CYW43_LINK_FAIL ) || ( l_link_status == CYW43_LINK_BADAUTH ) ||
          ( l_link_status == CYW43_LINK_NONET ) )
     {
       printf( "Failed to initialise WiFi (err %d)\n", l_link_status );
+      g_telemetry.count( BC_METRIC_NTP_FAILURES );
       cyw43_arch_deinit();
-      l_active = false;
-      l_connecting = false;
+      l_check->owned = false;
+      l_check->active = false;
+      l_check->connecting = false;
       return false;
     }
 
     /* If it's connected, we're out of that phase. */
     if ( l_link_status == CYW43_LINK_UP )
     {
-      l_connecting = false;
+      g_telemetry.record( BC_METRIC_WIFI_CONNECT, ( time_us_64() - l_check->connect_tick ) / 1000 );
+      l_check->connecting = false;
     }
   }
 
   /* After those checks, if we're not connecting we *should* be connected. */
-  if ( !l_connecting )
+  if ( !l_check->connecting )
   {
     /* We'll need a PCB (which I'm gonna call a socket) for our work. */
-    if ( l_ntpstate.socket == nullptr )
+    if ( l_check->ntpstate.socket == nullptr )
     {
-      l_ntpstate.socket = udp_new_ip_type( IPADDR_TYPE_ANY );
-      if ( l_ntpstate.socket == nullptr )
+      l_check->ntpstate.socket = udp_new_ip_type( IPADDR_TYPE_ANY );
+      if ( l_check->ntpstate.socket == nullptr )
       {
         printf( "Failed to create UDP PCB socket\n" );
         return false;
       }
 
       /* So, as long as we have a valid socket, set up the recv handler. */
-      udp_recv( l_ntpstate.socket, ntpcb_recv, &l_ntpstate );
+      udp_recv( l_check->ntpstate.socket, ntpcb_recv, &l_check->ntpstate );
     }
 
     /* If there's already a query, we just wait to have a response. */
-    if ( l_ntpstate.active_query )
+    if ( l_check->ntpstate.active_query )
     {
       /* Wait until the time is set. */
-      if ( l_ntpstate.time > 0 )
+      if ( ( l_check->ntpstate.time > 0 ) && ( l_check->linger_until == 0 ) )
       {
+        /* Note how far out the RTC had got (from the last sync, not from boot). */
+        if ( g_ntp_source.stratum != 0 )
+        {
+          rtc_get_datetime( &l_rtctime );
+          g_telemetry.record( BC_METRIC_NTP_OFFSET, (int32_t)( l_check->ntpstate.time - rtc_to_ntp( &l_rtctime, p_timezone ) ) );
+        }
+        g_telemetry.count( BC_METRIC_NTP_SYNCS );
+
         /* Apply our timezone and update the RTC with this time. */
-        rtc_set_datetime( ntp_apply_timezone( l_ntpstate.time, p_timezone ) );
+        rtc_set_datetime( ntp_apply_timezone( l_check->ntpstate.time, p_timezone ) );
+        ip_addr_copy( g_ntp_source.server, l_check->ntpstate.server );
+        g_ntp_source.stratum = l_check->ntpstate.stratum;
+
+        /* The link's up anyway, so send the telemetry, and let it get out. */
+        l_check->linger_until = time_us_64() + ( g_telemetry.flush() ? BC_TELEMETRY_LINGER_USECS : 0 );
+      }
+
+      if ( ( l_check->linger_until != 0 ) && ( time_us_64() >= l_check->linger_until ) )
+      {
+        l_check->linger_until = 0;
 
         /* Lastly, tear down the connection and indicate it's all worked. */
-        cyw43_arch_deinit();
-        l_active = false;
-        l_connecting = false;
+        if ( p_own_link && !BC_SNTP_SERVER )
+        {
+          cyw43_arch_deinit();
+        }
+        l_check->kept = l_check->owned = p_own_link && BC_SNTP_SERVER;
+        l_check->active = false;
+        l_check->connecting = false;
         return true;
       }
     }
@@ -350,20 +588,21 @@ bool checktime( int8_t p_timezone )
     {
       /* Calls into lwIP need to be correctly locked. */
       cyw43_arch_lwip_begin();
-      l_error = dns_gethostbyname( NTP_SERVER, &l_ntpstate.server, ntpcb_dns, &l_ntpstate );
-      l_ntpstate.active_query = true;
+      l_error = dns_gethostbyname( g_ntp_server, &l_check->ntpstate.server, ntpcb_dns, &l_check->ntpstate );
+      l_check->ntpstate.active_query = true;
       cyw43_arch_lwip_end();
 
       /* If we got an OK straight away, we had a cached DNS entry. */
       if ( l_error == ERR_OK )
       {
         /* Call the lookup directly. */
-        ntp_request( &l_ntpstate );
+        ntp_request( &l_check->ntpstate );
       }
       else if ( l_error != ERR_INPROGRESS )
       {
         printf( "Failed to lookup NTP server DNS\n" );
-        l_ntpstate.active_query = false;
+        g_telemetry.count( BC_METRIC_NTP_FAILURES );
+        l_check->ntpstate.active_query = false;
         return false;
       }
     }
@@ -375,7 +614,48 @@ bool checktime( int8_t p_timezone )
 
 
 /*
- * gradient_background; lifted wholesale from clock.py
+ * checktime_release - lets go of the network part way through a sync (or a
+ *                     link kept up after one), for another app to use; the
+ *                     WiFi only goes down if we brought it up. The next call
+ *                     to checktime() starts again from scratch.
+ */
+
+void checktime_release( void )
+{
+  ntpcheck_t *l_check = &g_ntpcheck;
+
+  if ( l_check->ntpstate.socket != nullptr )
+  {
+    cyw43_arch_lwip_begin();
+    udp_remove( l_check->ntpstate.socket );
+    l_check->ntpstate.socket = nullptr;
+    cyw43_arch_lwip_end();
+  }
+  if ( l_check->owned )
+  {
+    cyw43_arch_deinit();
+  }
+  l_check->active = l_check->connecting = false;
+  l_check->kept = l_check->owned = false;
+  l_check->ntpstate.active_query = false;
+  l_check->linger_until = 0;
+  return;
+}
+
+
+/*
+ * gradient_background; lifted wholesale from clock.py, but drawn onto a
+ *                      canvas (see canvas.hpp) rather than via PicoGraphics.
+ *
+ *                      Rather than working out every column's colour in HSV
+ *                      each frame, the colours at midnight and midday are
+ *                      worked out once (bc_gradient_init) and each frame
+ *                      blends between them in linear light, so the colours
+ *                      in between don't go dark and muddy.
+ *
+ *                      The blend only moves a little from one minute to the
+ *                      next, so pens come from a cache (see pen_cache.hpp)
+ *                      rather than being made afresh every frame.
  */
 
 void from_hsv(float h, float s, float v, uint8_t &r, uint8_t &g, uint8_t &b) {
@@ -396,292 +676,1080 @@ void from_hsv(float h, float s, float v, uint8_t &r, uint8_t &g, uint8_t &b) {
   }
 }
 
-void gradient_background( pimoroni::PicoGraphics *p_graphics, 
-                          float p_hue, float p_sat, float p_val )
+void bc_gradient_init( bcgradient_t *p_gradient )
 {
-  uint8_t       l_width = pimoroni::GalacticUnicorn::WIDTH / 2;
+  const int     l_width = BC_GRADIENT_COLUMNS - 1;
   uint8_t       l_r, l_g, l_b;
-  uint_fast8_t  l_x, l_y;
+  int           l_x;
 
   for ( l_x = 0; l_x <= l_width; l_x++ )
   {
-    from_hsv( ( HUE_OFFSET * l_x / l_width ) + p_hue, p_sat, p_val, l_r, l_g, l_b );
-    p_graphics->set_pen( p_graphics->create_pen( l_r, l_g, l_b ) );
-    p_graphics->pixel( pimoroni::Point( l_x, 0 ) );
-    p_graphics->pixel( pimoroni::Point( l_x, pimoroni::GalacticUnicorn::HEIGHT-1 ) );
-    if ( l_x == 9 )
+    from_hsv( ( HUE_OFFSET * l_x / l_width ) + MIDNIGHT_HUE, MIDNIGHT_SATURATION, MIDNIGHT_VALUE, l_r, l_g, l_b );
+    p_gradient->midnight[l_x] = LinearLight::to_linear( l_r, l_g, l_b );
+    from_hsv( ( HUE_OFFSET * l_x / l_width ) + MIDDAY_HUE, MIDDAY_SATURATION, MIDDAY_VALUE, l_r, l_g, l_b );
+    p_gradient->midday[l_x] = LinearLight::to_linear( l_r, l_g, l_b );
+  }
+  return;
+}
+
+/* One column of the background, and its mirror image on the right. */
+template <class C>
+void gradient_column( C &p_canvas, int p_x, typename C::pen_t p_pen )
+{
+  int   l_y, l_mirror;
+
+  /* The mirror of the very first column would be just off the edge. */
+  l_mirror = C::WIDTH - p_x;
+
+  p_canvas.set( p_x, 0, p_pen );
+  p_canvas.set( p_x, C::HEIGHT-1, p_pen );
+  if ( p_x > 0 )
+  {
+    p_canvas.set( l_mirror, 0, p_pen );
+    p_canvas.set( l_mirror, C::HEIGHT-1, p_pen );
+  }
+  if ( p_x == 9 )
+  {
+    p_canvas.template set<9, 1>( p_pen );
+    p_canvas.template set<9, C::HEIGHT-2>( p_pen );
+    p_canvas.template set<44, 1>( p_pen );
+    p_canvas.template set<44, C::HEIGHT-2>( p_pen );
+  }
+  if ( p_x < 9 )
+  {
+    for ( l_y = 1; l_y < C::HEIGHT-1; l_y++ )
     {
-      p_graphics->pixel( pimoroni::Point( 9, 1 ) );
-      p_graphics->pixel( pimoroni::Point( 9, pimoroni::GalacticUnicorn::HEIGHT-2 ) );
-      p_graphics->pixel( pimoroni::Point( 44, 1 ) );
-      p_graphics->pixel( pimoroni::Point( 44, pimoroni::GalacticUnicorn::HEIGHT-2 ) );
+      p_canvas.set( p_x, l_y, p_pen );
+      if ( p_x > 0 )
+      {
+        p_canvas.set( l_mirror, l_y, p_pen );
+      }
     }
-    if ( l_x < 9 || l_x > 43 )
+  }
+  return;
+}
+
+/*
+ * p_mix is how far from midnight (0) to midday (256) we are; without a pen
+ * cache, every column's pen is made from scratch (for the benchmark).
+ */
+template <class C>
+void gradient_background( C &p_canvas, const bcgradient_t &p_gradient, uint_fast16_t p_mix,
+                          PenCache<C> *p_pens )
+{
+  uint8_t   l_r, l_g, l_b;
+  int       l_x;
+
+  for ( l_x = 0; l_x < BC_GRADIENT_COLUMNS; l_x++ )
+  {
+    LinearLight::mix( p_gradient.midnight[l_x], p_gradient.midday[l_x], p_mix, l_r, l_g, l_b );
+    gradient_column( p_canvas, l_x, p_pens ? p_pens->pen( p_canvas, l_r, l_g, l_b )
+                                           : p_canvas.create_pen( l_r, l_g, l_b ) );
+  }
+  return;
+}
+
+/* The original, blending in gamma-encoded HSV; only the benchmark uses it now. */
+template <class C>
+void gradient_background_hsv( C &p_canvas, float p_hue, float p_sat, float p_val )
+{
+  const int l_width = C::WIDTH / 2;
+  uint8_t   l_r, l_g, l_b;
+  int       l_x;
+
+  for ( l_x = 0; l_x <= l_width; l_x++ )
+  {
+    from_hsv( ( HUE_OFFSET * l_x / l_width ) + p_hue, p_sat, p_val, l_r, l_g, l_b );
+    gradient_column( p_canvas, l_x, p_canvas.create_pen( l_r, l_g, l_b ) );
+  }
+  return;
+}
+
+
+/*
+ * bc_draw - the bulk of a frame (background and digits), as a template so
+ *           the benchmark can run it through both canvas types.
+ */
+
+template <class C>
+void bc_draw( C &p_canvas, PenCache<C> &p_pens, const uint8_t *p_digits, typename C::pen_t p_black_pen,
+              typename C::pen_t p_white_pen )
+{
+  const uint8_t l_digit_x[BC_DIGITS] = { 10, 15, 22, 27, 34, 39 };
+  uint_fast8_t  l_index;
+
+  p_canvas.fill( p_black_pen );
+  gradient_background( p_canvas, g_gradient, LINEAR_LIGHT_MIX_ONE, &p_pens );
+  for ( l_index = 0; l_index < BC_DIGITS; l_index++ )
+  {
+    NumericFont::render( p_canvas, l_digit_x[l_index], 2, p_digits[l_index], p_white_pen );
+  }
+  return;
+}
+
+
+/*
+ * bc_scaled_by_pixel - the obvious way to draw a scaled glyph, with S*S
+ *                      pixels for every lit bit; only kept for the benchmark
+ *                      to measure NumericFont's span-based scaling against.
+ */
+
+template <uint_fast8_t S, class C>
+void bc_scaled_by_pixel( C &p_canvas, int p_x, int p_y, uint_fast8_t p_digit, typename C::pen_t p_pen )
+{
+  uint_fast8_t  l_column, l_row, l_dx, l_dy;
+
+  for ( l_column = 0; l_column < NUMERIC_FONT_WIDTH; l_column++ )
+  {
+    for ( l_row = 0; l_row < NUMERIC_FONT_HEIGHT; l_row++ )
     {
-      for ( l_y = 1; l_y < pimoroni::GalacticUnicorn::HEIGHT-1; l_y++ )
+      if ( g_numeric_font_columns[p_digit][l_column] & ( 1 << l_row ) )
       {
-        p_graphics->pixel( pimoroni::Point( l_x, l_y ) );
-        p_graphics->pixel( pimoroni::Point( pimoroni::GalacticUnicorn::WIDTH - l_x, l_y ) );
+        for ( l_dy = 0; l_dy < S; l_dy++ )
+        {
+          for ( l_dx = 0; l_dx < S; l_dx++ )
+          {
+            p_canvas.pixel( p_x + l_column * S + l_dx, p_y + l_row * S + l_dy, p_pen );
+          }
+        }
       }
     }
-    p_graphics->pixel( pimoroni::Point( pimoroni::GalacticUnicorn::WIDTH - l_x, 0 ) );
-    p_graphics->pixel( pimoroni::Point( pimoroni::GalacticUnicorn::WIDTH - l_x, pimoroni::GalacticUnicorn::HEIGHT-1 ) );
   }
+  return;
+}
 
-  /* All done. */
+
+/*
+ * bc_benchmark_scaled - times scaled glyphs (2x and 3x, still and rolling,
+ *                       and 3x the obvious way) onto a canvas two panels
+ *                       wide, as if for a wall.
+ */
+
+void bc_benchmark_scaled( void )
+{
+#ifdef UNICORN_INSTRUMENT
+  typedef Canvas<BC_WALL_WIDTH, BC_WALL_HEIGHT, CanvasRGB565> WallCanvas;
+
+  const uint8_t     l_digits[BC_DIGITS] = { 1, 2, 3, 4, 5, 6 };
+  uint16_t         *l_buffer = new uint16_t[BC_WALL_WIDTH * BC_WALL_HEIGHT];
+  WallCanvas        l_wall( l_buffer );
+  WallCanvas::pen_t l_pen = WallCanvas::create_pen( 255, 255, 255 );
+  uint64_t          l_2x_us, l_3x_us, l_pixels_us;
+  uint_fast16_t     l_frame;
+  uint_fast8_t      l_index;
+
+  BenchRun l_2x_run( "numeric_font", "render_2x" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    for ( l_index = 0; l_index < BC_DIGITS; l_index++ )
+    {
+      NumericFont::render_scaled<2>( l_wall, 2 + l_index * 10, 2, l_digits[l_index], l_pen );
+    }
+  }
+  l_2x_us = l_2x_run.end( BC_BENCHMARK_FRAMES * BC_DIGITS );
+
+  BenchRun l_3x_run( "numeric_font", "render_3x" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    for ( l_index = 0; l_index < BC_DIGITS; l_index++ )
+    {
+      NumericFont::render_scaled<3>( l_wall, 2 + l_index * 15, 0, l_digits[l_index], l_pen );
+    }
+  }
+  l_3x_us = l_3x_run.end( BC_BENCHMARK_FRAMES * BC_DIGITS );
+
+  BenchRun l_roll_run( "numeric_font", "roll_3x" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    for ( l_index = 0; l_index < BC_DIGITS; l_index++ )
+    {
+      NumericFont::roll_scaled<3>( l_wall, 2 + l_index * 15, 0, l_digits[l_index], ( l_digits[l_index] + 1 ) % 10,
+                                   l_frame % NUMERIC_FONT_ROLL_FRAMES, l_pen );
+    }
+  }
+  l_roll_run.end( BC_BENCHMARK_FRAMES * BC_DIGITS );
+
+  BenchRun l_pixels_run( "numeric_font", "render_3x_pixels" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    for ( l_index = 0; l_index < BC_DIGITS; l_index++ )
+    {
+      bc_scaled_by_pixel<3>( l_wall, 2 + l_index * 15, 0, l_digits[l_index], l_pen );
+    }
+  }
+  l_pixels_us = l_pixels_run.end( BC_BENCHMARK_FRAMES * BC_DIGITS );
+
+  printf( "better_clock: scaled glyphs, %.0f/s at 2x, %.0f/s at 3x (%.0f/s pixel by pixel)\n",
+          BC_BENCHMARK_FRAMES * BC_DIGITS * 1000000.0f / l_2x_us,
+          BC_BENCHMARK_FRAMES * BC_DIGITS * 1000000.0f / l_3x_us,
+          BC_BENCHMARK_FRAMES * BC_DIGITS * 1000000.0f / l_pixels_us );
+
+  delete[] l_buffer;
+#endif
   return;
 }
 
 
 /*
- * main - entry point, from which everything is controlled.
+ * bc_benchmark - draws the same frame through the generic PicoGraphics path
+ *                and the specialised canvas, checks they match, and times
+ *                both; then times the stages of the canvas frame (clear,
+ *                background and glyphs, rolling or not) on their own.
  */
 
-int main()
+void bc_benchmark( pimoroni::PicoGraphics_PenRGB565 *p_graphics )
 {
-  int                               l_black_pen, l_white_pen;
-  bool                              l_blink;
-  uint_fast8_t                      l_adjusted_brightness = 0, l_adjusted_timezone = 0;
-  float                             l_base_brightness;
-  uint64_t                          l_current_tick, l_dim_tick, l_ntp_tick;
-  uint_fast8_t                      l_index;
-  datetime_t                        l_time;
-  datetime_t                       *l_newtime;
-  int8_t                            l_timezone = 0;
-  pimoroni::GalacticUnicorn        *l_unicorn;
-  pimoroni::PicoGraphics_PenRGB565 *l_graphics;
+#ifdef UNICORN_INSTRUMENT
+  const uint8_t     l_digits[BC_DIGITS] = { 1, 2, 3, 4, 5, 6 };
+  UnicornCanvas     l_canvas( p_graphics->frame_buffer );
+  UnicornPicoCanvas l_generic( p_graphics );
+  uint16_t         *l_saved;
+  uint64_t          l_canvas_us, l_generic_us, l_gradient_us, l_hsv_us, l_uncached_us;
+  uint64_t          l_pico_cached_us, l_pico_uncached_us;
+  float             l_mix;
+  uint_fast16_t     l_frame;
+  uint_fast8_t      l_index;
+  bool              l_match;
+
+  /* The pen caches are a bit big for the stack. */
+  PenCache<UnicornCanvas>     *l_canvas_pens = new PenCache<UnicornCanvas>;
+  PenCache<UnicornPicoCanvas> *l_generic_pens = new PenCache<UnicornPicoCanvas>;
+
+  /* Same picture either way? */
+  l_saved = new uint16_t[pimoroni::GalacticUnicorn::WIDTH * pimoroni::GalacticUnicorn::HEIGHT];
+  bc_draw( l_generic, *l_generic_pens, l_digits, l_generic.create_pen( 0, 0, 0 ),
+           l_generic.create_pen( 255, 255, 255 ) );
+  memcpy( l_saved, p_graphics->frame_buffer, sizeof( uint16_t ) * pimoroni::GalacticUnicorn::WIDTH *
+                                             pimoroni::GalacticUnicorn::HEIGHT );
+  bc_draw( l_canvas, *l_canvas_pens, l_digits, l_canvas.create_pen( 0, 0, 0 ),
+           l_canvas.create_pen( 255, 255, 255 ) );
+  l_match = memcmp( l_saved, p_graphics->frame_buffer, sizeof( uint16_t ) * pimoroni::GalacticUnicorn::WIDTH *
+                                                       pimoroni::GalacticUnicorn::HEIGHT ) == 0;
+  delete[] l_saved;
+
+  /* And how long does each take? */
+  BenchRun l_generic_run( "better_clock", "frame_picographics" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    bc_draw( l_generic, *l_generic_pens, l_digits, l_generic.create_pen( 0, 0, 0 ),
+             l_generic.create_pen( 255, 255, 255 ) );
+  }
+  l_generic_us = l_generic_run.end( BC_BENCHMARK_FRAMES );
+
+  BenchRun l_canvas_run( "better_clock", "frame_canvas" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    bc_draw( l_canvas, *l_canvas_pens, l_digits, l_canvas.create_pen( 0, 0, 0 ),
+             l_canvas.create_pen( 255, 255, 255 ) );
+  }
+  l_canvas_us = l_canvas_run.end( BC_BENCHMARK_FRAMES );
+
+  printf( "better_clock: frame via PicoGraphics %lluus, via canvas %lluus (x%.2f), output %s\n",
+          l_generic_us / BC_BENCHMARK_FRAMES, l_canvas_us / BC_BENCHMARK_FRAMES,
+          (float)l_generic_us / l_canvas_us, l_match ? "matches" : "DIFFERS" );
+
+  /* The stages of the canvas frame, one at a time. */
+  BenchRun l_clear_run( "better_clock", "clear" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    l_canvas.fill( l_canvas.create_pen( 0, 0, 0 ) );
+  }
+  l_clear_run.end( BC_BENCHMARK_FRAMES );
 
   /*
-   * First thing to do is to create the Unicorn and Graphics objects. Pimoroni
-   * examples do this in variable declarations but I prefer it split out.
+   * The background, blended in linear light and (as it was) in HSV; the mix
+   * moves on every few frames, as (more slowly) it does through the day.
    */
-  l_unicorn = new pimoroni::GalacticUnicorn();
-  l_graphics = new pimoroni::PicoGraphics_PenRGB565( pimoroni::GalacticUnicorn::WIDTH,
-                                                     pimoroni::GalacticUnicorn::HEIGHT,
-                                                     nullptr );
-
-  /* Next up, we need to intialise both the Pico and the Unicorn. */
-  stdio_init_all();
-  l_unicorn->init();
-  l_blink = true;
-  l_base_brightness = 0.5f;
-
-  /* Set up some standard pens we will always need. */
-  l_black_pen = l_graphics->create_pen( 0, 0, 0 );
-  l_white_pen = l_graphics->create_pen( 255, 255, 255 );
-
-  /* Need to initialise the RTC, which appears not to actually run until set. */
-  rtc_init();
-  l_time.year = 2023;
-  l_time.month = 1;
-  l_time.day = 1;
-  l_time.dotw = 0;
-  l_time.hour = l_time.min = l_time.sec = 0;
-  rtc_set_datetime( &l_time );
-
-  /* Lastly, we need to initialise our random number generator and other bits. */
-  l_dim_tick = l_ntp_tick = 0;
-  l_current_tick = time_us_64();
-  srand( l_current_tick );
+  BenchRun l_gradient_run( "better_clock", "gradient_background" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    gradient_background( l_canvas, g_gradient, ( l_frame / 8 ) % ( LINEAR_LIGHT_MIX_ONE + 1 ), l_canvas_pens );
+  }
+  l_gradient_us = l_gradient_run.end( BC_BENCHMARK_FRAMES );
 
   /*
-   * All set up, so now we enter effectively an infinite loop.
+   * And without the pen cache; on the canvas, making a pen is only a few
+   * shifts, so it's through PicoGraphics that the cache should really earn
+   * its keep.
    */
-  while( true )
+  BenchRun l_uncached_run( "better_clock", "gradient_uncached" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
   {
-    /*
-     * Update.
-     */
+    gradient_background<UnicornCanvas>( l_canvas, g_gradient, ( l_frame / 8 ) % ( LINEAR_LIGHT_MIX_ONE + 1 ), nullptr );
+  }
+  l_uncached_us = l_uncached_run.end( BC_BENCHMARK_FRAMES );
+
+  BenchRun l_generic_cached_run( "better_clock", "gradient_picographics" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    gradient_background( l_generic, g_gradient, ( l_frame / 8 ) % ( LINEAR_LIGHT_MIX_ONE + 1 ), l_generic_pens );
+  }
+  l_pico_cached_us = l_generic_cached_run.end( BC_BENCHMARK_FRAMES );
+
+  BenchRun l_generic_uncached_run( "better_clock", "gradient_picographics_uncached" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    gradient_background<UnicornPicoCanvas>( l_generic, g_gradient, ( l_frame / 8 ) % ( LINEAR_LIGHT_MIX_ONE + 1 ),
+                                            nullptr );
+  }
+  l_pico_uncached_us = l_generic_uncached_run.end( BC_BENCHMARK_FRAMES );
+
+  printf( "better_clock: background with pen cache %lluus, without %lluus; "
+          "through PicoGraphics %lluus, without %lluus\n",
+          l_gradient_us / BC_BENCHMARK_FRAMES, l_uncached_us / BC_BENCHMARK_FRAMES,
+          l_pico_cached_us / BC_BENCHMARK_FRAMES, l_pico_uncached_us / BC_BENCHMARK_FRAMES );
+
+  BenchRun l_hsv_run( "better_clock", "gradient_hsv" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    l_mix = ( ( l_frame / 8 ) % ( LINEAR_LIGHT_MIX_ONE + 1 ) ) / (float)LINEAR_LIGHT_MIX_ONE;
+    gradient_background_hsv( l_canvas, ( ( MIDDAY_HUE - MIDNIGHT_HUE ) * l_mix ) + MIDNIGHT_HUE,
+                             ( ( MIDDAY_SATURATION - MIDNIGHT_SATURATION ) * l_mix ) + MIDNIGHT_SATURATION,
+                             ( ( MIDDAY_VALUE - MIDNIGHT_VALUE ) * l_mix ) + MIDNIGHT_VALUE );
+  }
+  l_hsv_us = l_hsv_run.end( BC_BENCHMARK_FRAMES );
 
-    /* Check the time - this is seconds since boot, not 'real' time. */
-    l_current_tick = time_us_64();
+  printf( "better_clock: background in linear light %lluus, in HSV %lluus (x%.2f)\n",
+          l_uncached_us / BC_BENCHMARK_FRAMES, l_hsv_us / BC_BENCHMARK_FRAMES, (float)l_hsv_us / l_uncached_us );
 
-    /* Should we check the ambient light? */
-    if ( ( l_current_tick < BC_USECS_IN_SEC ) ||
-         ( l_current_tick > ( l_dim_tick + ( BC_DIM_FREQUENCY_SECS*BC_USECS_IN_SEC ) ) ) )
+  /* Glyphs are counted one at a time, as that's what NumericFont draws. */
+  BenchRun l_render_run( "numeric_font", "render" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    for ( l_index = 0; l_index < BC_DIGITS; l_index++ )
     {
-      dimmer( l_unicorn, l_base_brightness );
-      l_dim_tick = l_current_tick;
+      NumericFont::render( l_canvas, 10 + l_index * 5, 2, l_digits[l_index], l_canvas.create_pen( 255, 255, 255 ) );
     }
+  }
+  l_render_run.end( BC_BENCHMARK_FRAMES * BC_DIGITS );
 
-    /* And the clock? */
-    if ( ( l_ntp_tick == 0 ) ||
-         ( l_current_tick > ( l_ntp_tick + ( BC_NTP_FREQUENCY_SECS*BC_USECS_IN_SEC ) ) ) )
+  BenchRun l_roll_run( "numeric_font", "roll" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    for ( l_index = 0; l_index < BC_DIGITS; l_index++ )
     {
-      /* If we succeed, we're done until the next check. */
-      if ( checktime( l_timezone ) )
-      {
-        l_ntp_tick = l_current_tick;
-      }
+      NumericFont::roll( l_canvas, 10 + l_index * 5, 2, l_digits[l_index], ( l_digits[l_index] + 1 ) % 10,
+                         l_frame % NUMERIC_FONT_ROLL_FRAMES, l_canvas.create_pen( 255, 255, 255 ) );
     }
+  }
+  l_roll_run.end( BC_BENCHMARK_FRAMES * BC_DIGITS );
+
+  BenchRun l_clipped_run( "numeric_font", "render_clipped" );
+  for ( l_frame = 0; l_frame < BC_BENCHMARK_FRAMES; l_frame++ )
+  {
+    for ( l_index = 0; l_index < BC_DIGITS; l_index++ )
+    {
+      NumericFont::render( l_canvas, UnicornCanvas::WIDTH - 2, 2 + l_index, l_digits[l_index],
+                           l_canvas.create_pen( 255, 255, 255 ) );
+    }
+  }
+  l_clipped_run.end( BC_BENCHMARK_FRAMES * BC_DIGITS );
 
+  /* Scaled up, as for a wall of panels; the clock at 3x spans two. */
+  bc_benchmark_scaled();
+
+  delete l_canvas_pens;
+  delete l_generic_pens;
+#endif
+  return;
+}
+
+
+/*
+ * BetterClock - the clock itself, as an app; everything it needs to remember
+ *               from one frame to the next lives in here.
+ */
+
+class BetterClock : public UnicornApp
+{
+  private:
+    UnicornCanvas::pen_t  m_black_pen, m_white_pen;
+    PenCache<UnicornCanvas> m_pens;
+    alignas( 4 ) UnicornCanvas::pen_t m_background[BC_FRAME_PIXELS];
+    uint_fast16_t   m_background_mix;
+    bool            m_ntp_busy, m_second_locked, m_rolling;
+    float           m_base_brightness;
+    uint64_t        m_current_tick, m_dim_tick, m_ntp_tick, m_input_tick;
+    uint64_t        m_brightness_until, m_timezone_until, m_second_tick;
+    uint64_t        m_roll_tick, m_lock_utc, m_rtc_tick;
+    uint32_t        m_rtc_seconds, m_frame_start;
+    bool            m_rtc_pending, m_window_flushed;
+    int_fast8_t     m_last_second;
+    uint_fast8_t    m_idle_fps;
+    uint_fast8_t    m_roll_frame;
+    uint8_t         m_shown[BC_DIGITS];
+    uint8_t         m_roll_from[BC_DIGITS];
+    datetime_t      m_time;
+    int8_t          m_timezone;
+    TemporalDither  m_dither;
+    FleetTime       m_fleet;
+    SntpServer      m_sntp;
+    NightBlank      m_night;
 
     /*
-     * User Input.
+     * update_fleet - in a fleet, only the leader talks NTP, and hands on the
+     *                time it gets to the fleet; followers take theirs from it.
+     *                Loading the RTC restarts its one second divider, so the
+     *                seconds tick from wherever we load it.
      */
-
-    /* First up, brightness - controlled by the Unicorn's LUX buttons. */
-    if ( l_unicorn->is_pressed( pimoroni::GalacticUnicorn::SWITCH_BRIGHTNESS_UP ) )
+    void update_fleet( void )
     {
-      if ( ( l_base_brightness += 0.1f ) > 1.0f )
+      InstrumentScope l_scope( BC_STAGE_NETWORK );
+      datetime_t      l_rtctime;
+      uint64_t        l_tick, l_utc;
+
+      /* Followers set the RTC right on the start of the leader's next second. */
+      if ( m_fleet.poll( m_current_tick ) )
       {
-        l_base_brightness = 1.0f;
+        m_fleet.sample( &l_tick, &l_utc );
+        l_utc += m_current_tick - l_tick;
+        m_rtc_seconds = l_utc / BC_USECS_IN_SEC + 1;
+        m_rtc_tick = m_current_tick + BC_USECS_IN_SEC - ( l_utc % BC_USECS_IN_SEC );
+        m_rtc_pending = true;
       }
-      dimmer( l_unicorn, l_base_brightness );
-      l_adjusted_brightness = 4;
-    }
-    if ( l_unicorn->is_pressed( pimoroni::GalacticUnicorn::SWITCH_BRIGHTNESS_DOWN ) )
-    {
-      if ( ( l_base_brightness -= 0.1f ) < 0.1f )
+      if ( m_rtc_pending && ( m_current_tick >= m_rtc_tick ) )
       {
-        l_base_brightness = 0.1f;
+        rtc_set_datetime( ntp_apply_timezone( m_rtc_seconds + ( m_current_tick - m_rtc_tick ) / BC_USECS_IN_SEC,
+                                              m_timezone ) );
+        m_rtc_pending = false;
+        m_second_tick = m_current_tick;
+        m_second_locked = true;
+        sleep_us( 64 );
       }
-      dimmer( l_unicorn, l_base_brightness );
-      l_adjusted_brightness = 4;
-    }
 
-    /* Next, adjusting the timezone using the volume buttons (like clock.py) */
-    if ( l_unicorn->is_pressed( pimoroni::GalacticUnicorn::SWITCH_VOLUME_UP ) )
-    {
-      if ( l_timezone < 14 )
+      /*
+       * A follower only has the radio up for its windows, and never syncs
+       * itself; so its telemetry goes at the start of each, while it waits
+       * for a beacon. The leader's goes with its NTP syncs, as ever.
+       */
+      if ( m_fleet.busy() && m_fleet.link_up() )
+      {
+        if ( !m_window_flushed )
+        {
+          g_telemetry.flush();
+          m_window_flushed = true;
+        }
+      }
+      else
       {
-        /* Increment the timezone, and add that hour to the RTC. */
-        l_adjusted_timezone = 4;
-        l_timezone++;
-        rtc_get_datetime( &l_time );
-        l_newtime = rtc_add_hours( &l_time, 1 );
-        rtc_set_datetime( l_newtime );
+        m_window_flushed = false;
+      }
+      m_ntp_busy = m_fleet.busy() || m_rtc_pending;
 
-        /* Need to wait for the RTC to actually update. */
-        sleep_us( 64 );
+      if ( !m_fleet.leading() )
+      {
+        m_ntp_tick = 0;
+        return;
       }
+
+      /* The leader syncs just as a lone clock would, but over the fleet's link. */
+      if ( m_fleet.link_up() &&
+           ( ( m_ntp_tick == 0 ) ||
+             ( m_current_tick > ( m_ntp_tick + ( BC_NTP_FREQUENCY_SECS*BC_USECS_IN_SEC ) ) ) ) )
+      {
+        if ( checktime( m_timezone, false ) )
+        {
+          m_ntp_tick = m_second_tick = m_current_tick;
+          m_second_locked = true;
+          sleep_us( 64 );
+          rtc_get_datetime( &l_rtctime );
+          m_lock_utc = rtc_to_ntp( &l_rtctime, m_timezone ) * BC_USECS_IN_SEC;
+        }
+        else
+        {
+          m_ntp_busy = true;
+        }
+      }
+
+      /* Once it's synced and knows where its second starts, it speaks for the time. */
+      if ( ( m_ntp_tick != 0 ) && m_second_locked )
+      {
+        m_fleet.lead( m_second_tick, m_lock_utc );
+      }
+      return;
     }
-    if ( l_unicorn->is_pressed( pimoroni::GalacticUnicorn::SWITCH_VOLUME_DOWN ) )
+
+    /*
+     * update_sntp - serves our time on to the LAN, whenever we have the link
+     *               up and are sure of the time; in a fleet, only the leader
+     *               does, as the others have their radios off.
+     */
+    void update_sntp( void )
     {
-      if ( l_timezone > -12 )
+      bool  l_link_up;
+
+#if BC_FLEET
+      l_link_up = m_fleet.leading() && m_fleet.link_up();
+#else
+      l_link_up = cyw43_tcpip_link_status( &cyw43_state, CYW43_ITF_STA ) == CYW43_LINK_UP;
+
+      /* Losing the link we kept up means syncing again, to bring it back. */
+      if ( !l_link_up && !m_ntp_busy && ( m_ntp_tick != 0 ) )
       {
-        /* Increment the timezone, and add that hour to the RTC. */
-        l_adjusted_timezone = 4;
-        l_timezone--;
-        rtc_get_datetime( &l_time );
-        l_newtime = rtc_add_hours( &l_time, -1 );
-        rtc_set_datetime( l_newtime );
+        m_ntp_tick = 0;
+      }
+#endif
+      m_sntp.poll( m_current_tick, l_link_up );
 
-        /* Need to wait for the RTC to actually update. */
-        sleep_us( 64 );
+      if ( ( m_ntp_tick != 0 ) && m_second_locked )
+      {
+        m_sntp.serve( m_second_tick, m_lock_utc, m_ntp_tick, g_ntp_source.stratum, &g_ntp_source.server );
       }
+      return;
     }
 
     /*
-     * Render.
+     * cmd_* - console commands (see console.hpp); they only change settings,
+     *         and leave any actual work to the next update.
      */
+    static bool cmd_brightness( void *p_clock, uint_fast8_t p_argc, char *p_argv[] )
+    {
+      BetterClock *l_clock = (BetterClock *)p_clock;
+      float        l_brightness;
 
-    /* Start the frame by clearing the screen. */
-    l_graphics->set_pen( l_black_pen );
-    l_graphics->clear();
+      if ( p_argc > 1 )
+      {
+        l_brightness = strtof( p_argv[1], nullptr );
+        if ( ( l_brightness < 0.1f ) || ( l_brightness > 1.0f ) )
+        {
+          return false;
+        }
+        l_clock->m_base_brightness = l_brightness;
+        l_clock->m_dim_tick = 0;
+        l_clock->m_brightness_until = time_us_64() + BC_ADJUST_USECS;
+      }
+      printf( "brightness %.1f\n", l_clock->m_base_brightness );
+      return true;
+    }
 
-    /* Render the background gradient, based on the time of day. */
-    rtc_get_datetime( &l_time );
+    static bool cmd_timezone( void *p_clock, uint_fast8_t p_argc, char *p_argv[] )
+    {
+      BetterClock *l_clock = (BetterClock *)p_clock;
+      long         l_timezone;
 
-    uint_fast16_t l_daysecs;
-    float         l_daypcnt, l_midpcnt;
-    float         l_hue, l_sat, l_val;
+      if ( p_argc > 1 )
+      {
+        l_timezone = strtol( p_argv[1], nullptr, 10 );
+        if ( ( l_timezone < -12 ) || ( l_timezone > 14 ) )
+        {
+          return false;
+        }
 
-    l_daysecs = ( ( ( l_time.hour * 60 ) + l_time.min ) * 60 ) + l_time.sec;
-    l_daypcnt = l_daysecs / 86400.0f;
-    l_midpcnt = 1.0f - ( ( cos( l_daypcnt * 3.14159 * 2 ) + 1 ) / 2 );
-    printf( "Daysecs %d, daypercent %f, percent to midday = %f\n", l_daysecs, l_daypcnt, l_midpcnt );
+        /* Just as with the buttons, the RTC moves with the timezone. */
+        rtc_get_datetime( &l_clock->m_time );
+        rtc_set_datetime( rtc_add_hours( &l_clock->m_time, l_timezone - l_clock->m_timezone ) );
+        l_clock->m_timezone = l_timezone;
+        l_clock->m_second_locked = false;
+        l_clock->m_timezone_until = time_us_64() + BC_ADJUST_USECS;
+        sleep_us( 64 );
+      }
+      printf( "timezone UTC%+d\n", (int)l_clock->m_timezone );
+      return true;
+    }
 
-    l_hue = ((MIDDAY_HUE - MIDNIGHT_HUE) * l_midpcnt) + MIDNIGHT_HUE;
-    l_sat = ((MIDDAY_SATURATION - MIDNIGHT_SATURATION) * l_midpcnt) + MIDNIGHT_SATURATION;
-    l_val = ((MIDDAY_VALUE - MIDNIGHT_VALUE) * l_midpcnt) + MIDNIGHT_VALUE;
+    static bool cmd_ntp( void *p_clock, uint_fast8_t p_argc, char *p_argv[] )
+    {
+      BetterClock *l_clock = (BetterClock *)p_clock;
 
-    gradient_background( l_graphics, l_hue, l_sat, l_val );
+      if ( p_argc > 1 )
+      {
+        if ( strlen( p_argv[1] ) >= NTP_SERVER_MAX )
+        {
+          return false;
+        }
+        strcpy( g_ntp_server, p_argv[1] );
+      }
 
-    /* And finally switch back to white. */
-    l_graphics->set_pen( l_white_pen );
+      /* Either way, sync again now (which a fleet follower leaves to its leader). */
+      l_clock->m_ntp_tick = 0;
+      printf( "syncing with %s\n", g_ntp_server );
+      return true;
+    }
 
-    /* If we're adjusting timezones, just display that. */
-    if ( l_adjusted_timezone > 0 )
+    static bool cmd_night( void *p_clock, uint_fast8_t p_argc, char *p_argv[] )
     {
-      l_adjusted_timezone--;
+      BetterClock *l_clock = (BetterClock *)p_clock;
+
+      if ( !BC_NIGHT_BLANK )
+      {
+        printf( "night blanking not built in (see BC_NIGHT_BLANK)\n" );
+        return true;
+      }
+      if ( ( p_argc > 1 ) && ( strcmp( p_argv[1], "now" ) == 0 ) )
+      {
+        l_clock->m_night.force();
+        return true;
+      }
+      l_clock->m_night.report();
+      return p_argc < 2;
+    }
 
-      /* "UTC" */
-      NumericFont::render( l_graphics, 10, 2, 10 );
-      NumericFont::render( l_graphics, 15, 2, 11 );
-      NumericFont::render( l_graphics, 20, 2, 12 );
+    static bool cmd_fps( void *p_clock, uint_fast8_t p_argc, char *p_argv[] )
+    {
+      BetterClock *l_clock = (BetterClock *)p_clock;
+      long         l_fps;
 
-      /* Sign. */
-      if ( l_timezone > 0 )
+      if ( p_argc > 1 )
       {
-        NumericFont::render( l_graphics, 25, 2, 13 );
+        l_fps = strtol( p_argv[1], nullptr, 10 );
+        if ( ( l_fps < 0 ) || ( l_fps > BC_DITHER_FPS ) )
+        {
+          return false;
+        }
+        l_clock->m_idle_fps = l_fps;
       }
-      else if ( l_timezone < 0 )
+      if ( l_clock->m_idle_fps == 0 )
       {
-        NumericFont::render( l_graphics, 25, 2, 14 );
+        printf( "refreshing twice a second, with the separators\n" );
       }
       else
       {
-        NumericFont::render( l_graphics, 25, 2, 15 );
+        printf( "refreshing at %dfps\n", (int)l_clock->m_idle_fps );
       }
+      return true;
+    }
 
-      /* And the timezone. */
-      NumericFont::render( l_graphics, 30, 2, abs(l_timezone)/10 );
-      NumericFont::render( l_graphics, 35, 2, abs(l_timezone)%10 );      
+    static inline const consolecommand_t m_commands[] = {
+      { "brightness", "[0.1-1.0]",  cmd_brightness },
+      { "timezone",   "[-12-14]",   cmd_timezone },
+      { "ntp",        "[server]",   cmd_ntp },
+      { "fps",        "[0-60, 0 for twice a second]", cmd_fps },
+      { "night",      "[now]",      cmd_night },
+      { nullptr, nullptr, nullptr }
+    };
+
+  public:
+    void init( appcontext_t *p_context )
+    {
+      m_base_brightness = 0.5f;
+      m_timezone = 0;
+
+      /* Set up some standard pens we will always need. */
+      m_black_pen = UnicornCanvas::create_pen( 0, 0, 0 );
+      m_white_pen = UnicornCanvas::create_pen( 255, 255, 255 );
+
+      /* Need to initialise the RTC, which appears not to actually run until set. */
+      rtc_init();
+      m_time.year = 2023;
+      m_time.month = 1;
+      m_time.day = 1;
+      m_time.dotw = 0;
+      m_time.hour = m_time.min = m_time.sec = 0;
+      rtc_set_datetime( &m_time );
+
+      /* The background's colours at either end of the day. */
+      bc_gradient_init( &g_gradient );
+
+      /* When instrumented, see what the canvas buys us over PicoGraphics. */
+      bc_benchmark( p_context->graphics );
+
+      /* Without a collector, telemetry just sits there doing nothing. */
+      g_telemetry.init( g_metrics, BC_METRICS, BC_TELEMETRY_HOST, BC_TELEMETRY_PORT );
+
+      /* Night blanking is always there for the console, if not built in. */
+      m_night.init( BC_NIGHT_FROM, BC_NIGHT_UNTIL, BC_NIGHT_DARK );
+
+      /* Our place in the fleet is decided by the unit ID. */
+      m_fleet.init();
+      m_sntp.init();
+
+      /* Lastly, we need to initialise our random number generator and other bits. */
+      m_dim_tick = m_ntp_tick = m_input_tick = 0;
+      m_brightness_until = m_timezone_until = m_second_tick = 0;
+      m_second_locked = false;
+      m_last_second = -1;
+      m_idle_fps = 0;
+      m_roll_tick = 0;
+      m_rolling = false;
+      m_rtc_pending = m_window_flushed = false;
+      m_background_mix = BC_NO_MIX;
+      memset( m_shown, 0xff, sizeof( m_shown ) );
+      m_current_tick = time_us_64();
+      srand( m_current_tick );
+      return;
     }
-    else
+
+    void resume( appcontext_t *p_context )
     {
-      /* Otherwise, render the current time, in hours minutes and seconds. */
+      /* If we're dithering, we apply brightness so the Unicorn runs flat out. */
+#if BC_DITHER
+      p_context->unicorn->set_brightness( 1.0f );
+#endif
+
+      /* Brightness may have been changed while we were away. */
+      m_dim_tick = 0;
+
+      /* Name our instrumentation stages, for reporting. */
+      Instrument::name_stage( BC_STAGE_UPDATE, "update" );
+      Instrument::name_stage( BC_STAGE_RENDER, "render" );
+      Instrument::name_stage( BC_STAGE_PRESENT, "present" );
+      Instrument::name_stage( BC_STAGE_NETWORK, "network" );
+      return;
+    }
+
+    void update( appcontext_t *p_context )
+    {
+      pimoroni::GalacticUnicorn *l_unicorn = p_context->unicorn;
+      bool                       l_input_ready;
+      uint32_t                   l_stage_tick;
+      uint8_t                    l_digits[BC_DIGITS];
+      datetime_t                *l_newtime;
+
+#if BC_NIGHT_BLANK
+      /* With nobody about, and the radio off, we may as well sleep a while. */
+      rtc_get_datetime( &m_time );
+      if ( ( m_ntp_tick != 0 ) && !m_ntp_busy && m_night.due( &m_time, time_us_64() ) )
+      {
+        m_night.sleep( l_unicorn, &m_time );
+
+        /* Then straight back to it; the button that woke us isn't input. */
+        m_dim_tick = 0;
+        m_second_locked = false;
+        m_input_tick = time_us_64();
+      }
+#endif
+
+      /* Check the time - this is seconds since boot, not 'real' time. */
+      m_current_tick = time_us_64();
+      m_frame_start = time_us_32();
+      l_stage_tick = Instrument::start( BC_STAGE_UPDATE );
 
-      /* Hours first. */
-      NumericFont::render( l_graphics, 10, 2, l_time.hour/10 );
-      NumericFont::render( l_graphics, 15, 2, l_time.hour%10 );
+      /* Last frame's background is the likeliest start; the DMA puts it back. */
+      DmaSurface::copy_async( p_context->graphics->frame_buffer, m_background, sizeof( m_background ) );
 
-      /* Then minutes. */
-      NumericFont::render( l_graphics, 22, 2, l_time.min/10 );
-      NumericFont::render( l_graphics, 27, 2, l_time.min%10 );
+      /* Should we check the ambient light? */
+      if ( ( m_dim_tick == 0 ) || ( m_current_tick < BC_USECS_IN_SEC ) ||
+           ( m_current_tick > ( m_dim_tick + ( BC_DIM_FREQUENCY_SECS*BC_USECS_IN_SEC ) ) ) )
+      {
+        dimmer( l_unicorn, &m_dither, m_base_brightness );
+        m_night.observe( l_unicorn->light(), m_current_tick );
+        m_dim_tick = m_current_tick;
+      }
+
+      /* And the clock? */
+      m_ntp_busy = false;
+#if BC_FLEET
+      update_fleet();
+#else
+      if ( ( m_ntp_tick == 0 ) ||
+           ( m_current_tick > ( m_ntp_tick + ( BC_NTP_FREQUENCY_SECS*BC_USECS_IN_SEC ) ) ) )
+      {
+        /* Network stalls are the likeliest hang, so they get their own stage. */
+        InstrumentScope l_scope( BC_STAGE_NETWORK );
+
+        /* If we succeed, we're done until the next check. */
+        if ( checktime( m_timezone ) )
+        {
+          m_ntp_tick = m_current_tick;
+          m_second_locked = false;
+        }
+        else
+        {
+          m_ntp_busy = true;
+        }
+      }
+#endif
+#if BC_SNTP_SERVER
+      update_sntp();
+#endif
+
+
+      /*
+       * User Input.
+       */
+
+      /* Buttons are read as held, so don't let them repeat at our frame rate. */
+      l_input_ready = ( m_current_tick > ( m_input_tick + BC_INPUT_REPEAT_USECS ) );
+
+      /* First up, brightness - controlled by the Unicorn's LUX buttons. */
+      if ( l_input_ready && l_unicorn->is_pressed( pimoroni::GalacticUnicorn::SWITCH_BRIGHTNESS_UP ) )
+      {
+        if ( ( m_base_brightness += 0.1f ) > 1.0f )
+        {
+          m_base_brightness = 1.0f;
+        }
+        dimmer( l_unicorn, &m_dither, m_base_brightness );
+        m_brightness_until = m_current_tick + BC_ADJUST_USECS;
+        m_input_tick = m_current_tick;
+      }
+      if ( l_input_ready && l_unicorn->is_pressed( pimoroni::GalacticUnicorn::SWITCH_BRIGHTNESS_DOWN ) )
+      {
+        if ( ( m_base_brightness -= 0.1f ) < 0.1f )
+        {
+          m_base_brightness = 0.1f;
+        }
+        dimmer( l_unicorn, &m_dither, m_base_brightness );
+        m_brightness_until = m_current_tick + BC_ADJUST_USECS;
+        m_input_tick = m_current_tick;
+      }
+
+      /* Next, adjusting the timezone using the volume buttons (like clock.py) */
+      if ( l_input_ready && l_unicorn->is_pressed( pimoroni::GalacticUnicorn::SWITCH_VOLUME_UP ) )
+      {
+        if ( m_timezone < 14 )
+        {
+          /* Increment the timezone, and add that hour to the RTC. */
+          m_timezone_until = m_current_tick + BC_ADJUST_USECS;
+          m_input_tick = m_current_tick;
+          m_timezone++;
+          rtc_get_datetime( &m_time );
+          l_newtime = rtc_add_hours( &m_time, 1 );
+          rtc_set_datetime( l_newtime );
+          m_second_locked = false;
+
+          /* Need to wait for the RTC to actually update. */
+          sleep_us( 64 );
+        }
+      }
+      if ( l_input_ready && l_unicorn->is_pressed( pimoroni::GalacticUnicorn::SWITCH_VOLUME_DOWN ) )
+      {
+        if ( m_timezone > -12 )
+        {
+          /* Increment the timezone, and add that hour to the RTC. */
+          m_timezone_until = m_current_tick + BC_ADJUST_USECS;
+          m_input_tick = m_current_tick;
+          m_timezone--;
+          rtc_get_datetime( &m_time );
+          l_newtime = rtc_add_hours( &m_time, -1 );
+          rtc_set_datetime( l_newtime );
+          m_second_locked = false;
+
+          /* Need to wait for the RTC to actually update. */
+          sleep_us( 64 );
+        }
+      }
 
-      /* And lastly seconds. */
-      NumericFont::render( l_graphics, 34, 2, l_time.sec/10 );
-      NumericFont::render( l_graphics, 39, 2, l_time.sec%10 );
+      /* Fetch the time we're about to show. */
+      rtc_get_datetime( &m_time );
 
-      /* Blinking separators next. */
-      if ( l_blink )
+      /*
+       * The RTC doesn't tell us where we are within a second, so to line frames
+       * up with it we watch for the seconds changing (polling quickly until we
+       * have) and remember when that happened.
+       */
+      if ( m_time.sec != m_last_second )
       {
-        l_graphics->pixel( pimoroni::Point( 20, 4 ) );
-        l_graphics->pixel( pimoroni::Point( 20, 6 ) );
+        if ( !m_second_locked && m_last_second >= 0 )
+        {
+          m_second_tick = m_current_tick;
+          m_second_locked = true;
+          m_lock_utc = rtc_to_ntp( &m_time, m_timezone ) * BC_USECS_IN_SEC;
+        }
+        m_last_second = m_time.sec;
+      }
 
-        l_graphics->pixel( pimoroni::Point( 32, 4 ) );
-        l_graphics->pixel( pimoroni::Point( 32, 6 ) );
+      /*
+       * Any digits which have changed roll into place over the next few frames;
+       * the ones which haven't just roll from themselves, which is a no-op.
+       */
+      l_digits[0] = m_time.hour / 10;
+      l_digits[1] = m_time.hour % 10;
+      l_digits[2] = m_time.min / 10;
+      l_digits[3] = m_time.min % 10;
+      l_digits[4] = m_time.sec / 10;
+      l_digits[5] = m_time.sec % 10;
+      if ( memcmp( l_digits, m_shown, sizeof( l_digits ) ) != 0 )
+      {
+        memcpy( m_roll_from, m_shown, sizeof( m_roll_from ) );
+        memcpy( m_shown, l_digits, sizeof( m_shown ) );
+        m_roll_tick = m_current_tick;
       }
-      l_blink = !l_blink;
+      m_rolling = ( m_current_tick - m_roll_tick ) <
+                  ( NUMERIC_FONT_ROLL_FRAMES * BC_USECS_IN_SEC / BC_ROLL_FPS );
+      m_roll_frame = m_rolling ? ( ( m_current_tick - m_roll_tick ) * BC_ROLL_FPS ) / BC_USECS_IN_SEC
+                               : NUMERIC_FONT_ROLL_FRAMES;
+
+      Instrument::record( BC_STAGE_UPDATE, time_us_32() - l_stage_tick );
+      return;
     }
 
-    /* If the brightness was adjusted, show the sliding scale on the right. */
-    if ( l_adjusted_brightness > 0 )
+    void render( appcontext_t *p_context )
     {
-      for ( l_index = 0; l_index < pimoroni::GalacticUnicorn::HEIGHT; l_index++ )
+      pimoroni::PicoGraphics_PenRGB565 *l_graphics = p_context->graphics;
+      UnicornCanvas                     l_canvas( l_graphics->frame_buffer );
+      const uint8_t                     l_digit_x[BC_DIGITS] = { 10, 15, 22, 27, 34, 39 };
+      uint32_t                          l_stage_tick;
+      uint_fast8_t                      l_index;
+      uint_fast16_t                     l_daysecs, l_mix;
+      float                             l_daypcnt, l_midpcnt;
+
+      l_stage_tick = Instrument::start( BC_STAGE_RENDER );
+
+      /* The frame starts as the background the DMA's copied in, once it has. */
+      DmaSurface::wait();
+
+      /* The background gradient is based on the time of day. */
+      l_daysecs = ( ( ( m_time.hour * 60 ) + m_time.min ) * 60 ) + m_time.sec;
+      l_daypcnt = l_daysecs / 86400.0f;
+      l_midpcnt = 1.0f - ( ( cos( l_daypcnt * 3.14159 * 2 ) + 1 ) / 2 );
+
+      /* Which only moves every few minutes; only then is it redrawn. */
+      l_mix = l_midpcnt * LINEAR_LIGHT_MIX_ONE;
+      if ( l_mix != m_background_mix )
       {
-        if ( l_index <= ( l_base_brightness * pimoroni::GalacticUnicorn::HEIGHT ) )
+        UnicornCanvas l_background( m_background );
+
+        l_background.fill( m_black_pen );
+        gradient_background( l_background, g_gradient, l_mix, &m_pens );
+        memcpy( l_graphics->frame_buffer, m_background, sizeof( m_background ) );
+        m_background_mix = l_mix;
+      }
+
+      /* If we're adjusting timezones, just display that. */
+      if ( m_current_tick < m_timezone_until )
+      {
+        /* "UTC" */
+        NumericFont::render<10, 2>( l_canvas, 10, m_white_pen );
+        NumericFont::render<15, 2>( l_canvas, 11, m_white_pen );
+        NumericFont::render<20, 2>( l_canvas, 12, m_white_pen );
+
+        /* Sign. */
+        if ( m_timezone > 0 )
+        {
+          NumericFont::render<25, 2>( l_canvas, 13, m_white_pen );
+        }
+        else if ( m_timezone < 0 )
+        {
+          NumericFont::render<25, 2>( l_canvas, 14, m_white_pen );
+        }
+        else
         {
-          l_graphics->pixel( pimoroni::Point( 
-                              pimoroni::GalacticUnicorn::WIDTH - 1,
-                              pimoroni::GalacticUnicorn::HEIGHT - l_index - 1
-                            ) );
+          NumericFont::render<25, 2>( l_canvas, 15, m_white_pen );
         }
+
+        /* And the timezone. */
+        NumericFont::render<30, 2>( l_canvas, abs(m_timezone)/10, m_white_pen );
+        NumericFont::render<35, 2>( l_canvas, abs(m_timezone)%10, m_white_pen );
       }
-      l_adjusted_brightness--;
+      else
+      {
+        /* Otherwise, render the current time, in hours minutes and seconds. */
+        for ( l_index = 0; l_index < BC_DIGITS; l_index++ )
+        {
+          NumericFont::roll( l_canvas, l_digit_x[l_index], 2,
+                             m_roll_from[l_index], m_shown[l_index], m_roll_frame, m_white_pen );
+        }
+
+        /* Blinking separators next, on a half second cycle whatever our rate. */
+        if ( ( ( ( m_current_tick - m_second_tick ) / ( BC_USECS_IN_SEC / 2 ) ) & 0x01 ) == 0 )
+        {
+          l_canvas.set<20, 4>( m_white_pen );
+          l_canvas.set<20, 6>( m_white_pen );
+
+          l_canvas.set<32, 4>( m_white_pen );
+          l_canvas.set<32, 6>( m_white_pen );
+        }
+      }
+
+      /* If the brightness was adjusted, show the sliding scale on the right. */
+      if ( m_current_tick < m_brightness_until )
+      {
+        for ( l_index = 0; l_index < UnicornCanvas::HEIGHT; l_index++ )
+        {
+          if ( l_index <= ( m_base_brightness * UnicornCanvas::HEIGHT ) )
+          {
+            l_canvas.set( UnicornCanvas::WIDTH - 1, UnicornCanvas::HEIGHT - l_index - 1, m_white_pen );
+          }
+        }
+      }
+
+      Instrument::record( BC_STAGE_RENDER, time_us_32() - l_stage_tick );
+
+      /* All drawing is complete - so, we ask the Unicorn to update. */
+      l_stage_tick = Instrument::start( BC_STAGE_PRESENT );
+#if BC_DITHER
+      m_dither.present( p_context->unicorn, l_graphics );
+#else
+      p_context->unicorn->update( l_graphics );
+#endif
+      Instrument::record( BC_STAGE_PRESENT, time_us_32() - l_stage_tick );
+      g_telemetry.record( BC_METRIC_FRAME_US, time_us_32() - m_frame_start );
+      m_night.presented();
+
+      /*
+       * And the next frame; if nothing's going on, that's the next half
+       * second (when the separators blink), just after the RTC ticks.
+       */
+      if ( BC_DITHER )
+      {
+        p_context->scheduler->next_fps( BC_DITHER_FPS );
+      }
+      else if ( m_rolling )
+      {
+        p_context->scheduler->next_fps( BC_ROLL_FPS );
+      }
+      else if ( m_ntp_busy || !m_second_locked )
+      {
+        p_context->scheduler->next_fps( BC_BUSY_FPS );
+      }
+      else if ( m_idle_fps > 0 )
+      {
+        p_context->scheduler->next_fps( m_idle_fps );
+      }
+      else
+      {
+        p_context->scheduler->next_at( m_current_tick + ( BC_USECS_IN_SEC / 2 ) + BC_TICK_SLACK_USECS -
+                                       ( ( m_current_tick - m_second_tick ) % ( BC_USECS_IN_SEC / 2 ) ) );
+      }
+
+      /* Whatever else, a fleet follower wakes on time to set its RTC. */
+      if ( m_rtc_pending )
+      {
+        p_context->scheduler->next_by( m_rtc_tick );
+      }
+      return;
     }
 
-    /* All drawing is complete - so, we ask the Unicorn to update. */
-    l_unicorn->update( l_graphics );
+    void suspend( appcontext_t *p_context )
+    {
+      /* Leave the panel at a sensible brightness for whoever is next. */
+      p_context->unicorn->set_brightness( m_base_brightness );
+
+      /*
+       * And the radio free, as the next app may want it; whatever we were
+       * up to on the network starts again from scratch when we're back.
+       */
+      m_sntp.stop();
+      checktime_release();
+#if BC_FLEET
+      m_fleet.stop();
+      m_window_flushed = false;
+#endif
+      return;
+    }
 
-    /* And wait a short while for the next frame. */
-    sleep_ms( 500 );
-  }
+    const consolecommand_t *commands( void )
+    {
+      return m_commands;
+    }
+};
+
+
+/*
+ * better_clock_app - hands out the clock, for whoever is running it.
+ */
+
+UnicornApp *better_clock_app( void )
+{
+  static BetterClock  l_clock;
+  return &l_clock;
+}
+
+
+/*
+ * main - entry point; when we're built on our own, we're the only app.
+ */
+
+#ifndef UNICORN_LAUNCHER
+int main()
+{
+  UnicornApp *l_apps[] = { better_clock_app() };
+
+  AppRunner::run( l_apps, 1 );
 
   /* We'll never get here! */
   return 0;
 }
+#endif
 
 /* End of file better_clock.cpp */
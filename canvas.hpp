@@ -0,0 +1,258 @@
+/*
+ * canvas.hpp - from the Unicorn C(++) Examples collection
+ *
+ * A thin drawing layer over a frame buffer, with the geometry and the pixel
+ * format baked in at compile time: Canvas<W, H, Format>. Loops bounded by the
+ * canvas size can be unrolled, and a pixel whose position is a constant is
+ * checked against the edges by the compiler (static_assert) rather than at
+ * run time, so it costs a single store.
+ *
+ * Anything else is clipped once per span or glyph, not once per pixel, and
+ * there are no virtual calls; compare PicoGraphics, where every pixel goes
+ * through the clip rectangle and a virtual set_pixel().
+ *
+ * PicoCanvas offers the same interface on top of PicoGraphics, so a kernel
+ * written as a template over the canvas type can be run either way; which is
+ * how the examples benchmark one against the other.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef CANVAS_HPP
+#define CANVAS_HPP
+
+
+/* System headers. */
+
+#include "pico/stdlib.h"
+
+
+/* Local headers. */
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+#include "libraries/galactic_unicorn/galactic_unicorn.hpp"
+
+
+/* Structs. */
+
+/*
+ * Pixel formats; just the storage type, and how to make a pen. RGB565 pens
+ * are byte-swapped, to match what PicoGraphics keeps in its frame buffer.
+ */
+
+struct CanvasRGB565
+{
+  typedef uint16_t  pixel_t;
+
+  static constexpr pixel_t pen( uint8_t p_r, uint8_t p_g, uint8_t p_b )
+  {
+    return (pixel_t)( ( p_r & 0xf8 ) | ( p_g >> 5 ) |
+                      ( ( p_g & 0x1c ) << 11 ) | ( ( p_b & 0xf8 ) << 5 ) );
+  }
+};
+
+
+/* Classes. */
+
+template <int W, int H, typename Format>
+class Canvas
+{
+  public:
+    typedef typename Format::pixel_t  pen_t;
+    static constexpr int              WIDTH = W;
+    static constexpr int              HEIGHT = H;
+
+  private:
+    pen_t  *m_buffer;
+
+  public:
+    /* The buffer is W*H pixels; it can be a band of a taller frame buffer. */
+    Canvas( void *p_buffer )
+    {
+      m_buffer = (pen_t *)p_buffer;
+    }
+
+    static constexpr pen_t create_pen( uint8_t p_r, uint8_t p_g, uint8_t p_b )
+    {
+      return Format::pen( p_r, p_g, p_b );
+    }
+
+    /* Unchecked; for callers who already know the pixel is on the canvas. */
+    inline void set( int p_x, int p_y, pen_t p_pen )
+    {
+      m_buffer[p_y * W + p_x] = p_pen;
+    }
+
+    /* A constant position is checked when compiling, not at run time. */
+    template <int X, int Y>
+    inline void set( pen_t p_pen )
+    {
+      static_assert( ( X >= 0 ) && ( X < W ) && ( Y >= 0 ) && ( Y < H ), "pixel is off the canvas" );
+      m_buffer[Y * W + X] = p_pen;
+    }
+
+    /* Checked; one unsigned compare per axis covers both edges. */
+    inline void pixel( int p_x, int p_y, pen_t p_pen )
+    {
+      if ( ( (unsigned)p_x < (unsigned)W ) && ( (unsigned)p_y < (unsigned)H ) )
+      {
+        m_buffer[p_y * W + p_x] = p_pen;
+      }
+    }
+
+    void fill( pen_t p_pen )
+    {
+      pen_t  *l_pixel = m_buffer;
+      int     l_index;
+
+      for ( l_index = 0; l_index < W * H; l_index++ )
+      {
+        *l_pixel++ = p_pen;
+      }
+      return;
+    }
+
+    /* A horizontal run of pixels, clipped once at either end. */
+    void span( int p_x, int p_y, int p_length, pen_t p_pen )
+    {
+      pen_t  *l_pixel;
+
+      if ( ( (unsigned)p_y >= (unsigned)H ) || ( p_x >= W ) || ( p_x + p_length <= 0 ) )
+      {
+        return;
+      }
+      if ( p_x < 0 )
+      {
+        p_length += p_x;
+        p_x = 0;
+      }
+      if ( p_x + p_length > W )
+      {
+        p_length = W - p_x;
+      }
+
+      l_pixel = &m_buffer[p_y * W + p_x];
+      while ( p_length-- > 0 )
+      {
+        *l_pixel++ = p_pen;
+      }
+      return;
+    }
+
+    /* A filled circle, drawn exactly as PicoGraphics would. */
+    void circle( int p_x, int p_y, int p_radius, pen_t p_pen )
+    {
+      int   l_ox = p_radius, l_oy = 0, l_err = -p_radius, l_last_oy;
+
+      /* Quick rejection of circles which are entirely off the canvas. */
+      if ( ( p_x + p_radius < 0 ) || ( p_x - p_radius >= W ) ||
+           ( p_y + p_radius < 0 ) || ( p_y - p_radius >= H ) )
+      {
+        return;
+      }
+
+      while ( l_ox >= l_oy )
+      {
+        l_last_oy = l_oy;
+        l_err += l_oy;
+        l_oy++;
+        l_err += l_oy;
+
+        span( p_x - l_ox, p_y + l_last_oy, l_ox * 2 + 1, p_pen );
+        if ( l_last_oy != 0 )
+        {
+          span( p_x - l_ox, p_y - l_last_oy, l_ox * 2 + 1, p_pen );
+        }
+
+        if ( ( l_err >= 0 ) && ( l_ox != l_last_oy ) )
+        {
+          span( p_x - l_last_oy, p_y + l_ox, l_last_oy * 2 + 1, p_pen );
+          if ( l_ox != 0 )
+          {
+            span( p_x - l_last_oy, p_y - l_ox, l_last_oy * 2 + 1, p_pen );
+          }
+          l_err -= l_ox;
+          l_ox--;
+          l_err -= l_ox;
+        }
+      }
+      return;
+    }
+};
+
+
+/*
+ * PicoCanvas - the same interface, but going through PicoGraphics for every
+ *              pixel; the generic path, kept to benchmark against.
+ */
+
+template <int W, int H>
+class PicoCanvas
+{
+  public:
+    typedef uint  pen_t;
+    static constexpr int  WIDTH = W;
+    static constexpr int  HEIGHT = H;
+
+  private:
+    pimoroni::PicoGraphics *m_graphics;
+
+  public:
+    PicoCanvas( pimoroni::PicoGraphics *p_graphics )
+    {
+      m_graphics = p_graphics;
+    }
+
+    pen_t create_pen( uint8_t p_r, uint8_t p_g, uint8_t p_b )
+    {
+      return m_graphics->create_pen( p_r, p_g, p_b );
+    }
+
+    inline void set( int p_x, int p_y, pen_t p_pen )
+    {
+      pixel( p_x, p_y, p_pen );
+    }
+
+    template <int X, int Y>
+    inline void set( pen_t p_pen )
+    {
+      pixel( X, Y, p_pen );
+    }
+
+    inline void pixel( int p_x, int p_y, pen_t p_pen )
+    {
+      m_graphics->set_pen( p_pen );
+      m_graphics->pixel( pimoroni::Point( p_x, p_y ) );
+    }
+
+    void fill( pen_t p_pen )
+    {
+      m_graphics->set_pen( p_pen );
+      m_graphics->clear();
+    }
+
+    void span( int p_x, int p_y, int p_length, pen_t p_pen )
+    {
+      m_graphics->set_pen( p_pen );
+      m_graphics->pixel_span( pimoroni::Point( p_x, p_y ), p_length );
+    }
+
+    void circle( int p_x, int p_y, int p_radius, pen_t p_pen )
+    {
+      m_graphics->set_pen( p_pen );
+      m_graphics->circle( pimoroni::Point( p_x, p_y ), p_radius );
+    }
+};
+
+
+/* The panel itself, in the only format the examples draw in. */
+typedef Canvas<pimoroni::GalacticUnicorn::WIDTH, pimoroni::GalacticUnicorn::HEIGHT, CanvasRGB565> UnicornCanvas;
+typedef PicoCanvas<pimoroni::GalacticUnicorn::WIDTH, pimoroni::GalacticUnicorn::HEIGHT> UnicornPicoCanvas;
+
+
+#endif /* CANVAS_HPP */
+
+/* End of file canvas.hpp */
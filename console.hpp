@@ -0,0 +1,294 @@
+/*
+ * console.hpp - from the Unicorn C(++) Examples collection
+ *
+ * A small command console over USB serial, so settings can be changed on a
+ * running Unicorn without a rebuild. Reading stdin with getchar() from the
+ * frame loop would block rendering, so instead characters are gathered into
+ * a ring as they arrive (from the SDK's chars-available callback) and the
+ * frame loop picks them up, a few at a time, in poll().
+ *
+ * Lines are built up over as many frames as it takes; each poll() stops as
+ * soon as it has used up a small budget, and runs at most one command. The
+ * commands themselves live in static tables - a few of our own, plus any the
+ * current app offers - and should be quick; anything slow should just set a
+ * flag for the app to act on in its own time.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef CONSOLE_HPP
+#define CONSOLE_HPP
+
+
+/* System headers. */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+
+/* Local headers. */
+
+#include "instrument.hpp"
+#include "profiler.hpp"
+#include "spsc_queue.hpp"
+
+
+/* Constants. */
+
+#define CONSOLE_RING_SIZE       256
+#define CONSOLE_LINE_MAX        64
+#define CONSOLE_ARGS_MAX        4
+
+/* How long poll() may spend on any one frame, before leaving the rest. */
+#define CONSOLE_BUDGET_US       100
+
+/* Console time is timed as a stage of its own, just before the idle one. */
+#define CONSOLE_STAGE           ( INSTRUMENT_STAGE_IDLE - 1 )
+
+
+/* Structs. */
+
+/*
+ * A command; the handler is given whoever offered the table (so, the app),
+ * and the words of the line, command first. Returning false shows the usage.
+ */
+typedef struct
+{
+  const char   *name;
+  const char   *usage;
+  bool        (*handler)( void *p_target, uint_fast8_t p_argc, char *p_argv[] );
+} consolecommand_t;
+
+
+/* Class. */
+
+class Console
+{
+  private:
+    static inline SpscQueue<char, CONSOLE_RING_SIZE> m_ring;
+    static inline char          m_line[CONSOLE_LINE_MAX];
+    static inline uint_fast8_t  m_length;
+    static inline bool          m_overlong;
+
+    /* What we've been up to, for the stats command. */
+    static inline uint32_t      m_lines, m_deferred, m_worst_us;
+    static inline uint32_t      m_busy_frames, m_busy_missed;
+    static inline bool          m_busy;
+
+    /* Called (in IRQ context) whenever USB has characters for us. */
+    static void chars_cb( void *p_param )
+    {
+      int   l_char;
+      char *l_slot;
+
+      while ( ( l_char = getchar_timeout_us( 0 ) ) != PICO_ERROR_TIMEOUT )
+      {
+        if ( ( l_slot = m_ring.claim() ) != nullptr )
+        {
+          *l_slot = (char)l_char;
+          m_ring.publish();
+        }
+      }
+      return;
+    }
+
+    static const consolecommand_t *find( const consolecommand_t *p_table, const char *p_name )
+    {
+      for ( ; ( p_table != nullptr ) && ( p_table->name != nullptr ); p_table++ )
+      {
+        if ( strcmp( p_table->name, p_name ) == 0 )
+        {
+          return p_table;
+        }
+      }
+      return nullptr;
+    }
+
+    static void list( const consolecommand_t *p_table )
+    {
+      for ( ; ( p_table != nullptr ) && ( p_table->name != nullptr ); p_table++ )
+      {
+        printf( "  %-10s %s\n", p_table->name, p_table->usage );
+      }
+      return;
+    }
+
+    static bool cmd_help( void *p_target, uint_fast8_t p_argc, char *p_argv[] );
+    static bool cmd_stats( void *p_target, uint_fast8_t p_argc, char *p_argv[] );
+
+    static inline const consolecommand_t m_commands[] = {
+      { "help",    "",  cmd_help },
+      { "stats",   "",  cmd_stats },
+      { "profile", "[start [hz] | stop | clear | dump]", Profiler::cmd_profile },
+      { nullptr, nullptr, nullptr }
+    };
+
+    /* Whichever app's commands we're currently offering, for help. */
+    static inline const consolecommand_t *m_app_commands;
+
+    /* Splits the line into words, in place, and runs whatever it names. */
+    static void dispatch( const consolecommand_t *p_commands, void *p_target )
+    {
+      char                   *l_argv[CONSOLE_ARGS_MAX];
+      uint_fast8_t            l_argc = 0;
+      char                   *l_word;
+      const consolecommand_t *l_command;
+
+      for ( l_word = strtok( m_line, " \t" ); ( l_word != nullptr ) && ( l_argc < CONSOLE_ARGS_MAX );
+            l_word = strtok( nullptr, " \t" ) )
+      {
+        l_argv[l_argc++] = l_word;
+      }
+      if ( l_argc == 0 )
+      {
+        return;
+      }
+
+      m_app_commands = p_commands;
+      if ( ( l_command = find( m_commands, l_argv[0] ) ) == nullptr )
+      {
+        l_command = find( p_commands, l_argv[0] );
+      }
+      if ( l_command == nullptr )
+      {
+        printf( "%s: unknown command (try 'help')\n", l_argv[0] );
+      }
+      else if ( !l_command->handler( p_target, l_argc, l_argv ) )
+      {
+        printf( "usage: %s %s\n", l_command->name, l_command->usage );
+      }
+      m_lines++;
+      return;
+    }
+
+  public:
+    static void init( void )
+    {
+      Instrument::name_stage( CONSOLE_STAGE, "console" );
+      stdio_set_chars_available_callback( chars_cb, nullptr );
+      return;
+    }
+
+    /*
+     * poll - called once a frame, before the app's update; works through
+     *        whatever has arrived until it's done a line or run out of time.
+     */
+    static void poll( const consolecommand_t *p_commands, void *p_target )
+    {
+      const char   *l_char;
+      uint32_t      l_start, l_elapsed;
+
+      m_busy = false;
+      if ( m_ring.front() == nullptr )
+      {
+        return;
+      }
+
+      l_start = Instrument::start( CONSOLE_STAGE );
+      m_busy = true;
+      while ( ( l_char = m_ring.front() ) != nullptr )
+      {
+        if ( time_us_32() - l_start > CONSOLE_BUDGET_US )
+        {
+          m_deferred++;
+          break;
+        }
+
+        switch( *l_char )
+        {
+          case '\r':
+          case '\n':
+            /* A complete line; run it, and leave anything else for next time. */
+            m_line[m_length] = '\0';
+            if ( m_overlong )
+            {
+              printf( "line too long, ignored\n" );
+            }
+            else
+            {
+              dispatch( p_commands, p_target );
+            }
+            m_length = 0;
+            m_overlong = false;
+            m_ring.pop();
+            l_char = nullptr;
+            break;
+
+          case '\b':
+          case 0x7f:
+            if ( m_length > 0 )
+            {
+              m_length--;
+            }
+            m_ring.pop();
+            break;
+
+          default:
+            if ( m_length < CONSOLE_LINE_MAX - 1 )
+            {
+              m_line[m_length++] = *l_char;
+            }
+            else
+            {
+              m_overlong = true;
+            }
+            m_ring.pop();
+            break;
+        }
+        if ( l_char == nullptr )
+        {
+          break;
+        }
+      }
+
+      l_elapsed = time_us_32() - l_start;
+      Instrument::record( CONSOLE_STAGE, l_elapsed );
+      if ( l_elapsed > m_worst_us )
+      {
+        m_worst_us = l_elapsed;
+      }
+      return;
+    }
+
+    /* Called once the frame's done; did our work cost it its deadline? */
+    static void frame( bool p_on_time )
+    {
+      if ( m_busy )
+      {
+        m_busy_frames++;
+        if ( !p_on_time )
+        {
+          m_busy_missed++;
+        }
+      }
+      return;
+    }
+};
+
+
+/* The console's own commands. */
+
+inline bool Console::cmd_help( void *p_target, uint_fast8_t p_argc, char *p_argv[] )
+{
+  list( m_commands );
+  list( m_app_commands );
+  return true;
+}
+
+inline bool Console::cmd_stats( void *p_target, uint_fast8_t p_argc, char *p_argv[] )
+{
+  printf( "console: %lu lines, %lu frames busy (%lu missed their deadline), "
+          "%lu deferred, longest %luus, %lu chars dropped\n",
+          (unsigned long)m_lines, (unsigned long)m_busy_frames, (unsigned long)m_busy_missed,
+          (unsigned long)m_deferred, (unsigned long)m_worst_us, (unsigned long)m_ring.dropped() );
+  return true;
+}
+
+
+#endif /* CONSOLE_HPP */
+
+/* End of file console.hpp */
@@ -0,0 +1,125 @@
+/*
+ * dither.hpp - from the Unicorn C(++) Examples collection
+ *
+ * An optional presentation stage which applies brightness in software, with
+ * temporal ordered dithering, rather than leaving it to the Unicorn. At low
+ * brightness the Unicorn only has a handful of levels left per channel, so
+ * smooth gradients collapse into bands; dithering the fractional part of the
+ * scaled value (which moves every frame) restores the in-between levels, as
+ * long as we're refreshing fast enough for the eye to average them out.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef DITHER_HPP
+#define DITHER_HPP
+
+
+/* Local headers. */
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+#include "libraries/galactic_unicorn/galactic_unicorn.hpp"
+
+
+/* Constants. */
+
+#define DITHER_MATRIX_SIZE       4
+#define DITHER_FRAME_STEP        64
+
+
+/* Class. */
+
+class TemporalDither
+{
+  private:
+    /* 4x4 Bayer matrix, pre-scaled into 0-255 thresholds (n * 16 + 8). */
+    static constexpr uint8_t m_matrix[DITHER_MATRIX_SIZE][DITHER_MATRIX_SIZE] = {
+      {   8, 136,  40, 168 },
+      { 200,  72, 232, 104 },
+      {  56, 184,  24, 152 },
+      { 248, 120, 216,  88 }
+    };
+
+    uint_fast16_t m_level;
+    uint8_t       m_phase;
+
+  public:
+    TemporalDither()
+    {
+      m_level = 256;
+      m_phase = 0;
+    }
+
+    /* Brightness is 0.0-1.0, as with the Unicorn; we hold it in 8.8 though. */
+    void set_brightness( float p_brightness )
+    {
+      if ( p_brightness < 0.0f )
+      {
+        p_brightness = 0.0f;
+      }
+      if ( p_brightness > 1.0f )
+      {
+        p_brightness = 1.0f;
+      }
+      m_level = p_brightness * 256.0f;
+      return;
+    }
+
+    /*
+     * present - the drop-in replacement for GalacticUnicorn::update(); the
+     *           Unicorn's own brightness should be left at full, because we
+     *           will have already scaled everything.
+     */
+    void present( pimoroni::GalacticUnicorn *p_unicorn,
+                  pimoroni::PicoGraphics_PenRGB565 *p_graphics )
+    {
+      const uint16_t *l_pixel = (const uint16_t *)p_graphics->frame_buffer;
+      const uint8_t  *l_row;
+      uint_fast16_t   l_colour, l_r, l_g, l_b;
+      uint8_t         l_threshold;
+      uint_fast8_t    l_x, l_y;
+
+      for ( l_y = 0; l_y < pimoroni::GalacticUnicorn::HEIGHT; l_y++ )
+      {
+        l_row = m_matrix[l_y % DITHER_MATRIX_SIZE];
+
+        for ( l_x = 0; l_x < pimoroni::GalacticUnicorn::WIDTH; l_x++ )
+        {
+          /* Pens are stored byte-swapped in the RGB565 buffer. */
+          l_colour = __builtin_bswap16( *l_pixel++ );
+
+          /* Expand each channel back out to 8 bits. */
+          l_r = ( l_colour >> 8 ) & 0xf8;
+          l_r |= l_r >> 5;
+          l_g = ( l_colour >> 3 ) & 0xfc;
+          l_g |= l_g >> 6;
+          l_b = ( l_colour << 3 ) & 0xf8;
+          l_b |= l_b >> 5;
+
+          /*
+           * Scale into 8.8 fixed point, and let the threshold decide whether
+           * the fractional part rounds up; the threshold wraps (uint8_t) as
+           * the phase moves on each frame.
+           */
+          l_threshold = l_row[l_x % DITHER_MATRIX_SIZE] + m_phase;
+          l_r = ( l_r * m_level + l_threshold ) >> 8;
+          l_g = ( l_g * m_level + l_threshold ) >> 8;
+          l_b = ( l_b * m_level + l_threshold ) >> 8;
+
+          p_unicorn->set_pixel( l_x, l_y, l_r, l_g, l_b );
+        }
+      }
+
+      /* Move the pattern on, so each pixel cycles through four thresholds. */
+      m_phase += DITHER_FRAME_STEP;
+      return;
+    }
+};
+
+
+#endif /* DITHER_HPP */
+
+/* End of file dither.hpp */
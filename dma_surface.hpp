@@ -0,0 +1,256 @@
+/*
+ * dma_surface.hpp - from the Unicorn C(++) Examples collection
+ *
+ * Clearing the frame buffer (or copying a saved background over it) is a
+ * CPU loop over every pixel, every frame, which a DMA channel can do just as
+ * well while the CPU gets on with something else.
+ *
+ * So a frame starts the job going with clear_async() or copy_async() at the
+ * top of update(), and render() calls wait() before it draws anything; in
+ * between, the CPU is free for input, the network and the frame's logic.
+ * Only one job is ever in flight, and nothing may touch the buffer until
+ * it's been waited for.
+ *
+ * The DMA moves whole words; RGB565 frames needn't be a whole number of
+ * them (the Galactic Unicorn's 583 pixels aren't), so the odd pixel left
+ * over is done by the CPU. Buffers which aren't word-aligned, or no free
+ * channel, just mean doing the whole job on the CPU, there and then.
+ *
+ * When instrumented, calibrate() times the CPU and DMA doing the job at
+ * startup (as benchmarks); each frame then counts the cycles the CPU would
+ * have spent, less those spent starting and waiting on the DMA, as freed.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef DMA_SURFACE_HPP
+#define DMA_SURFACE_HPP
+
+
+/* System headers. */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+
+
+/* Local headers. */
+
+#include "instrument.hpp"
+#include "bench.hpp"
+
+
+/* Constants. */
+
+#define DMA_SURFACE_CALIBRATE_RUNS  64
+
+/* CPU costs are kept per this many bytes, so small jobs don't round to 0. */
+#define DMA_SURFACE_COST_BYTES      1024
+
+
+/* Class. */
+
+class DmaSurface
+{
+  private:
+    static inline int               m_channel = -1;
+    static inline uint32_t          m_fill;
+    static inline bool              m_pending;
+    static inline uint32_t          m_clear_cost, m_copy_cost;
+    static inline uint32_t          m_saving, m_spent_us;
+
+    /* Whether the DMA can take a job on these buffers at all. */
+    static bool usable( const void *p_dst, const void *p_src )
+    {
+      return ( m_channel >= 0 ) && ( ( ( (uintptr_t)p_dst | (uintptr_t)p_src ) & 0x03 ) == 0 );
+    }
+
+    /* Starts the channel moving the words; only the read side varies. */
+    static void start( void *p_dst, const void *p_src, size_t p_words, bool p_read_increment )
+    {
+      dma_channel_config  l_config = dma_channel_get_default_config( m_channel );
+
+      channel_config_set_transfer_data_size( &l_config, DMA_SIZE_32 );
+      channel_config_set_read_increment( &l_config, p_read_increment );
+      channel_config_set_write_increment( &l_config, true );
+      dma_channel_configure( m_channel, &l_config, p_dst, p_src, p_words, true );
+      m_pending = true;
+      return;
+    }
+
+    /* What the CPU would have spent on the job, from the calibrated cost. */
+    static void expect( uint32_t p_cost, size_t p_bytes, uint32_t p_start_tick )
+    {
+#ifdef UNICORN_INSTRUMENT
+      m_saving = p_cost * p_bytes / DMA_SURFACE_COST_BYTES;
+      m_spent_us = time_us_32() - p_start_tick;
+#endif
+      return;
+    }
+
+    /* The CPU versions; the fallback, and the baseline for calibration. */
+    static void cpu_clear( uint16_t *p_buffer, size_t p_pixels, uint16_t p_pen )
+    {
+      while ( p_pixels-- > 0 )
+      {
+        *p_buffer++ = p_pen;
+      }
+      return;
+    }
+
+  public:
+    /* Claims a channel, if there's one spare; otherwise the CPU does it all. */
+    static void init( void )
+    {
+      if ( m_channel < 0 )
+      {
+        m_channel = dma_claim_unused_channel( false );
+      }
+      return;
+    }
+
+    /*
+     * clear_async - starts filling p_bytes of RGB565 pixels with one pen; the
+     *               DMA reads the same (doubled up) word over and over.
+     */
+    static void clear_async( void *p_buffer, size_t p_bytes, uint16_t p_pen )
+    {
+      uint32_t  l_tick = time_us_32();
+      uint16_t *l_pixels = (uint16_t *)p_buffer;
+
+      wait();
+      if ( !usable( p_buffer, &m_fill ) )
+      {
+        cpu_clear( l_pixels, p_bytes / 2, p_pen );
+        return;
+      }
+
+      m_fill = p_pen | ( (uint32_t)p_pen << 16 );
+      start( p_buffer, &m_fill, p_bytes / 4, false );
+      if ( p_bytes & 0x02 )
+      {
+        l_pixels[p_bytes / 2 - 1] = p_pen;
+      }
+      expect( m_clear_cost, p_bytes, l_tick );
+      return;
+    }
+
+    /*
+     * copy_async - starts copying p_bytes (of pixels, a whole number of them)
+     *              from one buffer to another; they mustn't overlap.
+     */
+    static void copy_async( void *p_dst, const void *p_src, size_t p_bytes )
+    {
+      uint32_t  l_tick = time_us_32();
+
+      wait();
+      if ( !usable( p_dst, p_src ) )
+      {
+        memcpy( p_dst, p_src, p_bytes );
+        return;
+      }
+
+      start( p_dst, p_src, p_bytes / 4, true );
+      if ( p_bytes & 0x02 )
+      {
+        ( (uint16_t *)p_dst )[p_bytes / 2 - 1] = ( (const uint16_t *)p_src )[p_bytes / 2 - 1];
+      }
+      expect( m_copy_cost, p_bytes, l_tick );
+      return;
+    }
+
+    /*
+     * wait - blocks until the job in flight (if any) is done; after this, the
+     *        buffer is all the CPU's again.
+     */
+    static void wait( void )
+    {
+#ifdef UNICORN_INSTRUMENT
+      uint32_t  l_tick = time_us_32();
+      uint32_t  l_spent;
+#endif
+
+      if ( !m_pending )
+      {
+        return;
+      }
+
+      dma_channel_wait_for_finish_blocking( m_channel );
+      m_pending = false;
+
+#ifdef UNICORN_INSTRUMENT
+      l_spent = ( m_spent_us + time_us_32() - l_tick ) * ( clock_get_hz( clk_sys ) / 1000000 );
+      if ( m_saving > l_spent )
+      {
+        Instrument::count( INSTRUMENT_COUNT_DMA_FREED, m_saving - l_spent );
+      }
+#endif
+      return;
+    }
+
+    /*
+     * calibrate - times clearing and copying a buffer of this size on the
+     *             CPU, and by DMA, so that the saving can be counted each
+     *             frame. The buffer's contents are lost.
+     */
+    static void calibrate( void *p_buffer, size_t p_bytes )
+    {
+#ifdef UNICORN_INSTRUMENT
+      uint8_t      *l_buffer = (uint8_t *)p_buffer;
+      size_t        l_half = ( p_bytes / 2 ) & ~0x03;
+      uint32_t      l_mhz = clock_get_hz( clk_sys ) / 1000000;
+      uint64_t      l_clear_us, l_copy_us, l_dma_clear_us, l_dma_copy_us;
+      uint_fast16_t l_run;
+
+      BenchRun l_clear_run( "surface", "clear_cpu" );
+      for ( l_run = 0; l_run < DMA_SURFACE_CALIBRATE_RUNS; l_run++ )
+      {
+        cpu_clear( (uint16_t *)p_buffer, p_bytes / 2, l_run );
+      }
+      l_clear_us = l_clear_run.end( DMA_SURFACE_CALIBRATE_RUNS );
+
+      /* Copies are timed half onto half, so they can't overlap. */
+      BenchRun l_copy_run( "surface", "copy_cpu" );
+      for ( l_run = 0; l_run < DMA_SURFACE_CALIBRATE_RUNS; l_run++ )
+      {
+        memcpy( l_buffer + l_half, l_buffer, l_half );
+      }
+      l_copy_us = l_copy_run.end( DMA_SURFACE_CALIBRATE_RUNS );
+
+      BenchRun l_dma_clear_run( "surface", "clear_dma" );
+      for ( l_run = 0; l_run < DMA_SURFACE_CALIBRATE_RUNS; l_run++ )
+      {
+        clear_async( p_buffer, p_bytes, l_run );
+        wait();
+      }
+      l_dma_clear_us = l_dma_clear_run.end( DMA_SURFACE_CALIBRATE_RUNS );
+
+      BenchRun l_dma_copy_run( "surface", "copy_dma" );
+      for ( l_run = 0; l_run < DMA_SURFACE_CALIBRATE_RUNS; l_run++ )
+      {
+        copy_async( l_buffer + l_half, l_buffer, l_half );
+        wait();
+      }
+      l_dma_copy_us = l_dma_copy_run.end( DMA_SURFACE_CALIBRATE_RUNS );
+
+      m_clear_cost = l_clear_us * l_mhz * DMA_SURFACE_COST_BYTES / ( DMA_SURFACE_CALIBRATE_RUNS * p_bytes );
+      m_copy_cost = l_copy_us * l_mhz * DMA_SURFACE_COST_BYTES / ( DMA_SURFACE_CALIBRATE_RUNS * l_half );
+      printf( "surface: %u bytes, clear %lluus on the CPU, %lluus by DMA; copy %lluus, %lluus%s\n",
+              (unsigned)p_bytes, l_clear_us / DMA_SURFACE_CALIBRATE_RUNS, l_dma_clear_us / DMA_SURFACE_CALIBRATE_RUNS,
+              l_copy_us * 2 / DMA_SURFACE_CALIBRATE_RUNS, l_dma_copy_us * 2 / DMA_SURFACE_CALIBRATE_RUNS,
+              ( m_channel < 0 ) ? " (no DMA channel, so all CPU)" : "" );
+      memset( p_buffer, 0, p_bytes );
+#endif
+      return;
+    }
+};
+
+
+#endif /* DMA_SURFACE_HPP */
+
+/* End of file dma_surface.hpp */
@@ -0,0 +1,94 @@
+/*
+ * dual_core.hpp - from the Unicorn C(++) Examples collection
+ *
+ * A tiny fork/join helper, so that an example can hand half of its frame to
+ * the (otherwise idle) second core. Core 1 sits in a loop waiting on the
+ * inter-core FIFO; fork() gives it a job and pokes the FIFO, join() waits
+ * for the answering poke once the job is done.
+ *
+ * Only one job can be in flight at a time, which is all a split frame needs.
+ * Anything the two halves share must be left alone between fork and join.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef DUAL_CORE_HPP
+#define DUAL_CORE_HPP
+
+
+/* System headers. */
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+
+
+/* Constants. */
+
+#define DUAL_CORE_GO             0x474f
+#define DUAL_CORE_DONE           0x444e
+
+
+/* Class. */
+
+class DualCore
+{
+  public:
+    typedef void (*job_t)( void *p_arg );
+
+  private:
+    static inline volatile job_t  m_job;
+    static inline void * volatile m_arg;
+    static inline bool            m_launched;
+
+    /* The loop core 1 runs forever; wait, work, answer. */
+    static void worker( void )
+    {
+      while( true )
+      {
+        if ( multicore_fifo_pop_blocking() == DUAL_CORE_GO )
+        {
+          m_job( m_arg );
+          multicore_fifo_push_blocking( DUAL_CORE_DONE );
+        }
+      }
+    }
+
+  public:
+    /* Starts core 1 running the worker; safe to call more than once. */
+    static void init( void )
+    {
+      if ( !m_launched )
+      {
+        multicore_launch_core1( worker );
+        m_launched = true;
+      }
+      return;
+    }
+
+    /* Hands a job to core 1; the FIFO write is what publishes it. */
+    static void fork( job_t p_job, void *p_arg )
+    {
+      m_job = p_job;
+      m_arg = p_arg;
+      multicore_fifo_push_blocking( DUAL_CORE_GO );
+      return;
+    }
+
+    /* Waits for core 1 to finish whatever it was given. */
+    static void join( void )
+    {
+      while ( multicore_fifo_pop_blocking() != DUAL_CORE_DONE )
+      {
+        tight_loop_contents();
+      }
+      return;
+    }
+};
+
+
+#endif /* DUAL_CORE_HPP */
+
+/* End of file dual_core.hpp */
@@ -0,0 +1,290 @@
+/*
+ * fire.cpp - from the Unicorn C(++) Examples collection
+ *
+ * The classic demoscene fire effect; heat is seeded along a couple of hidden
+ * rows below the panel, and each frame every cell takes a cooled average of
+ * the cells beneath it, so the flames rise and fade.
+ *
+ * Heat is a single byte per cell and the update is all fixed point, worked a
+ * row at a time with the three cells below sliding along in registers. The
+ * heat values are then turned into colours through a 256 entry palette that
+ * holds ready-made RGB565 pens, written straight into the frame buffer.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+
+/* Local headers. */
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+#include "libraries/galactic_unicorn/galactic_unicorn.hpp"
+#include "instrument.hpp"
+#include "app.hpp"
+
+
+/* Constants. */
+
+#define FIRE_WIDTH           pimoroni::GalacticUnicorn::WIDTH
+#define FIRE_HEIGHT          pimoroni::GalacticUnicorn::HEIGHT
+#define FIRE_SOURCE_ROWS     2
+#define FIRE_ROWS            ( FIRE_HEIGHT + FIRE_SOURCE_ROWS )
+#define FIRE_SPREAD          62
+#define FIRE_COOLING         3
+#define FIRE_FPS             30
+#define FIRE_BENCHMARK_FRAMES 1000
+
+
+/* Enums. */
+
+typedef enum
+{
+  FIRE_STAGE_UPDATE,
+  FIRE_STAGE_RENDER,
+  FIRE_STAGE_PRESENT
+} fire_stage_t;
+
+
+/* Structs. */
+
+typedef struct
+{
+  uint8_t   heat[FIRE_ROWS][FIRE_WIDTH];
+  uint16_t  palette[256];
+  uint32_t  random;
+} firestate_t;
+
+
+/* Functions. */
+
+/*
+ * fire_random - a xorshift generator; rand() is far too slow to call for
+ *               every cell of the source rows on every frame.
+ */
+
+static inline uint32_t fire_random( firestate_t *p_fire )
+{
+  p_fire->random ^= p_fire->random << 13;
+  p_fire->random ^= p_fire->random >> 17;
+  p_fire->random ^= p_fire->random << 5;
+  return p_fire->random;
+}
+
+
+/*
+ * fire_palette - builds the heat-to-colour palette; black through red and
+ *                orange up to a yellowy white. Only done once, at startup.
+ */
+
+void fire_palette( firestate_t *p_fire, pimoroni::PicoGraphics *p_graphics )
+{
+  uint_fast16_t l_heat;
+  uint8_t       l_r, l_g, l_b;
+
+  for ( l_heat = 0; l_heat < 256; l_heat++ )
+  {
+    l_r = l_heat < 85 ? l_heat * 3 : 255;
+    l_g = l_heat < 85 ? 0 : ( l_heat < 170 ? ( l_heat - 85 ) * 3 : 255 );
+    l_b = l_heat < 170 ? 0 : ( l_heat - 170 ) * 3;
+
+    /* RGB565 pens are already in frame buffer (byte-swapped) order. */
+    p_fire->palette[l_heat] = p_graphics->create_pen( l_r, l_g, l_b );
+  }
+
+  return;
+}
+
+
+/*
+ * fire_update - stokes the source rows, and then propagates the heat up the
+ *               panel a row at a time.
+ */
+
+void fire_update( firestate_t *p_fire )
+{
+  const uint8_t  *l_below, *l_below2;
+  uint8_t        *l_row;
+  uint_fast16_t   l_left, l_centre, l_right, l_sum;
+  uint_fast8_t    l_x, l_y;
+  uint32_t        l_random = 0;
+
+  /* The hidden source rows get fresh random heat, four cells per random. */
+  for ( l_y = FIRE_HEIGHT; l_y < FIRE_ROWS; l_y++ )
+  {
+    for ( l_x = 0; l_x < FIRE_WIDTH; l_x++ )
+    {
+      if ( ( l_x & 0x03 ) == 0 )
+      {
+        l_random = fire_random( p_fire );
+      }
+      p_fire->heat[l_y][l_x] = ( l_random & 0xff ) > 96 ? 255 : 0;
+      l_random >>= 8;
+    }
+  }
+
+  /* Then every visible row is a cooled average of what's underneath it. */
+  for ( l_y = 0; l_y < FIRE_HEIGHT; l_y++ )
+  {
+    l_row = p_fire->heat[l_y];
+    l_below = p_fire->heat[l_y + 1];
+    l_below2 = p_fire->heat[l_y + 2];
+
+    /* Slide a three cell window along the row below, wrapping at the edges. */
+    l_left = l_below[FIRE_WIDTH - 1];
+    l_centre = l_below[0];
+    for ( l_x = 0; l_x < FIRE_WIDTH; l_x++ )
+    {
+      l_right = l_below[l_x + 1 < FIRE_WIDTH ? l_x + 1 : 0];
+
+      /* Four samples, scaled by spread/256 (so /4 and a touch of cooling). */
+      l_sum = ( ( l_left + l_centre + l_right + l_below2[l_x] ) * FIRE_SPREAD ) >> 8;
+      l_row[l_x] = l_sum > FIRE_COOLING ? l_sum - FIRE_COOLING : 0;
+
+      l_left = l_centre;
+      l_centre = l_right;
+    }
+  }
+
+  return;
+}
+
+
+/*
+ * fire_render - maps the visible heat through the palette, straight into the
+ *               graphics frame buffer.
+ */
+
+void fire_render( const firestate_t *p_fire, pimoroni::PicoGraphics *p_graphics )
+{
+  uint16_t       *l_pixel = (uint16_t *)p_graphics->frame_buffer;
+  const uint8_t  *l_heat = &p_fire->heat[0][0];
+  uint_fast16_t   l_index;
+
+  for ( l_index = 0; l_index < FIRE_WIDTH * FIRE_HEIGHT; l_index++ )
+  {
+    *l_pixel++ = p_fire->palette[*l_heat++];
+  }
+
+  return;
+}
+
+
+/*
+ * fire_benchmark - runs update and render flat out for a while, to see how
+ *                  much headroom the effect leaves.
+ */
+
+void fire_benchmark( firestate_t *p_fire, pimoroni::PicoGraphics *p_graphics )
+{
+#ifdef UNICORN_INSTRUMENT
+  uint64_t      l_start, l_elapsed;
+  uint_fast16_t l_index;
+
+  l_start = time_us_64();
+  for ( l_index = 0; l_index < FIRE_BENCHMARK_FRAMES; l_index++ )
+  {
+    fire_update( p_fire );
+    fire_render( p_fire, p_graphics );
+  }
+  l_elapsed = time_us_64() - l_start;
+
+  printf( "fire: %d frames in %lluus (%lluus/frame, %.0f fps before presenting)\n",
+          FIRE_BENCHMARK_FRAMES, l_elapsed, l_elapsed / FIRE_BENCHMARK_FRAMES,
+          FIRE_BENCHMARK_FRAMES * 1000000.0f / l_elapsed );
+#endif
+  return;
+}
+
+
+/*
+ * FireApp - stokes and propagates the heat each frame, then maps it to pens.
+ */
+
+class FireApp : public UnicornApp
+{
+  private:
+    firestate_t                       m_fire;
+
+  public:
+    void init( appcontext_t *p_context )
+    {
+      /* The palette only ever needs working out once. */
+      fire_palette( &m_fire, p_context->graphics );
+      m_fire.random = time_us_32() | 0x01;
+
+      fire_benchmark( &m_fire, p_context->graphics );
+      return;
+    }
+
+    void resume( appcontext_t *p_context )
+    {
+      Instrument::name_stage( FIRE_STAGE_UPDATE, "update" );
+      Instrument::name_stage( FIRE_STAGE_RENDER, "render" );
+      Instrument::name_stage( FIRE_STAGE_PRESENT, "present" );
+      return;
+    }
+
+    void update( appcontext_t *p_context )
+    {
+      uint32_t  l_stage_tick;
+
+      l_stage_tick = Instrument::start( FIRE_STAGE_UPDATE );
+      fire_update( &m_fire );
+      Instrument::record( FIRE_STAGE_UPDATE, time_us_32() - l_stage_tick );
+      return;
+    }
+
+    void render( appcontext_t *p_context )
+    {
+      uint32_t  l_stage_tick;
+
+      /* Every pixel is written, so there's no need to clear the screen first. */
+      l_stage_tick = Instrument::start( FIRE_STAGE_RENDER );
+      fire_render( &m_fire, p_context->graphics );
+      Instrument::record( FIRE_STAGE_RENDER, time_us_32() - l_stage_tick );
+
+      /* Flames are drawn - so, we ask the Unicorn to update. */
+      l_stage_tick = Instrument::start( FIRE_STAGE_PRESENT );
+      p_context->unicorn->update( p_context->graphics );
+      Instrument::record( FIRE_STAGE_PRESENT, time_us_32() - l_stage_tick );
+
+      /* And the next frame is due at our usual rate. */
+      p_context->scheduler->next_fps( FIRE_FPS );
+      return;
+    }
+};
+
+
+/*
+ * fire_app - hands out the fire, for whoever is running it.
+ */
+
+UnicornApp *fire_app( void )
+{
+  static FireApp  l_fire;
+  return &l_fire;
+}
+
+
+/*
+ * main - entry point; when we're built on our own, we're the only app.
+ */
+
+#ifndef UNICORN_LAUNCHER
+int main()
+{
+  UnicornApp *l_apps[] = { fire_app() };
+
+  AppRunner::run( l_apps, 1 );
+
+  /* We'll never get here! */
+  return 0;
+}
+#endif
+
+/* End of file fire.cpp */
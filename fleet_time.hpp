@@ -0,0 +1,607 @@
+/*
+ * fleet_time.hpp - from the Unicorn C(++) Examples collection
+ *
+ * Time distribution for a fleet of Unicorns on the one LAN; rather than every
+ * unit asking pool.ntp.org (and each ending up a different fraction of a
+ * second out), one of them - the leader - does the NTP sync, and multicasts a
+ * small timestamped beacon every second for the rest to follow.
+ *
+ * Election is simple: a unit which listens through a whole window without
+ * hearing a beacon takes the lead, and if two leaders ever hear each other
+ * the one with the higher unit ID (from the flash's unique ID) steps down.
+ *
+ * Followers don't keep the radio on; every so often they open a receive
+ * window, join the network, wait for a beacon, and then swap a few echo
+ * packets with the leader to measure the round trip. The sample with the
+ * shortest round trip wins, and half of that is added on as the one-way
+ * delay; then the radio goes off again until the next window.
+ *
+ * All times on the wire are NTP-style (seconds since 1900, UTC) plus
+ * microseconds, so every unit can still show its own timezone.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef FLEET_TIME_HPP
+#define FLEET_TIME_HPP
+
+
+/* System headers. */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "pico/unique_id.h"
+
+#include "lwip/igmp.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+
+
+/* Constants. */
+
+#define FLEET_PORT              4243
+#define FLEET_GROUP             "239.255.85.84"
+#define FLEET_MAGIC             0x55465431    /* "UFT1" */
+#define FLEET_PACKET_LEN        24
+
+#define FLEET_USECS_IN_SEC      1000000LLU
+#define FLEET_BEACON_USECS      ( 1 * FLEET_USECS_IN_SEC )
+#define FLEET_ANCHOR_USECS      ( 2 * FLEET_USECS_IN_SEC )
+#define FLEET_CONNECT_USECS     ( 20 * FLEET_USECS_IN_SEC )
+#define FLEET_WINDOW_USECS      ( 5 * FLEET_USECS_IN_SEC )
+#define FLEET_RETRY_USECS       ( 60 * FLEET_USECS_IN_SEC )
+#define FLEET_RESYNC_USECS      ( 600 * FLEET_USECS_IN_SEC )
+
+/* Echo exchanges per window, and empty windows before a follower takes over. */
+#define FLEET_ECHOES            4
+#define FLEET_MISSED_WINDOWS    2
+
+
+/* Enums. */
+
+typedef enum
+{
+  FLEET_BEACON = 1,
+  FLEET_ECHO_REQUEST,
+  FLEET_ECHO_REPLY
+} fleet_type_t;
+
+typedef enum
+{
+  FLEET_ELECTING,
+  FLEET_FOLLOWER,
+  FLEET_LEADER
+} fleet_role_t;
+
+
+/* Structs. */
+
+/*
+ * On the wire, all of this is big-endian, in this order; 24 bytes. The echo
+ * is the follower's own timer (low 32 bits), handed straight back to it.
+ */
+typedef struct
+{
+  uint32_t  magic;
+  uint8_t   type;
+  uint8_t   flags;
+  uint16_t  sequence;
+  uint32_t  unit;
+  uint32_t  seconds;
+  uint32_t  usecs;
+  uint32_t  echo;
+} fleetpacket_t;
+
+
+/* Class. */
+
+class FleetTime
+{
+  private:
+    uint32_t        m_unit;
+    fleet_role_t    m_role;
+    struct udp_pcb *m_socket;
+    bool            m_link_active, m_connecting, m_window_open;
+    uint64_t        m_link_tick, m_window_tick, m_next_window, m_beacon_tick;
+    uint_fast8_t    m_missed;
+    uint16_t        m_sequence;
+
+    /* The leader's idea of the time (UTC usecs against our timer). */
+    uint64_t        m_anchor_tick, m_anchor_utc, m_anchor_refreshed;
+
+    /* What a follower has heard during this window, from lwIP callbacks. */
+    uint32_t        m_leader_unit;
+    ip_addr_t       m_leader_addr;
+    uint_fast8_t    m_replies;
+    uint32_t        m_best_rtt, m_delay;
+    uint64_t        m_sample_tick, m_sample_utc;
+    bool            m_sample_valid, m_sample_ready;
+
+    static void encode( const fleetpacket_t *p_packet, uint8_t *p_buffer )
+    {
+      const uint32_t  l_words[] = { p_packet->magic,
+                                    (uint32_t)( p_packet->type << 24 | p_packet->flags << 16 | p_packet->sequence ),
+                                    p_packet->unit, p_packet->seconds, p_packet->usecs, p_packet->echo };
+      uint_fast8_t    l_index;
+
+      for ( l_index = 0; l_index < FLEET_PACKET_LEN / 4; l_index++ )
+      {
+        p_buffer[l_index*4]   = l_words[l_index] >> 24;
+        p_buffer[l_index*4+1] = l_words[l_index] >> 16;
+        p_buffer[l_index*4+2] = l_words[l_index] >> 8;
+        p_buffer[l_index*4+3] = l_words[l_index];
+      }
+      return;
+    }
+
+    static bool decode( const uint8_t *p_buffer, fleetpacket_t *p_packet )
+    {
+      uint32_t      l_words[FLEET_PACKET_LEN / 4];
+      uint_fast8_t  l_index;
+
+      for ( l_index = 0; l_index < FLEET_PACKET_LEN / 4; l_index++ )
+      {
+        l_words[l_index] = (uint32_t)p_buffer[l_index*4] << 24 | p_buffer[l_index*4+1] << 16 |
+                           p_buffer[l_index*4+2] << 8 | p_buffer[l_index*4+3];
+      }
+
+      p_packet->magic = l_words[0];
+      p_packet->type = l_words[1] >> 24;
+      p_packet->flags = l_words[1] >> 16;
+      p_packet->sequence = l_words[1];
+      p_packet->unit = l_words[2];
+      p_packet->seconds = l_words[3];
+      p_packet->usecs = l_words[4];
+      p_packet->echo = l_words[5];
+      return ( p_packet->magic == FLEET_MAGIC ) && ( p_packet->usecs < FLEET_USECS_IN_SEC );
+    }
+
+    /* Sends a packet; the caller holds the lwIP lock (or is a callback). */
+    void send( uint8_t p_type, uint16_t p_sequence, uint64_t p_utc, uint32_t p_echo,
+               const ip_addr_t *p_addr, uint16_t p_port )
+    {
+      fleetpacket_t l_packet;
+      struct pbuf  *l_buffer;
+
+      l_buffer = pbuf_alloc( PBUF_TRANSPORT, FLEET_PACKET_LEN, PBUF_RAM );
+      if ( l_buffer == nullptr )
+      {
+        return;
+      }
+
+      l_packet.magic = FLEET_MAGIC;
+      l_packet.type = p_type;
+      l_packet.flags = 0;
+      l_packet.sequence = p_sequence;
+      l_packet.unit = m_unit;
+      l_packet.seconds = p_utc / FLEET_USECS_IN_SEC;
+      l_packet.usecs = p_utc % FLEET_USECS_IN_SEC;
+      l_packet.echo = p_echo;
+      encode( &l_packet, (uint8_t *)l_buffer->payload );
+
+      udp_sendto( m_socket, l_buffer, p_addr, p_port );
+      pbuf_free( l_buffer );
+      return;
+    }
+
+    /* The leader only speaks for the time while the app keeps it fresh. */
+    bool anchored( uint64_t p_tick )
+    {
+      return ( m_anchor_refreshed != 0 ) && ( p_tick - m_anchor_refreshed < FLEET_ANCHOR_USECS );
+    }
+
+    void echo_request( void )
+    {
+      send( FLEET_ECHO_REQUEST, ++m_sequence, 0, (uint32_t)time_us_64(), &m_leader_addr, FLEET_PORT );
+      return;
+    }
+
+    /*
+     * receive - handles a packet, from lwIP's callback (so in IRQ context); the
+     *           leader answers echoes, everyone else gathers time samples.
+     */
+    void receive( struct pbuf *p_buffer, const ip_addr_t *p_addr, uint16_t p_port )
+    {
+      uint8_t       l_bytes[FLEET_PACKET_LEN];
+      fleetpacket_t l_packet;
+      uint64_t      l_now = time_us_64();
+      uint64_t      l_utc;
+      uint32_t      l_rtt;
+
+      if ( ( p_buffer->tot_len != FLEET_PACKET_LEN ) ||
+           ( pbuf_copy_partial( p_buffer, l_bytes, FLEET_PACKET_LEN, 0 ) != FLEET_PACKET_LEN ) ||
+           !decode( l_bytes, &l_packet ) || ( l_packet.unit == m_unit ) )
+      {
+        return;
+      }
+      l_utc = l_packet.seconds * FLEET_USECS_IN_SEC + l_packet.usecs;
+
+      switch( l_packet.type )
+      {
+        case FLEET_ECHO_REQUEST:
+          /* Only the leader answers; with the time as it stands right now. */
+          if ( ( m_role == FLEET_LEADER ) && anchored( l_now ) )
+          {
+            send( FLEET_ECHO_REPLY, l_packet.sequence, m_anchor_utc + ( l_now - m_anchor_tick ),
+                  l_packet.echo, p_addr, p_port );
+          }
+          break;
+
+        case FLEET_BEACON:
+          /* A leader ignores anyone it outranks; otherwise, lowest unit wins. */
+          if ( ( m_role == FLEET_LEADER ) && ( l_packet.unit > m_unit ) )
+          {
+            break;
+          }
+          if ( !m_window_open || ( ( m_leader_unit != 0 ) && ( l_packet.unit > m_leader_unit ) ) )
+          {
+            break;
+          }
+          if ( l_packet.unit != m_leader_unit )
+          {
+            m_leader_unit = l_packet.unit;
+            ip_addr_copy( m_leader_addr, *p_addr );
+            m_replies = 0;
+            m_best_rtt = UINT32_MAX;
+            m_sample_valid = false;
+          }
+
+          /* Until an echo comes back, the beacon plus the last delay will do. */
+          if ( m_best_rtt == UINT32_MAX )
+          {
+            m_sample_tick = l_now;
+            m_sample_utc = l_utc + m_delay;
+            m_sample_valid = true;
+          }
+          if ( m_replies < FLEET_ECHOES )
+          {
+            echo_request();
+          }
+          break;
+
+        case FLEET_ECHO_REPLY:
+          if ( !m_window_open || ( l_packet.unit != m_leader_unit ) || ( l_packet.sequence != m_sequence ) )
+          {
+            break;
+          }
+
+          /* Keep whichever exchange was quickest; it's the least skewed. */
+          l_rtt = (uint32_t)l_now - l_packet.echo;
+          if ( l_rtt < m_best_rtt )
+          {
+            m_best_rtt = l_rtt;
+            m_sample_tick = l_now;
+            m_sample_utc = l_utc + l_rtt / 2;
+            m_sample_valid = true;
+          }
+          if ( ++m_replies < FLEET_ECHOES )
+          {
+            echo_request();
+          }
+          break;
+      }
+      return;
+    }
+
+    static void receive_cb( void *p_fleet, struct udp_pcb *p_socket, struct pbuf *p_buffer,
+                            const ip_addr_t *p_addr, uint16_t p_port )
+    {
+      ( (FleetTime *)p_fleet )->receive( p_buffer, p_addr, p_port );
+      pbuf_free( p_buffer );
+      return;
+    }
+
+    /*
+     * link_open / link_close - the radio is only powered while we need it; a
+     *                          leader keeps it, followers only for a window.
+     */
+    void link_open( uint64_t p_tick )
+    {
+      cyw43_arch_init();
+      cyw43_arch_enable_sta_mode();
+      cyw43_arch_wifi_connect_async( WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK );
+      m_link_active = m_connecting = true;
+      m_link_tick = p_tick;
+      return;
+    }
+
+    bool link_bind( void )
+    {
+      ip_addr_t l_group;
+
+      cyw43_arch_lwip_begin();
+      m_socket = udp_new_ip_type( IPADDR_TYPE_ANY );
+      if ( m_socket != nullptr )
+      {
+        udp_bind( m_socket, IP_ADDR_ANY, FLEET_PORT );
+        udp_recv( m_socket, receive_cb, this );
+        ipaddr_aton( FLEET_GROUP, &l_group );
+        igmp_joingroup( IP4_ADDR_ANY4, ip_2_ip4( &l_group ) );
+      }
+      cyw43_arch_lwip_end();
+
+      if ( m_socket == nullptr )
+      {
+        printf( "Fleet: failed to create UDP PCB socket\n" );
+        return false;
+      }
+      return true;
+    }
+
+    void link_close( void )
+    {
+      ip_addr_t l_group;
+
+      if ( m_socket != nullptr )
+      {
+        cyw43_arch_lwip_begin();
+        ipaddr_aton( FLEET_GROUP, &l_group );
+        igmp_leavegroup( IP4_ADDR_ANY4, ip_2_ip4( &l_group ) );
+        udp_remove( m_socket );
+        m_socket = nullptr;
+        cyw43_arch_lwip_end();
+      }
+      cyw43_arch_deinit();
+      m_link_active = m_connecting = m_window_open = false;
+      return;
+    }
+
+    void window_open( uint64_t p_tick )
+    {
+      cyw43_arch_lwip_begin();
+      m_leader_unit = 0;
+      m_replies = 0;
+      m_best_rtt = UINT32_MAX;
+      m_sample_valid = false;
+      m_window_open = true;
+      cyw43_arch_lwip_end();
+      m_window_tick = p_tick;
+      return;
+    }
+
+    /* A window's done; either we've a time to hand over, or nobody's leading. */
+    void window_close( uint64_t p_tick )
+    {
+      bool  l_valid;
+
+      cyw43_arch_lwip_begin();
+      m_window_open = false;
+      l_valid = m_sample_valid;
+      if ( m_best_rtt != UINT32_MAX )
+      {
+        m_delay = m_best_rtt / 2;
+      }
+      cyw43_arch_lwip_end();
+
+      if ( l_valid )
+      {
+        if ( m_role != FLEET_FOLLOWER )
+        {
+          printf( "Fleet: following unit %08lx\n", (unsigned long)m_leader_unit );
+        }
+        m_role = FLEET_FOLLOWER;
+        m_missed = 0;
+        m_sample_ready = true;
+        link_close();
+        m_next_window = p_tick + FLEET_RESYNC_USECS;
+        return;
+      }
+
+      /* Nobody there; at boot we take over straight away, else after a few. */
+      if ( ( m_role == FLEET_ELECTING ) || ( ++m_missed >= FLEET_MISSED_WINDOWS ) )
+      {
+        printf( "Fleet: leading as unit %08lx\n", (unsigned long)m_unit );
+        m_role = FLEET_LEADER;
+        m_anchor_refreshed = 0;
+        m_beacon_tick = 0;
+        return;
+      }
+      link_close();
+      m_next_window = p_tick + FLEET_RETRY_USECS;
+      return;
+    }
+
+  public:
+    FleetTime()
+    {
+      m_role = FLEET_ELECTING;
+      m_socket = nullptr;
+      m_link_active = m_connecting = m_window_open = false;
+      m_next_window = m_anchor_refreshed = 0;
+      m_missed = 0;
+      m_sequence = 0;
+      m_leader_unit = 0;
+      m_delay = 0;
+      m_sample_valid = m_sample_ready = false;
+    }
+
+    /* init - works out our unit ID, which is what elections are decided on. */
+    void init( void )
+    {
+      pico_unique_board_id_t  l_id;
+      uint_fast8_t            l_index;
+
+      /* FNV-1a of the flash's unique ID; zero means 'nobody', so avoid it. */
+      pico_get_unique_board_id( &l_id );
+      m_unit = 2166136261u;
+      for ( l_index = 0; l_index < PICO_UNIQUE_BOARD_ID_SIZE_BYTES; l_index++ )
+      {
+        m_unit = ( m_unit ^ l_id.id[l_index] ) * 16777619u;
+      }
+      if ( m_unit == 0 )
+      {
+        m_unit = 1;
+      }
+      return;
+    }
+
+    /*
+     * poll - moves things along; called every frame. Returns true when a
+     *        follower has a fresh time for the app to pick up with sample().
+     */
+    bool poll( uint64_t p_tick )
+    {
+      int   l_link_status;
+
+      /* Followers (and the undecided) sleep with the radio off between windows. */
+      if ( !m_link_active )
+      {
+        if ( ( m_role == FLEET_LEADER ) || ( p_tick >= m_next_window ) )
+        {
+          link_open( p_tick );
+        }
+        return false;
+      }
+
+      l_link_status = cyw43_tcpip_link_status( &cyw43_state, CYW43_ITF_STA );
+      if ( m_connecting )
+      {
+        if ( ( l_link_status == CYW43_LINK_FAIL ) || ( l_link_status == CYW43_LINK_BADAUTH ) ||
+             ( l_link_status == CYW43_LINK_NONET ) || ( p_tick - m_link_tick > FLEET_CONNECT_USECS ) )
+        {
+          printf( "Fleet: failed to join WiFi (err %d)\n", l_link_status );
+          link_close();
+          m_next_window = p_tick + FLEET_RETRY_USECS;
+          return false;
+        }
+        if ( l_link_status != CYW43_LINK_UP )
+        {
+          return false;
+        }
+
+        m_connecting = false;
+        if ( !link_bind() )
+        {
+          link_close();
+          m_next_window = p_tick + FLEET_RETRY_USECS;
+          return false;
+        }
+        if ( m_role != FLEET_LEADER )
+        {
+          window_open( p_tick );
+        }
+      }
+
+      /* A leader that loses the network goes back to looking for one. */
+      if ( ( m_role == FLEET_LEADER ) && ( l_link_status != CYW43_LINK_UP ) )
+      {
+        printf( "Fleet: lost the network, standing down\n" );
+        link_close();
+        m_role = FLEET_ELECTING;
+        m_next_window = p_tick;
+        return false;
+      }
+
+      /* And one that hears a better candidate follows it, from this window. */
+      if ( ( m_role == FLEET_LEADER ) && ( m_leader_unit != 0 ) && ( m_leader_unit < m_unit ) )
+      {
+        m_role = FLEET_FOLLOWER;
+        window_open( p_tick );
+      }
+
+      if ( m_role == FLEET_LEADER )
+      {
+        /* Listen out for rivals, whilst beaconing once a second. */
+        m_window_open = true;
+        if ( anchored( p_tick ) && ( p_tick - m_beacon_tick >= FLEET_BEACON_USECS ) )
+        {
+          ip_addr_t l_group;
+
+          ipaddr_aton( FLEET_GROUP, &l_group );
+          cyw43_arch_lwip_begin();
+          send( FLEET_BEACON, ++m_sequence, m_anchor_utc + ( time_us_64() - m_anchor_tick ), 0,
+                &l_group, FLEET_PORT );
+          cyw43_arch_lwip_end();
+          m_beacon_tick = p_tick;
+        }
+        return false;
+      }
+
+      /* Followers close the window once the echoes are in, or time's up. */
+      if ( ( m_replies >= FLEET_ECHOES ) || ( p_tick - m_window_tick > FLEET_WINDOW_USECS ) )
+      {
+        window_close( p_tick );
+      }
+      if ( m_sample_ready )
+      {
+        m_sample_ready = false;
+        return true;
+      }
+      return false;
+    }
+
+    /*
+     * stop - lets go of the radio, for another app to use. A follower caught
+     *        part way through a window tries again as soon as it's polled; a
+     *        leader just brings the link back up, and carries on leading.
+     */
+    void stop( void )
+    {
+      if ( !m_link_active )
+      {
+        return;
+      }
+      link_close();
+      m_sample_ready = false;
+      if ( m_role != FLEET_LEADER )
+      {
+        m_next_window = 0;
+      }
+      return;
+    }
+
+    /* The time (UTC usecs, NTP era) at a given tick of our own timer. */
+    void sample( uint64_t *p_tick, uint64_t *p_utc )
+    {
+      *p_tick = m_sample_tick;
+      *p_utc = m_sample_utc;
+      return;
+    }
+
+    /*
+     * lead - the leader's app keeps telling us what time it is, while it's
+     *        sure of it; beacons stop soon after it stops.
+     */
+    void lead( uint64_t p_tick, uint64_t p_utc )
+    {
+      cyw43_arch_lwip_begin();
+      m_anchor_tick = p_tick;
+      m_anchor_utc = p_utc;
+      m_anchor_refreshed = time_us_64();
+      cyw43_arch_lwip_end();
+      return;
+    }
+
+    bool leading( void )
+    {
+      return m_role == FLEET_LEADER;
+    }
+
+    /* Which unit we are; where leaders meet, the lowest one wins. */
+    uint32_t unit( void )
+    {
+      return m_unit;
+    }
+
+    /* Is the network up for the app to use, too? (a follower's only in a window) */
+    bool link_up( void )
+    {
+      return m_link_active && !m_connecting;
+    }
+
+    /* While the radio's on (and we're not the leader), we're busy. */
+    bool busy( void )
+    {
+      return m_link_active && ( m_role != FLEET_LEADER );
+    }
+};
+
+
+#endif /* FLEET_TIME_HPP */
+
+/* End of file fleet_time.hpp */
@@ -0,0 +1,132 @@
+/*
+ * frame_monitor.hpp - from the Unicorn C(++) Examples collection
+ *
+ * Keeps an eye on the render loop, with the RP2040's hardware watchdog as the
+ * big stick. The watchdog is only fed when a frame meets its deadline; if the
+ * loop wedges (or just keeps missing deadlines) for long enough, we reset.
+ *
+ * Instrumentation notes the current stage in a watchdog scratch register as
+ * we go, and those survive the reset; so on the next boot we can report where
+ * we were when it all went wrong, rather than just silently hanging.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef FRAME_MONITOR_HPP
+#define FRAME_MONITOR_HPP
+
+
+/* System headers. */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/watchdog.h"
+
+
+/* Local headers. */
+
+#include "instrument.hpp"
+
+
+/* Constants. */
+
+#define FRAME_MONITOR_TIMEOUT_MS   5000
+#define FRAME_MONITOR_REPORT_SECS  5LLU
+#define FRAME_MONITOR_SCRATCH_FRAMES 1
+#define FRAME_MONITOR_NO_RESET     0xff
+
+
+/* Class. */
+
+class FrameMonitor
+{
+  private:
+    static inline uint_fast8_t  m_reset_stage = FRAME_MONITOR_NO_RESET;
+    static inline uint32_t      m_reset_frames;
+    static inline bool          m_reported;
+    static inline uint32_t      m_frames;
+
+  public:
+    /*
+     * init - picks up anything left behind by a watchdog reset, and then
+     *        starts the watchdog. Stage names should be set before this.
+     */
+    static void init( uint32_t p_timeout_ms = FRAME_MONITOR_TIMEOUT_MS )
+    {
+      uint32_t  l_scratch = watchdog_hw->scratch[INSTRUMENT_SCRATCH_STAGE];
+
+      /* Only a real timeout counts; not watchdog_reboot(), or a UF2 flash. */
+      if ( watchdog_enable_caused_reboot() &&
+           ( ( l_scratch & 0xffff0000 ) == INSTRUMENT_STAGE_MAGIC ) )
+      {
+        m_reset_stage = l_scratch & 0xff;
+        m_reset_frames = watchdog_hw->scratch[FRAME_MONITOR_SCRATCH_FRAMES];
+      }
+
+      /* Clear them down, so a later (non-watchdog) reset can't confuse us. */
+      watchdog_hw->scratch[INSTRUMENT_SCRATCH_STAGE] = 0;
+      watchdog_hw->scratch[FRAME_MONITOR_SCRATCH_FRAMES] = 0;
+      m_frames = 0;
+
+      /* Pause on debug, so breakpoints don't get us reset. */
+      watchdog_enable( p_timeout_ms, true );
+      return;
+    }
+
+    /* Stops the watchdog, for a (deliberate) wait longer than it would stand. */
+    static void pause( void )
+    {
+      hw_clear_bits( &watchdog_hw->ctrl, WATCHDOG_CTRL_ENABLE_BITS );
+      return;
+    }
+
+    /* And starts it again, with a full timeout ahead of it. */
+    static void resume( void )
+    {
+      watchdog_update();
+      hw_set_bits( &watchdog_hw->ctrl, WATCHDOG_CTRL_ENABLE_BITS );
+      return;
+    }
+
+    /* If the last boot was down to us, which stage was it stuck in? */
+    static uint_fast8_t reset_stage( void )
+    {
+      return m_reset_stage;
+    }
+
+    /*
+     * frame - called at the end of every frame, with whether it made its
+     *         deadline. Only frames that did get to feed the watchdog.
+     */
+    static void frame( bool p_on_time )
+    {
+      m_frames++;
+      watchdog_hw->scratch[FRAME_MONITOR_SCRATCH_FRAMES] = m_frames;
+
+      if ( p_on_time )
+      {
+        watchdog_update();
+      }
+
+      /* USB takes a while to come up, so hold off reporting for a bit. */
+      if ( !m_reported && ( time_us_64() > FRAME_MONITOR_REPORT_SECS * 1000000LLU ) )
+      {
+        if ( m_reset_stage != FRAME_MONITOR_NO_RESET )
+        {
+          printf( "Watchdog reset last boot; stuck in stage '%s' (%d) after %lu frames\n",
+                  Instrument::stage_name( m_reset_stage ), m_reset_stage,
+                  (unsigned long)m_reset_frames );
+        }
+        m_reported = true;
+      }
+      return;
+    }
+};
+
+
+#endif /* FRAME_MONITOR_HPP */
+
+/* End of file frame_monitor.hpp */
@@ -0,0 +1,751 @@
+/*
+ * genlock.hpp - from the Unicorn C(++) Examples collection
+ *
+ * Frame sync across several Unicorns on the one LAN, so that an effect which
+ * spans them all presents each frame on every panel at the same moment.
+ *
+ * Panel 0 leads. Each frame it picks a presentation time (on its own timer)
+ * a little way ahead, and sends the frame number, that time and the app's
+ * state for the frame to every follower; then it waits until that time and
+ * presents. Followers keep an estimate of the offset between their timer and
+ * the leader's, from echo exchanges (the one with the quickest round trip
+ * of the last few wins, NTP style), and so present at the same moment.
+ *
+ * Followers also tell the leader when they actually presented each frame (on
+ * their own timer), along with the timestamps of their last echo; from those
+ * the leader works out, NTP style, how far out each follower really was. It
+ * can only be sure of that to within half the echo's round trip, so that's
+ * reported alongside; the quickest echo of the period gives the tightest.
+ *
+ * Frames go unicast to each follower the leader has heard from; multicast is
+ * only used to find the leader, as access points hold multicast back until
+ * their next beacon. For the same reason, power saving is switched off.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef GENLOCK_HPP
+#define GENLOCK_HPP
+
+
+/* System headers. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+
+#include "lwip/igmp.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+
+
+/* Local headers. */
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+#include "libraries/galactic_unicorn/galactic_unicorn.hpp"
+#include "spsc_queue.hpp"
+
+
+/* Constants. */
+
+#define GENLOCK_PORT            4244
+#define GENLOCK_GROUP           "239.255.85.71"
+#define GENLOCK_MAGIC           0x55474c31    /* "UGL1" */
+#define GENLOCK_HEADER_LEN      28
+#define GENLOCK_EXCHANGE_LEN    16
+#define GENLOCK_STATE_MAX       128
+#define GENLOCK_PANELS_MAX      8
+
+/* How far ahead of presentation a frame is sent, and how often we echo. */
+#define GENLOCK_LEAD_USECS      40000LLU
+#define GENLOCK_ECHO_USECS      500000LLU
+#define GENLOCK_ANNOUNCE_USECS  1000000LLU
+#define GENLOCK_STALE_USECS     1000000LLU
+#define GENLOCK_REPORT_USECS    10000000LLU
+
+/* Offset samples kept (followers), and presentation times kept (leader). */
+#define GENLOCK_FILTER          8
+#define GENLOCK_HISTORY         16
+
+/* The last stretch before presenting is spun, rather than slept. */
+#define GENLOCK_SPIN_USECS      200
+
+
+/* Enums. */
+
+typedef enum
+{
+  GENLOCK_FRAME = 1,
+  GENLOCK_ECHO_REQUEST,
+  GENLOCK_ECHO_REPLY
+} genlock_type_t;
+
+
+/* Structs. */
+
+/*
+ * On the wire, big-endian: magic, type, panel, state length, frame, time (64
+ * bits), echo, error; then the state. The time is when a frame is to be
+ * presented, or when an echo was answered (on the leader's timer); or in an
+ * echo request, when the follower presented its last frame (on its own). The
+ * state of an echo request is the follower's last exchange: the leader's time
+ * in its reply (64 bits), and when the follower sent and got that (32 each).
+ * The error is unused.
+ */
+typedef struct
+{
+  uint8_t   type;
+  uint8_t   panel;
+  uint16_t  length;
+  uint32_t  frame;
+  uint64_t  time;
+  uint32_t  echo;
+  uint32_t  error;
+  uint8_t   state[GENLOCK_STATE_MAX];
+} genlockpacket_t;
+
+typedef struct
+{
+  ip_addr_t addr;
+  uint16_t  port;
+  uint64_t  seen_tick;
+  int32_t   skew, worst;
+  uint32_t  error, frame;     /* of the tightest echo, and the frame it was for */
+  int64_t   skew_total;
+  uint32_t  skew_count;
+} genlockpanel_t;
+
+
+/* Class. */
+
+class Genlock
+{
+  private:
+    uint8_t         m_panel;
+    struct udp_pcb *m_socket;
+    bool            m_active, m_connecting;
+    uint64_t        m_echo_tick, m_announce_tick, m_report_tick;
+    uint8_t         m_buffer[GENLOCK_HEADER_LEN + GENLOCK_STATE_MAX];
+
+    /* Leader; who's following, and when we presented recent frames. */
+    genlockpanel_t  m_panels[GENLOCK_PANELS_MAX];
+    uint32_t        m_history_frame[GENLOCK_HISTORY];
+    uint64_t        m_history_tick[GENLOCK_HISTORY];
+
+    /* Follower; where the leader is, and how far its timer is from ours. */
+    bool            m_leader_known;
+    ip_addr_t       m_leader_addr;
+    uint32_t        m_filter_rtt[GENLOCK_FILTER];
+    int64_t         m_filter_offset[GENLOCK_FILTER];
+    uint_fast8_t    m_filter_next, m_filter_count;
+    uint32_t        m_presented_frame;
+    uint64_t        m_presented_tick;
+    uint64_t        m_exchange_time;
+    uint32_t        m_exchange_sent, m_exchange_received;
+    SpscQueue<genlockpacket_t, 4> m_frames;
+    uint32_t        m_queued_frame;
+    uint64_t        m_queued_tick, m_frame_tick;
+
+    static uint_fast16_t encode( const genlockpacket_t *p_packet, uint8_t *p_buffer )
+    {
+      const uint32_t  l_words[] = { GENLOCK_MAGIC,
+                                    (uint32_t)( p_packet->type << 24 | p_packet->panel << 16 | p_packet->length ),
+                                    p_packet->frame, (uint32_t)( p_packet->time >> 32 ),
+                                    (uint32_t)p_packet->time, p_packet->echo, p_packet->error };
+      uint_fast8_t    l_index;
+
+      for ( l_index = 0; l_index < GENLOCK_HEADER_LEN / 4; l_index++ )
+      {
+        p_buffer[l_index*4]   = l_words[l_index] >> 24;
+        p_buffer[l_index*4+1] = l_words[l_index] >> 16;
+        p_buffer[l_index*4+2] = l_words[l_index] >> 8;
+        p_buffer[l_index*4+3] = l_words[l_index];
+      }
+      memcpy( p_buffer + GENLOCK_HEADER_LEN, p_packet->state, p_packet->length );
+      return GENLOCK_HEADER_LEN + p_packet->length;
+    }
+
+    static bool decode( const uint8_t *p_buffer, uint_fast16_t p_length, genlockpacket_t *p_packet )
+    {
+      uint32_t      l_words[GENLOCK_HEADER_LEN / 4];
+      uint_fast8_t  l_index;
+
+      if ( p_length < GENLOCK_HEADER_LEN )
+      {
+        return false;
+      }
+      for ( l_index = 0; l_index < GENLOCK_HEADER_LEN / 4; l_index++ )
+      {
+        l_words[l_index] = (uint32_t)p_buffer[l_index*4] << 24 | p_buffer[l_index*4+1] << 16 |
+                           p_buffer[l_index*4+2] << 8 | p_buffer[l_index*4+3];
+      }
+
+      p_packet->type = l_words[1] >> 24;
+      p_packet->panel = l_words[1] >> 16;
+      p_packet->length = l_words[1];
+      p_packet->frame = l_words[2];
+      p_packet->time = (uint64_t)l_words[3] << 32 | l_words[4];
+      p_packet->echo = l_words[5];
+      p_packet->error = l_words[6];
+      if ( ( l_words[0] != GENLOCK_MAGIC ) || ( p_packet->panel >= GENLOCK_PANELS_MAX ) ||
+           ( p_packet->length > GENLOCK_STATE_MAX ) || ( p_length != (uint_fast16_t)( GENLOCK_HEADER_LEN + p_packet->length ) ) )
+      {
+        return false;
+      }
+      memcpy( p_packet->state, p_buffer + GENLOCK_HEADER_LEN, p_packet->length );
+      return true;
+    }
+
+    /* The state of an echo request is just big-endian words, like the header. */
+    static void store32( uint8_t *p_buffer, uint32_t p_value )
+    {
+      p_buffer[0] = p_value >> 24;
+      p_buffer[1] = p_value >> 16;
+      p_buffer[2] = p_value >> 8;
+      p_buffer[3] = p_value;
+      return;
+    }
+
+    static uint32_t load32( const uint8_t *p_buffer )
+    {
+      return (uint32_t)p_buffer[0] << 24 | p_buffer[1] << 16 | p_buffer[2] << 8 | p_buffer[3];
+    }
+
+    /* Sends a packet; the caller holds the lwIP lock (or is a callback). */
+    void send( const genlockpacket_t *p_packet, const ip_addr_t *p_addr, uint16_t p_port )
+    {
+      struct pbuf    *l_buffer;
+      uint_fast16_t   l_length;
+
+      l_length = encode( p_packet, m_buffer );
+      l_buffer = pbuf_alloc( PBUF_TRANSPORT, l_length, PBUF_RAM );
+      if ( l_buffer == nullptr )
+      {
+        return;
+      }
+      memcpy( l_buffer->payload, m_buffer, l_length );
+      udp_sendto( m_socket, l_buffer, p_addr, p_port );
+      pbuf_free( l_buffer );
+      return;
+    }
+
+    /* The quickest recent echo; the one least skewed by the network. */
+    uint_fast8_t best( void )
+    {
+      uint_fast8_t  l_index, l_best = 0;
+
+      for ( l_index = 1; l_index < m_filter_count; l_index++ )
+      {
+        if ( m_filter_rtt[l_index] < m_filter_rtt[l_best] )
+        {
+          l_best = l_index;
+        }
+      }
+      return l_best;
+    }
+
+    /* The offset (leader minus us), from that echo. */
+    int64_t offset( void )
+    {
+      return m_filter_offset[best()];
+    }
+
+    /*
+     * receive - handles a packet, from lwIP's callback (so in IRQ context);
+     *           keeping this short, frames are just queued for the app.
+     */
+    void receive( struct pbuf *p_buffer, const ip_addr_t *p_addr, uint16_t p_port )
+    {
+      genlockpacket_t *l_slot;
+      genlockpacket_t  l_packet;
+      genlockpanel_t  *l_panel;
+      uint_fast16_t    l_length;
+      uint_fast8_t     l_index;
+      uint64_t         l_now = time_us_64(), l_reply;
+      uint32_t         l_rtt, l_sent, l_received, l_error;
+      int32_t          l_skew;
+
+      l_length = pbuf_copy_partial( p_buffer, m_buffer, sizeof( m_buffer ), 0 );
+      if ( ( p_buffer->tot_len != l_length ) || !decode( m_buffer, l_length, &l_packet ) ||
+           ( l_packet.panel == m_panel ) )
+      {
+        return;
+      }
+
+      switch( l_packet.type )
+      {
+        case GENLOCK_FRAME:
+          /* Only from the leader; which also tells us where it is. */
+          if ( ( m_panel == 0 ) || ( l_packet.panel != 0 ) )
+          {
+            break;
+          }
+          ip_addr_copy( m_leader_addr, *p_addr );
+          m_leader_known = true;
+
+          /*
+           * The multicast copy can turn up after the unicast one; skip it. A
+           * leader that's restarted will have gone quiet for a while first.
+           */
+          if ( ( m_queued_tick != 0 ) && ( l_now - m_queued_tick < GENLOCK_STALE_USECS ) &&
+               ( (int32_t)( l_packet.frame - m_queued_frame ) <= 0 ) )
+          {
+            break;
+          }
+          m_queued_frame = l_packet.frame;
+          m_queued_tick = l_now;
+          l_slot = m_frames.claim();
+          if ( l_slot != nullptr )
+          {
+            memcpy( l_slot, &l_packet, sizeof( l_packet ) );
+            m_frames.publish();
+          }
+          break;
+
+        case GENLOCK_ECHO_REQUEST:
+          if ( m_panel != 0 )
+          {
+            break;
+          }
+
+          /* Note the follower. */
+          l_panel = &m_panels[l_packet.panel];
+          ip_addr_copy( l_panel->addr, *p_addr );
+          l_panel->port = p_port;
+          l_panel->seen_tick = l_now;
+
+          /*
+           * And how far out its last frame was. The time in our last reply to
+           * it was (give or take half the round trip) half way between when it
+           * sent for that and got it, on its timer; so on ours, it presented at
+           * that time, plus however long after half way that was.
+           */
+          l_index = l_packet.frame % GENLOCK_HISTORY;
+          if ( ( l_packet.time != 0 ) && ( l_packet.length == GENLOCK_EXCHANGE_LEN ) &&
+               ( m_history_tick[l_index] != 0 ) && ( m_history_frame[l_index] == l_packet.frame ) )
+          {
+            l_reply = (uint64_t)load32( l_packet.state ) << 32 | load32( l_packet.state + 4 );
+            l_sent = load32( l_packet.state + 8 );
+            l_received = load32( l_packet.state + 12 );
+            l_error = ( l_received - l_sent ) / 2;
+            l_skew = (int32_t)( l_reply - m_history_tick[l_index] ) +
+                     (int32_t)( (uint32_t)l_packet.time - l_received ) + (int32_t)l_error;
+
+            /* The quickest echo gives the tightest; but they all go in the mean. */
+            if ( ( l_panel->skew_count == 0 ) || ( l_error < l_panel->error ) )
+            {
+              l_panel->skew = l_skew;
+              l_panel->error = l_error;
+              l_panel->frame = l_packet.frame;
+            }
+            if ( abs( l_skew ) - (int32_t)l_error > l_panel->worst )
+            {
+              l_panel->worst = abs( l_skew ) - (int32_t)l_error;
+            }
+            l_panel->skew_total += l_skew;
+            l_panel->skew_count++;
+          }
+
+          /* And hand back the time, as close to the request as possible. */
+          l_packet.type = GENLOCK_ECHO_REPLY;
+          l_packet.panel = m_panel;
+          l_packet.length = 0;
+          l_packet.error = 0;
+          l_packet.time = time_us_64();
+          send( &l_packet, p_addr, p_port );
+          break;
+
+        case GENLOCK_ECHO_REPLY:
+          if ( ( m_panel == 0 ) || ( l_packet.panel != 0 ) )
+          {
+            break;
+          }
+
+          /* The leader's time was (probably) half way through the round trip. */
+          l_rtt = (uint32_t)l_now - l_packet.echo;
+          m_filter_rtt[m_filter_next] = l_rtt;
+          m_filter_offset[m_filter_next] = (int64_t)( l_packet.time + l_rtt / 2 ) - (int64_t)l_now;
+          m_filter_next = ( m_filter_next + 1 ) % GENLOCK_FILTER;
+          if ( m_filter_count < GENLOCK_FILTER )
+          {
+            m_filter_count++;
+          }
+
+          /* The whole exchange goes back, so the leader can put our frames on its timer. */
+          m_exchange_time = l_packet.time;
+          m_exchange_sent = l_packet.echo;
+          m_exchange_received = (uint32_t)l_now;
+          break;
+      }
+      return;
+    }
+
+    static void receive_cb( void *p_genlock, struct udp_pcb *p_socket, struct pbuf *p_buffer,
+                            const ip_addr_t *p_addr, uint16_t p_port )
+    {
+      ( (Genlock *)p_genlock )->receive( p_buffer, p_addr, p_port );
+      pbuf_free( p_buffer );
+      return;
+    }
+
+    /* network - brings up the WiFi and our socket, a step at a time. */
+    bool network( void )
+    {
+      ip_addr_t l_group;
+      int       l_link_status;
+
+      if ( !m_active )
+      {
+        cyw43_arch_init();
+        cyw43_arch_enable_sta_mode();
+        cyw43_arch_wifi_connect_async( WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK );
+        m_connecting = true;
+        m_active = true;
+        m_socket = nullptr;
+      }
+
+      if ( m_connecting )
+      {
+        l_link_status = cyw43_tcpip_link_status( &cyw43_state, CYW43_ITF_STA );
+        if ( ( l_link_status == CYW43_LINK_FAIL ) || ( l_link_status == CYW43_LINK_BADAUTH ) ||
+             ( l_link_status == CYW43_LINK_NONET ) )
+        {
+          printf( "Genlock: failed to initialise WiFi (err %d)\n", l_link_status );
+          cyw43_arch_deinit();
+          m_active = false;
+          return false;
+        }
+
+        if ( l_link_status != CYW43_LINK_UP )
+        {
+          return false;
+        }
+        m_connecting = false;
+
+        /* Power saving would hold our frames at the access point. */
+        cyw43_wifi_pm( &cyw43_state, CYW43_PERFORMANCE_PM );
+      }
+
+      if ( m_socket == nullptr )
+      {
+        cyw43_arch_lwip_begin();
+        m_socket = udp_new_ip_type( IPADDR_TYPE_ANY );
+        if ( m_socket != nullptr )
+        {
+          udp_bind( m_socket, IP_ADDR_ANY, GENLOCK_PORT );
+          udp_recv( m_socket, receive_cb, this );
+          ipaddr_aton( GENLOCK_GROUP, &l_group );
+          igmp_joingroup( IP4_ADDR_ANY4, ip_2_ip4( &l_group ) );
+        }
+        cyw43_arch_lwip_end();
+
+        if ( m_socket == nullptr )
+        {
+          printf( "Genlock: failed to create UDP PCB socket\n" );
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    /* report - the leader's view of how far out each follower is. */
+    void report( uint64_t p_tick )
+    {
+#ifdef UNICORN_INSTRUMENT
+      genlockpanel_t  l_panel;
+      uint_fast8_t    l_index;
+
+      for ( l_index = 1; l_index < GENLOCK_PANELS_MAX; l_index++ )
+      {
+        if ( !follower( l_index, p_tick, &l_panel ) )
+        {
+          continue;
+        }
+        printf( "genlock: panel %d skew %ldus +/-%luus (mean %ldus over %lu echoes, worst at least %ldus)\n",
+                (int)l_index, (long)l_panel.skew, (unsigned long)l_panel.error,
+                (long)( l_panel.skew_total / l_panel.skew_count ),
+                (unsigned long)l_panel.skew_count, (long)l_panel.worst );
+
+        cyw43_arch_lwip_begin();
+        m_panels[l_index].worst = 0;
+        m_panels[l_index].skew_total = 0;
+        m_panels[l_index].skew_count = 0;
+        cyw43_arch_lwip_end();
+      }
+#endif
+      return;
+    }
+
+  public:
+    Genlock()
+    {
+      m_panel = 0;
+      m_socket = nullptr;
+      m_active = m_connecting = m_leader_known = false;
+      m_echo_tick = m_announce_tick = m_report_tick = 0;
+      memset( m_panels, 0, sizeof( m_panels ) );
+      memset( m_history_frame, 0, sizeof( m_history_frame ) );
+      memset( m_history_tick, 0, sizeof( m_history_tick ) );
+      m_filter_next = m_filter_count = 0;
+      m_presented_frame = 0;
+      m_presented_tick = 0;
+      m_exchange_time = 0;
+      m_exchange_sent = m_exchange_received = 0;
+      m_queued_frame = 0;
+      m_queued_tick = m_frame_tick = 0;
+    }
+
+    /* Panel 0 leads; every other panel follows it. */
+    void init( uint8_t p_panel )
+    {
+      m_panel = p_panel;
+      return;
+    }
+
+    bool leading( void )
+    {
+      return m_panel == 0;
+    }
+
+    /*
+     * follower - (leader) what we've worked out of a follower's skew since the
+     *            last report; false if it's gone quiet, or sent nothing to go on.
+     */
+    bool follower( uint8_t p_panel, uint64_t p_tick, genlockpanel_t *p_follower )
+    {
+      if ( !leading() || ( p_panel == 0 ) || ( p_panel >= GENLOCK_PANELS_MAX ) )
+      {
+        return false;
+      }
+
+      cyw43_arch_lwip_begin();
+      memcpy( p_follower, &m_panels[p_panel], sizeof( genlockpanel_t ) );
+      cyw43_arch_lwip_end();
+      return ( p_follower->seen_tick != 0 ) && ( p_tick - p_follower->seen_tick <= GENLOCK_STALE_USECS ) &&
+             ( p_follower->skew_count > 0 );
+    }
+
+    /*
+     * stop - lets go of the WiFi, for when another app in the image wants it;
+     *        the next poll() brings it all back up again, from scratch.
+     */
+    void stop( void )
+    {
+      ip_addr_t l_group;
+
+      if ( !m_active )
+      {
+        return;
+      }
+
+      if ( m_socket != nullptr )
+      {
+        cyw43_arch_lwip_begin();
+        ipaddr_aton( GENLOCK_GROUP, &l_group );
+        igmp_leavegroup( IP4_ADDR_ANY4, ip_2_ip4( &l_group ) );
+        udp_remove( m_socket );
+        cyw43_arch_lwip_end();
+        m_socket = nullptr;
+      }
+      cyw43_arch_deinit();
+      m_active = m_connecting = false;
+
+      /* Anything we knew of the others will be stale by the time we're back. */
+      while ( m_frames.front() != nullptr )
+      {
+        m_frames.pop();
+      }
+      memset( m_panels, 0, sizeof( m_panels ) );
+      m_leader_known = false;
+      m_filter_next = m_filter_count = 0;
+      m_exchange_time = 0;
+      m_queued_tick = m_frame_tick = 0;
+      return;
+    }
+
+    /*
+     * poll - keeps the network moving; followers echo off the leader every
+     *        so often, and the leader reports on them. Called every frame.
+     */
+    void poll( uint64_t p_tick )
+    {
+      genlockpacket_t l_packet;
+
+      if ( !network() )
+      {
+        return;
+      }
+
+      if ( leading() )
+      {
+        if ( p_tick - m_report_tick >= GENLOCK_REPORT_USECS )
+        {
+          report( p_tick );
+          m_report_tick = p_tick;
+        }
+        return;
+      }
+
+      /*
+       * Followers echo off the leader; telling it when their last frame went
+       * (on our own timer), and the last exchange it can put that on its own by.
+       * Until we're following it though, our frame numbers are just our own.
+       */
+      if ( m_leader_known && ( p_tick - m_echo_tick >= GENLOCK_ECHO_USECS ) )
+      {
+        cyw43_arch_lwip_begin();
+        l_packet.type = GENLOCK_ECHO_REQUEST;
+        l_packet.panel = m_panel;
+        l_packet.length = 0;
+        l_packet.frame = m_presented_frame;
+        l_packet.time = locked( p_tick ) ? m_presented_tick : 0;
+        l_packet.echo = (uint32_t)time_us_64();
+        l_packet.error = 0;
+        if ( m_exchange_time != 0 )
+        {
+          store32( l_packet.state, (uint32_t)( m_exchange_time >> 32 ) );
+          store32( l_packet.state + 4, (uint32_t)m_exchange_time );
+          store32( l_packet.state + 8, m_exchange_sent );
+          store32( l_packet.state + 12, m_exchange_received );
+          l_packet.length = GENLOCK_EXCHANGE_LEN;
+        }
+        send( &l_packet, &m_leader_addr, GENLOCK_PORT );
+        cyw43_arch_lwip_end();
+        m_echo_tick = p_tick;
+      }
+      return;
+    }
+
+    /*
+     * publish - (leader) hands a frame's state, and when it is to be presented,
+     *           to every follower we've heard from lately; and now and again
+     *           to anyone listening, so that new followers can find us.
+     */
+    void publish( uint32_t p_frame, uint64_t p_present_tick, const void *p_state, uint16_t p_length )
+    {
+      genlockpacket_t l_packet;
+      ip_addr_t       l_group;
+      uint64_t        l_now = time_us_64();
+      uint_fast8_t    l_index;
+
+      if ( !leading() || ( m_socket == nullptr ) || ( p_length > GENLOCK_STATE_MAX ) )
+      {
+        return;
+      }
+
+      l_packet.type = GENLOCK_FRAME;
+      l_packet.panel = m_panel;
+      l_packet.length = p_length;
+      l_packet.frame = p_frame;
+      l_packet.time = p_present_tick;
+      l_packet.echo = 0;
+      l_packet.error = 0;
+      memcpy( l_packet.state, p_state, p_length );
+
+      cyw43_arch_lwip_begin();
+      for ( l_index = 1; l_index < GENLOCK_PANELS_MAX; l_index++ )
+      {
+        if ( ( m_panels[l_index].seen_tick != 0 ) && ( l_now - m_panels[l_index].seen_tick < GENLOCK_STALE_USECS ) )
+        {
+          send( &l_packet, &m_panels[l_index].addr, m_panels[l_index].port );
+        }
+      }
+      if ( l_now - m_announce_tick >= GENLOCK_ANNOUNCE_USECS )
+      {
+        ipaddr_aton( GENLOCK_GROUP, &l_group );
+        send( &l_packet, &l_group, GENLOCK_PORT );
+        m_announce_tick = l_now;
+      }
+      cyw43_arch_lwip_end();
+      return;
+    }
+
+    /*
+     * follow - (follower) the most recent frame from the leader, if there's a
+     *          new one; with its presentation time moved onto our own timer.
+     *          Returns false if there isn't one, or we can't place it yet.
+     */
+    bool follow( uint32_t *p_frame, uint64_t *p_present_tick, void *p_state, uint16_t p_length )
+    {
+      const genlockpacket_t *l_packet;
+      bool                   l_found = false, l_locked;
+
+      /*
+       * Only the newest frame matters; anything older is already late, as is
+       * one which turns up after we've gone ahead and shown that frame anyway.
+       * If we've lost the leader for a while though, our frame numbers are
+       * our own, and the leader's win.
+       */
+      l_locked = locked( time_us_64() );
+      cyw43_arch_lwip_begin();
+      while ( ( l_packet = m_frames.front() ) != nullptr )
+      {
+        if ( ( m_filter_count > 0 ) &&
+             ( !l_locked || ( (int32_t)( l_packet->frame - m_presented_frame ) > 0 ) ) )
+        {
+          *p_frame = l_packet->frame;
+          *p_present_tick = l_packet->time - offset();
+          memcpy( p_state, l_packet->state, l_packet->length < p_length ? l_packet->length : p_length );
+          l_found = true;
+        }
+        m_frames.pop();
+      }
+      cyw43_arch_lwip_end();
+      if ( l_found )
+      {
+        m_frame_tick = time_us_64();
+      }
+      return l_found;
+    }
+
+    /* Is a follower currently being driven by the leader? */
+    bool locked( uint64_t p_tick )
+    {
+      return leading() || ( ( m_frame_tick != 0 ) && ( p_tick - m_frame_tick < GENLOCK_STALE_USECS ) );
+    }
+
+    /*
+     * present - waits until the given time (on our own timer), then presents;
+     *           and remembers when that actually happened, to report skew.
+     */
+    void present( pimoroni::GalacticUnicorn *p_unicorn, pimoroni::PicoGraphics *p_graphics,
+                  uint32_t p_frame, uint64_t p_present_tick )
+    {
+      uint64_t  l_now = time_us_64();
+
+      /* Sleep most of the way; spin the last bit, as wakeups can be late. */
+      if ( p_present_tick > l_now + GENLOCK_SPIN_USECS )
+      {
+        sleep_until( from_us_since_boot( p_present_tick - GENLOCK_SPIN_USECS ) );
+      }
+      busy_wait_until( from_us_since_boot( p_present_tick ) );
+
+      p_unicorn->update( p_graphics );
+      l_now = time_us_64();
+
+      if ( leading() )
+      {
+        cyw43_arch_lwip_begin();
+        m_history_frame[p_frame % GENLOCK_HISTORY] = p_frame;
+        m_history_tick[p_frame % GENLOCK_HISTORY] = l_now;
+        cyw43_arch_lwip_end();
+      }
+      else
+      {
+        m_presented_frame = p_frame;
+        m_presented_tick = l_now;
+      }
+      return;
+    }
+};
+
+
+#endif /* GENLOCK_HPP */
+
+/* End of file genlock.hpp */
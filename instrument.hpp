@@ -0,0 +1,272 @@
+/*
+ * instrument.hpp - from the Unicorn C(++) Examples collection
+ *
+ * A very lightweight set of timing counters, so that examples can measure how
+ * long each stage of their frame takes. Stage timings are accumulated and
+ * periodically reported over stdio (so, USB) before being reset.
+ *
+ * Alongside the stages, there are a few simple event counters which shared
+ * code (rather than the examples themselves) can bump.
+ *
+ * Stages are timed from interrupt handlers (lwIP callbacks) as well as the
+ * main loop, so the stats are only ever updated with interrupts disabled.
+ *
+ * Whichever stage we're currently in is also always noted in one of the
+ * watchdog scratch registers (which survive a watchdog reset), so that if we
+ * hang, the frame monitor can tell us where after the reboot.
+ *
+ * All of this is only compiled in if UNICORN_INSTRUMENT is defined (the CMake
+ * option of the same name does that for you); otherwise every call collapses
+ * to nothing, so there's no cost in leaving the calls in place.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef INSTRUMENT_HPP
+#define INSTRUMENT_HPP
+
+
+/* System headers. */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "hardware/watchdog.h"
+
+
+/* Constants. */
+
+#define INSTRUMENT_MAX_STAGES    8
+#define INSTRUMENT_REPORT_SECS   10LLU
+
+/* The last stage is reserved for time spent idle, waiting for the next frame. */
+#define INSTRUMENT_STAGE_IDLE    ( INSTRUMENT_MAX_STAGES - 1 )
+
+/* Scratch 0-3 are ours; the SDK uses 4-7 for its own reboot handling. */
+#define INSTRUMENT_SCRATCH_STAGE 0
+#define INSTRUMENT_STAGE_MAGIC   0x53540000
+
+
+/* Enums. */
+
+typedef enum
+{
+  INSTRUMENT_COUNT_MISSED,
+  INSTRUMENT_COUNT_PENS,
+  INSTRUMENT_COUNT_PEN_HITS,
+  INSTRUMENT_COUNT_DMA_FREED,
+  INSTRUMENT_MAX_COUNTERS
+} instrument_counter_t;
+
+
+/* Class. */
+
+class Instrument
+{
+  private:
+    typedef struct
+    {
+      const char   *name;
+      uint32_t      count;
+      uint32_t      max_us;
+      uint64_t      total_us;
+    } stage_t;
+
+    static inline stage_t   m_stages[INSTRUMENT_MAX_STAGES];
+    static inline uint32_t  m_counters[INSTRUMENT_MAX_COUNTERS];
+    static inline const char *m_counter_names[INSTRUMENT_MAX_COUNTERS] = {
+      "missed", "pens", "pen_hits", "dma_freed"
+    };
+    static inline uint32_t  m_frames;
+    static inline uint64_t  m_report_tick;
+    static inline volatile uint_fast8_t m_current;
+
+  public:
+    /* Stages are just small integers; names are only used when reporting. */
+    static void name_stage( uint_fast8_t p_stage, const char *p_name )
+    {
+      if ( p_stage < INSTRUMENT_MAX_STAGES )
+      {
+        m_stages[p_stage].name = p_name;
+      }
+      return;
+    }
+
+    static const char *stage_name( uint_fast8_t p_stage )
+    {
+      if ( ( p_stage < INSTRUMENT_MAX_STAGES ) && ( m_stages[p_stage].name != nullptr ) )
+      {
+        return m_stages[p_stage].name;
+      }
+      return "?";
+    }
+
+    /* Notes which stage we're in; this is always done, instrumented or not. */
+    static void mark( uint_fast8_t p_stage )
+    {
+      m_current = p_stage;
+      watchdog_hw->scratch[INSTRUMENT_SCRATCH_STAGE] = INSTRUMENT_STAGE_MAGIC | p_stage;
+      return;
+    }
+
+    static uint_fast8_t current( void )
+    {
+      return m_current;
+    }
+
+    /* Enters a stage, returning the tick to later pass to record(). */
+    static uint32_t start( uint_fast8_t p_stage )
+    {
+      mark( p_stage );
+      return time_us_32();
+    }
+
+    /* Records a single timing against a stage. */
+    static void record( uint_fast8_t p_stage, uint32_t p_elapsed_us )
+    {
+#ifdef UNICORN_INSTRUMENT
+      uint32_t  l_interrupts;
+
+      if ( p_stage < INSTRUMENT_MAX_STAGES )
+      {
+        l_interrupts = save_and_disable_interrupts();
+        m_stages[p_stage].count++;
+        m_stages[p_stage].total_us += p_elapsed_us;
+        if ( p_elapsed_us > m_stages[p_stage].max_us )
+        {
+          m_stages[p_stage].max_us = p_elapsed_us;
+        }
+        restore_interrupts( l_interrupts );
+      }
+#endif
+      return;
+    }
+
+    /* Bumps one of the shared event counters. */
+    static void count( instrument_counter_t p_counter, uint32_t p_amount = 1 )
+    {
+#ifdef UNICORN_INSTRUMENT
+      uint32_t  l_interrupts = save_and_disable_interrupts();
+
+      m_counters[p_counter] += p_amount;
+      restore_interrupts( l_interrupts );
+#endif
+      return;
+    }
+
+    /* Called once per frame; counts them, and reports when it's due. */
+    static void frame( void )
+    {
+#ifdef UNICORN_INSTRUMENT
+      uint64_t  l_now = time_us_64();
+
+      m_frames++;
+      if ( m_report_tick == 0 )
+      {
+        m_report_tick = l_now;
+      }
+      if ( l_now > ( m_report_tick + ( INSTRUMENT_REPORT_SECS * 1000000LLU ) ) )
+      {
+        report( l_now - m_report_tick );
+        m_report_tick = l_now;
+      }
+#endif
+      return;
+    }
+
+    /* Dumps (and resets) the accumulated stats for the last period. */
+    static void report( uint64_t p_period_us )
+    {
+#ifdef UNICORN_INSTRUMENT
+      stage_t       l_stages[INSTRUMENT_MAX_STAGES];
+      uint32_t      l_counters[INSTRUMENT_MAX_COUNTERS];
+      uint_fast8_t  l_index;
+      uint32_t      l_mhz = clock_get_hz( clk_sys ) / 1000000;
+      uint32_t      l_avg_us, l_interrupts;
+
+      /* Take (and reset) a copy of it all in one go; then print at leisure. */
+      l_interrupts = save_and_disable_interrupts();
+      memcpy( l_stages, m_stages, sizeof( l_stages ) );
+      memcpy( l_counters, m_counters, sizeof( l_counters ) );
+      for ( l_index = 0; l_index < INSTRUMENT_MAX_STAGES; l_index++ )
+      {
+        m_stages[l_index].count = 0;
+        m_stages[l_index].max_us = 0;
+        m_stages[l_index].total_us = 0;
+      }
+      memset( m_counters, 0, sizeof( m_counters ) );
+      restore_interrupts( l_interrupts );
+
+      /* Idle time is the closest thing we have to a power measurement. */
+      printf( "== %lu frames in %llums (%.1f fps), idle %.1f%%\n", (unsigned long)m_frames,
+              p_period_us / 1000, m_frames * 1000000.0f / p_period_us,
+              l_stages[INSTRUMENT_STAGE_IDLE].total_us * 100.0f / p_period_us );
+
+      for ( l_index = 0; l_index < INSTRUMENT_MAX_STAGES; l_index++ )
+      {
+        if ( l_stages[l_index].count == 0 )
+        {
+          continue;
+        }
+
+        /* Cycle counts are derived; the M0+ has no cycle counter to ask. */
+        l_avg_us = l_stages[l_index].total_us / l_stages[l_index].count;
+        printf( "   %-12s avg %6luus (%8lu cycles) max %6luus over %lu\n",
+                l_stages[l_index].name ? l_stages[l_index].name : "?",
+                (unsigned long)l_avg_us, (unsigned long)( l_avg_us * l_mhz ),
+                (unsigned long)l_stages[l_index].max_us,
+                (unsigned long)l_stages[l_index].count );
+      }
+
+      /* Counters are given as totals, and per frame. */
+      printf( "  " );
+      for ( l_index = 0; l_index < INSTRUMENT_MAX_COUNTERS; l_index++ )
+      {
+        printf( " %s %lu (%.1f/frame)", m_counter_names[l_index], (unsigned long)l_counters[l_index],
+                m_frames ? (float)l_counters[l_index] / m_frames : 0.0f );
+      }
+      printf( "\n" );
+      m_frames = 0;
+#endif
+      return;
+    }
+};
+
+
+/*
+ * InstrumentScope - times the block it lives in, against the given stage;
+ *                   scopes can nest (or interrupt each other).
+ */
+
+class InstrumentScope
+{
+  private:
+    uint_fast8_t  m_stage;
+    uint_fast8_t  m_previous;
+    uint32_t      m_start;
+
+  public:
+    InstrumentScope( uint_fast8_t p_stage )
+    {
+      m_stage = p_stage;
+      m_previous = Instrument::current();
+      m_start = Instrument::start( p_stage );
+    }
+
+    /* On the way out, we're back in whatever stage we were before. */
+    ~InstrumentScope()
+    {
+      Instrument::record( m_stage, time_us_32() - m_start );
+      Instrument::mark( m_previous );
+    }
+};
+
+
+#endif /* INSTRUMENT_HPP */
+
+/* End of file instrument.hpp */
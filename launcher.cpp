@@ -0,0 +1,50 @@
+/*
+ * launcher.cpp - from the Unicorn C(++) Examples collection
+ *
+ * Rather than one firmware image per example, this links several of them
+ * into a single image; they share the one display, graphics object and
+ * network stack, and holding A and B together switches between them.
+ *
+ * Each example still builds on its own, too; UNICORN_LAUNCHER just leaves
+ * out their main(), so that this one can run them all.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include "pico/stdlib.h"
+
+
+/* Local headers. */
+
+#include "app.hpp"
+
+
+/* Functions. */
+
+/* Each app is handed out by its own source file. */
+UnicornApp *better_clock_app( void );
+UnicornApp *rain_app( void );
+UnicornApp *life_app( void );
+UnicornApp *fire_app( void );
+UnicornApp *plasma_app( void );
+UnicornApp *ticker_app( void );
+
+
+/*
+ * main - the first app is where we start; A+B moves through the rest.
+ */
+
+int main()
+{
+  UnicornApp *l_apps[] = { better_clock_app(), rain_app(), life_app(), fire_app(), plasma_app(), ticker_app() };
+
+  AppRunner::run( l_apps, sizeof( l_apps ) / sizeof( l_apps[0] ) );
+
+  /* We'll never get here! */
+  return 0;
+}
+
+/* End of file launcher.cpp */
@@ -0,0 +1,354 @@
+/*
+ * life.cpp - from the Unicorn C(++) Examples collection
+ *
+ * Conway's Game of Life, wrapped around the Unicorn as a torus. The whole
+ * 53x11 grid fits into eleven 64-bit words - one per row - so rather than
+ * counting neighbours cell by cell we count them for a whole row at once,
+ * by feeding the eight shifted neighbour rows through a little bit-parallel
+ * adder. Each bit position ends up holding its own neighbour count.
+ *
+ * A short history of generation hashes is kept, so that when the board dies
+ * out or settles into a repeating pattern we notice, and reseed it.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "pico/stdlib.h"
+
+/* Local headers. */
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+#include "libraries/galactic_unicorn/galactic_unicorn.hpp"
+#include "instrument.hpp"
+#include "app.hpp"
+
+
+/* Constants. */
+
+#define LIFE_WIDTH           pimoroni::GalacticUnicorn::WIDTH
+#define LIFE_HEIGHT          pimoroni::GalacticUnicorn::HEIGHT
+#define LIFE_ROW_MASK        ( ( 1LLU << LIFE_WIDTH ) - 1 )
+#define LIFE_HISTORY         16
+#define LIFE_MAX_GENERATIONS 2000
+#define LIFE_SEED_DENSITY    3
+#define LIFE_FPS             10
+#define LIFE_BENCHMARK_GENS  10000
+
+
+/* Enums. */
+
+typedef enum
+{
+  LIFE_STAGE_STEP,
+  LIFE_STAGE_RENDER,
+  LIFE_STAGE_PRESENT
+} life_stage_t;
+
+
+/* Structs. */
+
+typedef struct
+{
+  uint64_t      rows[LIFE_HEIGHT];
+  uint64_t      history[LIFE_HISTORY];
+  uint_fast8_t  history_next;
+  uint32_t      generation;
+} lifeboard_t;
+
+
+/* Functions. */
+
+/*
+ * life_rotl / life_rotr - rotate a row left or right by one cell, wrapping
+ *                         around the panel width rather than the 64 bits.
+ */
+
+static inline uint64_t life_rotl( uint64_t p_row )
+{
+  return ( ( p_row << 1 ) | ( p_row >> ( LIFE_WIDTH - 1 ) ) ) & LIFE_ROW_MASK;
+}
+
+static inline uint64_t life_rotr( uint64_t p_row )
+{
+  return ( p_row >> 1 ) | ( ( p_row & 0x01 ) << ( LIFE_WIDTH - 1 ) );
+}
+
+
+/*
+ * life_add - adds one neighbour row into the per-bit counters. s0 and s1 are
+ *            the low two bits of the count; s2 is a sticky 'four or more'
+ *            flag, because beyond that we don't care (the cell is dead).
+ */
+
+static inline void life_add( uint64_t &p_s0, uint64_t &p_s1, uint64_t &p_s2, uint64_t p_row )
+{
+  uint64_t  l_carry0, l_carry1;
+
+  l_carry0 = p_s0 & p_row;
+  p_s0 ^= p_row;
+  l_carry1 = p_s1 & l_carry0;
+  p_s1 ^= l_carry0;
+  p_s2 |= l_carry1;
+}
+
+
+/*
+ * life_hash - a simple FNV-1a style hash of the board, for cycle detection.
+ */
+
+uint64_t life_hash( const lifeboard_t *p_board )
+{
+  uint64_t      l_hash = 0xcbf29ce484222325LLU;
+  uint_fast8_t  l_row;
+
+  for ( l_row = 0; l_row < LIFE_HEIGHT; l_row++ )
+  {
+    l_hash ^= p_board->rows[l_row];
+    l_hash *= 0x100000001b3LLU;
+  }
+
+  return l_hash;
+}
+
+
+/*
+ * life_seed - fills the board with a random soup, and forgets its history.
+ */
+
+void life_seed( lifeboard_t *p_board )
+{
+  uint_fast8_t  l_row, l_column;
+
+  for ( l_row = 0; l_row < LIFE_HEIGHT; l_row++ )
+  {
+    p_board->rows[l_row] = 0;
+    for ( l_column = 0; l_column < LIFE_WIDTH; l_column++ )
+    {
+      if ( rand() % LIFE_SEED_DENSITY == 0 )
+      {
+        p_board->rows[l_row] |= 1LLU << l_column;
+      }
+    }
+  }
+
+  for ( l_row = 0; l_row < LIFE_HISTORY; l_row++ )
+  {
+    p_board->history[l_row] = 0;
+  }
+  p_board->history_next = 0;
+  p_board->generation = 0;
+
+  return;
+}
+
+
+/*
+ * life_step - advances the board by a single generation. Returns false if
+ *             the new generation has been seen recently (or the board has
+ *             simply run for long enough), and so wants reseeding.
+ */
+
+bool life_step( lifeboard_t *p_board )
+{
+  uint64_t      l_next[LIFE_HEIGHT];
+  uint64_t      l_above, l_row, l_below;
+  uint64_t      l_s0, l_s1, l_s2, l_hash;
+  uint_fast8_t  l_index;
+
+  for ( l_index = 0; l_index < LIFE_HEIGHT; l_index++ )
+  {
+    l_above = p_board->rows[( l_index + LIFE_HEIGHT - 1 ) % LIFE_HEIGHT];
+    l_row   = p_board->rows[l_index];
+    l_below = p_board->rows[( l_index + 1 ) % LIFE_HEIGHT];
+
+    /* Count all eight neighbours of every cell in the row, in parallel. */
+    l_s0 = l_s1 = l_s2 = 0;
+    life_add( l_s0, l_s1, l_s2, life_rotl( l_above ) );
+    life_add( l_s0, l_s1, l_s2, l_above );
+    life_add( l_s0, l_s1, l_s2, life_rotr( l_above ) );
+    life_add( l_s0, l_s1, l_s2, life_rotl( l_row ) );
+    life_add( l_s0, l_s1, l_s2, life_rotr( l_row ) );
+    life_add( l_s0, l_s1, l_s2, life_rotl( l_below ) );
+    life_add( l_s0, l_s1, l_s2, l_below );
+    life_add( l_s0, l_s1, l_s2, life_rotr( l_below ) );
+
+    /* Alive next time if the count is three, or two and already alive. */
+    l_next[l_index] = ~l_s2 & l_s1 & ( l_s0 | l_row );
+  }
+
+  memcpy( p_board->rows, l_next, sizeof( l_next ) );
+  p_board->generation++;
+
+  /* See if we've been here before; this also catches an empty board. */
+  l_hash = life_hash( p_board );
+  for ( l_index = 0; l_index < LIFE_HISTORY; l_index++ )
+  {
+    if ( p_board->history[l_index] == l_hash )
+    {
+      return false;
+    }
+  }
+  p_board->history[p_board->history_next] = l_hash;
+  p_board->history_next = ( p_board->history_next + 1 ) % LIFE_HISTORY;
+
+  /* Long-lived boards (gliders forever circling, say) eventually get reset. */
+  return p_board->generation < LIFE_MAX_GENERATIONS;
+}
+
+
+/*
+ * life_benchmark - runs the simulation flat out for a while, without any
+ *                  rendering, to see how many generations a second we manage.
+ */
+
+void life_benchmark( void )
+{
+#ifdef UNICORN_INSTRUMENT
+  lifeboard_t   l_board;
+  uint64_t      l_start, l_elapsed;
+  uint32_t      l_index;
+
+  life_seed( &l_board );
+  l_start = time_us_64();
+  for ( l_index = 0; l_index < LIFE_BENCHMARK_GENS; l_index++ )
+  {
+    if ( !life_step( &l_board ) )
+    {
+      life_seed( &l_board );
+    }
+  }
+  l_elapsed = time_us_64() - l_start;
+
+  printf( "life: %d generations in %lluus (%.0f generations/sec)\n",
+          LIFE_BENCHMARK_GENS, l_elapsed, LIFE_BENCHMARK_GENS * 1000000.0f / l_elapsed );
+#endif
+  return;
+}
+
+
+/*
+ * LifeApp - much like rain; a generation each frame, drawn a cell at a time.
+ */
+
+class LifeApp : public UnicornApp
+{
+  private:
+    int                               m_black_pen, m_born_pen, m_alive_pen;
+    uint64_t                          m_previous[LIFE_HEIGHT];
+    lifeboard_t                       m_board;
+
+  public:
+    void init( appcontext_t *p_context )
+    {
+      pimoroni::PicoGraphics_PenRGB565 *l_graphics = p_context->graphics;
+
+      /* Newborn cells are drawn a little brighter than the survivors. */
+      m_black_pen = l_graphics->create_pen( 0, 0, 0 );
+      m_born_pen = l_graphics->create_pen( 150, 255, 150 );
+      m_alive_pen = l_graphics->create_pen( 30, 160, 60 );
+
+      /* Seed the random number generator, and then the board. */
+      srand( time_us_64() );
+      life_benchmark();
+      life_seed( &m_board );
+      return;
+    }
+
+    void resume( appcontext_t *p_context )
+    {
+      Instrument::name_stage( LIFE_STAGE_STEP, "step" );
+      Instrument::name_stage( LIFE_STAGE_RENDER, "render" );
+      Instrument::name_stage( LIFE_STAGE_PRESENT, "present" );
+      return;
+    }
+
+    void update( appcontext_t *p_context )
+    {
+      uint32_t  l_stage_tick;
+
+      /* Remember the old board, so we can tell which cells are newborn. */
+      l_stage_tick = Instrument::start( LIFE_STAGE_STEP );
+      memcpy( m_previous, m_board.rows, sizeof( m_previous ) );
+
+      /* Advance a generation, and start again if it's gone stale. */
+      if ( !life_step( &m_board ) )
+      {
+        life_seed( &m_board );
+      }
+      Instrument::record( LIFE_STAGE_STEP, time_us_32() - l_stage_tick );
+      return;
+    }
+
+    void render( appcontext_t *p_context )
+    {
+      pimoroni::PicoGraphics_PenRGB565 *l_graphics = p_context->graphics;
+      uint64_t                          l_cells, l_born;
+      uint32_t                          l_stage_tick;
+      uint_fast8_t                      l_row, l_column;
+
+      /* Clear the screen, and draw every living cell. */
+      l_stage_tick = Instrument::start( LIFE_STAGE_RENDER );
+      l_graphics->set_pen( m_black_pen );
+      l_graphics->clear();
+
+      for ( l_row = 0; l_row < LIFE_HEIGHT; l_row++ )
+      {
+        /* Just walk the set bits, rather than test every column. */
+        l_cells = m_board.rows[l_row];
+        l_born = l_cells & ~m_previous[l_row];
+        while ( l_cells )
+        {
+          l_column = __builtin_ctzll( l_cells );
+          l_graphics->set_pen( ( l_born & ( 1LLU << l_column ) ) ? m_born_pen : m_alive_pen );
+          l_graphics->pixel( pimoroni::Point( l_column, l_row ) );
+          l_cells &= l_cells - 1;
+        }
+      }
+      Instrument::record( LIFE_STAGE_RENDER, time_us_32() - l_stage_tick );
+
+      /* Generation is drawn - so, we ask the Unicorn to update. */
+      l_stage_tick = Instrument::start( LIFE_STAGE_PRESENT );
+      p_context->unicorn->update( l_graphics );
+      Instrument::record( LIFE_STAGE_PRESENT, time_us_32() - l_stage_tick );
+
+      /* And the next frame is due at our usual rate. */
+      p_context->scheduler->next_fps( LIFE_FPS );
+      return;
+    }
+};
+
+
+/*
+ * life_app - hands out the game of life, for whoever is running it.
+ */
+
+UnicornApp *life_app( void )
+{
+  static LifeApp  l_life;
+  return &l_life;
+}
+
+
+/*
+ * main - entry point; when we're built on our own, we're the only app.
+ */
+
+#ifndef UNICORN_LAUNCHER
+int main()
+{
+  UnicornApp *l_apps[] = { life_app() };
+
+  AppRunner::run( l_apps, 1 );
+
+  /* We'll never get here! */
+  return 0;
+}
+#endif
+
+/* End of file life.cpp */
@@ -0,0 +1,146 @@
+/*
+ * linear_light.hpp - from the Unicorn C(++) Examples collection
+ *
+ * Blending colours as they're stored (gamma-encoded sRGB) gets the maths of
+ * light wrong; halfway between two colours comes out darker and muddier than
+ * it should, and a slow fade looks uneven. Blending in linear light fixes
+ * that, and it needn't cost any floating point at run time: two lookup tables,
+ * built by the compiler and living in flash, take 8-bit sRGB to 16-bit linear
+ * and back again.
+ *
+ * Linear values run 0-65535; going back, the table is indexed by the top 12
+ * bits, which is plenty to land on the nearest 8-bit value (and the panel
+ * only shows 5 or 6 bits of it in the end anyway).
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef LINEAR_LIGHT_HPP
+#define LINEAR_LIGHT_HPP
+
+
+/* System headers. */
+
+#include <stdint.h>
+
+
+/* Constants. */
+
+#define LINEAR_LIGHT_MAX        65535
+#define LINEAR_LIGHT_BITS       12
+#define LINEAR_LIGHT_MIX_ONE    256
+
+
+/* Structs. */
+
+/* A colour, in linear light. */
+typedef struct
+{
+  uint16_t  r, g, b;
+} linearcolour_t;
+
+
+/* Class. */
+
+class LinearLight
+{
+  private:
+    /* x^(1/5), by Newton's method; good enough for the tables, at compile time. */
+    static constexpr double fifth_root( double p_value )
+    {
+      double        l_root = 1.0;
+      uint_fast8_t  l_index = 0;
+
+      if ( p_value <= 0.0 )
+      {
+        return 0.0;
+      }
+      for ( l_index = 0; l_index < 40; l_index++ )
+      {
+        l_root = ( 4.0 * l_root + p_value / ( l_root * l_root * l_root * l_root ) ) / 5.0;
+      }
+      return l_root;
+    }
+
+    /* The sRGB transfer curve; x^2.4 being x^2 times the fifth root of x^2. */
+    static constexpr double decode( double p_value )
+    {
+      double  l_base = 0;
+
+      if ( p_value <= 0.04045 )
+      {
+        return p_value / 12.92;
+      }
+      l_base = ( p_value + 0.055 ) / 1.055;
+      return l_base * l_base * fifth_root( l_base * l_base );
+    }
+
+    struct Tables
+    {
+      uint16_t  linear[256];
+      uint8_t   srgb[1 << LINEAR_LIGHT_BITS];
+
+      constexpr Tables() : linear(), srgb()
+      {
+        int       l_index = 0, l_code = 0;
+        uint32_t  l_value = 0;
+
+        for ( l_index = 0; l_index < 256; l_index++ )
+        {
+          linear[l_index] = (uint16_t)( decode( l_index / 255.0 ) * LINEAR_LIGHT_MAX + 0.5 );
+        }
+
+        /* Back again; the nearest code to the middle of each slot, walking up. */
+        for ( l_index = 0; l_index < ( 1 << LINEAR_LIGHT_BITS ); l_index++ )
+        {
+          l_value = ( l_index << ( 16 - LINEAR_LIGHT_BITS ) ) + ( 1 << ( 15 - LINEAR_LIGHT_BITS ) );
+          while ( ( l_code < 255 ) && ( (uint32_t)linear[l_code] + linear[l_code + 1] < 2 * l_value ) )
+          {
+            l_code++;
+          }
+          srgb[l_index] = (uint8_t)l_code;
+        }
+      }
+    };
+
+    static const Tables m_tables;
+
+  public:
+    static uint16_t to_linear( uint8_t p_value )
+    {
+      return m_tables.linear[p_value];
+    }
+
+    static uint8_t to_srgb( uint16_t p_value )
+    {
+      return m_tables.srgb[p_value >> ( 16 - LINEAR_LIGHT_BITS )];
+    }
+
+    static linearcolour_t to_linear( uint8_t p_r, uint8_t p_g, uint8_t p_b )
+    {
+      return linearcolour_t{ to_linear( p_r ), to_linear( p_g ), to_linear( p_b ) };
+    }
+
+    /*
+     * mix - blends two linear colours, p_mix of the way (out of 256) from the
+     *       first to the second, and hands back the result as 8-bit sRGB.
+     */
+    static void mix( const linearcolour_t &p_from, const linearcolour_t &p_to, uint_fast16_t p_mix,
+                     uint8_t &p_r, uint8_t &p_g, uint8_t &p_b )
+    {
+      p_r = to_srgb( p_from.r + ( ( ( (int32_t)p_to.r - p_from.r ) * (int32_t)p_mix ) >> 8 ) );
+      p_g = to_srgb( p_from.g + ( ( ( (int32_t)p_to.g - p_from.g ) * (int32_t)p_mix ) >> 8 ) );
+      p_b = to_srgb( p_from.b + ( ( ( (int32_t)p_to.b - p_from.b ) * (int32_t)p_mix ) >> 8 ) );
+      return;
+    }
+};
+
+inline constexpr LinearLight::Tables LinearLight::m_tables;
+
+
+#endif /* LINEAR_LIGHT_HPP */
+
+/* End of file linear_light.hpp */
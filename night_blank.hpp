@@ -0,0 +1,326 @@
+/*
+ * night_blank.hpp - from the Unicorn C(++) Examples collection
+ *
+ * A clock in an empty room has nobody to show the time to; overnight (within
+ * a scheduled window of hours), or once the light sensor says it's been dark
+ * for a while, we may as well blank the display, stop rendering altogether
+ * and put the RP2040 to sleep until we're wanted again.
+ *
+ * Sleep here is the RP2040's 'sleep' state: the core waits in WFI with
+ * SLEEPDEEP set, so every clock not named in the SLEEP_EN registers is gated
+ * off until an interrupt comes in. We keep the RTC (so the wall time carries
+ * on), the timer and watchdog tick (so time_us_64() does too, and nothing
+ * counting from it gets confused), and the IO bank, for the buttons. Either
+ * an RTC alarm - the end of the window, or the next look at the light - or
+ * any of the Unicorn's buttons wakes us.
+ *
+ * The radio must be off for any of this (the clock only brings it up to sync
+ * its time, so that's most of the time); the watchdog is paused for the
+ * duration, since sleeping for hours is the whole point.
+ *
+ * Each night's sleep is reported when the first frame after it has been
+ * shown: how long we were blanked, what share of that was actually spent
+ * asleep (rather than woken by some other interrupt), and how long it took
+ * from waking to that first frame.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef NIGHT_BLANK_HPP
+#define NIGHT_BLANK_HPP
+
+
+/* System headers. */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "pico/util/datetime.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/rtc.h"
+#include "hardware/sync.h"
+#include "hardware/structs/scb.h"
+
+
+/* Local headers. */
+
+#include "libraries/galactic_unicorn/galactic_unicorn.hpp"
+#include "frame_monitor.hpp"
+
+
+/* Constants. */
+
+/* How long it must have been dark, and how often to look while blanked. */
+#define NIGHT_BLANK_DARK_SECS    600LLU
+#define NIGHT_BLANK_CHECK_MINS   5
+
+/* Once it's dark, the light must come up to this many times the level. */
+#define NIGHT_BLANK_HYSTERESIS   2
+
+/* Woken by a button, the display stays on at least this long. */
+#define NIGHT_BLANK_AWAKE_SECS   60LLU
+
+#define NIGHT_BLANK_BUTTONS      9
+
+
+/* Enums. */
+
+typedef enum
+{
+  NIGHT_WAKE_NONE,
+  NIGHT_WAKE_ALARM,
+  NIGHT_WAKE_BUTTON
+} night_wake_t;
+
+
+/* Class. */
+
+class NightBlank
+{
+  private:
+    static constexpr uint8_t m_buttons[NIGHT_BLANK_BUTTONS] = {
+      pimoroni::GalacticUnicorn::SWITCH_A, pimoroni::GalacticUnicorn::SWITCH_B,
+      pimoroni::GalacticUnicorn::SWITCH_C, pimoroni::GalacticUnicorn::SWITCH_D,
+      pimoroni::GalacticUnicorn::SWITCH_SLEEP,
+      pimoroni::GalacticUnicorn::SWITCH_VOLUME_UP, pimoroni::GalacticUnicorn::SWITCH_VOLUME_DOWN,
+      pimoroni::GalacticUnicorn::SWITCH_BRIGHTNESS_UP, pimoroni::GalacticUnicorn::SWITCH_BRIGHTNESS_DOWN
+    };
+
+    /* Set from the interrupt handlers; only ever one sleep at a time. */
+    static inline volatile uint_fast8_t m_reason;
+
+    uint8_t         m_from_hour, m_until_hour;
+    uint16_t        m_dark_level;
+    bool            m_forced, m_reporting;
+    uint64_t        m_dark_since, m_awake_until;
+    uint64_t        m_blank_tick, m_wake_tick;
+    uint64_t        m_blanked_us, m_asleep_us;
+    uint32_t        m_wakes, m_latency_us;
+    night_wake_t    m_woken_by;
+
+    static void on_alarm( void )
+    {
+      m_reason = NIGHT_WAKE_ALARM;
+      return;
+    }
+
+    static void on_button( uint p_gpio, uint32_t p_events )
+    {
+      m_reason = NIGHT_WAKE_BUTTON;
+      return;
+    }
+
+    /* Within the scheduled window? It may well wrap around midnight. */
+    bool in_window( int8_t p_hour )
+    {
+      if ( m_from_hour == m_until_hour )
+      {
+        return false;
+      }
+      if ( m_from_hour < m_until_hour )
+      {
+        return ( p_hour >= m_from_hour ) && ( p_hour < m_until_hour );
+      }
+      return ( p_hour >= m_from_hour ) || ( p_hour < m_until_hour );
+    }
+
+    /*
+     * doze - one spell in the sleep state, until any interrupt at all; with
+     *        interrupts held off while we check, so a wake can't slip in
+     *        between the check and the WFI.
+     */
+    static void doze( void )
+    {
+      uint32_t  l_sleep_en0 = clocks_hw->sleep_en0;
+      uint32_t  l_sleep_en1 = clocks_hw->sleep_en1;
+      uint32_t  l_interrupts;
+
+      clocks_hw->sleep_en0 = CLOCKS_SLEEP_EN0_CLK_RTC_RTC_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_RTC_BITS |
+                             CLOCKS_SLEEP_EN0_CLK_SYS_IO_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_PADS_BITS;
+      clocks_hw->sleep_en1 = CLOCKS_SLEEP_EN1_CLK_SYS_TIMER_BITS | CLOCKS_SLEEP_EN1_CLK_SYS_WATCHDOG_BITS |
+                             CLOCKS_SLEEP_EN1_CLK_SYS_XOSC_BITS;
+
+      /* Gating USB would drop the console; if anyone's listening, keep it. */
+      if ( stdio_usb_connected() )
+      {
+        clocks_hw->sleep_en1 |= CLOCKS_SLEEP_EN1_CLK_USB_USBCTRL_BITS | CLOCKS_SLEEP_EN1_CLK_SYS_USBCTRL_BITS;
+      }
+
+      scb_hw->scr |= M0PLUS_SCR_SLEEPDEEP_BITS;
+      l_interrupts = save_and_disable_interrupts();
+      if ( m_reason == NIGHT_WAKE_NONE )
+      {
+        __wfi();
+      }
+      restore_interrupts( l_interrupts );
+      scb_hw->scr &= ~M0PLUS_SCR_SLEEPDEEP_BITS;
+
+      clocks_hw->sleep_en0 = l_sleep_en0;
+      clocks_hw->sleep_en1 = l_sleep_en1;
+      return;
+    }
+
+    /* Sets the RTC alarm for whenever we next need to look around. */
+    void set_alarm( const datetime_t *p_now )
+    {
+      datetime_t  l_alarm = { -1, -1, -1, -1, -1, -1, -1 };
+
+      /* In the window, that's its end; otherwise, a few minutes from now. */
+      if ( !m_forced && in_window( p_now->hour ) )
+      {
+        l_alarm.hour = m_until_hour;
+        l_alarm.min = 0;
+        l_alarm.sec = 0;
+      }
+      else
+      {
+        l_alarm.min = ( p_now->min + NIGHT_BLANK_CHECK_MINS ) % 60;
+        l_alarm.sec = p_now->sec;
+      }
+      rtc_set_alarm( &l_alarm, on_alarm );
+      return;
+    }
+
+  public:
+    /* Blanks from one hour until another (the same for never), or when dark. */
+    void init( uint8_t p_from_hour, uint8_t p_until_hour, uint16_t p_dark_level )
+    {
+      m_from_hour = p_from_hour;
+      m_until_hour = p_until_hour;
+      m_dark_level = p_dark_level;
+      m_forced = m_reporting = false;
+      m_dark_since = m_awake_until = 0;
+      m_blanked_us = m_asleep_us = 0;
+      m_wakes = m_latency_us = 0;
+      m_woken_by = NIGHT_WAKE_NONE;
+      return;
+    }
+
+    /* Fed the light level now and then, so we know how long it's been dark. */
+    void observe( uint16_t p_light, uint64_t p_now )
+    {
+      if ( ( m_dark_level > 0 ) && ( p_light < m_dark_level ) )
+      {
+        if ( m_dark_since == 0 )
+        {
+          m_dark_since = p_now;
+        }
+      }
+      else
+      {
+        m_dark_since = 0;
+      }
+      return;
+    }
+
+    /* Blank at the next chance, until a button is pressed. */
+    void force( void )
+    {
+      m_forced = true;
+      return;
+    }
+
+    /* Is it time to blank? Not for a while after someone's woken us. */
+    bool due( const datetime_t *p_now, uint64_t p_now_tick )
+    {
+      if ( p_now_tick < m_awake_until )
+      {
+        return false;
+      }
+      return m_forced || in_window( p_now->hour ) ||
+             ( ( m_dark_since != 0 ) && ( p_now_tick - m_dark_since >= NIGHT_BLANK_DARK_SECS * 1000000LLU ) );
+    }
+
+    /*
+     * sleep - blanks the display and sleeps, looking around whenever the
+     *         RTC wakes us, until it's time to get up or a button is pressed.
+     *         The caller should redraw (and rebrighten) as soon as we return.
+     */
+    void sleep( pimoroni::GalacticUnicorn *p_unicorn, datetime_t *p_now )
+    {
+      uint64_t      l_doze_tick;
+      uint_fast8_t  l_index;
+      bool          l_dark;
+
+      p_unicorn->clear();
+      FrameMonitor::pause();
+      for ( l_index = 0; l_index < NIGHT_BLANK_BUTTONS; l_index++ )
+      {
+        gpio_set_irq_enabled_with_callback( m_buttons[l_index], GPIO_IRQ_EDGE_FALL, true, on_button );
+      }
+
+      m_blank_tick = time_us_64();
+      m_asleep_us = 0;
+      m_wakes = 0;
+      do
+      {
+        m_reason = NIGHT_WAKE_NONE;
+        set_alarm( p_now );
+        while ( m_reason == NIGHT_WAKE_NONE )
+        {
+          l_doze_tick = time_us_64();
+          doze();
+          m_asleep_us += time_us_64() - l_doze_tick;
+          m_wakes++;
+        }
+        rtc_disable_alarm();
+        rtc_get_datetime( p_now );
+
+        /* The display's off, so the sensor sees only the room. */
+        l_dark = ( m_dark_level > 0 ) && ( p_unicorn->light() < m_dark_level * NIGHT_BLANK_HYSTERESIS );
+      }
+      while ( ( m_reason == NIGHT_WAKE_ALARM ) && ( m_forced || in_window( p_now->hour ) || l_dark ) );
+      m_wake_tick = time_us_64();
+
+      for ( l_index = 0; l_index < NIGHT_BLANK_BUTTONS; l_index++ )
+      {
+        gpio_set_irq_enabled( m_buttons[l_index], GPIO_IRQ_EDGE_FALL, false );
+      }
+      FrameMonitor::resume();
+
+      /* If someone wanted us, stay up for them a while; and light is light. */
+      m_woken_by = (night_wake_t)m_reason;
+      if ( m_woken_by == NIGHT_WAKE_BUTTON )
+      {
+        m_awake_until = m_wake_tick + NIGHT_BLANK_AWAKE_SECS * 1000000LLU;
+      }
+      m_blanked_us = m_wake_tick - m_blank_tick;
+      m_dark_since = 0;
+      m_forced = false;
+      m_reporting = true;
+      return;
+    }
+
+    /* Called once a frame has been shown; the first after a sleep is timed. */
+    void presented( void )
+    {
+      if ( m_reporting )
+      {
+        m_latency_us = time_us_64() - m_wake_tick;
+        m_reporting = false;
+        report();
+      }
+      return;
+    }
+
+    /* How the last night went. */
+    void report( void )
+    {
+      uint32_t  l_duty = m_blanked_us ? (uint32_t)( m_asleep_us * 10000 / m_blanked_us ) : 0;
+
+      printf( "night: blanked %llus, asleep %lu.%02lu%% of it (%lu wakes); woken by %s, first frame after %luus\n",
+              m_blanked_us / 1000000LLU, (unsigned long)( l_duty / 100 ), (unsigned long)( l_duty % 100 ),
+              (unsigned long)m_wakes, ( m_woken_by == NIGHT_WAKE_BUTTON ) ? "a button" : "the RTC",
+              (unsigned long)m_latency_us );
+      return;
+    }
+};
+
+
+#endif /* NIGHT_BLANK_HPP */
+
+/* End of file night_blank.hpp */
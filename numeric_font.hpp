@@ -4,6 +4,10 @@
  * This is a lightweight class providing a simple, fixed width numeric font
  * for more predictable rendering on the Unicorn. Characters are all 7x4.
  *
+ * The glyphs themselves are drawn in fonts/numeric.bdf; the build turns that
+ * into numeric_font_data.hpp (see tools/font_compile.py), so to add one, add
+ * it to the font and to the list of characters in CMakeLists.txt.
+ *
  * On principle, I dislike rolling code into a header file, but for this use
  * case (it's just dropped into tiny, single-file examples) I can stomach it.
  *
@@ -20,12 +24,21 @@
 /* Local headers. */
 
 #include "libraries/pico_graphics/pico_graphics.hpp"
+#include "numeric_font_data.hpp"
 
 
 /* Constants. */
 
-#define NUMERIC_FONT_WIDTH    4
-#define NUMERIC_FONT_HEIGHT   7
+/* A roll moves one glyph up and out, the next in, with a blank row between. */
+#define NUMERIC_FONT_ROLL_TRAVEL  ( NUMERIC_FONT_HEIGHT + 1 )
+#define NUMERIC_FONT_ROLL_FRAMES  ( NUMERIC_FONT_ROLL_TRAVEL - 1 )
+
+/*
+ * Scaled glyphs are drawn as runs along each row; a row of the font can hold
+ * at most this many, and scaled runs still have to fit in a nibble apiece.
+ */
+#define NUMERIC_FONT_RUNS         ( ( NUMERIC_FONT_WIDTH + 1 ) / 2 )
+#define NUMERIC_FONT_SCALE_MAX    ( 15 / NUMERIC_FONT_WIDTH )
 
 
 /* Class. */
@@ -33,54 +46,330 @@
 class NumericFont
 {
   private:
-    static constexpr uint_fast8_t m_font_data[16][4] = {
-      { 0x3e,0x41,0x41,0x3e },  // 0
-      { 0x00,0x02,0x7f,0x00 },  // 1
-      { 0x62,0x51,0x49,0x46 },  // 2
-      { 0x21,0x49,0x4d,0x33 },  // 3
-      { 0x18,0x16,0x11,0x7f },  // 4
-      { 0x4f,0x49,0x49,0x31 },  // 5
-      { 0x3c,0x4a,0x49,0x30 },  // 6
-      { 0x01,0x61,0x19,0x07 },  // 7
-      { 0x36,0x49,0x49,0x36 },  // 8
-      { 0x06,0x49,0x29,0x1e },  // 9
-      { 0x3f,0x40,0x40,0x3f },  // U
-      { 0x01,0x7f,0x01,0x00 },  // T
-      { 0x3e,0x41,0x41,0x22 },  // C
-      { 0x00,0x08,0x1c,0x08 },  // +
-      { 0x00,0x08,0x08,0x08 },  // -
-      { 0x00,0x14,0x14,0x14 }   // =
+    /* Digits first, then "UTC+-="; the order the clock expects. */
+    static_assert( NUMERIC_FONT_GLYPHS >= 16, "the clock needs the digits, and UTC+-=" );
+
+    /*
+     * The in-between frames of every digit rolling into every other digit,
+     * worked out by the compiler; each one is just another set of columns.
+     */
+    struct RollTable
+    {
+      uint8_t columns[10][10][NUMERIC_FONT_ROLL_FRAMES][NUMERIC_FONT_WIDTH];
+
+      constexpr RollTable() : columns()
+      {
+        int l_from = 0, l_to = 0, l_frame = 0, l_column = 0, l_offset = 0;
+
+        for ( l_from = 0; l_from < 10; l_from++ )
+        {
+          for ( l_to = 0; l_to < 10; l_to++ )
+          {
+            for ( l_frame = 0; l_frame < NUMERIC_FONT_ROLL_FRAMES; l_frame++ )
+            {
+              /* Bit 0 is the top row, so rolling up is shifting down. */
+              l_offset = l_frame + 1;
+              for ( l_column = 0; l_column < NUMERIC_FONT_WIDTH; l_column++ )
+              {
+                columns[l_from][l_to][l_frame][l_column] = (uint8_t)(
+                  ( ( g_numeric_font_columns[l_from][l_column] >> l_offset ) |
+                    ( g_numeric_font_columns[l_to][l_column] << ( NUMERIC_FONT_ROLL_TRAVEL - l_offset ) ) ) &
+                  ( ( 1 << NUMERIC_FONT_HEIGHT ) - 1 ) );
+              }
+            }
+          }
+        }
+      }
     };
+
+    static const RollTable m_roll;
+
+    /*
+     * Each row of each glyph, blown up S times, as runs; start << 4 | length,
+     * as the font compiler packs them. Rolling digits aren't in the font,
+     * so there are also the runs of every possible row, found by its mask.
+     */
+    template <uint_fast8_t S>
+    struct ScaleTable
+    {
+      static_assert( ( S >= 1 ) && ( S <= NUMERIC_FONT_SCALE_MAX ), "scaled runs must fit in a nibble" );
+      static_assert( NUMERIC_FONT_SPANS <= NUMERIC_FONT_RUNS, "font has more runs to a row than can fit" );
+
+      uint8_t glyphs[NUMERIC_FONT_GLYPHS][NUMERIC_FONT_HEIGHT][NUMERIC_FONT_RUNS];
+      uint8_t masks[1 << NUMERIC_FONT_WIDTH][NUMERIC_FONT_RUNS];
+
+      constexpr ScaleTable() : glyphs(), masks()
+      {
+        int l_glyph = 0, l_row = 0, l_run = 0, l_mask = 0, l_column = 0, l_start = 0;
+
+        for ( l_glyph = 0; l_glyph < NUMERIC_FONT_GLYPHS; l_glyph++ )
+        {
+          for ( l_row = 0; l_row < NUMERIC_FONT_HEIGHT; l_row++ )
+          {
+            for ( l_run = 0; l_run < NUMERIC_FONT_SPANS; l_run++ )
+            {
+              /* Both nibbles scale together; neither can carry into the other. */
+              glyphs[l_glyph][l_row][l_run] = (uint8_t)( g_numeric_font_spans[l_glyph][l_row][l_run] * S );
+            }
+          }
+        }
+
+        /* Bit 0 of a mask is the leftmost column. */
+        for ( l_mask = 0; l_mask < ( 1 << NUMERIC_FONT_WIDTH ); l_mask++ )
+        {
+          l_run = 0;
+          for ( l_column = 0; l_column < NUMERIC_FONT_WIDTH; l_column++ )
+          {
+            if ( !( l_mask & ( 1 << l_column ) ) )
+            {
+              continue;
+            }
+            l_start = l_column;
+            while ( ( l_column + 1 < NUMERIC_FONT_WIDTH ) && ( l_mask & ( 2 << l_column ) ) )
+            {
+              l_column++;
+            }
+            masks[l_mask][l_run++] = (uint8_t)( ( ( l_start * S ) << 4 ) | ( ( l_column - l_start + 1 ) * S ) );
+          }
+        }
+      }
+    };
+
+    template <uint_fast8_t S>
+    static const ScaleTable<S> m_scaled;
+
+    /*
+     * blit - draws a single glyph's worth of columns. The glyph is clipped
+     *        once, up front, so each pixel can go straight to the buffer.
+     */
+    static void blit( pimoroni::PicoGraphics *p_graphics, int32_t p_x, int32_t p_y,
+                      const uint8_t *p_columns )
+    {
+      const pimoroni::Rect &l_clip = p_graphics->clip;
+      int32_t               l_first, l_last, l_row;
+      uint_fast8_t          l_mask, l_bits;
+
+      /* Which columns are inside the clip? */
+      l_first = ( l_clip.x > p_x ) ? l_clip.x - p_x : 0;
+      l_last = l_clip.x + l_clip.w - p_x;
+      if ( l_last > NUMERIC_FONT_WIDTH )
+      {
+        l_last = NUMERIC_FONT_WIDTH;
+      }
+
+      /* And rows; these are bits, so they turn into a mask. */
+      l_mask = ( 1 << NUMERIC_FONT_HEIGHT ) - 1;
+      if ( l_clip.y > p_y )
+      {
+        l_mask = ( l_clip.y - p_y >= NUMERIC_FONT_HEIGHT ) ? 0 : l_mask & ( l_mask << ( l_clip.y - p_y ) );
+      }
+      if ( l_clip.y + l_clip.h < p_y + NUMERIC_FONT_HEIGHT )
+      {
+        l_mask = ( l_clip.y + l_clip.h <= p_y ) ? 0 : l_mask & ( ( 1 << ( l_clip.y + l_clip.h - p_y ) ) - 1 );
+      }
+
+      /* Everything left is visible. */
+      for ( ; l_first < l_last; l_first++ )
+      {
+        l_bits = p_columns[l_first] & l_mask;
+        for ( l_row = 0; l_bits != 0; l_row++, l_bits >>= 1 )
+        {
+          if ( l_bits & 0x01 )
+          {
+            p_graphics->set_pixel( pimoroni::Point( p_x + l_first, p_y + l_row ) );
+          }
+        }
+      }
+      return;
+    }
+
   public:
     static void render( pimoroni::PicoGraphics *p_graphics, uint_fast8_t p_x, uint_fast8_t p_y, uint_fast8_t p_digit )
     {
-      const uint_fast8_t *l_font_data;
-      uint_fast8_t        l_row, l_column;
-
       /* We only render single digits, and a half dozen symbols. */
-      if ( p_digit > 15 )
+      if ( p_digit >= NUMERIC_FONT_GLYPHS )
+      {
+        return;
+      }
+
+      blit( p_graphics, p_x, p_y, g_numeric_font_columns[p_digit] );
+      return;
+    }
+
+    /*
+     * roll - renders a frame part way through one digit rolling up into the
+     *        next; frames run from 0 to NUMERIC_FONT_ROLL_FRAMES-1, and
+     *        anything past that is just the new digit.
+     */
+    static void roll( pimoroni::PicoGraphics *p_graphics, uint_fast8_t p_x, uint_fast8_t p_y,
+                      uint_fast8_t p_from, uint_fast8_t p_to, uint_fast8_t p_frame )
+    {
+      if ( ( p_from > 9 ) || ( p_to > 9 ) || ( p_from == p_to ) || ( p_frame >= NUMERIC_FONT_ROLL_FRAMES ) )
       {
+        render( p_graphics, p_x, p_y, p_to );
         return;
       }
 
-      /* Select the correct font data then. */
-      l_font_data = m_font_data[p_digit];
+      blit( p_graphics, p_x, p_y, m_roll.columns[p_from][p_to][p_frame] );
+      return;
+    }
+
+    /*
+     * Canvas versions (see canvas.hpp) of the above; a glyph which is wholly
+     * on the canvas is drawn without any clipping at all.
+     */
+    template <class C>
+    static void blit( C &p_canvas, int p_x, int p_y, const uint8_t *p_columns,
+                      typename C::pen_t p_pen )
+    {
+      uint_fast8_t  l_column, l_row, l_bits;
+      bool          l_inside;
+
+      l_inside = ( p_x >= 0 ) && ( p_x + NUMERIC_FONT_WIDTH <= C::WIDTH ) &&
+                 ( p_y >= 0 ) && ( p_y + NUMERIC_FONT_HEIGHT <= C::HEIGHT );
 
-      /* Work through each column. */
-      for( l_column = 0; l_column < NUMERIC_FONT_WIDTH; l_column++ )
+      for ( l_column = 0; l_column < NUMERIC_FONT_WIDTH; l_column++ )
       {
-        for ( l_row = 0; l_row < NUMERIC_FONT_HEIGHT; l_row++ )
+        l_bits = p_columns[l_column];
+        for ( l_row = 0; l_bits != 0; l_row++, l_bits >>= 1 )
         {
-          /* Only draw if the bit is set. */
-          if ( l_font_data[l_column] & ( 0x01 << l_row ) )
+          if ( l_bits & 0x01 )
           {
-            p_graphics->pixel( pimoroni::Point( p_x + l_column, p_y + l_row ) );
+            if ( l_inside )
+            {
+              p_canvas.set( p_x + l_column, p_y + l_row, p_pen );
+            }
+            else
+            {
+              p_canvas.pixel( p_x + l_column, p_y + l_row, p_pen );
+            }
           }
         }
       }
+      return;
+    }
+
+    template <class C>
+    static void render( C &p_canvas, int p_x, int p_y, uint_fast8_t p_digit, typename C::pen_t p_pen )
+    {
+      if ( p_digit >= NUMERIC_FONT_GLYPHS )
+      {
+        return;
+      }
+
+      blit( p_canvas, p_x, p_y, g_numeric_font_columns[p_digit], p_pen );
+      return;
+    }
+
+    /* At a fixed position, the compiler checks the glyph fits. */
+    template <int X, int Y, class C>
+    static void render( C &p_canvas, uint_fast8_t p_digit, typename C::pen_t p_pen )
+    {
+      static_assert( ( X >= 0 ) && ( X + NUMERIC_FONT_WIDTH <= C::WIDTH ) &&
+                     ( Y >= 0 ) && ( Y + NUMERIC_FONT_HEIGHT <= C::HEIGHT ), "glyph is off the canvas" );
+
+      render( p_canvas, X, Y, p_digit, p_pen );
+      return;
+    }
+
+    template <class C>
+    static void roll( C &p_canvas, int p_x, int p_y, uint_fast8_t p_from, uint_fast8_t p_to,
+                      uint_fast8_t p_frame, typename C::pen_t p_pen )
+    {
+      if ( ( p_from > 9 ) || ( p_to > 9 ) || ( p_from == p_to ) || ( p_frame >= NUMERIC_FONT_ROLL_FRAMES ) )
+      {
+        render( p_canvas, p_x, p_y, p_to, p_pen );
+        return;
+      }
+
+      blit( p_canvas, p_x, p_y, m_roll.columns[p_from][p_to][p_frame], p_pen );
+      return;
+    }
+
+    /*
+     * Scaled versions, S times the size (up to NUMERIC_FONT_SCALE_MAX), for
+     * reading across a room. Each run of a row is a single span, repeated
+     * for S rows, rather than S*S pixels per lit bit. Spans are clipped, so
+     * a glyph can straddle panels; on a wall of them, each panel draws the
+     * whole clock, offset by its own position, and keeps its own slice.
+     */
+    template <uint_fast8_t S, class C>
+    static void blit_scaled( C &p_canvas, int p_x, int p_y, const uint8_t *const *p_rows,
+                             typename C::pen_t p_pen )
+    {
+      uint_fast8_t  l_row, l_run, l_repeat, l_packed;
+      int           l_y;
+
+      for ( l_row = 0, l_y = p_y; l_row < NUMERIC_FONT_HEIGHT; l_row++, l_y += S )
+      {
+        for ( l_run = 0; l_run < NUMERIC_FONT_RUNS; l_run++ )
+        {
+          if ( ( l_packed = p_rows[l_row][l_run] ) == 0 )
+          {
+            break;
+          }
+          for ( l_repeat = 0; l_repeat < S; l_repeat++ )
+          {
+            p_canvas.span( p_x + ( l_packed >> 4 ), l_y + l_repeat, l_packed & 0x0f, p_pen );
+          }
+        }
+      }
+      return;
+    }
+
+    template <uint_fast8_t S, class C>
+    static void render_scaled( C &p_canvas, int p_x, int p_y, uint_fast8_t p_digit, typename C::pen_t p_pen )
+    {
+      const uint8_t  *l_rows[NUMERIC_FONT_HEIGHT];
+      uint_fast8_t    l_row;
+
+      if ( p_digit >= NUMERIC_FONT_GLYPHS )
+      {
+        return;
+      }
+
+      for ( l_row = 0; l_row < NUMERIC_FONT_HEIGHT; l_row++ )
+      {
+        l_rows[l_row] = m_scaled<S>.glyphs[p_digit][l_row];
+      }
+      blit_scaled<S>( p_canvas, p_x, p_y, l_rows, p_pen );
+      return;
+    }
+
+    /* Rolling frames are stored by column; turn each row into a mask first. */
+    template <uint_fast8_t S, class C>
+    static void roll_scaled( C &p_canvas, int p_x, int p_y, uint_fast8_t p_from, uint_fast8_t p_to,
+                             uint_fast8_t p_frame, typename C::pen_t p_pen )
+    {
+      const uint8_t  *l_rows[NUMERIC_FONT_HEIGHT];
+      const uint8_t  *l_columns;
+      uint_fast8_t    l_row, l_column, l_mask;
+
+      if ( ( p_from > 9 ) || ( p_to > 9 ) || ( p_from == p_to ) || ( p_frame >= NUMERIC_FONT_ROLL_FRAMES ) )
+      {
+        render_scaled<S>( p_canvas, p_x, p_y, p_to, p_pen );
+        return;
+      }
+
+      l_columns = m_roll.columns[p_from][p_to][p_frame];
+      for ( l_row = 0; l_row < NUMERIC_FONT_HEIGHT; l_row++ )
+      {
+        for ( l_column = 0, l_mask = 0; l_column < NUMERIC_FONT_WIDTH; l_column++ )
+        {
+          l_mask |= ( ( l_columns[l_column] >> l_row ) & 0x01 ) << l_column;
+        }
+        l_rows[l_row] = m_scaled<S>.masks[l_mask];
+      }
+      blit_scaled<S>( p_canvas, p_x, p_y, l_rows, p_pen );
+      return;
     }
 };
 
+inline constexpr NumericFont::RollTable NumericFont::m_roll;
+
+template <uint_fast8_t S>
+inline constexpr NumericFont::ScaleTable<S> NumericFont::m_scaled;
+
 
 #endif /* NUMERIC_FONT_HPP */
 
@@ -0,0 +1,138 @@
+/*
+ * pen_cache.hpp - from the Unicorn C(++) Examples collection
+ *
+ * Turning a colour into a pen isn't free - through PicoGraphics it's a virtual
+ * call, and for palette formats a search - yet per-frame code tends to ask
+ * for the same handful of colours over and over. Two ways round that, both
+ * owned by the caller rather than hidden away in a global:
+ *
+ *  - PenCache, a small direct-mapped cache keyed by the packed RGB value, for
+ *    colours worked out on the fly (a background that shifts slowly with the
+ *    time of day, say); a miss simply replaces whatever was in that slot.
+ *
+ *  - pen_table(), which turns a fixed list of colours into pens once, up
+ *    front, for effects whose palette never changes.
+ *
+ * Both work with anything offering create_pen(r, g, b) - the canvases, or
+ * PicoGraphics itself. When instrumented, every lookup (and every hit) is
+ * counted, and reported per frame along with the other counters.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef PEN_CACHE_HPP
+#define PEN_CACHE_HPP
+
+
+/* System headers. */
+
+#include <stdint.h>
+
+
+/* Local headers. */
+
+#include "instrument.hpp"
+
+
+/* Constants. */
+
+/* Comfortably more than the 27 colours of better_clock's background. */
+#define PEN_CACHE_SLOTS         64
+
+/* Packed RGB only uses 24 bits; the top one marks a slot as filled. */
+#define PEN_CACHE_VALID         0x01000000
+
+
+/* Structs. */
+
+/* One entry of a fixed palette, for pen_table(). */
+typedef struct
+{
+  uint8_t   r, g, b;
+} pencolour_t;
+
+
+/* Class. */
+
+template <class C, uint_fast16_t N = PEN_CACHE_SLOTS>
+class PenCache
+{
+  static_assert( ( N & ( N - 1 ) ) == 0, "pen cache size must be a power of two" );
+
+  public:
+    typedef typename C::pen_t   pen_t;
+
+  private:
+    uint32_t  m_keys[N];
+    pen_t     m_pens[N];
+
+  public:
+    PenCache( void ) : m_keys(), m_pens()
+    {
+    }
+
+    /* Forgets everything; needed if the canvas's palette is ever changed. */
+    void clear( void )
+    {
+      uint_fast16_t l_index;
+
+      for ( l_index = 0; l_index < N; l_index++ )
+      {
+        m_keys[l_index] = 0;
+      }
+      return;
+    }
+
+    /*
+     * pen - the pen for a colour; from the cache if we've seen it lately,
+     *       otherwise from the canvas (and remembered for next time).
+     */
+    pen_t pen( C &p_canvas, uint8_t p_r, uint8_t p_g, uint8_t p_b )
+    {
+      uint32_t      l_key = PEN_CACHE_VALID | ( p_r << 16 ) | ( p_g << 8 ) | p_b;
+      uint_fast16_t l_slot;
+
+      /* Fold the channels together, so near-identical colours spread out. */
+      l_slot = ( ( l_key * 2654435761u ) >> 16 ) & ( N - 1 );
+
+      Instrument::count( INSTRUMENT_COUNT_PENS );
+      if ( m_keys[l_slot] == l_key )
+      {
+        Instrument::count( INSTRUMENT_COUNT_PEN_HITS );
+        return m_pens[l_slot];
+      }
+
+      m_keys[l_slot] = l_key;
+      m_pens[l_slot] = p_canvas.create_pen( p_r, p_g, p_b );
+      return m_pens[l_slot];
+    }
+};
+
+
+/* Functions. */
+
+/*
+ * pen_table - fills a caller-owned table of pens from a list of colours; for
+ *             palettes which are fixed, so can be worked out just the once.
+ */
+
+template <class C, typename P>
+void pen_table( C &p_canvas, const pencolour_t *p_colours, P *p_pens, uint_fast16_t p_count )
+{
+  uint_fast16_t l_index;
+
+  for ( l_index = 0; l_index < p_count; l_index++ )
+  {
+    p_pens[l_index] = p_canvas.create_pen( p_colours[l_index].r, p_colours[l_index].g, p_colours[l_index].b );
+  }
+  Instrument::count( INSTRUMENT_COUNT_PENS, p_count );
+  return;
+}
+
+
+#endif /* PEN_CACHE_HPP */
+
+/* End of file pen_cache.hpp */
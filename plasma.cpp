@@ -0,0 +1,354 @@
+/*
+ * plasma.cpp - from the Unicorn C(++) Examples collection
+ *
+ * Another demoscene staple, the plasma. Rather than calling sin() for every
+ * pixel, we use a 256 entry sine table (built at compile time) indexed by
+ * 8.8 fixed point phase accumulators.
+ *
+ * Better still, the plasma is the sum of some sines which only depend on the
+ * column, and some which only depend on the row; we work those out once per
+ * column and once per row, so each pixel is just an add and a palette lookup.
+ * That means the cost per pixel stays flat, however big the canvas gets.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+
+/* Local headers. */
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+#include "libraries/galactic_unicorn/galactic_unicorn.hpp"
+#include "instrument.hpp"
+#include "app.hpp"
+
+
+/* Constants. */
+
+#define PLASMA_MAX_PANELS    3
+#define PLASMA_MAX_WIDTH     ( pimoroni::GalacticUnicorn::WIDTH * PLASMA_MAX_PANELS )
+#define PLASMA_MAX_HEIGHT    ( pimoroni::GalacticUnicorn::HEIGHT * PLASMA_MAX_PANELS )
+#define PLASMA_TERMS         2
+#define PLASMA_FPS           30
+#define PLASMA_BENCHMARK_FRAMES 200
+#define PLASMA_PI            3.14159265358979323846
+
+
+/* Enums. */
+
+typedef enum
+{
+  PLASMA_STAGE_UPDATE,
+  PLASMA_STAGE_RENDER,
+  PLASMA_STAGE_PRESENT
+} plasma_stage_t;
+
+
+/* Structs. */
+
+typedef struct
+{
+  uint16_t  phase;       /* 8.8 fixed point, so it wraps every 256 entries. */
+  uint16_t  step;        /* Phase change per pixel along the axis.          */
+  int16_t   drift;       /* Phase change per frame, to animate.             */
+} plasmaterm_t;
+
+typedef struct
+{
+  plasmaterm_t  columns[PLASMA_TERMS];
+  plasmaterm_t  rows[PLASMA_TERMS];
+  int16_t       column_sum[PLASMA_MAX_WIDTH];
+  int16_t       row_sum[PLASMA_MAX_HEIGHT];
+  uint16_t      palette[256];
+  uint8_t       cycle;
+} plasmastate_t;
+
+
+/* Sine table. */
+
+/*
+ * A constexpr sine, good enough to build an 8 bit table at compile time;
+ * a Taylor series, after folding the angle into -pi/2 .. pi/2.
+ */
+
+constexpr double plasma_sin( double p_angle )
+{
+  double  l_term = 0, l_sum = 0;
+  int     l_index = 0;
+
+  if ( p_angle > PLASMA_PI / 2 )
+  {
+    p_angle = PLASMA_PI - p_angle;
+  }
+  if ( p_angle < -PLASMA_PI / 2 )
+  {
+    p_angle = -PLASMA_PI - p_angle;
+  }
+
+  l_term = l_sum = p_angle;
+  for ( l_index = 1; l_index < 8; l_index++ )
+  {
+    l_term *= -p_angle * p_angle / ( ( 2 * l_index ) * ( 2 * l_index + 1 ) );
+    l_sum += l_term;
+  }
+
+  return l_sum;
+}
+
+struct PlasmaSineTable
+{
+  int8_t  value[256];
+
+  constexpr PlasmaSineTable() : value()
+  {
+    double  l_sine = 0;
+    int     l_index = 0;
+
+    for ( l_index = 0; l_index < 256; l_index++ )
+    {
+      l_sine = 127.0 * plasma_sin( ( l_index < 128 ? l_index : l_index - 256 ) * PLASMA_PI / 128.0 );
+      value[l_index] = (int8_t)( l_sine + ( l_sine < 0 ? -0.5 : 0.5 ) );
+    }
+  }
+};
+
+static constexpr PlasmaSineTable g_sine;
+
+
+/* Functions. */
+
+/*
+ * plasma_axis - works out the summed sine terms along one axis, stepping
+ *               the phases along rather than multiplying for each pixel.
+ */
+
+void plasma_axis( plasmaterm_t *p_terms, int16_t *p_sums, uint_fast16_t p_length )
+{
+  uint16_t      l_phase[PLASMA_TERMS];
+  uint_fast16_t l_index;
+  uint_fast8_t  l_term;
+
+  for ( l_term = 0; l_term < PLASMA_TERMS; l_term++ )
+  {
+    l_phase[l_term] = p_terms[l_term].phase;
+  }
+
+  for ( l_index = 0; l_index < p_length; l_index++ )
+  {
+    p_sums[l_index] = 0;
+    for ( l_term = 0; l_term < PLASMA_TERMS; l_term++ )
+    {
+      p_sums[l_index] += g_sine.value[l_phase[l_term] >> 8];
+      l_phase[l_term] += p_terms[l_term].step;
+    }
+  }
+
+  /* And move the animation on for next time. */
+  for ( l_term = 0; l_term < PLASMA_TERMS; l_term++ )
+  {
+    p_terms[l_term].phase += p_terms[l_term].drift;
+  }
+
+  return;
+}
+
+
+/*
+ * plasma_update - refreshes the per-column and per-row sums for a canvas of
+ *                 the given size.
+ */
+
+void plasma_update( plasmastate_t *p_plasma, uint_fast16_t p_width, uint_fast16_t p_height )
+{
+  plasma_axis( p_plasma->columns, p_plasma->column_sum, p_width );
+  plasma_axis( p_plasma->rows, p_plasma->row_sum, p_height );
+  p_plasma->cycle++;
+  return;
+}
+
+
+/*
+ * plasma_render - combines the column and row sums for each pixel, and maps
+ *                 them through the palette into an RGB565 buffer.
+ */
+
+void plasma_render( const plasmastate_t *p_plasma, uint16_t *p_buffer,
+                    uint_fast16_t p_width, uint_fast16_t p_height )
+{
+  int_fast16_t  l_row;
+  uint_fast16_t l_x, l_y;
+
+  for ( l_y = 0; l_y < p_height; l_y++ )
+  {
+    /* Fold the palette cycling into the row term, once per row. */
+    l_row = p_plasma->row_sum[l_y] + ( p_plasma->cycle << 2 );
+
+    for ( l_x = 0; l_x < p_width; l_x++ )
+    {
+      /* Four sines of +/-127 sum to +/-508; a quarter of that indexes 256. */
+      *p_buffer++ = p_plasma->palette[( ( p_plasma->column_sum[l_x] + l_row ) >> 2 ) & 0xff];
+    }
+  }
+
+  return;
+}
+
+
+/*
+ * plasma_init - sets up the palette, and the speeds of the various terms.
+ */
+
+void plasma_init( plasmastate_t *p_plasma, pimoroni::PicoGraphics *p_graphics )
+{
+  static const plasmaterm_t l_columns[PLASMA_TERMS] = { { 0, 0x0600, 0x0180 }, { 0x4000, 0x0280, -0x00c0 } };
+  static const plasmaterm_t l_rows[PLASMA_TERMS]    = { { 0, 0x0900, -0x0100 }, { 0x8000, 0x0400, 0x0140 } };
+  uint_fast16_t l_index;
+
+  memcpy( p_plasma->columns, l_columns, sizeof( l_columns ) );
+  memcpy( p_plasma->rows, l_rows, sizeof( l_rows ) );
+  p_plasma->cycle = 0;
+
+  /* A smooth loop around the colour wheel, with the channels 120 degrees apart. */
+  for ( l_index = 0; l_index < 256; l_index++ )
+  {
+    p_plasma->palette[l_index] = p_graphics->create_pen(
+      128 + g_sine.value[l_index & 0xff],
+      128 + g_sine.value[( l_index + 85 ) & 0xff],
+      128 + g_sine.value[( l_index + 170 ) & 0xff]
+    );
+  }
+
+  return;
+}
+
+
+/*
+ * plasma_benchmark - runs the effect flat out on the panel, and then on a
+ *                    bigger (chained panel) canvas, reporting cycles/pixel.
+ */
+
+void plasma_benchmark( plasmastate_t *p_plasma, pimoroni::PicoGraphics *p_graphics )
+{
+#ifdef UNICORN_INSTRUMENT
+  uint16_t     *l_buffer;
+  uint64_t      l_start, l_elapsed;
+  uint_fast16_t l_index, l_width, l_height;
+  uint_fast8_t  l_panels;
+  uint32_t      l_mhz = clock_get_hz( clk_sys ) / 1000000;
+
+  l_buffer = new uint16_t[PLASMA_MAX_WIDTH * PLASMA_MAX_HEIGHT];
+
+  for ( l_panels = 1; l_panels <= PLASMA_MAX_PANELS; l_panels++ )
+  {
+    l_width = pimoroni::GalacticUnicorn::WIDTH * l_panels;
+    l_height = pimoroni::GalacticUnicorn::HEIGHT * l_panels;
+
+    l_start = time_us_64();
+    for ( l_index = 0; l_index < PLASMA_BENCHMARK_FRAMES; l_index++ )
+    {
+      plasma_update( p_plasma, l_width, l_height );
+      plasma_render( p_plasma, l_buffer, l_width, l_height );
+    }
+    l_elapsed = time_us_64() - l_start;
+
+    printf( "plasma: %dx%d, %lluus/frame, %.1f cycles/pixel\n",
+            (int)l_width, (int)l_height, l_elapsed / PLASMA_BENCHMARK_FRAMES,
+            (float)l_elapsed * l_mhz / ( PLASMA_BENCHMARK_FRAMES * l_width * l_height ) );
+  }
+
+  delete[] l_buffer;
+#endif
+  return;
+}
+
+
+/*
+ * PlasmaApp - sums the row and column terms each frame, straight into pens.
+ */
+
+class PlasmaApp : public UnicornApp
+{
+  private:
+    plasmastate_t                     m_plasma;
+
+  public:
+    void init( appcontext_t *p_context )
+    {
+      plasma_init( &m_plasma, p_context->graphics );
+      plasma_benchmark( &m_plasma, p_context->graphics );
+      return;
+    }
+
+    void resume( appcontext_t *p_context )
+    {
+      Instrument::name_stage( PLASMA_STAGE_UPDATE, "update" );
+      Instrument::name_stage( PLASMA_STAGE_RENDER, "render" );
+      Instrument::name_stage( PLASMA_STAGE_PRESENT, "present" );
+      return;
+    }
+
+    void update( appcontext_t *p_context )
+    {
+      uint32_t  l_stage_tick;
+
+      l_stage_tick = Instrument::start( PLASMA_STAGE_UPDATE );
+      plasma_update( &m_plasma, pimoroni::GalacticUnicorn::WIDTH, pimoroni::GalacticUnicorn::HEIGHT );
+      Instrument::record( PLASMA_STAGE_UPDATE, time_us_32() - l_stage_tick );
+      return;
+    }
+
+    void render( appcontext_t *p_context )
+    {
+      uint32_t  l_stage_tick;
+
+      /* Every pixel is written, so there's no need to clear the screen first. */
+      l_stage_tick = Instrument::start( PLASMA_STAGE_RENDER );
+      plasma_render( &m_plasma, (uint16_t *)p_context->graphics->frame_buffer,
+                     pimoroni::GalacticUnicorn::WIDTH, pimoroni::GalacticUnicorn::HEIGHT );
+      Instrument::record( PLASMA_STAGE_RENDER, time_us_32() - l_stage_tick );
+
+      /* Plasma is drawn - so, we ask the Unicorn to update. */
+      l_stage_tick = Instrument::start( PLASMA_STAGE_PRESENT );
+      p_context->unicorn->update( p_context->graphics );
+      Instrument::record( PLASMA_STAGE_PRESENT, time_us_32() - l_stage_tick );
+
+      /* And the next frame is due at our usual rate. */
+      p_context->scheduler->next_fps( PLASMA_FPS );
+      return;
+    }
+};
+
+
+/*
+ * plasma_app - hands out the plasma, for whoever is running it.
+ */
+
+UnicornApp *plasma_app( void )
+{
+  static PlasmaApp  l_plasma;
+  return &l_plasma;
+}
+
+
+/*
+ * main - entry point; when we're built on our own, we're the only app.
+ */
+
+#ifndef UNICORN_LAUNCHER
+int main()
+{
+  UnicornApp *l_apps[] = { plasma_app() };
+
+  AppRunner::run( l_apps, 1 );
+
+  /* We'll never get here! */
+  return 0;
+}
+#endif
+
+/* End of file plasma.cpp */
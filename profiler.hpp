@@ -0,0 +1,357 @@
+/*
+ * profiler.hpp - from the Unicorn C(++) Examples collection
+ *
+ * A sampling profiler, for finding out where the cycles go on a Unicorn we
+ * can't attach a debugger to - including inside pico_graphics, the Unicorn
+ * driver and lwIP, which the stage timings can't see into.
+ *
+ * A spare hardware alarm interrupts us PROFILER_DEFAULT_HZ times a second, at
+ * the highest priority, so that it samples inside other interrupt handlers
+ * too. A tiny assembler shim hands the sampler the exception frame the core
+ * pushed on entry, which holds the interrupted PC (and LR, which is usually
+ * its caller, or near enough); each pair is counted in a fixed-size table.
+ *
+ * The sampler lives in RAM, so it doesn't disturb the flash cache, and
+ * times itself on SysTick; the dump gives its cost as a share of the
+ * time, which at the default rate should be well under 1%.
+ *
+ * 'profile dump' on the console (see console.hpp) prints the table, a few
+ * lines a frame, for tools/profile.py to turn into a flat profile or flame
+ * graph against the ELF. Only core 0 is sampled.
+ *
+ * All of this is only compiled in if UNICORN_PROFILE is defined (the CMake
+ * option of the same name does that for you); otherwise every call collapses
+ * to nothing.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+
+/* System headers. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/timer.h"
+#include "hardware/structs/systick.h"
+
+
+/* Constants. */
+
+#define PROFILER_DEFAULT_HZ     1000
+#define PROFILER_MAX_HZ         10000
+#define PROFILER_SLOTS          512
+#define PROFILER_PROBES         8
+
+/* Stacking and unstacking the frame isn't seen by SysTick; roughly this. */
+#define PROFILER_ENTRY_CYCLES   32
+
+/* How many lines of the table to print each frame, while dumping. */
+#define PROFILER_DUMP_LINES     16
+
+#define PROFILER_PREFIX         "PROFILE "
+
+
+/* Structs. */
+
+typedef struct
+{
+  uint32_t  pc;
+  uint32_t  caller;
+  uint32_t  count;
+} profileslot_t;
+
+
+/* Class. */
+
+class Profiler
+{
+  private:
+    static inline profileslot_t     m_slots[PROFILER_SLOTS];
+    static inline volatile uint32_t m_samples, m_dropped;
+    static inline volatile uint64_t m_cycles;
+    static inline uint32_t          m_period_us, m_next;
+    static inline int               m_alarm = -1;
+    static inline bool              m_running;
+    static inline uint64_t          m_started_us, m_elapsed_us;
+    static inline bool              m_dumping, m_resume;
+    static inline uint_fast16_t     m_dump_slot;
+
+    static void arm( void )
+    {
+      m_next = timer_hw->timerawl + m_period_us;
+      timer_hw->alarm[m_alarm] = m_next;
+      return;
+    }
+
+  public:
+    /*
+     * sample - called (via the shim) with the exception frame; r0-r3, r12,
+     *          lr, pc, xpsr. Counts the pair, and sets up the next alarm.
+     */
+    static void __not_in_flash_func( sample )( const uint32_t *p_frame )
+    {
+      uint32_t      l_start = systick_hw->cvr;
+      uint32_t      l_pc = p_frame[6], l_caller = p_frame[5];
+      uint_fast16_t l_slot, l_probe;
+
+      timer_hw->intr = 1u << m_alarm;
+
+      /* Open addressing, but only so far; if it's that full, just count it. */
+      l_slot = ( ( l_pc >> 1 ) ^ ( l_caller * 2654435761u ) ) & ( PROFILER_SLOTS - 1 );
+      for ( l_probe = 0; l_probe < PROFILER_PROBES; l_probe++ )
+      {
+        profileslot_t *l_entry = &m_slots[( l_slot + l_probe ) & ( PROFILER_SLOTS - 1 )];
+        if ( l_entry->count == 0 )
+        {
+          l_entry->pc = l_pc;
+          l_entry->caller = l_caller;
+        }
+        if ( ( l_entry->pc == l_pc ) && ( l_entry->caller == l_caller ) )
+        {
+          l_entry->count++;
+          break;
+        }
+      }
+      if ( l_probe == PROFILER_PROBES )
+      {
+        m_dropped++;
+      }
+      m_samples++;
+
+      /* Keep to the beat, unless we've fallen right behind it. */
+      m_next += m_period_us;
+      if ( (int32_t)( m_next - timer_hw->timerawl ) <= 0 )
+      {
+        m_next = timer_hw->timerawl + m_period_us;
+      }
+      timer_hw->alarm[m_alarm] = m_next;
+
+      m_cycles += ( ( l_start - systick_hw->cvr ) & 0x00ffffff ) + PROFILER_ENTRY_CYCLES;
+      return;
+    }
+
+    /* Starts sampling at the given rate (or carries on, at the new one). */
+    static bool start( uint32_t p_hz = PROFILER_DEFAULT_HZ );
+
+    static void stop( void )
+    {
+#ifdef UNICORN_PROFILE
+      if ( m_running )
+      {
+        hw_clear_bits( &timer_hw->inte, 1u << m_alarm );
+        timer_hw->armed = 1u << m_alarm;
+        timer_hw->intr = 1u << m_alarm;
+        m_elapsed_us += time_us_64() - m_started_us;
+        m_running = false;
+      }
+#endif
+      return;
+    }
+
+    static void clear( void )
+    {
+#ifdef UNICORN_PROFILE
+      bool  l_running = m_running;
+
+      stop();
+      memset( m_slots, 0, sizeof( m_slots ) );
+      m_samples = m_dropped = 0;
+      m_cycles = 0;
+      m_elapsed_us = 0;
+      if ( l_running )
+      {
+        start( 1000000 / m_period_us );
+      }
+#endif
+      return;
+    }
+
+    /* What share of the time sampling has taken, in hundredths of a percent. */
+    static uint32_t overhead( void )
+    {
+      uint64_t  l_elapsed = m_elapsed_us + ( m_running ? time_us_64() - m_started_us : 0 );
+      uint64_t  l_available = l_elapsed * ( clock_get_hz( clk_sys ) / 1000000 );
+
+      return l_available ? (uint32_t)( m_cycles * 10000 / l_available ) : 0;
+    }
+
+    /*
+     * poll - called once a frame; if a dump's been asked for, prints the
+     *        next few lines of it, with sampling paused until it's done.
+     */
+    static void poll( void )
+    {
+#ifdef UNICORN_PROFILE
+      uint_fast8_t  l_lines;
+
+      if ( !m_dumping )
+      {
+        return;
+      }
+
+      for ( l_lines = 0; ( l_lines < PROFILER_DUMP_LINES ) && ( m_dump_slot < PROFILER_SLOTS ); m_dump_slot++ )
+      {
+        if ( m_slots[m_dump_slot].count > 0 )
+        {
+          printf( PROFILER_PREFIX "%08lx %08lx %lu\n", (unsigned long)m_slots[m_dump_slot].pc,
+                  (unsigned long)m_slots[m_dump_slot].caller, (unsigned long)m_slots[m_dump_slot].count );
+          l_lines++;
+        }
+      }
+      if ( m_dump_slot == PROFILER_SLOTS )
+      {
+        printf( PROFILER_PREFIX "end\n" );
+        m_dumping = false;
+        clear();
+        if ( m_resume )
+        {
+          start( 1000000 / m_period_us );
+        }
+      }
+#endif
+      return;
+    }
+
+    static bool cmd_profile( void *p_target, uint_fast8_t p_argc, char *p_argv[] );
+};
+
+
+/* The shim, and the start of sampling, need a real build to mean anything. */
+
+#ifdef UNICORN_PROFILE
+
+/* Plain C linkage, so the shim can find it by name. */
+extern "C" inline void __attribute__(( used ))
+__not_in_flash_func( profiler_sample )( const uint32_t *p_frame )
+{
+  Profiler::sample( p_frame );
+  return;
+}
+
+/*
+ * Which stack the frame went on depends on bit 2 of EXC_RETURN (in LR);
+ * find it, and tail-call the sampler, so that it returns from the exception.
+ */
+extern "C" inline void __attribute__(( naked )) __not_in_flash_func( profiler_irq )( void )
+{
+  __asm volatile (
+    "  movs r0, #4          \n"
+    "  mov  r1, lr          \n"
+    "  tst  r0, r1          \n"
+    "  beq  1f              \n"
+    "  mrs  r0, psp         \n"
+    "  b    2f              \n"
+    "1:                     \n"
+    "  mrs  r0, msp         \n"
+    "2:                     \n"
+    "  ldr  r1, =profiler_sample \n"
+    "  bx   r1              \n"
+  );
+}
+
+inline bool Profiler::start( uint32_t p_hz )
+{
+  if ( ( p_hz == 0 ) || ( p_hz > PROFILER_MAX_HZ ) )
+  {
+    return false;
+  }
+  stop();
+
+  /* The first time, find ourselves an alarm, and get SysTick counting. */
+  if ( m_alarm < 0 )
+  {
+    if ( ( m_alarm = hardware_alarm_claim_unused( false ) ) < 0 )
+    {
+      printf( "profiler: no free hardware alarm\n" );
+      return false;
+    }
+    irq_set_exclusive_handler( TIMER_IRQ_0 + m_alarm, profiler_irq );
+    irq_set_priority( TIMER_IRQ_0 + m_alarm, PICO_HIGHEST_IRQ_PRIORITY );
+    irq_set_enabled( TIMER_IRQ_0 + m_alarm, true );
+
+    systick_hw->rvr = 0x00ffffff;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x05;
+  }
+
+  m_period_us = 1000000 / p_hz;
+  m_started_us = time_us_64();
+  m_running = true;
+  hw_set_bits( &timer_hw->inte, 1u << m_alarm );
+  arm();
+  return true;
+}
+
+#else
+
+inline bool Profiler::start( uint32_t p_hz )
+{
+  return false;
+}
+
+#endif /* UNICORN_PROFILE */
+
+
+/*
+ * cmd_profile - the console's 'profile' command; start [hz], stop, clear,
+ *               or dump (and then start afresh).
+ */
+
+inline bool Profiler::cmd_profile( void *p_target, uint_fast8_t p_argc, char *p_argv[] )
+{
+#ifdef UNICORN_PROFILE
+  if ( p_argc < 2 )
+  {
+    printf( "profiler: %s at %luHz, %lu samples (%lu dropped), overhead %lu.%02lu%%\n",
+            m_running ? "running" : "stopped", (unsigned long)( m_period_us ? 1000000 / m_period_us : 0 ),
+            (unsigned long)m_samples, (unsigned long)m_dropped,
+            (unsigned long)( overhead() / 100 ), (unsigned long)( overhead() % 100 ) );
+    return true;
+  }
+  if ( strcmp( p_argv[1], "start" ) == 0 )
+  {
+    return start( ( p_argc > 2 ) ? strtoul( p_argv[2], nullptr, 10 ) : PROFILER_DEFAULT_HZ );
+  }
+  if ( strcmp( p_argv[1], "stop" ) == 0 )
+  {
+    stop();
+    return true;
+  }
+  if ( strcmp( p_argv[1], "clear" ) == 0 )
+  {
+    clear();
+    return true;
+  }
+  if ( ( strcmp( p_argv[1], "dump" ) == 0 ) && ( m_period_us > 0 ) && !m_dumping )
+  {
+    m_resume = m_running;
+    stop();
+    printf( PROFILER_PREFIX "begin hz=%lu samples=%lu dropped=%lu overhead=%lu.%02lu%% mhz=%lu\n",
+            (unsigned long)( 1000000 / m_period_us ), (unsigned long)m_samples, (unsigned long)m_dropped,
+            (unsigned long)( overhead() / 100 ), (unsigned long)( overhead() % 100 ),
+            (unsigned long)( clock_get_hz( clk_sys ) / 1000000 ) );
+    m_dump_slot = 0;
+    m_dumping = true;
+    return true;
+  }
+  return false;
+#else
+  printf( "profiler: not built in (see UNICORN_PROFILE)\n" );
+  return true;
+#endif
+}
+
+
+#endif /* PROFILER_HPP */
+
+/* End of file profiler.hpp */
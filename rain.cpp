@@ -4,6 +4,18 @@
  * This is an implementation of the terminal-era 'rain' program - it simulates
  * rain falling on your Unicorn!
  *
+ * Optionally (RAIN_DUAL_CORE), the frame is split in two and the bottom half
+ * is rendered by the second core while the first does the top; drops that
+ * straddle the split are simply drawn by both, each clipped to its own half.
+ *
+ * Drawing goes through a canvas (see canvas.hpp) sized to the band being
+ * drawn, so the clipping is against compile-time edges; the PicoGraphics
+ * version is kept for the benchmark to compare against.
+ *
+ * Several Unicorns side by side can share one wall of rain (RAIN_GENLOCK);
+ * panel 0 runs the rain for the whole wall, and sends each frame's drops to
+ * the others, which all present it at the same moment (see genlock.hpp).
+ *
  * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
  * Released under the MIT License; see LICENSE for details.
  */
@@ -19,6 +31,13 @@
 
 #include "libraries/pico_graphics/pico_graphics.hpp"
 #include "libraries/galactic_unicorn/galactic_unicorn.hpp"
+#include "canvas.hpp"
+#include "pen_cache.hpp"
+#include "dual_core.hpp"
+#include "instrument.hpp"
+#include "bench.hpp"
+#include "genlock.hpp"
+#include "app.hpp"
 
 
 /* Constants. */
@@ -26,6 +45,44 @@
 #define  RAINDROP_LIFESPAN    7
 #define  RAINDROP_MAX         10
 #define  RAINDROP_MIN         2
+#define  RAIN_FPS             8
+
+#ifndef RAIN_DUAL_CORE
+#define  RAIN_DUAL_CORE       0
+#endif
+#define  RAIN_SPLIT_Y         ( pimoroni::GalacticUnicorn::HEIGHT / 2 )
+#define  RAIN_WIDTH           pimoroni::GalacticUnicorn::WIDTH
+#define  RAIN_HEIGHT          pimoroni::GalacticUnicorn::HEIGHT
+#define  RAIN_FRAME_BYTES     ( RAIN_WIDTH * RAIN_HEIGHT * sizeof( uint16_t ) )
+
+/* A wall of RAIN_PANELS, of which we're RAIN_PANEL (counting from the left). */
+#ifndef RAIN_GENLOCK
+#define  RAIN_GENLOCK         0
+#endif
+#ifndef RAIN_PANELS
+#define  RAIN_PANELS          1
+#endif
+#ifndef RAIN_PANEL
+#define  RAIN_PANEL           0
+#endif
+#define  RAIN_WALL_WIDTH      ( RAIN_WIDTH * RAIN_PANELS )
+#define  RAIN_DROPS           ( RAINDROP_MAX * RAIN_PANELS )
+#define  RAIN_DROP_BYTES      3
+
+#define  RAIN_BENCHMARK_DENSE 64
+#define  RAIN_BENCHMARK_LIGHT 2
+#define  RAIN_BENCHMARK_FRAMES 500
+
+
+/* Enums. */
+
+typedef enum
+{
+  RAIN_STAGE_UPDATE,
+  RAIN_STAGE_RENDER,
+  RAIN_STAGE_JOIN,
+  RAIN_STAGE_PRESENT
+} rain_stage_t;
 
 
 /* Structs. */
@@ -38,159 +95,544 @@ typedef struct
   bool         alive;
 } raindrop_t;
 
+typedef struct
+{
+  pimoroni::PicoGraphics *graphics;
+  const raindrop_t       *raindrops;
+  uint_fast8_t            count;
+  const int              *palette;
+  int                     black_pen;
+  int                     origin_x;
+  bool                    cleared;    /* The DMA has already blanked the frame. */
+} rainjob_t;
+
+
+/* Canvases for the whole panel, and for each half of it. */
+typedef Canvas<RAIN_WIDTH, RAIN_HEIGHT, CanvasRGB565>                 RainCanvas;
+typedef Canvas<RAIN_WIDTH, RAIN_SPLIT_Y, CanvasRGB565>                RainTopCanvas;
+typedef Canvas<RAIN_WIDTH, RAIN_HEIGHT - RAIN_SPLIT_Y, CanvasRGB565>  RainBottomCanvas;
+
+static_assert( RAIN_WALL_WIDTH <= 256, "drop positions are kept in a byte" );
+static_assert( RAIN_DROPS * RAIN_DROP_BYTES <= GENLOCK_STATE_MAX, "too many drops to send each frame" );
+static_assert( ( RAIN_PANEL < RAIN_PANELS ) && ( RAIN_PANELS <= GENLOCK_PANELS_MAX ), "no such panel" );
+
+
+/* Globals. */
+
+/* A drop fades as it spreads, from a white splash to almost nothing. */
+static const pencolour_t g_rain_colours[RAINDROP_LIFESPAN] = {
+  { 255, 255, 255 }, {  50,  50, 150 }, {  40,  40, 100 }, {  30,  30,  80 },
+  {  20,  20,  50 }, {  10,  10,  20 }, {   5,   5,  10 }
+};
+
 
 /* Functions. */
 
+/*
+ * rain_render - clears, and draws every living raindrop into, whatever area
+ *               the graphics object is clipped to. Drops which can't touch
+ *               that area are skipped entirely. This is the generic path,
+ *               now only used by the benchmark.
+ */
+
+void rain_render( const rainjob_t *p_job )
+{
+  pimoroni::PicoGraphics *l_graphics = p_job->graphics;
+  const raindrop_t       *l_drop;
+  uint_fast8_t            l_index;
+
+  /* Start by clearing the screen (well, our part of it). */
+  l_graphics->set_pen( p_job->black_pen );
+  l_graphics->clear();
+
+  for( l_index = 0; l_index < p_job->count; l_index++ )
+  {
+    l_drop = &p_job->raindrops[l_index];
+
+    /*
+     * Skip any dead raindrops, or ones entirely outside our clip; signed, as
+     * a ring can spread above the top row (uint_fast8_t is a word on the Pico).
+     */
+    if ( !l_drop->alive ||
+         ( (int32_t)l_drop->y + (int32_t)l_drop->age < l_graphics->clip.y ) ||
+         ( (int32_t)l_drop->y - (int32_t)l_drop->age >= l_graphics->clip.y + l_graphics->clip.h ) )
+    {
+      continue;
+    }
+
+    /* First thing to do is to draw it then - outer circle first. */
+    l_graphics->set_pen( p_job->palette[l_drop->age] );
+    l_graphics->circle( pimoroni::Point( l_drop->x, l_drop->y ), l_drop->age );
+
+    /*
+     * But circles are filled, so we draw a slightly smaller black circle
+     * inside it to turn it into an outline.
+     */
+    if ( l_drop->age > 1 )
+    {
+      l_graphics->set_pen( p_job->black_pen );
+      l_graphics->circle( pimoroni::Point( l_drop->x, l_drop->y ), l_drop->age - 1 );
+    }
+
+    /* Older drops are big enough that we have a central dot in them too. */
+    if ( l_drop->age > 4 )
+    {
+      l_graphics->set_pen( p_job->palette[l_drop->age] );
+      l_graphics->circle( pimoroni::Point( l_drop->x, l_drop->y ), 1 );
+    }
+  }
+
+  return;
+}
 
 /*
- * main - this is such a small job, everything just slots into main(). Feels
- *        a little untidy, but at the same time I don't want to over-engineer!
+ * rain_draw - as rain_render, but onto a canvas which covers the band of the
+ *             frame buffer starting at row p_origin; and the part of the wall
+ *             starting at column origin_x.
  */
 
-int main()
+template <class C>
+void rain_draw( const rainjob_t *p_job, C &p_canvas, int p_origin )
+{
+  const raindrop_t  *l_drop;
+  uint_fast8_t       l_index;
+  int                l_x, l_y, l_age;
+
+  /* Start by clearing the screen (well, our part of it), unless it's done. */
+  if ( !p_job->cleared )
+  {
+    p_canvas.fill( p_job->black_pen );
+  }
+
+  for( l_index = 0; l_index < p_job->count; l_index++ )
+  {
+    l_drop = &p_job->raindrops[l_index];
+    l_x = (int)l_drop->x - p_job->origin_x;
+    l_y = (int)l_drop->y - p_origin;
+    l_age = l_drop->age;
+
+    /* Skip any dead raindrops, or ones entirely outside our band (signed!). */
+    if ( !l_drop->alive || ( l_y + l_age < 0 ) || ( l_y - l_age >= C::HEIGHT ) )
+    {
+      continue;
+    }
+
+    /* Outer circle first, then a black one inside it to make an outline. */
+    p_canvas.circle( l_x, l_y, l_drop->age, p_job->palette[l_drop->age] );
+    if ( l_drop->age > 1 )
+    {
+      p_canvas.circle( l_x, l_y, l_drop->age - 1, p_job->black_pen );
+    }
+
+    /* Older drops are big enough that we have a central dot in them too. */
+    if ( l_drop->age > 4 )
+    {
+      p_canvas.circle( l_x, l_y, 1, p_job->palette[l_drop->age] );
+    }
+  }
+
+  return;
+}
+
+/* Core 1 always gets the bottom half. */
+void rain_draw_job( void *p_job )
 {
-  int                               l_palette[RAINDROP_LIFESPAN];
-  int                               l_black_pen;
-  uint_fast8_t                      l_index, l_dropcount, l_dropgap;
-  raindrop_t                        l_raindrops[RAINDROP_MAX];
-  pimoroni::GalacticUnicorn        *l_unicorn;
-  pimoroni::PicoGraphics_PenRGB565 *l_graphics;
-
-  /*
-   * First thing to do is to create the Unicorn and Graphics objects. Pimoroni
-   * examples do this in variable declarations but I prefer it split out.
-   */
-  l_unicorn = new pimoroni::GalacticUnicorn();
-  l_graphics = new pimoroni::PicoGraphics_PenRGB565( pimoroni::GalacticUnicorn::WIDTH,
-                                                     pimoroni::GalacticUnicorn::HEIGHT,
-                                                     nullptr );
-
-  /* Next up, we need to intialise both the Pico and the Unicorn. */
-  stdio_init_all();
-  l_unicorn->init();
-
-  /*
-   * Our raindrops have a fairly simple, static palette - we only need to 
-   * work this out once, at start up.
-   */
-  l_palette[0] = l_graphics->create_pen( 255, 255, 255 );
-  l_palette[1] = l_graphics->create_pen(  50,  50, 150 );
-  l_palette[2] = l_graphics->create_pen(  40,  40, 100 );
-  l_palette[3] = l_graphics->create_pen(  30,  30,  80 );
-  l_palette[4] = l_graphics->create_pen(  20,  20,  50 );
-  l_palette[5] = l_graphics->create_pen(  10,  10,  20 );
-  l_palette[6] = l_graphics->create_pen(   5,   5,  10 );
-
-  l_black_pen = l_graphics->create_pen( 0, 0, 0 );
-
-  /*
-   * Initialise our raindrop array; compiler defaults should do this for us,
-   * but there's no harm in being explicit about it. 
-   */
-  for( l_index = 0; l_index < RAINDROP_MAX; l_index++ )
+  const rainjob_t  *l_job = (const rainjob_t *)p_job;
+  RainBottomCanvas  l_canvas( (uint16_t *)l_job->graphics->frame_buffer + RAIN_SPLIT_Y * RAIN_WIDTH );
+
+  rain_draw( l_job, l_canvas, RAIN_SPLIT_Y );
+  return;
+}
+
+
+/*
+ * rain_frame - renders a whole frame, either all on this core or split in
+ *              half across both. Returns how long we spent waiting on core 1.
+ */
+
+uint32_t rain_frame( rainjob_t *p_top, rainjob_t *p_bottom, bool p_dual )
+{
+  RainCanvas      l_canvas( p_top->graphics->frame_buffer );
+  RainTopCanvas   l_top_canvas( p_top->graphics->frame_buffer );
+  uint32_t        l_wait_tick;
+
+  if ( !p_dual )
   {
-    l_raindrops[l_index].alive = false;
+    /* The 'top' job is the whole screen in single core mode. */
+    rain_draw( p_top, l_canvas, 0 );
+    return 0;
   }
 
-  /* Lastly, we need to initialise our random number generator. */
-  srand( time( NULL ) );
+  DualCore::fork( rain_draw_job, p_bottom );
+  rain_draw( p_top, l_top_canvas, 0 );
+
+  l_wait_tick = time_us_32();
+  DualCore::join();
+  return time_us_32() - l_wait_tick;
+}
+
+
+/*
+ * rain_benchmark - renders a dense and a light scene flat out, on one core
+ *                  and then two, to show the speedup and sync overhead.
+ */
+
+void rain_benchmark( rainjob_t *p_top, rainjob_t *p_bottom )
+{
+#ifdef UNICORN_INSTRUMENT
+  raindrop_t    l_raindrops[RAIN_BENCHMARK_DENSE];
+  const uint_fast8_t l_counts[2] = { RAIN_BENCHMARK_DENSE, RAIN_BENCHMARK_LIGHT };
+  const raindrop_t  *l_saved = p_top->raindrops;
+  uint_fast8_t  l_saved_count = p_top->count;
+  int           l_saved_origin = p_top->origin_x;
+  uint64_t      l_elapsed[2], l_generic, l_wait;
+  const char   *l_kernels[2][3] = { { "dense_picographics", "dense_single", "dense_dual" },
+                                    { "light_picographics", "light_single", "light_dual" } };
+  uint_fast16_t l_index, l_frame;
+  uint_fast8_t  l_scene, l_mode;
+
+  /* A fixed spread of drops of every age. */
+  for ( l_index = 0; l_index < RAIN_BENCHMARK_DENSE; l_index++ )
+  {
+    l_raindrops[l_index].x = rand()%pimoroni::GalacticUnicorn::WIDTH;
+    l_raindrops[l_index].y = rand()%pimoroni::GalacticUnicorn::HEIGHT;
+    l_raindrops[l_index].age = l_index % RAINDROP_LIFESPAN;
+    l_raindrops[l_index].alive = true;
+  }
+  p_top->raindrops = p_bottom->raindrops = l_raindrops;
+  p_top->origin_x = p_bottom->origin_x = 0;
 
-  /*
-   * All set up, so now we enter effectively an infinite loop.
-   */
-  while( true )
+  for ( l_scene = 0; l_scene < 2; l_scene++ )
   {
-    /* Start the frame by clearing the screen. */
-    l_graphics->set_pen( l_black_pen );
-    l_graphics->clear();
-
-    /* Look through the raindrop list; count the ones that are still alive. */
-    l_dropcount = 0;
-    l_dropgap = RAINDROP_MAX;
-    for ( l_index = 0; l_index < RAINDROP_MAX; l_index++ )
+    p_top->count = p_bottom->count = l_counts[l_scene];
+    l_wait = 0;
+
+    /* The generic PicoGraphics path first, on the one core. */
+    p_top->graphics->remove_clip();
+    BenchRun l_generic_run( "rain", l_kernels[l_scene][0] );
+    for ( l_frame = 0; l_frame < RAIN_BENCHMARK_FRAMES; l_frame++ )
+    {
+      rain_render( p_top );
+    }
+    l_generic = l_generic_run.end( RAIN_BENCHMARK_FRAMES );
+
+    for ( l_mode = 0; l_mode < 2; l_mode++ )
     {
-      /* If it's reached it's lifespan, it dies. */
-      if ( l_raindrops[l_index].age >= RAINDROP_LIFESPAN )
+      BenchRun l_run( "rain", l_kernels[l_scene][1 + l_mode] );
+      for ( l_frame = 0; l_frame < RAIN_BENCHMARK_FRAMES; l_frame++ )
       {
-        l_raindrops[l_index].alive = false;
+        l_wait += rain_frame( p_top, p_bottom, l_mode );
       }
+      l_elapsed[l_mode] = l_run.end( RAIN_BENCHMARK_FRAMES );
+    }
+
+    printf( "rain: %d drops, PicoGraphics %lluus/frame, canvas %lluus/frame (x%.2f)\n",
+            (int)l_counts[l_scene], l_generic / RAIN_BENCHMARK_FRAMES,
+            l_elapsed[0] / RAIN_BENCHMARK_FRAMES, (float)l_generic / l_elapsed[0] );
+    printf( "rain: %d drops, single %lluus/frame, dual %lluus/frame (x%.2f), %lluus/frame waiting on core 1\n",
+            (int)l_counts[l_scene],
+            l_elapsed[0] / RAIN_BENCHMARK_FRAMES, l_elapsed[1] / RAIN_BENCHMARK_FRAMES,
+            (float)l_elapsed[0] / l_elapsed[1], l_wait / RAIN_BENCHMARK_FRAMES );
+  }
+
+  p_top->raindrops = p_bottom->raindrops = l_saved;
+  p_top->count = p_bottom->count = l_saved_count;
+  p_top->origin_x = p_bottom->origin_x = l_saved_origin;
+#endif
+  return;
+}
+
+
+/*
+ * RainApp - this is such a small job, it was all just in main() once; now it
+ *           lives in an app, so it can share a firmware image with others.
+ */
 
-      /* Only count the living. */
-      if ( l_raindrops[l_index].alive )
+class RainApp : public UnicornApp
+{
+  private:
+    int                               m_palette[RAINDROP_LIFESPAN];
+    raindrop_t                        m_raindrops[RAIN_DROPS];
+    rainjob_t                         m_top, m_bottom;
+    Genlock                           m_genlock;
+    uint32_t                          m_frame;
+    uint64_t                          m_present_tick;
+
+    /* A frame's drops, as sent from the leading panel to the rest. */
+    void pack( uint8_t *p_state )
+    {
+      uint_fast8_t  l_index;
+
+      for ( l_index = 0; l_index < RAIN_DROPS; l_index++ )
       {
-        /* Keep track of how many are alive. */
-        l_dropcount++;
+        *p_state++ = m_raindrops[l_index].x;
+        *p_state++ = m_raindrops[l_index].y;
+        *p_state++ = m_raindrops[l_index].alive ? m_raindrops[l_index].age : 0xff;
       }
-      else
+      return;
+    }
+
+    void unpack( const uint8_t *p_state )
+    {
+      uint_fast8_t  l_index;
+
+      for ( l_index = 0; l_index < RAIN_DROPS; l_index++ )
       {
-        /* Remember this is an available gap for a raindrop! */
-        l_dropgap = l_index;
+        m_raindrops[l_index].x = *p_state++;
+        m_raindrops[l_index].y = *p_state++;
+        m_raindrops[l_index].age = *p_state++;
+        m_raindrops[l_index].alive = ( m_raindrops[l_index].age < RAINDROP_LIFESPAN );
       }
+      return;
+    }
+
+  public:
+    void init( appcontext_t *p_context )
+    {
+      pimoroni::PicoGraphics_PenRGB565 *l_graphics = p_context->graphics;
+      uint_fast8_t                      l_index;
+      int                               l_black_pen;
+
+      /*
+       * Our raindrops have a fairly simple, static palette - we only need to 
+       * work this out once, at start up.
+       */
+      pen_table( *l_graphics, g_rain_colours, m_palette, RAINDROP_LIFESPAN );
+
+      l_black_pen = l_graphics->create_pen( 0, 0, 0 );
+
+      /*
+       * Initialise our raindrop array; compiler defaults should do this for us,
+       * but there's no harm in being explicit about it. 
+       */
+      for( l_index = 0; l_index < RAIN_DROPS; l_index++ )
+      {
+        m_raindrops[l_index].alive = false;
+      }
+
+      /* Set up the render jobs for each half of the screen; the same buffer. */
+      m_top.graphics = m_bottom.graphics = l_graphics;
+      m_top.raindrops = m_bottom.raindrops = m_raindrops;
+      m_top.count = m_bottom.count = RAIN_DROPS;
+      m_top.palette = m_bottom.palette = m_palette;
+      m_top.black_pen = m_bottom.black_pen = l_black_pen;
+      m_top.origin_x = m_bottom.origin_x = RAIN_PANEL * RAIN_WIDTH;
+      m_top.cleared = m_bottom.cleared = false;
+
+      /* On a wall, the leftmost panel leads. */
+      m_genlock.init( RAIN_PANEL );
+      m_frame = 0;
+      m_present_tick = 0;
+
+      /* Lastly, we need to initialise our random number generator. */
+      srand( time( NULL ) );
+
+      /* Core 1 only gets started up if we're going to use it. */
+#if RAIN_DUAL_CORE || defined( UNICORN_INSTRUMENT )
+      DualCore::init();
+#endif
+      rain_benchmark( &m_top, &m_bottom );
+
+      /* The benchmark clears its own frames; from here on, the DMA does. */
+      m_top.cleared = m_bottom.cleared = true;
+      return;
+    }
+
+    void resume( appcontext_t *p_context )
+    {
+      Instrument::name_stage( RAIN_STAGE_UPDATE, "update" );
+      Instrument::name_stage( RAIN_STAGE_RENDER, "render" );
+      Instrument::name_stage( RAIN_STAGE_JOIN, "join wait" );
+      Instrument::name_stage( RAIN_STAGE_PRESENT, "present" );
+      return;
     }
 
-    /* Decide if we need a new raindrop. */
-    if ( ( l_dropgap < RAINDROP_MAX ) && 
-         ( l_dropcount < ( RAINDROP_MIN + rand()%( RAINDROP_MAX - RAINDROP_MIN ) ) ) )
+    /* Other apps in the image may want the WiFi; it's back up on our next frame. */
+    void suspend( appcontext_t *p_context )
     {
-      /* So, spawn a new raindrop in a random location. */
-      l_raindrops[l_dropgap].x = rand()%pimoroni::GalacticUnicorn::WIDTH;
-      l_raindrops[l_dropgap].y = rand()%pimoroni::GalacticUnicorn::HEIGHT;
-      l_raindrops[l_dropgap].age = 0;
-      l_raindrops[l_dropgap].alive = true;
+#if RAIN_GENLOCK
+      m_genlock.stop();
+#endif
+      return;
     }
 
-    /* Now, work through all living raindrops and render / age them. */
-    for( l_index = 0; l_index < RAINDROP_MAX; l_index++ )
+    void update( appcontext_t *p_context )
     {
-      /* Skip any dead raindrops. */
-      if ( !l_raindrops[l_index].alive )
+      uint_fast8_t  l_index, l_dropcount, l_dropgap, l_spawn, l_spawners = RAIN_PANELS;
+      uint32_t      l_stage_tick;
+#if RAIN_GENLOCK
+      uint8_t       l_state[RAIN_DROPS * RAIN_DROP_BYTES];
+      uint64_t      l_now;
+#endif
+
+      l_stage_tick = Instrument::start( RAIN_STAGE_UPDATE );
+
+      /* The last frame's been presented, so the DMA can blank it meanwhile. */
+      DmaSurface::clear_async( p_context->graphics->frame_buffer, RAIN_FRAME_BYTES, m_top.black_pen );
+
+#if RAIN_GENLOCK
+      /* Following the leading panel, its drops are all we need to draw. */
+      l_now = time_us_64();
+      m_genlock.poll( l_now );
+      if ( !m_genlock.leading() &&
+           m_genlock.follow( &m_frame, &m_present_tick, l_state, sizeof( l_state ) ) )
       {
-        continue;
+        unpack( l_state );
+        Instrument::record( RAIN_STAGE_UPDATE, time_us_32() - l_stage_tick );
+        return;
       }
 
-      /* First thing to do is to draw it then - outer circle first. */
-      l_graphics->set_pen( l_palette[l_raindrops[l_index].age] );
-      l_graphics->circle(
-        pimoroni::Point( l_raindrops[l_index].x, l_raindrops[l_index].y ),
-        l_raindrops[l_index].age
-      );
+      /* Otherwise we keep to the same beat ourselves. */
+      m_frame++;
+      m_present_tick += 1000000 / RAIN_FPS;
+      if ( m_present_tick < l_now )
+      {
+        m_present_tick = l_now + GENLOCK_LEAD_USECS;
+      }
 
       /*
-       * But circles are filled, so we draw a slightly smaller black circle
-       * inside it to turn it into an outline.
+       * A follower that's only missed a frame or two just lets the leader's
+       * drops age, and spawns none of its own; it only makes its own rain
+       * once it's lost the leader altogether.
        */
-      if ( l_raindrops[l_index].age > 1 )
+      if ( !m_genlock.leading() && m_genlock.locked( l_now ) )
+      {
+        l_spawners = 0;
+      }
+#endif
+
+      /* Look through the raindrop list; count the ones that are still alive. */
+      l_dropcount = 0;
+      l_dropgap = RAIN_DROPS;
+      for ( l_index = 0; l_index < RAIN_DROPS; l_index++ )
+      {
+        /* If it's reached it's lifespan, it dies. */
+        if ( m_raindrops[l_index].age >= RAINDROP_LIFESPAN )
+        {
+          m_raindrops[l_index].alive = false;
+        }
+
+        /* Only count the living. */
+        if ( m_raindrops[l_index].alive )
+        {
+          /* Keep track of how many are alive. */
+          l_dropcount++;
+        }
+        else
+        {
+          /* Remember this is an available gap for a raindrop! */
+          l_dropgap = l_index;
+        }
+      }
+
+      /* Decide if we need a new raindrop; a whole wall gets a go per panel. */
+      for ( l_spawn = 0; l_spawn < l_spawners; l_spawn++ )
       {
-        l_graphics->set_pen( l_black_pen );
-        l_graphics->circle(
-          pimoroni::Point( l_raindrops[l_index].x, l_raindrops[l_index].y ),
-          l_raindrops[l_index].age - 1
-        );
+        if ( ( l_dropgap < RAIN_DROPS ) &&
+             ( l_dropcount < ( RAINDROP_MIN + rand()%( RAINDROP_MAX - RAINDROP_MIN ) ) * RAIN_PANELS ) )
+        {
+          /* So, spawn a new raindrop in a random location. */
+          m_raindrops[l_dropgap].x = rand()%RAIN_WALL_WIDTH;
+          m_raindrops[l_dropgap].y = rand()%pimoroni::GalacticUnicorn::HEIGHT;
+          m_raindrops[l_dropgap].age = 0;
+          m_raindrops[l_dropgap].alive = true;
+          l_dropcount++;
+
+          /* Any more goes will need another gap, before this one. */
+          for ( l_index = l_dropgap, l_dropgap = RAIN_DROPS; l_index > 0; l_index-- )
+          {
+            if ( !m_raindrops[l_index-1].alive )
+            {
+              l_dropgap = l_index - 1;
+              break;
+            }
+          }
+        }
       }
 
-      /* Older drops are big enough that we have a central dot in them too. */
-      if ( l_raindrops[l_index].age > 4 )
+#if RAIN_GENLOCK
+      /* If we're leading, everyone else gets this frame too. */
+      if ( m_genlock.leading() )
       {
-        l_graphics->set_pen( l_palette[l_raindrops[l_index].age] );
-        l_graphics->circle(
-          pimoroni::Point( l_raindrops[l_index].x, l_raindrops[l_index].y ),
-          1
-        );
+        pack( l_state );
+        m_genlock.publish( m_frame, m_present_tick, l_state, sizeof( l_state ) );
       }
+#endif
 
-      /* All drawn, so just age the drop. */
-      l_raindrops[l_index].age++;
+      Instrument::record( RAIN_STAGE_UPDATE, time_us_32() - l_stage_tick );
+      return;
     }
 
-    /* Raindrops are all processed - so, we ask the Unicorn to update. */
-    l_unicorn->update( l_graphics );
+    void render( appcontext_t *p_context )
+    {
+      uint_fast8_t  l_index;
+      uint32_t      l_stage_tick;
 
-    /* And wait a short while for the next frame. */
-    sleep_ms( 125 );
-  }
+      /* Now, render all the living raindrops - on one core, or across both. */
+      l_stage_tick = Instrument::start( RAIN_STAGE_RENDER );
+      DmaSurface::wait();
+      Instrument::record( RAIN_STAGE_JOIN, rain_frame( &m_top, &m_bottom, RAIN_DUAL_CORE ) );
+      Instrument::record( RAIN_STAGE_RENDER, time_us_32() - l_stage_tick );
+
+      /* All drawn, so just age the drops. */
+      for( l_index = 0; l_index < RAIN_DROPS; l_index++ )
+      {
+        if ( m_raindrops[l_index].alive )
+        {
+          m_raindrops[l_index].age++;
+        }
+      }
+
+      /* Raindrops are all processed - so, we ask the Unicorn to update. */
+      l_stage_tick = Instrument::start( RAIN_STAGE_PRESENT );
+#if RAIN_GENLOCK
+      m_genlock.present( p_context->unicorn, p_context->graphics, m_frame, m_present_tick );
+#else
+      p_context->unicorn->update( p_context->graphics );
+#endif
+      Instrument::record( RAIN_STAGE_PRESENT, time_us_32() - l_stage_tick );
+
+      /*
+       * And the next frame is due at our usual, leisurely, rate. On a wall,
+       * we start work on it a little before it's to be presented; followers
+       * a little later than the leader, so its frame has time to arrive.
+       */
+#if RAIN_GENLOCK
+      p_context->scheduler->next_at( m_present_tick + ( 1000000 / RAIN_FPS ) -
+                                     ( m_genlock.leading() ? GENLOCK_LEAD_USECS : GENLOCK_LEAD_USECS / 2 ) );
+#else
+      p_context->scheduler->next_fps( RAIN_FPS );
+#endif
+      return;
+    }
+};
+
+
+/*
+ * rain_app - hands out the rain, for whoever is running it.
+ */
+
+UnicornApp *rain_app( void )
+{
+  static RainApp  l_rain;
+  return &l_rain;
+}
+
+
+/*
+ * main - entry point; when we're built on our own, we're the only app.
+ */
+
+#ifndef UNICORN_LAUNCHER
+int main()
+{
+  UnicornApp *l_apps[] = { rain_app() };
+
+  AppRunner::run( l_apps, 1 );
 
   /* We'll never get here! */
   return 0;
 }
+#endif
 
 /* End of file rain.cpp */
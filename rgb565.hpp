@@ -0,0 +1,252 @@
+/*
+ * rgb565.hpp - from the Unicorn C(++) Examples collection
+ *
+ * A handful of per-pixel colour kernels (fade, blend, saturating add) which
+ * work directly on RGB565 frame buffers, two pixels at a time in a 32-bit
+ * word, rather than unpacking every pixel through PicoGraphics.
+ *
+ * The trick is to split the six channels of a pixel pair into two 'lanes',
+ * each holding three channels with enough empty bits between them that a
+ * multiply (by a 5-bit factor) or an add can't spill from one into the next:
+ *
+ *   lane A - word & 0x07e0f81f : B0 (0-4),  R0 (11-15), G1 (21-26)
+ *   lane B - word >> 5 & 0x07c0f83f : G0 (0-5), B1 (11-15), R1 (22-26)
+ *
+ * Frame buffer pens are stored byte-swapped, so each word is swapped back to
+ * native order on the way in and out; that costs a couple of instructions.
+ *
+ * The plain per-pixel versions are kept alongside as a reference; the host
+ * tests (tests/rgb565_test.cpp) check the two agree, and the host benchmark
+ * (tests/host_bench.cpp) times them against each other.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef RGB565_HPP
+#define RGB565_HPP
+
+
+/* System headers. */
+
+#include "pico/stdlib.h"
+
+
+/* Constants. */
+
+#define RGB565_SCALE_ONE         32
+
+#define RGB565_LANE_A            0x07e0f81fu
+#define RGB565_LANE_B            0x07c0f83fu
+#define RGB565_CARRY_A5          0x00010020u
+#define RGB565_CARRY_A6          0x08000000u
+#define RGB565_CARRY_B5          0x08010000u
+#define RGB565_CARRY_B6          0x00000040u
+
+
+/* Class. */
+
+class Rgb565
+{
+  private:
+    /* Swaps the bytes of each 16-bit half, between frame buffer and native. */
+    static inline uint32_t swap( uint32_t p_word )
+    {
+      p_word = __builtin_bswap32( p_word );
+      return ( p_word >> 16 ) | ( p_word << 16 );
+    }
+
+    /* Scales both lanes of a (native) pixel pair by 0-32. */
+    static inline uint32_t scale_pair( uint32_t p_pair, uint_fast8_t p_scale )
+    {
+      uint32_t  l_lane_a, l_lane_b;
+
+      l_lane_a = ( ( ( p_pair & RGB565_LANE_A ) * p_scale ) >> 5 ) & RGB565_LANE_A;
+      l_lane_b = ( ( ( ( p_pair >> 5 ) & RGB565_LANE_B ) * p_scale ) >> 5 ) & RGB565_LANE_B;
+      return l_lane_a | ( l_lane_b << 5 );
+    }
+
+    /* Mixes two (native) pixel pairs, p_alpha of the first to 32 - p_alpha. */
+    static inline uint32_t blend_pair( uint32_t p_src, uint32_t p_dest, uint_fast8_t p_alpha )
+    {
+      uint32_t  l_lane_a, l_lane_b;
+      uint_fast8_t l_inverse = RGB565_SCALE_ONE - p_alpha;
+
+      l_lane_a = ( ( p_src & RGB565_LANE_A ) * p_alpha + ( p_dest & RGB565_LANE_A ) * l_inverse ) >> 5;
+      l_lane_b = ( ( ( p_src >> 5 ) & RGB565_LANE_B ) * p_alpha +
+                   ( ( p_dest >> 5 ) & RGB565_LANE_B ) * l_inverse ) >> 5;
+      return ( l_lane_a & RGB565_LANE_A ) | ( ( l_lane_b & RGB565_LANE_B ) << 5 );
+    }
+
+    /*
+     * Adds two (native) pixel pairs, clamping each channel. Any channel that
+     * overflows sets the bit just above it; 'carry - carry >> width' turns
+     * that bit into a mask of the whole channel, which we then OR back in.
+     */
+    static inline uint32_t add_pair( uint32_t p_src, uint32_t p_dest )
+    {
+      uint32_t  l_lane_a, l_lane_b, l_carry;
+
+      l_lane_a = ( p_src & RGB565_LANE_A ) + ( p_dest & RGB565_LANE_A );
+      l_carry = l_lane_a & ( RGB565_CARRY_A5 | RGB565_CARRY_A6 );
+      l_lane_a |= l_carry - ( ( l_carry & RGB565_CARRY_A5 ) >> 5 ) - ( ( l_carry & RGB565_CARRY_A6 ) >> 6 );
+
+      l_lane_b = ( ( p_src >> 5 ) & RGB565_LANE_B ) + ( ( p_dest >> 5 ) & RGB565_LANE_B );
+      l_carry = l_lane_b & ( RGB565_CARRY_B5 | RGB565_CARRY_B6 );
+      l_lane_b |= l_carry - ( ( l_carry & RGB565_CARRY_B5 ) >> 5 ) - ( ( l_carry & RGB565_CARRY_B6 ) >> 6 );
+
+      return ( l_lane_a & RGB565_LANE_A ) | ( ( l_lane_b & RGB565_LANE_B ) << 5 );
+    }
+
+    /* Unpacks a single frame buffer pixel, for the reference versions. */
+    static inline void unpack( uint16_t p_pixel, uint_fast8_t &p_r, uint_fast8_t &p_g, uint_fast8_t &p_b )
+    {
+      p_pixel = __builtin_bswap16( p_pixel );
+      p_r = p_pixel >> 11;
+      p_g = ( p_pixel >> 5 ) & 0x3f;
+      p_b = p_pixel & 0x1f;
+    }
+
+    static inline uint16_t pack( uint_fast8_t p_r, uint_fast8_t p_g, uint_fast8_t p_b )
+    {
+      return __builtin_bswap16( ( p_r << 11 ) | ( p_g << 5 ) | p_b );
+    }
+
+  public:
+    /*
+     * Each kernel works on a span of frame buffer pixels. Spans needn't be
+     * word aligned or an even length; stray pixels at either end are just
+     * handled as a half-empty pair.
+     */
+
+    /* Scales every pixel by p_scale / 32; so 16 halves, 32 leaves alone. */
+    static void fade( uint16_t *p_pixels, uint_fast16_t p_count, uint_fast8_t p_scale )
+    {
+      uint32_t *l_pair;
+
+      if ( p_count > 0 && ( (uintptr_t)p_pixels & 0x02 ) )
+      {
+        *p_pixels = swap( scale_pair( swap( *p_pixels ), p_scale ) );
+        p_pixels++;
+        p_count--;
+      }
+
+      for ( l_pair = (uint32_t *)p_pixels; p_count >= 2; p_count -= 2, l_pair++ )
+      {
+        *l_pair = swap( scale_pair( swap( *l_pair ), p_scale ) );
+      }
+
+      if ( p_count > 0 )
+      {
+        *(uint16_t *)l_pair = swap( scale_pair( swap( *(uint16_t *)l_pair ), p_scale ) );
+      }
+      return;
+    }
+
+    /* Blends p_src over p_dest, at an opacity of p_alpha / 32. */
+    static void blend( uint16_t *p_dest, const uint16_t *p_src, uint_fast16_t p_count, uint_fast8_t p_alpha )
+    {
+      /* Pairs only line up if both spans have the same alignment. */
+      if ( ( ( (uintptr_t)p_dest ^ (uintptr_t)p_src ) & 0x02 ) == 0 )
+      {
+        if ( p_count > 0 && ( (uintptr_t)p_dest & 0x02 ) )
+        {
+          *p_dest = swap( blend_pair( swap( *p_src ), swap( *p_dest ), p_alpha ) );
+          p_dest++;
+          p_src++;
+          p_count--;
+        }
+        for ( ; p_count >= 2; p_count -= 2, p_dest += 2, p_src += 2 )
+        {
+          *(uint32_t *)p_dest = swap( blend_pair( swap( *(const uint32_t *)p_src ),
+                                                  swap( *(uint32_t *)p_dest ), p_alpha ) );
+        }
+      }
+
+      for ( ; p_count > 0; p_count--, p_dest++, p_src++ )
+      {
+        *p_dest = swap( blend_pair( swap( *p_src ), swap( *p_dest ), p_alpha ) );
+      }
+      return;
+    }
+
+    /* Adds p_src onto p_dest, each channel clamping rather than wrapping. */
+    static void add( uint16_t *p_dest, const uint16_t *p_src, uint_fast16_t p_count )
+    {
+      if ( ( ( (uintptr_t)p_dest ^ (uintptr_t)p_src ) & 0x02 ) == 0 )
+      {
+        if ( p_count > 0 && ( (uintptr_t)p_dest & 0x02 ) )
+        {
+          *p_dest = swap( add_pair( swap( *p_src ), swap( *p_dest ) ) );
+          p_dest++;
+          p_src++;
+          p_count--;
+        }
+        for ( ; p_count >= 2; p_count -= 2, p_dest += 2, p_src += 2 )
+        {
+          *(uint32_t *)p_dest = swap( add_pair( swap( *(const uint32_t *)p_src ),
+                                                swap( *(uint32_t *)p_dest ) ) );
+        }
+      }
+
+      for ( ; p_count > 0; p_count--, p_dest++, p_src++ )
+      {
+        *p_dest = swap( add_pair( swap( *p_src ), swap( *p_dest ) ) );
+      }
+      return;
+    }
+
+    /*
+     * Reference versions of the above; one pixel, one channel at a time.
+     */
+
+    static void fade_reference( uint16_t *p_pixels, uint_fast16_t p_count, uint_fast8_t p_scale )
+    {
+      uint_fast8_t  l_r, l_g, l_b;
+
+      for ( ; p_count > 0; p_count--, p_pixels++ )
+      {
+        unpack( *p_pixels, l_r, l_g, l_b );
+        *p_pixels = pack( l_r * p_scale >> 5, l_g * p_scale >> 5, l_b * p_scale >> 5 );
+      }
+      return;
+    }
+
+    static void blend_reference( uint16_t *p_dest, const uint16_t *p_src, uint_fast16_t p_count, uint_fast8_t p_alpha )
+    {
+      uint_fast8_t  l_sr, l_sg, l_sb, l_dr, l_dg, l_db;
+      uint_fast8_t  l_inverse = RGB565_SCALE_ONE - p_alpha;
+
+      for ( ; p_count > 0; p_count--, p_dest++, p_src++ )
+      {
+        unpack( *p_src, l_sr, l_sg, l_sb );
+        unpack( *p_dest, l_dr, l_dg, l_db );
+        *p_dest = pack( ( l_sr * p_alpha + l_dr * l_inverse ) >> 5,
+                        ( l_sg * p_alpha + l_dg * l_inverse ) >> 5,
+                        ( l_sb * p_alpha + l_db * l_inverse ) >> 5 );
+      }
+      return;
+    }
+
+    static void add_reference( uint16_t *p_dest, const uint16_t *p_src, uint_fast16_t p_count )
+    {
+      uint_fast8_t  l_sr, l_sg, l_sb, l_dr, l_dg, l_db;
+
+      for ( ; p_count > 0; p_count--, p_dest++, p_src++ )
+      {
+        unpack( *p_src, l_sr, l_sg, l_sb );
+        unpack( *p_dest, l_dr, l_dg, l_db );
+        *p_dest = pack( l_sr + l_dr > 0x1f ? 0x1f : l_sr + l_dr,
+                        l_sg + l_dg > 0x3f ? 0x3f : l_sg + l_dg,
+                        l_sb + l_db > 0x1f ? 0x1f : l_sb + l_db );
+      }
+      return;
+    }
+};
+
+
+#endif /* RGB565_HPP */
+
+/* End of file rgb565.hpp */
@@ -0,0 +1,132 @@
+/*
+ * scheduler.hpp - from the Unicorn C(++) Examples collection
+ *
+ * Rather than rendering a frame and then sleeping for a fixed time, each frame
+ * tells the scheduler when the next one is needed; an animation asks for a
+ * high frame rate, an idle clock asks for the next time anything changes.
+ *
+ * Deadlines are measured from when the frame was *due* rather than when we got
+ * around to it, so the rate doesn't drift with render time. Between frames we
+ * wait on WFE, so the core is asleep rather than spinning.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+
+/* System headers. */
+
+#include "pico/stdlib.h"
+
+
+/* Local headers. */
+
+#include "instrument.hpp"
+
+
+/* Constants. */
+
+#define SCHEDULER_MISS_SLACK_US  2000
+
+
+/* Class. */
+
+class FrameScheduler
+{
+  private:
+    uint64_t  m_frame_tick;
+    uint64_t  m_deadline;
+    bool      m_started;
+
+  public:
+    FrameScheduler()
+    {
+      m_frame_tick = m_deadline = time_us_64();
+      m_started = false;
+      Instrument::name_stage( INSTRUMENT_STAGE_IDLE, "idle" );
+    }
+
+    /* When the current frame was due to start. */
+    uint64_t frame_tick( void )
+    {
+      return m_frame_tick;
+    }
+
+    /* The next frame is wanted this long after the current one. */
+    void next_in( uint32_t p_interval_us )
+    {
+      m_deadline = m_frame_tick + p_interval_us;
+      return;
+    }
+
+    /* Or at a steady number of frames per second. */
+    void next_fps( uint_fast8_t p_fps )
+    {
+      next_in( 1000000 / p_fps );
+      return;
+    }
+
+    /* Or at a specific time (since boot); say, when the next second ticks. */
+    void next_at( uint64_t p_deadline )
+    {
+      m_deadline = p_deadline;
+      return;
+    }
+
+    /* And, having picked one of those, no later than this. */
+    void next_by( uint64_t p_deadline )
+    {
+      if ( p_deadline < m_deadline )
+      {
+        m_deadline = p_deadline;
+      }
+      return;
+    }
+
+    /*
+     * wait - sleeps until the next frame is due. If we're already (notably)
+     *        late, that's a missed deadline; we don't try to catch up.
+     *        Returns false if this frame missed its deadline.
+     */
+    bool wait( void )
+    {
+      uint64_t  l_now = time_us_64();
+      bool      l_on_time = true;
+
+      Instrument::mark( INSTRUMENT_STAGE_IDLE );
+
+      if ( l_now >= m_deadline )
+      {
+        /* (the first frame is always 'late', after all the setup) */
+        if ( m_started && ( l_now > m_deadline + SCHEDULER_MISS_SLACK_US ) )
+        {
+          Instrument::count( INSTRUMENT_COUNT_MISSED );
+          l_on_time = false;
+        }
+        m_frame_tick = l_now;
+        m_started = true;
+        return l_on_time;
+      }
+
+      /* WFE until the alarm fires (or anything else wakes us early). */
+      while ( !best_effort_wfe_or_timeout( from_us_since_boot( m_deadline ) ) )
+      {
+        tight_loop_contents();
+      }
+
+      Instrument::record( INSTRUMENT_STAGE_IDLE, time_us_64() - l_now );
+      m_frame_tick = m_deadline;
+      m_started = true;
+      return l_on_time;
+    }
+};
+
+
+#endif /* SCHEDULER_HPP */
+
+/* End of file scheduler.hpp */
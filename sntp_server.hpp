@@ -0,0 +1,349 @@
+/*
+ * sntp_server.hpp - from the Unicorn C(++) Examples collection
+ *
+ * A tiny SNTP server (RFC 4330), so that once a Unicorn has its time from
+ * the internet it can hand it on to everything else on the LAN. It answers
+ * client (mode 3) requests from the app's disciplined idea of the time, with
+ * the stratum of our upstream server plus one, and the time of our last sync
+ * as the reference timestamp.
+ *
+ * Requests are answered straight from lwIP's receive callback; the request's
+ * own pbuf is rewritten in place and sent back, so serving allocates nothing
+ * and never touches the frame loop. To keep a flood from eating into the
+ * frame, we only answer so many requests a second, and drop the rest.
+ *
+ * Until the app has told us what time it is (and keeps telling us), we stay
+ * quiet rather than hand out a time we're not sure of.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef SNTP_SERVER_HPP
+#define SNTP_SERVER_HPP
+
+
+/* System headers. */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+
+
+/* Constants. */
+
+#define SNTP_PORT               123
+#define SNTP_PACKET_LEN         48
+
+#define SNTP_USECS_IN_SEC       1000000LLU
+#define SNTP_ANCHOR_USECS       ( 2 * SNTP_USECS_IN_SEC )
+#define SNTP_REPORT_USECS       ( 10 * SNTP_USECS_IN_SEC )
+
+/* If it's been a day since we synced, we tell clients we're not to be trusted. */
+#define SNTP_STALE_USECS        ( 86400LLU * SNTP_USECS_IN_SEC )
+
+/* Most requests we'll answer in any one second; the rest are dropped. */
+#define SNTP_MAX_PER_SEC        200
+
+/*
+ * Our upstream time only comes in whole seconds, so we could be up to one
+ * out; and the crystal drifts (we allow 30ppm) from there.
+ */
+#define SNTP_BASE_DISPERSION    SNTP_USECS_IN_SEC
+#define SNTP_DRIFT_PPM          30
+#define SNTP_PRECISION          -20           /* ~1us, from the timer */
+
+/* The fields we care about, as byte offsets into the packet. */
+#define SNTP_OFS_MODE           0
+#define SNTP_OFS_STRATUM        1
+#define SNTP_OFS_POLL           2
+#define SNTP_OFS_PRECISION      3
+#define SNTP_OFS_ROOT_DELAY     4
+#define SNTP_OFS_ROOT_DISP      8
+#define SNTP_OFS_REFID          12
+#define SNTP_OFS_REFERENCE      16
+#define SNTP_OFS_ORIGINATE      24
+#define SNTP_OFS_RECEIVE        32
+#define SNTP_OFS_TRANSMIT       40
+
+
+/* Enums. */
+
+typedef enum
+{
+  SNTP_MODE_CLIENT = 3,
+  SNTP_MODE_SERVER = 4
+} sntp_mode_t;
+
+typedef enum
+{
+  SNTP_LEAP_NONE = 0,
+  SNTP_LEAP_ALARM = 3
+} sntp_leap_t;
+
+
+/* Class. */
+
+class SntpServer
+{
+  private:
+    struct udp_pcb *m_socket;
+
+    /* The app's idea of the time (UTC usecs, NTP era, against our timer). */
+    uint64_t        m_anchor_tick, m_anchor_utc, m_anchor_refreshed;
+    uint64_t        m_sync_tick;
+    uint8_t         m_stratum;
+    uint32_t        m_refid;
+
+    /* Rate limiting, and what we've done since the last report. */
+    uint64_t        m_second_tick, m_report_tick;
+    uint_fast16_t   m_second_count;
+    uint32_t        m_served, m_dropped, m_ignored, m_worst_us;
+
+    static void put32( uint8_t *p_buffer, uint32_t p_value )
+    {
+      p_buffer[0] = p_value >> 24;
+      p_buffer[1] = p_value >> 16;
+      p_buffer[2] = p_value >> 8;
+      p_buffer[3] = p_value;
+      return;
+    }
+
+    /* NTP timestamps are 32 bits of seconds and 32 of fraction. */
+    static void put_timestamp( uint8_t *p_buffer, uint64_t p_utc )
+    {
+      put32( p_buffer, p_utc / SNTP_USECS_IN_SEC );
+      put32( p_buffer + 4, ( ( p_utc % SNTP_USECS_IN_SEC ) << 32 ) / SNTP_USECS_IN_SEC );
+      return;
+    }
+
+    /* NTP short format; 16 bits of seconds and 16 of fraction. */
+    static uint32_t short_format( uint64_t p_usecs )
+    {
+      if ( p_usecs >= ( 0x10000LLU * SNTP_USECS_IN_SEC ) )
+      {
+        return UINT32_MAX;
+      }
+      return ( p_usecs << 16 ) / SNTP_USECS_IN_SEC;
+    }
+
+    bool anchored( uint64_t p_tick )
+    {
+      return ( m_anchor_refreshed != 0 ) && ( p_tick - m_anchor_refreshed < SNTP_ANCHOR_USECS );
+    }
+
+    /* The time, as best we know it, at a tick of our own timer. */
+    uint64_t utc_at( uint64_t p_tick )
+    {
+      return m_anchor_utc + p_tick - m_anchor_tick;
+    }
+
+    /*
+     * receive - from lwIP's callback, so in IRQ context. Turns a request into
+     *           its reply in the same pbuf, and sends it straight back.
+     */
+    void receive( struct pbuf *p_buffer, const ip_addr_t *p_addr, uint16_t p_port )
+    {
+      uint64_t    l_now = time_us_64();
+      uint64_t    l_age;
+      uint8_t    *l_packet;
+      uint8_t     l_version;
+      ip_addr_t   l_addr;
+
+      /* Only plain, unfragmented client requests; and only if we know the time. */
+      if ( ( p_buffer->tot_len < SNTP_PACKET_LEN ) || ( p_buffer->len != p_buffer->tot_len ) )
+      {
+        m_ignored++;
+        return;
+      }
+      l_packet = (uint8_t *)p_buffer->payload;
+      l_version = ( l_packet[SNTP_OFS_MODE] >> 3 ) & 0x07;
+      if ( ( ( l_packet[SNTP_OFS_MODE] & 0x07 ) != SNTP_MODE_CLIENT ) || ( l_version < 1 ) ||
+           ( l_version > 4 ) || !anchored( l_now ) )
+      {
+        m_ignored++;
+        return;
+      }
+
+      /* Don't let a flood of requests eat into our frames. */
+      if ( l_now - m_second_tick >= SNTP_USECS_IN_SEC )
+      {
+        m_second_tick = l_now;
+        m_second_count = 0;
+      }
+      if ( m_second_count >= SNTP_MAX_PER_SEC )
+      {
+        m_dropped++;
+        return;
+      }
+      m_second_count++;
+
+      /* Anything past the basic header (extensions, MACs) we don't speak. */
+      pbuf_realloc( p_buffer, SNTP_PACKET_LEN );
+
+      /* Their transmit time becomes our originate time, and in turn ours. */
+      memmove( l_packet + SNTP_OFS_ORIGINATE, l_packet + SNTP_OFS_TRANSMIT, 8 );
+      put_timestamp( l_packet + SNTP_OFS_RECEIVE, utc_at( l_now ) );
+
+      l_age = l_now - m_sync_tick;
+      l_packet[SNTP_OFS_MODE] = ( ( l_age > SNTP_STALE_USECS ? SNTP_LEAP_ALARM : SNTP_LEAP_NONE ) << 6 ) |
+                                ( l_version << 3 ) | SNTP_MODE_SERVER;
+      l_packet[SNTP_OFS_STRATUM] = m_stratum;
+      l_packet[SNTP_OFS_PRECISION] = (uint8_t)SNTP_PRECISION;
+      put32( l_packet + SNTP_OFS_ROOT_DELAY, 0 );
+      put32( l_packet + SNTP_OFS_ROOT_DISP,
+             short_format( SNTP_BASE_DISPERSION + l_age / ( SNTP_USECS_IN_SEC / SNTP_DRIFT_PPM ) ) );
+      put32( l_packet + SNTP_OFS_REFID, m_refid );
+      put_timestamp( l_packet + SNTP_OFS_REFERENCE, utc_at( m_sync_tick ) );
+
+      /* And lastly, the time it leaves. */
+      ip_addr_copy( l_addr, *p_addr );
+      put_timestamp( l_packet + SNTP_OFS_TRANSMIT, utc_at( time_us_64() ) );
+      udp_sendto( m_socket, p_buffer, &l_addr, p_port );
+
+      m_served++;
+      l_now = time_us_64() - l_now;
+      if ( l_now > m_worst_us )
+      {
+        m_worst_us = l_now;
+      }
+      return;
+    }
+
+    static void receive_cb( void *p_server, struct udp_pcb *p_socket, struct pbuf *p_buffer,
+                            const ip_addr_t *p_addr, uint16_t p_port )
+    {
+      ( (SntpServer *)p_server )->receive( p_buffer, p_addr, p_port );
+      pbuf_free( p_buffer );
+      return;
+    }
+
+    /* How we've been doing, every so often; only when instrumented. */
+    void report( uint64_t p_tick )
+    {
+#ifdef UNICORN_INSTRUMENT
+      uint32_t  l_served, l_dropped, l_ignored, l_worst_us;
+
+      if ( p_tick - m_report_tick < SNTP_REPORT_USECS )
+      {
+        return;
+      }
+
+      cyw43_arch_lwip_begin();
+      l_served = m_served;
+      l_dropped = m_dropped;
+      l_ignored = m_ignored;
+      l_worst_us = m_worst_us;
+      m_served = m_dropped = m_ignored = m_worst_us = 0;
+      cyw43_arch_lwip_end();
+
+      printf( "sntp: served %lu (%lu/s), dropped %lu, ignored %lu, longest %luus\n",
+              (unsigned long)l_served, (unsigned long)( l_served * SNTP_USECS_IN_SEC / ( p_tick - m_report_tick ) ),
+              (unsigned long)l_dropped, (unsigned long)l_ignored, (unsigned long)l_worst_us );
+      m_report_tick = p_tick;
+#endif
+      return;
+    }
+
+  public:
+    void init( void )
+    {
+      m_socket = nullptr;
+      m_anchor_tick = m_anchor_utc = m_anchor_refreshed = m_sync_tick = 0;
+      m_stratum = 0;
+      m_refid = 0;
+      m_second_tick = m_report_tick = 0;
+      m_second_count = 0;
+      m_served = m_dropped = m_ignored = m_worst_us = 0;
+      return;
+    }
+
+    /*
+     * poll - called every frame, with whether the app has the network up;
+     *        we listen while it's up, and let go of the socket when it isn't.
+     */
+    void poll( uint64_t p_tick, bool p_link_up )
+    {
+      if ( p_link_up && ( m_socket == nullptr ) )
+      {
+        cyw43_arch_lwip_begin();
+        m_socket = udp_new_ip_type( IPADDR_TYPE_ANY );
+        if ( m_socket != nullptr )
+        {
+          if ( udp_bind( m_socket, IP_ADDR_ANY, SNTP_PORT ) == ERR_OK )
+          {
+            udp_recv( m_socket, receive_cb, this );
+          }
+          else
+          {
+            udp_remove( m_socket );
+            m_socket = nullptr;
+          }
+        }
+        cyw43_arch_lwip_end();
+
+        /* Power saving holds requests back until the next AP beacon. */
+        if ( m_socket != nullptr )
+        {
+          cyw43_wifi_pm( &cyw43_state, CYW43_PERFORMANCE_PM );
+          m_report_tick = p_tick;
+        }
+      }
+      else if ( !p_link_up )
+      {
+        stop();
+      }
+
+      if ( m_socket != nullptr )
+      {
+        report( p_tick );
+      }
+      return;
+    }
+
+    /* stop - lets go of the socket; before the link goes down, if we can. */
+    void stop( void )
+    {
+      if ( m_socket != nullptr )
+      {
+        cyw43_arch_lwip_begin();
+        udp_remove( m_socket );
+        m_socket = nullptr;
+        cyw43_arch_lwip_end();
+      }
+      return;
+    }
+
+    /*
+     * serve - the app keeps telling us what time it is (UTC usecs, NTP era)
+     *         at a tick of our timer, while it's sure of it; along with when
+     *         it last synced, and against what.
+     */
+    void serve( uint64_t p_tick, uint64_t p_utc, uint64_t p_sync_tick,
+                uint8_t p_upstream_stratum, const ip_addr_t *p_upstream )
+    {
+      cyw43_arch_lwip_begin();
+      m_anchor_tick = p_tick;
+      m_anchor_utc = p_utc;
+      m_anchor_refreshed = time_us_64();
+      m_sync_tick = p_sync_tick;
+
+      /* We're one further from the source than whoever we asked. */
+      m_stratum = ( ( p_upstream_stratum >= 1 ) && ( p_upstream_stratum < 15 ) ) ? p_upstream_stratum + 1 : 15;
+      m_refid = ip4_addr_get_u32( ip_2_ip4( p_upstream ) );
+      m_refid = lwip_ntohl( m_refid );
+      cyw43_arch_lwip_end();
+      return;
+    }
+};
+
+
+#endif /* SNTP_SERVER_HPP */
+
+/* End of file sntp_server.hpp */
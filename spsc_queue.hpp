@@ -0,0 +1,93 @@
+/*
+ * spsc_queue.hpp - from the Unicorn C(++) Examples collection
+ *
+ * A fixed size, lock-free queue for exactly one producer and one consumer;
+ * typically an lwIP callback (which runs from an interrupt) handing things
+ * over to the main loop, without either side ever having to disable IRQs.
+ *
+ * The producer only ever writes the head, and the consumer only the tail;
+ * slots are filled in place, and only published once they're complete.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+
+/* System headers. */
+
+#include <atomic>
+#include <stdint.h>
+
+
+/* Class. */
+
+template <typename T, uint32_t N>
+class SpscQueue
+{
+  static_assert( ( N & ( N - 1 ) ) == 0, "SpscQueue size must be a power of two" );
+
+  private:
+    T                      m_slots[N];
+    std::atomic<uint32_t>  m_head{ 0 };
+    std::atomic<uint32_t>  m_tail{ 0 };
+    uint32_t               m_dropped = 0;
+
+  public:
+    /*
+     * claim - (producer) returns the next free slot to fill in, or nullptr if
+     *         the queue is full; nothing is visible until publish().
+     */
+    T *claim( void )
+    {
+      uint32_t  l_head = m_head.load( std::memory_order_relaxed );
+
+      if ( l_head - m_tail.load( std::memory_order_acquire ) >= N )
+      {
+        m_dropped++;
+        return nullptr;
+      }
+      return &m_slots[l_head & ( N - 1 )];
+    }
+
+    /* (producer) hands the claimed slot over to the consumer. */
+    void publish( void )
+    {
+      m_head.store( m_head.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+      return;
+    }
+
+    /* (consumer) the oldest published entry, or nullptr if there's nothing. */
+    const T *front( void )
+    {
+      uint32_t  l_tail = m_tail.load( std::memory_order_relaxed );
+
+      if ( l_tail == m_head.load( std::memory_order_acquire ) )
+      {
+        return nullptr;
+      }
+      return &m_slots[l_tail & ( N - 1 )];
+    }
+
+    /* (consumer) done with the front entry; its slot can be reused. */
+    void pop( void )
+    {
+      m_tail.store( m_tail.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+      return;
+    }
+
+    /* How many entries the producer had to throw away, for lack of space. */
+    uint32_t dropped( void )
+    {
+      return m_dropped;
+    }
+};
+
+
+#endif /* SPSC_QUEUE_HPP */
+
+/* End of file spsc_queue.hpp */
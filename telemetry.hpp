@@ -0,0 +1,366 @@
+/*
+ * telemetry.hpp - from the Unicorn C(++) Examples collection
+ *
+ * Fleet-wide numbers (frame times, how far out the clock had drifted, how
+ * long the WiFi took to come up, brightness) for a dashboard, without waking
+ * the radio just to send them.
+ *
+ * Values are aggregated locally, in a fixed table with no allocation:
+ *
+ *  - counters just add up;
+ *  - gauges keep the last value, and the lowest and highest since the last
+ *    send;
+ *  - histograms keep a count, sum, min and max, and a count per power of two
+ *    (so a value of 1000 goes in the "lt1024" bucket, and anything from
+ *    16384 up in "ge16384").
+ *
+ * Whenever the app has the radio up anyway - better_clock does, for its NTP
+ * sync - flush() sends it all in as few UDP datagrams as it can, one line per
+ * metric in InfluxDB line protocol (which Telegraf's socket listener, or
+ * tools/telemetry_collector.py, will take), and starts afresh. There are no
+ * timestamps; the collector stamps what it receives.
+ *
+ * No more than TELEMETRY_HOURLY_BYTES go in each hour, counted from the first
+ * send (and counting the UDP and IP headers too); whatever doesn't fit, or
+ * whose datagram lwIP wouldn't take, is kept, and carries on being added to,
+ * until the next send.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+
+/* System headers. */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "pico/unique_id.h"
+
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+
+
+/* Constants. */
+
+#define TELEMETRY_METRICS_MAX   8
+#define TELEMETRY_BUCKETS       16
+
+/* Comfortably inside one Ethernet frame, so nothing is ever fragmented. */
+#define TELEMETRY_DATAGRAM_MAX  512
+#define TELEMETRY_HEADER_BYTES  28            /* IPv4 and UDP, per datagram */
+
+/* The longest a line can be: name, tag, and every field at its widest. */
+#define TELEMETRY_NAME_MAX      24
+#define TELEMETRY_LINE_MAX      ( TELEMETRY_NAME_MAX + 16 + 80 + TELEMETRY_BUCKETS * 18 )
+
+#define TELEMETRY_HOURLY_BYTES  4096
+#define TELEMETRY_HOUR_USECS    ( 3600LLU * 1000000LLU )
+
+static_assert( TELEMETRY_LINE_MAX <= TELEMETRY_DATAGRAM_MAX, "a line must fit in a datagram" );
+static_assert( TELEMETRY_METRICS_MAX <= 32, "which metrics are in a datagram is kept in a word" );
+static_assert( TELEMETRY_DATAGRAM_MAX + TELEMETRY_HEADER_BYTES <= TELEMETRY_HOURLY_BYTES,
+               "the hourly budget must fit at least one datagram" );
+
+
+/* Enums. */
+
+typedef enum
+{
+  TELEMETRY_COUNTER,
+  TELEMETRY_GAUGE,
+  TELEMETRY_HISTOGRAM
+} telemetry_type_t;
+
+
+/* Structs. */
+
+/* What the app has to say about each of its metrics, by index. */
+typedef struct
+{
+  const char       *name;
+  telemetry_type_t  type;
+} telemetrymetric_t;
+
+typedef struct
+{
+  uint32_t  count;
+  int64_t   sum;
+  int32_t   min, max, last;
+  uint16_t  buckets[TELEMETRY_BUCKETS];
+} telemetryvalue_t;
+
+
+/* Class. */
+
+class Telemetry
+{
+  private:
+    const telemetrymetric_t *m_metrics;
+    uint_fast8_t      m_count;
+    telemetryvalue_t  m_values[TELEMETRY_METRICS_MAX];
+    ip_addr_t         m_collector;
+    uint16_t          m_port;
+    bool              m_enabled;
+    uint32_t          m_unit;
+    uint64_t          m_hour_tick;
+    uint32_t          m_hour_bytes;
+
+    /* Which power-of-two bucket a (non-negative) value falls in. */
+    static uint_fast8_t bucket( int32_t p_value )
+    {
+      uint_fast8_t  l_bucket = 0;
+
+      while ( ( l_bucket < TELEMETRY_BUCKETS - 1 ) && ( p_value >= ( 1 << l_bucket ) ) )
+      {
+        l_bucket++;
+      }
+      return l_bucket;
+    }
+
+    /* One metric's line, or nothing (0) if there's nothing to say. */
+    int line( uint_fast8_t p_index, char *p_buffer, size_t p_size )
+    {
+      const telemetryvalue_t *l_value = &m_values[p_index];
+      int                     l_length;
+      uint_fast8_t            l_bucket;
+
+      if ( l_value->count == 0 )
+      {
+        return 0;
+      }
+
+      l_length = snprintf( p_buffer, p_size, "%s,unit=%08lx ", m_metrics[p_index].name, (unsigned long)m_unit );
+      switch( m_metrics[p_index].type )
+      {
+        case TELEMETRY_COUNTER:
+          l_length += snprintf( p_buffer + l_length, p_size - l_length, "n=%lldi", (long long)l_value->sum );
+          break;
+        case TELEMETRY_GAUGE:
+          l_length += snprintf( p_buffer + l_length, p_size - l_length, "last=%ldi,min=%ldi,max=%ldi",
+                                (long)l_value->last, (long)l_value->min, (long)l_value->max );
+          break;
+        case TELEMETRY_HISTOGRAM:
+          l_length += snprintf( p_buffer + l_length, p_size - l_length, "n=%lui,sum=%lldi,min=%ldi,max=%ldi",
+                                (unsigned long)l_value->count, (long long)l_value->sum,
+                                (long)l_value->min, (long)l_value->max );
+          for ( l_bucket = 0; l_bucket < TELEMETRY_BUCKETS; l_bucket++ )
+          {
+            if ( l_value->buckets[l_bucket] > 0 )
+            {
+              l_length += snprintf( p_buffer + l_length, p_size - l_length, ",%s%lu=%ui",
+                                    ( l_bucket < TELEMETRY_BUCKETS - 1 ) ? "lt" : "ge",
+                                    1lu << ( ( l_bucket < TELEMETRY_BUCKETS - 1 ) ? l_bucket : l_bucket - 1 ),
+                                    (unsigned)l_value->buckets[l_bucket] );
+            }
+          }
+          break;
+      }
+      l_length += snprintf( p_buffer + l_length, p_size - l_length, "\n" );
+      return l_length;
+    }
+
+    /* Sends one datagram; the caller holds the lwIP lock. */
+    bool send( struct udp_pcb *p_socket, const char *p_payload, uint16_t p_length )
+    {
+      struct pbuf  *l_buffer;
+      err_t         l_error;
+
+      l_buffer = pbuf_alloc( PBUF_TRANSPORT, p_length, PBUF_RAM );
+      if ( l_buffer == nullptr )
+      {
+        return false;
+      }
+      memcpy( l_buffer->payload, p_payload, p_length );
+      l_error = udp_sendto( p_socket, l_buffer, &m_collector, m_port );
+      pbuf_free( l_buffer );
+      return l_error == ERR_OK;
+    }
+
+    /*
+     * deliver - sends a datagram of lines, and only once it's gone clears the
+     *           metrics they came from; otherwise they're held over, for next
+     *           time. Returns how many bytes went (headers and all).
+     */
+    uint32_t deliver( struct udp_pcb *p_socket, const char *p_payload, uint16_t p_length,
+                      uint32_t p_metrics, uint_fast8_t *p_held )
+    {
+      bool          l_sent = send( p_socket, p_payload, p_length );
+      uint_fast8_t  l_index;
+
+      for ( l_index = 0; l_index < m_count; l_index++ )
+      {
+        if ( ( p_metrics & ( 1u << l_index ) ) == 0 )
+        {
+          continue;
+        }
+        if ( l_sent )
+        {
+          memset( &m_values[l_index], 0, sizeof( telemetryvalue_t ) );
+        }
+        else
+        {
+          ( *p_held )++;
+        }
+      }
+      return l_sent ? p_length + TELEMETRY_HEADER_BYTES : 0;
+    }
+
+  public:
+    /*
+     * init - sets up the metrics (the app's table, indexed by its own enum),
+     *        and where to send them; without a collector, nothing's kept.
+     */
+    void init( const telemetrymetric_t *p_metrics, uint_fast8_t p_count, const char *p_collector, uint16_t p_port )
+    {
+      pico_unique_board_id_t  l_id;
+      uint_fast8_t            l_index;
+
+      m_metrics = p_metrics;
+      m_count = ( p_count < TELEMETRY_METRICS_MAX ) ? p_count : TELEMETRY_METRICS_MAX;
+      memset( m_values, 0, sizeof( m_values ) );
+      m_port = p_port;
+      m_enabled = ( p_collector != nullptr ) && ( p_collector[0] != '\0' ) &&
+                  ( ipaddr_aton( p_collector, &m_collector ) != 0 );
+      m_hour_tick = 0;
+      m_hour_bytes = 0;
+
+      /* The same FNV-1a of the flash's unique ID that the fleet uses. */
+      pico_get_unique_board_id( &l_id );
+      m_unit = 2166136261u;
+      for ( l_index = 0; l_index < PICO_UNIQUE_BOARD_ID_SIZE_BYTES; l_index++ )
+      {
+        m_unit = ( m_unit ^ l_id.id[l_index] ) * 16777619u;
+      }
+      return;
+    }
+
+    /* Adds to a counter. */
+    void count( uint_fast8_t p_index, uint32_t p_amount = 1 )
+    {
+      if ( m_enabled && ( p_index < m_count ) )
+      {
+        m_values[p_index].count++;
+        m_values[p_index].sum += p_amount;
+      }
+      return;
+    }
+
+    /* Records a value against a gauge or a histogram. */
+    void record( uint_fast8_t p_index, int32_t p_value )
+    {
+      telemetryvalue_t *l_value = &m_values[p_index];
+
+      if ( !m_enabled || ( p_index >= m_count ) )
+      {
+        return;
+      }
+
+      if ( ( l_value->count == 0 ) || ( p_value < l_value->min ) )
+      {
+        l_value->min = p_value;
+      }
+      if ( ( l_value->count == 0 ) || ( p_value > l_value->max ) )
+      {
+        l_value->max = p_value;
+      }
+      l_value->count++;
+      l_value->sum += p_value;
+      l_value->last = p_value;
+      if ( ( m_metrics[p_index].type == TELEMETRY_HISTOGRAM ) && ( p_value >= 0 ) &&
+           ( l_value->buckets[bucket( p_value )] < UINT16_MAX ) )
+      {
+        l_value->buckets[bucket( p_value )]++;
+      }
+      return;
+    }
+
+    /*
+     * flush - sends everything gathered since last time, as far as this
+     *         hour's budget allows; only to be called with the link up.
+     *         Returns how many bytes went (headers and all); anything that
+     *         didn't go is held over.
+     */
+    uint32_t flush( void )
+    {
+      char            l_datagram[TELEMETRY_DATAGRAM_MAX];
+      char            l_line[TELEMETRY_LINE_MAX];
+      struct udp_pcb *l_socket;
+      uint64_t        l_now = time_us_64();
+      uint32_t        l_sent = 0, l_metrics = 0;
+      uint_fast16_t   l_length = 0;
+      uint_fast8_t    l_index, l_held = 0;
+      int             l_line_length;
+
+      if ( !m_enabled )
+      {
+        return 0;
+      }
+      if ( ( m_hour_tick == 0 ) || ( l_now - m_hour_tick >= TELEMETRY_HOUR_USECS ) )
+      {
+        m_hour_tick = l_now;
+        m_hour_bytes = 0;
+      }
+
+      cyw43_arch_lwip_begin();
+      l_socket = udp_new_ip_type( IPADDR_TYPE_ANY );
+      if ( l_socket == nullptr )
+      {
+        cyw43_arch_lwip_end();
+        return 0;
+      }
+
+      for ( l_index = 0; l_index < m_count; l_index++ )
+      {
+        l_line_length = line( l_index, l_line, sizeof( l_line ) );
+        if ( l_line_length <= 0 )
+        {
+          continue;
+        }
+
+        /* If the datagram's full, off it goes; the line starts the next. */
+        if ( l_length + l_line_length > TELEMETRY_DATAGRAM_MAX )
+        {
+          l_sent += deliver( l_socket, l_datagram, l_length, l_metrics, &l_held );
+          l_length = 0;
+          l_metrics = 0;
+        }
+
+        /* A line that would take us over this hour's budget waits for the next. */
+        if ( m_hour_bytes + l_sent + l_length + l_line_length + TELEMETRY_HEADER_BYTES > TELEMETRY_HOURLY_BYTES )
+        {
+          l_held++;
+          continue;
+        }
+        memcpy( l_datagram + l_length, l_line, l_line_length );
+        l_length += l_line_length;
+        l_metrics |= 1u << l_index;
+      }
+      if ( l_length > 0 )
+      {
+        l_sent += deliver( l_socket, l_datagram, l_length, l_metrics, &l_held );
+      }
+
+      udp_remove( l_socket );
+      cyw43_arch_lwip_end();
+
+      m_hour_bytes += l_sent;
+      if ( ( l_sent > 0 ) || ( l_held > 0 ) )
+      {
+        printf( "telemetry: sent %lu bytes (%lu of %u this hour)%s\n", (unsigned long)l_sent,
+                (unsigned long)m_hour_bytes, TELEMETRY_HOURLY_BYTES, l_held ? ", some held over" : "" );
+      }
+      return l_sent;
+    }
+};
+
+
+#endif /* TELEMETRY_HPP */
+
+/* End of file telemetry.hpp */
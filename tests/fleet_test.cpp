@@ -0,0 +1,348 @@
+/*
+ * fleet_test.cpp - from the Unicorn C(++) Examples collection
+ *
+ * A fleet of better_clocks sharing time, run on the PC with the real
+ * FleetTime (fleet_time.hpp) in every one of them; each node has its own
+ * crystal error, boot time and WiFi join time, and the network between them
+ * has jitter, a long tail and loss. Each node's clock app is cut down to what
+ * update_fleet() does with the fleet's time, polled as often as the clock
+ * would; so followers load the RTC on the leader's next second, and the
+ * leader locks its second to the (whole second) NTP time it gets.
+ *
+ * Partway through, the leader is switched off. At the end there should be
+ * the one leader again, and every clock showing (near enough) the same time.
+ *
+ * The fleet's time steps whenever a leader syncs (hourly, and when a new one
+ * takes over), and when a leader stands down for a better one. A leader's
+ * second starts wherever NTP's whole seconds fell when it synced, so each
+ * step can be anything up to a second; and followers only hear about it at
+ * their next window, up to ten minutes on. Worse, a follower that synced to
+ * a leader which then stood down keeps that leader's time until then. So
+ * spreads are reported overall, and once everyone has caught up.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include <stdint.h>
+#include <math.h>
+
+#define uint_fast8_t uint32_t
+
+
+/* Local headers. */
+
+#include "host.hpp"
+#include "fleet_time.hpp"
+
+
+/* Constants. */
+
+#define TEST_SEC          1000000LLU
+#define TEST_NODES        12
+#define TEST_RUN_US       ( 3 * 3600 * TEST_SEC )
+#define TEST_KILL_US      ( 90 * 60 * TEST_SEC )
+#define TEST_BOOT_US      ( 10 * TEST_SEC )
+#define TEST_PPM          30.0
+#define TEST_LOSS_PERCENT 2
+#define TEST_SAMPLE_US    TEST_SEC
+#define TEST_EPOCH_US     ( 3900000000LLU * TEST_SEC + 371529 )
+
+/* As better_clock: NTP hourly, and 20fps when busy, else every half second. */
+#define TEST_NTP_US       ( 3600 * TEST_SEC )
+#define TEST_BUSY_US      ( TEST_SEC / 20 )
+#define TEST_SLACK_US     2000
+
+/* Once everyone has caught up, this is as far apart as any two should be. */
+#define TEST_SETTLED_US   100000
+#define TEST_DUTY_PERCENT 2.0
+
+
+/* Structs. */
+
+typedef struct
+{
+  FleetTime fleet;
+  bool      booted, alive;
+  uint64_t  next_poll;          /* on the simulation's clock */
+
+  /* What it's showing; whole seconds, from the tick the last one started. */
+  bool      showing;
+  uint64_t  seconds, second_tick;
+  uint64_t  synced_us;
+
+  /* A follower's RTC load, waiting for the leader's next second. */
+  bool      rtc_pending;
+  uint64_t  rtc_seconds, rtc_tick;
+
+  /* A leader's last NTP sync. */
+  uint64_t  ntp_tick;
+} testnode_t;
+
+
+/* Globals. */
+
+static testnode_t g_nodes[TEST_NODES];
+static uint64_t   g_step_us;          /* when the fleet's time last stepped */
+static uint32_t   g_steps;
+
+
+/* Functions. */
+
+/* Something in (0,1], from rand(); the simulation is the same every time. */
+static double test_random( void )
+{
+  return ( rand() + 1.0 ) / ( RAND_MAX + 1.0 );
+}
+
+/* A couple of ms of airtime, with a long tail for when the AP's busy. */
+static uint32_t test_latency( void )
+{
+  if ( rand() % 100 < TEST_LOSS_PERCENT )
+  {
+    return HOST_LOST;
+  }
+  return 1500 - 3000 * log( test_random() ) + ( rand() % 50 == 0 ? 20000 : 0 );
+}
+
+/* What a node is showing right now, in UTC microseconds. */
+static uint64_t test_shown( uint32_t p_node )
+{
+  return g_nodes[p_node].seconds * TEST_SEC +
+         host_node_time( p_node, g_host_time_us ) - g_nodes[p_node].second_tick;
+}
+
+/* One frame of a node's clock, as far as the fleet is concerned. */
+static void test_poll( uint32_t p_node )
+{
+  testnode_t *l_node = &g_nodes[p_node];
+  uint64_t    l_now, l_tick, l_utc, l_wait;
+  bool        l_leading = l_node->fleet.leading();
+
+  g_host_node = p_node;
+  l_now = time_us_64();
+  if ( !l_node->booted )
+  {
+    l_node->fleet.init();
+    l_node->booted = true;
+  }
+
+  /* Followers set the RTC right on the start of the leader's next second. */
+  if ( l_node->fleet.poll( l_now ) )
+  {
+    l_node->fleet.sample( &l_tick, &l_utc );
+    l_utc += l_now - l_tick;
+    l_node->rtc_seconds = l_utc / TEST_SEC + 1;
+    l_node->rtc_tick = l_now + TEST_SEC - ( l_utc % TEST_SEC );
+    l_node->rtc_pending = true;
+  }
+  if ( l_node->rtc_pending && ( l_now >= l_node->rtc_tick ) )
+  {
+    l_node->seconds = l_node->rtc_seconds + ( l_now - l_node->rtc_tick ) / TEST_SEC;
+    l_node->second_tick = l_now;
+    l_node->showing = true;
+    l_node->rtc_pending = false;
+    l_node->synced_us = g_host_time_us;
+  }
+
+  /* The leader's NTP only fills in whole seconds, so its second starts now. */
+  if ( !l_node->fleet.leading() )
+  {
+    l_node->ntp_tick = 0;
+    if ( l_leading )
+    {
+      g_step_us = g_host_time_us;
+      g_steps++;
+    }
+  }
+  else
+  {
+    if ( l_node->fleet.link_up() &&
+         ( ( l_node->ntp_tick == 0 ) || ( l_now > l_node->ntp_tick + TEST_NTP_US ) ) )
+    {
+      l_node->seconds = ( TEST_EPOCH_US + g_host_time_us + rand() % 30000 ) / TEST_SEC;
+      l_node->ntp_tick = l_node->second_tick = l_now;
+      l_node->showing = true;
+      l_node->synced_us = g_step_us = g_host_time_us;
+      g_steps++;
+    }
+    if ( l_node->ntp_tick != 0 )
+    {
+      l_node->fleet.lead( l_node->second_tick, l_node->seconds * TEST_SEC );
+    }
+  }
+
+  /* And the next frame; just after the next half second, unless busy. */
+  if ( l_node->fleet.busy() || l_node->rtc_pending || !l_node->showing )
+  {
+    l_wait = TEST_BUSY_US;
+  }
+  else
+  {
+    l_wait = TEST_SEC / 2 + TEST_SLACK_US - ( l_now - l_node->second_tick ) % ( TEST_SEC / 2 );
+  }
+  if ( l_node->rtc_pending && ( l_node->rtc_tick - l_now < l_wait ) )
+  {
+    l_wait = l_node->rtc_tick - l_now;
+  }
+  l_node->next_poll = g_host_time_us + l_wait;
+  return;
+}
+
+int main()
+{
+  uint32_t    l_node, l_leaders, l_leader, l_alive, l_followers, l_samples = 0, l_settled = 0, l_split = 0;
+  uint32_t    l_lowest = UINT32_MAX, l_elected = 0;
+  uint64_t    l_next, l_next_sample, l_lo, l_hi, l_shown, l_spread;
+  uint64_t    l_worst = 0, l_worst_settled = 0, l_total_settled = 0;
+  bool        l_killed = false, l_all_showing, l_caught_up;
+  double      l_duty = 0;
+
+  srand( 63 );
+  for ( l_node = 0; l_node < TEST_NODES; l_node++ )
+  {
+    g_host_nodes[l_node].boot_us = rand() % TEST_BOOT_US;
+    g_host_nodes[l_node].ppm = ( test_random() * 2 - 1 ) * TEST_PPM;
+    g_host_nodes[l_node].join_us = 2 * TEST_SEC + rand() % ( 3 * TEST_SEC );
+    g_host_nodes[l_node].link_status = CYW43_LINK_UP;
+    g_nodes[l_node].alive = true;
+    g_nodes[l_node].next_poll = g_host_nodes[l_node].boot_us;
+  }
+  g_host_latency = test_latency;
+  g_host_time_us = 0;
+  l_next_sample = TEST_SAMPLE_US;
+
+  while ( g_host_time_us < TEST_RUN_US )
+  {
+    /* Whatever's next; a node's frame, a datagram arriving, or a sample. */
+    l_next = std::min( host_udp_next(), l_next_sample );
+    for ( l_node = 0; l_node < TEST_NODES; l_node++ )
+    {
+      if ( g_nodes[l_node].alive && ( g_nodes[l_node].next_poll < l_next ) )
+      {
+        l_next = g_nodes[l_node].next_poll;
+      }
+    }
+    host_udp_run( l_next );
+
+    for ( l_node = 0; l_node < TEST_NODES; l_node++ )
+    {
+      if ( g_nodes[l_node].alive && ( g_nodes[l_node].next_poll <= g_host_time_us ) )
+      {
+        test_poll( l_node );
+      }
+    }
+
+    if ( g_host_time_us < l_next_sample )
+    {
+      continue;
+    }
+    l_next_sample += TEST_SAMPLE_US;
+
+    /* Partway through, switch the leader off; its radio goes with it. */
+    l_leaders = l_alive = 0;
+    l_leader = UINT32_MAX;
+    for ( l_node = 0; l_node < TEST_NODES; l_node++ )
+    {
+      if ( g_nodes[l_node].alive && g_nodes[l_node].booted )
+      {
+        l_alive++;
+        if ( g_nodes[l_node].fleet.leading() )
+        {
+          l_leaders++;
+          l_leader = l_node;
+          if ( !l_killed )
+          {
+            l_lowest = std::min( l_lowest, g_nodes[l_node].fleet.unit() );
+          }
+        }
+      }
+    }
+    if ( !l_killed && ( g_host_time_us >= TEST_KILL_US ) && ( l_leaders == 1 ) )
+    {
+      printf( "%.1fs: switching off the leader, unit %08lx\n", g_host_time_us / 1000000.0,
+              (unsigned long)g_nodes[l_leader].fleet.unit() );
+      l_elected = g_nodes[l_leader].fleet.unit();
+      g_nodes[l_leader].alive = false;
+      g_host_nodes[l_leader].radio = false;
+      l_killed = true;
+      continue;
+    }
+
+    /* With a single leader, and everyone showing a time, how far apart are they? */
+    l_all_showing = ( l_alive == TEST_NODES - l_killed );
+    l_caught_up = true;
+    l_lo = UINT64_MAX;
+    l_hi = 0;
+    for ( l_node = 0; l_node < TEST_NODES; l_node++ )
+    {
+      if ( !g_nodes[l_node].alive )
+      {
+        continue;
+      }
+      if ( !g_nodes[l_node].showing )
+      {
+        l_all_showing = false;
+        break;
+      }
+      l_shown = test_shown( l_node );
+      l_lo = std::min( l_lo, l_shown );
+      l_hi = std::max( l_hi, l_shown );
+      l_caught_up = l_caught_up && ( g_nodes[l_node].synced_us >= g_step_us );
+    }
+    if ( !l_all_showing || ( l_leaders != 1 ) )
+    {
+      continue;
+    }
+
+    l_spread = l_hi - l_lo;
+    l_samples++;
+    l_worst = std::max( l_worst, l_spread );
+    l_split += ( l_lo / TEST_SEC != l_hi / TEST_SEC );
+    if ( l_caught_up )
+    {
+      l_settled++;
+      l_total_settled += l_spread;
+      l_worst_settled = std::max( l_worst_settled, l_spread );
+    }
+  }
+
+  /* One leader at the end; and followers with their radios off, mostly. */
+  l_leaders = l_followers = 0;
+  for ( l_node = 0; l_node < TEST_NODES; l_node++ )
+  {
+    if ( g_nodes[l_node].alive && g_nodes[l_node].fleet.leading() )
+    {
+      l_leaders++;
+    }
+    else if ( g_nodes[l_node].alive )
+    {
+      l_followers++;
+      l_duty += g_host_nodes[l_node].radio_us;
+    }
+  }
+  l_duty = l_followers ? l_duty * 100.0 / ( l_followers * (double)TEST_RUN_US ) : 100.0;
+
+  printf( "%u nodes, %u steps in the fleet's time, %u samples (%u caught up)\n",
+          TEST_NODES, (unsigned)g_steps, (unsigned)l_samples, (unsigned)l_settled );
+  printf( "spread once caught up: mean %.2fms, worst %.2fms\n",
+          l_settled ? l_total_settled / 1000.0 / l_settled : 0.0, l_worst_settled / 1000.0 );
+  printf( "spread overall: worst %.2fms, showing different seconds %.2f%% of the time\n",
+          l_worst / 1000.0, l_samples ? l_split * 100.0 / l_samples : 0.0 );
+  printf( "follower radio duty cycle: %.2f%%\n", l_duty );
+
+  /* Where leaders met, the lowest unit won (until it was switched off). */
+  HOST_CHECK( l_killed );
+  HOST_CHECK( l_elected == l_lowest );
+  HOST_CHECK( l_leaders == 1 );
+  HOST_CHECK( l_samples > TEST_RUN_US / TEST_SAMPLE_US / 2 );
+  HOST_CHECK( l_settled > l_samples / 2 );
+  HOST_CHECK( l_worst_settled < TEST_SETTLED_US );
+  HOST_CHECK( l_worst < TEST_SEC + TEST_SETTLED_US );
+  HOST_CHECK( l_duty < TEST_DUTY_PERCENT );
+  return host_result( "fleet" );
+}
+
+/* End of file fleet_test.cpp */
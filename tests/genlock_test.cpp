@@ -0,0 +1,321 @@
+/*
+ * genlock_test.cpp - from the Unicorn C(++) Examples collection
+ *
+ * A wall of genlocked panels, run on the PC with the real Genlock (genlock.hpp)
+ * in every one of them; each panel has its own crystal error and boot time
+ * (so its timer is offset from the others), wakes up a little late now and
+ * then, and the network between them has jitter, a long tail and loss. Each
+ * panel's frame loop is cut down to what rain's does with the genlock: poll,
+ * follow (or run its own frame, and publish it if leading), render, present.
+ *
+ * Once the followers have found the leader, every panel should present each
+ * frame at (near enough) the same moment. And the leader's idea of how far
+ * out each follower is should hold up against when they really presented;
+ * its tightest skew to within the +/- it gives, its worst a lower bound.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#define uint_fast8_t uint32_t
+
+
+/* Local headers. */
+
+#include "host.hpp"
+#include "genlock.hpp"
+
+
+/* Constants. */
+
+#define TEST_SEC          1000000LLU
+#define TEST_PANELS       4
+#define TEST_FPS          8
+#define TEST_PERIOD_US    ( TEST_SEC / TEST_FPS )
+#define TEST_RUN_US       ( 10 * 60 * TEST_SEC )
+#define TEST_BOOT_US      ( 5 * TEST_SEC )
+#define TEST_PPM          30.0
+#define TEST_LOSS_PERCENT 2
+#define TEST_RENDER_US    400
+#define TEST_STATE_LEN    30
+#define TEST_FRAMES_MAX   ( TEST_RUN_US / TEST_PERIOD_US + 1 )
+
+/* Followers have found the leader, and have a few echoes behind them, by here. */
+#define TEST_SETTLE_US    ( 30 * TEST_SEC )
+
+/* Once settled, this is as far apart as the panels should present a frame. */
+#define TEST_SKEW_US      2000
+#define TEST_WORST_US     5000
+
+/*
+ * The leader puts a follower's frame on its own timer through an echo up to
+ * a second or so before; their crystals can drift apart by this much since.
+ */
+#define TEST_DRIFT_US     100
+
+/* Taken over every echo, the leader's mean skew should be nearer than any one. */
+#define TEST_MEAN_US      500
+
+
+/* Structs. */
+
+typedef struct
+{
+  Genlock               genlock;
+  bool                  booted, presenting;
+  uint64_t              next_us;        /* on the simulation's clock */
+  uint32_t              frame;
+  uint64_t              present_tick;   /* on its own timer */
+
+  /* When (on the simulation's clock) it presented each frame, while locked. */
+  std::vector<uint64_t> presented;
+} testnode_t;
+
+
+/* Globals. */
+
+static testnode_t                       g_nodes[TEST_PANELS];
+static pimoroni::GalacticUnicorn        g_unicorn;
+static pimoroni::PicoGraphics_PenRGB565 g_graphics( pimoroni::GalacticUnicorn::WIDTH,
+                                                    pimoroni::GalacticUnicorn::HEIGHT, nullptr );
+static uint32_t                         g_state_errors;
+
+
+/* Functions. */
+
+/* Something in (0,1], from rand(); the simulation is the same every time. */
+static double test_random( void )
+{
+  return ( rand() + 1.0 ) / ( RAND_MAX + 1.0 );
+}
+
+/* A couple of ms of airtime, with a long tail for when the AP's busy. */
+static uint32_t test_latency( void )
+{
+  if ( rand() % 100 < TEST_LOSS_PERCENT )
+  {
+    return HOST_LOST;
+  }
+  return 1500 - 1500 * log( test_random() ) + ( rand() % 50 == 0 ? 15000 : 0 );
+}
+
+/* Wakeups are usually prompt, but an interrupt can hold us up. */
+static uint32_t test_late( void )
+{
+  return -20 * log( test_random() ) + ( rand() % 100 == 0 ? 2000 : 0 );
+}
+
+/* When (on the simulation's clock) a node's timer gets to a tick; never past. */
+static uint64_t test_at( uint32_t p_node, uint64_t p_tick )
+{
+  uint64_t  l_time;
+
+  l_time = g_host_nodes[p_node].boot_us + p_tick / ( 1.0 + g_host_nodes[p_node].ppm / 1000000.0 );
+  while ( host_node_time( p_node, l_time ) < p_tick )
+  {
+    l_time++;
+  }
+  return std::max( l_time, g_host_time_us );
+}
+
+/* Rain's update(), as far as the genlock is concerned; then it renders. */
+static void test_update( uint32_t p_node )
+{
+  testnode_t *l_node = &g_nodes[p_node];
+  uint8_t     l_state[TEST_STATE_LEN];
+  uint64_t    l_now;
+
+  g_host_node = p_node;
+  l_now = time_us_64();
+  if ( !l_node->booted )
+  {
+    l_node->genlock.init( p_node );
+    l_node->booted = true;
+  }
+
+  l_node->genlock.poll( l_now );
+  if ( !l_node->genlock.leading() &&
+       l_node->genlock.follow( &l_node->frame, &l_node->present_tick, l_state, sizeof( l_state ) ) )
+  {
+    /* The state's just the frame number, over and over; it should arrive intact. */
+    g_state_errors += ( l_state[0] != (uint8_t)l_node->frame ) || ( l_state[TEST_STATE_LEN-1] != (uint8_t)l_node->frame );
+  }
+  else
+  {
+    l_node->frame++;
+    l_node->present_tick += TEST_PERIOD_US;
+    if ( l_node->present_tick < l_now )
+    {
+      l_node->present_tick = l_now + GENLOCK_LEAD_USECS;
+    }
+    if ( l_node->genlock.leading() )
+    {
+      memset( l_state, (uint8_t)l_node->frame, sizeof( l_state ) );
+      l_node->genlock.publish( l_node->frame, l_node->present_tick, l_state, sizeof( l_state ) );
+    }
+  }
+
+  /* Rendering takes a while; then present() waits (spinning, so promptly) for its time. */
+  l_node->next_us = test_at( p_node, std::max( l_now + TEST_RENDER_US, l_node->present_tick ) ) + rand() % 3;
+  l_node->presenting = true;
+  return;
+}
+
+/* Rain's present, and the wait for its next frame. */
+static void test_present( uint32_t p_node )
+{
+  testnode_t *l_node = &g_nodes[p_node];
+
+  g_host_node = p_node;
+  l_node->genlock.present( &g_unicorn, &g_graphics, l_node->frame, l_node->present_tick );
+  if ( l_node->genlock.locked( time_us_64() ) && ( l_node->frame < TEST_FRAMES_MAX ) )
+  {
+    l_node->presented[l_node->frame] = g_host_time_us;
+  }
+
+  l_node->next_us = test_at( p_node, l_node->present_tick + TEST_PERIOD_US -
+                                     ( l_node->genlock.leading() ? GENLOCK_LEAD_USECS : GENLOCK_LEAD_USECS / 2 ) ) +
+                    test_late();
+  l_node->presenting = false;
+  return;
+}
+
+/* How far out a follower really was with a frame; or INT64_MAX if it wasn't there. */
+static int64_t test_skew( uint32_t p_node, uint32_t p_frame )
+{
+  if ( ( p_frame >= TEST_FRAMES_MAX ) || ( g_nodes[0].presented[p_frame] == 0 ) ||
+       ( g_nodes[p_node].presented[p_frame] == 0 ) )
+  {
+    return INT64_MAX;
+  }
+  return (int64_t)( g_nodes[p_node].presented[p_frame] - g_nodes[0].presented[p_frame] );
+}
+
+int main()
+{
+  genlockpanel_t        l_panel;
+  std::vector<uint64_t> l_spreads;
+  uint32_t              l_node, l_frame, l_count;
+  uint64_t              l_next, l_lo, l_hi;
+  int64_t               l_skew, l_worst, l_total;
+  bool                  l_everywhere;
+
+  srand( 64 );
+  for ( l_node = 0; l_node < TEST_PANELS; l_node++ )
+  {
+    g_host_nodes[l_node].boot_us = rand() % TEST_BOOT_US;
+    g_host_nodes[l_node].ppm = ( test_random() * 2 - 1 ) * TEST_PPM;
+    g_host_nodes[l_node].join_us = 2 * TEST_SEC + rand() % ( 3 * TEST_SEC );
+    g_host_nodes[l_node].link_status = CYW43_LINK_UP;
+    g_nodes[l_node].next_us = g_host_nodes[l_node].boot_us;
+    g_nodes[l_node].presented.assign( TEST_FRAMES_MAX, 0 );
+  }
+  g_host_latency = test_latency;
+  g_host_time_us = 0;
+
+  while ( g_host_time_us < TEST_RUN_US )
+  {
+    /* Whatever's next; a panel's update or present, or a datagram arriving. */
+    l_next = host_udp_next();
+    for ( l_node = 0; l_node < TEST_PANELS; l_node++ )
+    {
+      l_next = std::min( l_next, g_nodes[l_node].next_us );
+    }
+    host_udp_run( l_next );
+
+    for ( l_node = 0; l_node < TEST_PANELS; l_node++ )
+    {
+      if ( g_nodes[l_node].next_us <= g_host_time_us )
+      {
+        if ( g_nodes[l_node].presenting )
+        {
+          test_present( l_node );
+        }
+        else
+        {
+          test_update( l_node );
+        }
+      }
+    }
+  }
+
+  /* How far apart every panel really presented each frame, once settled. */
+  for ( l_frame = 0; l_frame < TEST_FRAMES_MAX; l_frame++ )
+  {
+    l_everywhere = g_nodes[0].presented[l_frame] >= TEST_SETTLE_US;
+    l_lo = UINT64_MAX;
+    l_hi = 0;
+    for ( l_node = 0; l_everywhere && ( l_node < TEST_PANELS ); l_node++ )
+    {
+      l_everywhere = g_nodes[l_node].presented[l_frame] != 0;
+      l_lo = std::min( l_lo, g_nodes[l_node].presented[l_frame] );
+      l_hi = std::max( l_hi, g_nodes[l_node].presented[l_frame] );
+    }
+    if ( l_everywhere )
+    {
+      l_spreads.push_back( l_hi - l_lo );
+    }
+  }
+  std::sort( l_spreads.begin(), l_spreads.end() );
+
+  printf( "%u panels at %ufps for %.1f minutes; %lu frames presented everywhere\n",
+          (unsigned)TEST_PANELS, (unsigned)TEST_FPS, TEST_RUN_US / 60000000.0, (unsigned long)l_spreads.size() );
+  HOST_CHECK( l_spreads.size() > ( TEST_RUN_US - TEST_SETTLE_US ) / TEST_PERIOD_US * 9 / 10 );
+  HOST_CHECK( g_state_errors == 0 );
+  if ( l_spreads.empty() )
+  {
+    return host_result( "genlock" );
+  }
+  printf( "genlocked skew: median %luus, 99%% %luus, worst %luus\n",
+          (unsigned long)l_spreads[l_spreads.size() / 2], (unsigned long)l_spreads[l_spreads.size() * 99 / 100],
+          (unsigned long)l_spreads.back() );
+  HOST_CHECK( l_spreads[l_spreads.size() * 99 / 100] < TEST_SKEW_US );
+  HOST_CHECK( l_spreads.back() < TEST_WORST_US );
+
+  /* And what the leader made of each follower; it never reported, so that's the whole run. */
+  for ( l_node = 1; l_node < TEST_PANELS; l_node++ )
+  {
+    g_host_node = 0;
+    if ( !g_nodes[0].genlock.follower( l_node, time_us_64(), &l_panel ) )
+    {
+      HOST_CHECK( !"the leader has a skew for every follower" );
+      continue;
+    }
+
+    l_worst = l_total = 0;
+    l_count = 0;
+    for ( l_frame = 0; l_frame < TEST_FRAMES_MAX; l_frame++ )
+    {
+      l_skew = test_skew( l_node, l_frame );
+      if ( l_skew != INT64_MAX )
+      {
+        l_worst = std::max( l_worst, l_skew < 0 ? -l_skew : l_skew );
+        l_total += l_skew;
+        l_count++;
+      }
+    }
+    l_skew = test_skew( l_node, l_panel.frame );
+
+    printf( "panel %lu: leader reports %ldus +/-%luus for frame %lu (really %ldus), mean %ldus over %lu echoes "
+            "(really %ldus), worst at least %ldus (really %ldus)\n",
+            (unsigned long)l_node, (long)l_panel.skew, (unsigned long)l_panel.error, (unsigned long)l_panel.frame,
+            (long)l_skew, (long)( l_panel.skew_total / l_panel.skew_count ), (unsigned long)l_panel.skew_count,
+            (long)( l_count ? l_total / l_count : 0 ), (long)l_panel.worst, (long)l_worst );
+    HOST_CHECK( l_panel.skew_count > TEST_RUN_US / GENLOCK_ECHO_USECS / 2 );
+    HOST_CHECK( l_skew != INT64_MAX );
+    HOST_CHECK( llabs( l_panel.skew - l_skew ) <= l_panel.error + TEST_DRIFT_US );
+    HOST_CHECK( l_panel.worst <= l_worst + TEST_DRIFT_US );
+    HOST_CHECK( ( l_count > 0 ) && ( llabs( l_panel.skew_total / l_panel.skew_count - l_total / l_count ) < TEST_MEAN_US ) );
+  }
+
+  return host_result( "genlock" );
+}
+
+/* End of file genlock_test.cpp */
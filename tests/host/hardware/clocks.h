@@ -0,0 +1,24 @@
+/*
+ * hardware/clocks.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_HARDWARE_CLOCKS_H
+#define HOST_HARDWARE_CLOCKS_H
+
+#include <stdint.h>
+enum clock_index { clk_gpout0, clk_ref, clk_sys, clk_peri, clk_usb, clk_adc, clk_rtc };
+uint32_t clock_get_hz(enum clock_index);
+typedef struct { volatile uint32_t sleep_en0, sleep_en1, wake_en0, wake_en1; } clocks_hw_t;
+extern clocks_hw_t *clocks_hw;
+#define CLOCKS_SLEEP_EN0_CLK_RTC_RTC_BITS 0x00800000u
+#define CLOCKS_SLEEP_EN1_CLK_SYS_TIMER_BITS 0x00200000u
+#define CLOCKS_SLEEP_EN0_CLK_SYS_IO_BITS 0x00040000u
+#define CLOCKS_SLEEP_EN0_CLK_SYS_PADS_BITS 0x00080000u
+#define CLOCKS_SLEEP_EN0_CLK_SYS_RTC_BITS 0x00400000u
+#define CLOCKS_SLEEP_EN1_CLK_SYS_WATCHDOG_BITS 0x00002000u
+#define CLOCKS_SLEEP_EN1_CLK_SYS_XOSC_BITS 0x00004000u
+#define CLOCKS_SLEEP_EN1_CLK_USB_USBCTRL_BITS 0x00000200u
+#define CLOCKS_SLEEP_EN1_CLK_SYS_USBCTRL_BITS 0x00000100u
+
+#endif /* HOST_HARDWARE_CLOCKS_H */
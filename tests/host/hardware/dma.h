@@ -0,0 +1,22 @@
+/*
+ * hardware/dma.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_HARDWARE_DMA_H
+#define HOST_HARDWARE_DMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+typedef struct { uint32_t ctrl; } dma_channel_config;
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+int dma_claim_unused_channel(bool);
+dma_channel_config dma_channel_get_default_config(unsigned);
+void channel_config_set_transfer_data_size(dma_channel_config*, enum dma_channel_transfer_size);
+void channel_config_set_read_increment(dma_channel_config*, bool);
+void channel_config_set_write_increment(dma_channel_config*, bool);
+void dma_channel_configure(unsigned, const dma_channel_config*, volatile void*, const volatile void*, unsigned, bool);
+void dma_channel_wait_for_finish_blocking(unsigned);
+bool dma_channel_is_busy(unsigned);
+
+#endif /* HOST_HARDWARE_DMA_H */
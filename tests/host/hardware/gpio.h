@@ -0,0 +1,17 @@
+/*
+ * hardware/gpio.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_HARDWARE_GPIO_H
+#define HOST_HARDWARE_GPIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+typedef unsigned int uint;
+enum gpio_irq_level { GPIO_IRQ_LEVEL_LOW = 1, GPIO_IRQ_LEVEL_HIGH = 2, GPIO_IRQ_EDGE_FALL = 4, GPIO_IRQ_EDGE_RISE = 8 };
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+void gpio_set_irq_enabled(uint, uint32_t, bool);
+void gpio_set_irq_enabled_with_callback(uint, uint32_t, bool, gpio_irq_callback_t);
+
+#endif /* HOST_HARDWARE_GPIO_H */
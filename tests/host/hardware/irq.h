@@ -0,0 +1,17 @@
+/*
+ * hardware/irq.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_HARDWARE_IRQ_H
+#define HOST_HARDWARE_IRQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#define TIMER_IRQ_0 0
+#define PICO_HIGHEST_IRQ_PRIORITY 0
+typedef void (*irq_handler_t)(void);
+void irq_set_exclusive_handler(unsigned, irq_handler_t); void irq_remove_handler(unsigned, irq_handler_t);
+void irq_set_enabled(unsigned, bool); void irq_set_priority(unsigned, uint8_t);
+
+#endif /* HOST_HARDWARE_IRQ_H */
@@ -0,0 +1,15 @@
+/*
+ * hardware/rtc.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_HARDWARE_RTC_H
+#define HOST_HARDWARE_RTC_H
+
+#include "pico/util/datetime.h"
+#include <stdbool.h>
+typedef void (*rtc_callback_t)(void);
+void rtc_init(void); bool rtc_set_datetime(datetime_t*); bool rtc_get_datetime(datetime_t*); bool rtc_running(void);
+void rtc_set_alarm(datetime_t*, rtc_callback_t); void rtc_enable_alarm(void); void rtc_disable_alarm(void);
+
+#endif /* HOST_HARDWARE_RTC_H */
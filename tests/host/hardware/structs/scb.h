@@ -0,0 +1,14 @@
+/*
+ * hardware/structs/scb.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_HARDWARE_STRUCTS_SCB_H
+#define HOST_HARDWARE_STRUCTS_SCB_H
+
+#include <stdint.h>
+typedef struct { volatile uint32_t cpuid, icsr, vtor, aircr, scr; } armv6m_scb_hw_t;
+extern armv6m_scb_hw_t *scb_hw;
+#define M0PLUS_SCR_SLEEPDEEP_BITS 0x00000004u
+
+#endif /* HOST_HARDWARE_STRUCTS_SCB_H */
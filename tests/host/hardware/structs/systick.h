@@ -0,0 +1,13 @@
+/*
+ * hardware/structs/systick.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_HARDWARE_STRUCTS_SYSTICK_H
+#define HOST_HARDWARE_STRUCTS_SYSTICK_H
+
+#include <stdint.h>
+typedef struct { volatile uint32_t csr, rvr, cvr, calib; } systick_hw_t;
+extern systick_hw_t *systick_hw;
+
+#endif /* HOST_HARDWARE_STRUCTS_SYSTICK_H */
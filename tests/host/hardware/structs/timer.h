@@ -0,0 +1,14 @@
+/*
+ * hardware/structs/timer.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_HARDWARE_STRUCTS_TIMER_H
+#define HOST_HARDWARE_STRUCTS_TIMER_H
+
+#include <stdint.h>
+typedef struct { volatile uint32_t timehw, timelw, timehr, timelr, alarm[4], armed, timerawh, timerawl, dbgpause, pause, intr, inte, intf, ints; } timer_hw_t;
+extern timer_hw_t *timer_hw;
+static inline void hw_set_bits(volatile uint32_t *a, uint32_t m){*a|=m;} static inline void hw_clear_bits(volatile uint32_t *a, uint32_t m){*a&=~m;}
+
+#endif /* HOST_HARDWARE_STRUCTS_TIMER_H */
@@ -0,0 +1,12 @@
+/*
+ * hardware/sync.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+#include <stdint.h>
+uint32_t save_and_disable_interrupts(void); void restore_interrupts(uint32_t);
+
+#endif /* HOST_HARDWARE_SYNC_H */
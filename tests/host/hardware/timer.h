@@ -0,0 +1,14 @@
+/*
+ * hardware/timer.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_HARDWARE_TIMER_H
+#define HOST_HARDWARE_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/structs/timer.h"
+int hardware_alarm_claim_unused(bool); void hardware_alarm_unclaim(unsigned);
+
+#endif /* HOST_HARDWARE_TIMER_H */
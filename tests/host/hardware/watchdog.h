@@ -0,0 +1,18 @@
+/*
+ * hardware/watchdog.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_HARDWARE_WATCHDOG_H
+#define HOST_HARDWARE_WATCHDOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+typedef struct { volatile uint32_t ctrl, load, reason, scratch[8], tick; } watchdog_hw_t;
+extern watchdog_hw_t *watchdog_hw;
+void watchdog_enable(uint32_t, bool); void watchdog_update(void); bool watchdog_caused_reboot(void); bool watchdog_enable_caused_reboot(void);
+void watchdog_reboot(uint32_t, uint32_t, uint32_t); void watchdog_disable(void);
+#define WATCHDOG_CTRL_ENABLE_BITS 0x40000000u
+#include "hardware/structs/timer.h"
+
+#endif /* HOST_HARDWARE_WATCHDOG_H */
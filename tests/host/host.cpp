@@ -0,0 +1,561 @@
+/*
+ * host.cpp - from the Unicorn C(++) Examples collection
+ *
+ * Host implementations of the bits of the Pico SDK, Pimoroni libraries and
+ * lwIP that the tests pull in; enough for the code under test to run on a
+ * PC, not a model of the hardware. Time stands still unless a test (or a
+ * sleep) moves it on, or a benchmark asks for the PC's own clock; DMA and the
+ * second core do nothing. The radio joins whatever network the test sets up
+ * (see host.hpp), and datagrams sent on it are held until host_udp_run()
+ * hands them on.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include <vector>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/stdio_usb.h"
+#include "pico/unique_id.h"
+#include "pico/cyw43_arch.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/rtc.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "hardware/watchdog.h"
+#include "hardware/structs/scb.h"
+#include "hardware/structs/systick.h"
+#include "lwip/dns.h"
+#include "lwip/igmp.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "libraries/pico_graphics/pico_graphics.hpp"
+#include "libraries/galactic_unicorn/galactic_unicorn.hpp"
+#include "libraries/bitmap_fonts/bitmap_fonts.hpp"
+#include "libraries/bitmap_fonts/font8_data.hpp"
+
+
+/* Local headers. */
+
+#include "host.hpp"
+
+
+/* Globals. */
+
+uint64_t g_host_time_us = 1000000;
+uint32_t g_host_circles;
+uint32_t g_host_failures;
+hostnode_t g_host_nodes[HOST_NODES_MAX];
+uint32_t   g_host_node;
+void     (*g_host_present)( pimoroni::PicoGraphics *p_graphics );
+uint32_t (*g_host_latency)( void );
+uint32_t   g_host_udp_fails;
+bool       g_host_real_time;
+
+/* Every socket that's been created (and not yet removed). */
+static struct udp_pcb  *g_sockets;
+
+/* Datagrams in flight, by when they arrive. */
+typedef struct
+{
+  uint32_t              node;
+  uint16_t              port;
+  ip_addr_t             from;
+  uint16_t              from_port;
+  std::vector<uint8_t>  data;
+} hostdatagram_t;
+
+static std::multimap<uint64_t, hostdatagram_t> g_in_flight;
+
+static clocks_hw_t      g_clocks;
+static armv6m_scb_hw_t  g_scb;
+static timer_hw_t       g_timer;
+static systick_hw_t     g_systick;
+static watchdog_hw_t    g_watchdog;
+
+clocks_hw_t     *clocks_hw = &g_clocks;
+armv6m_scb_hw_t *scb_hw = &g_scb;
+timer_hw_t      *timer_hw = &g_timer;
+systick_hw_t    *systick_hw = &g_systick;
+watchdog_hw_t   *watchdog_hw = &g_watchdog;
+
+const ip_addr_t ip_addr_any = { 0 };
+cyw43_t         cyw43_state;
+
+
+/* Functions. */
+
+int host_result( const char *p_name )
+{
+  printf( "%s: %s (%lu failed checks)\n", p_name, g_host_failures ? "FAILED" : "passed",
+          (unsigned long)g_host_failures );
+  return g_host_failures ? 1 : 0;
+}
+
+
+/* Time. */
+
+/* Each node's timer runs from its boot, and a little fast or slow. */
+
+uint64_t host_node_time( uint32_t p_node, uint64_t p_time )
+{
+  uint64_t  l_elapsed = p_time - g_host_nodes[p_node].boot_us;
+
+  return l_elapsed + (int64_t)( l_elapsed * g_host_nodes[p_node].ppm / 1000000.0 );
+}
+
+uint64_t time_us_64( void )
+{
+  struct timespec l_now;
+
+  if ( g_host_real_time )
+  {
+    clock_gettime( CLOCK_MONOTONIC, &l_now );
+    return l_now.tv_sec * 1000000LLU + l_now.tv_nsec / 1000;
+  }
+  return host_node_time( g_host_node, g_host_time_us );
+}
+
+uint32_t time_us_32( void ) { return (uint32_t)time_us_64(); }
+void sleep_us( uint64_t p_us ) { g_host_time_us += p_us; }
+void sleep_ms( uint32_t p_ms ) { g_host_time_us += p_ms * 1000LLU; }
+void sleep_until( absolute_time_t p_time ) { if ( p_time > time_us_64() ) g_host_time_us += p_time - time_us_64(); }
+void busy_wait_until( absolute_time_t p_time ) { sleep_until( p_time ); }
+absolute_time_t get_absolute_time( void ) { return time_us_64(); }
+absolute_time_t make_timeout_time_us( uint64_t p_us ) { return time_us_64() + p_us; }
+absolute_time_t make_timeout_time_ms( uint32_t p_ms ) { return time_us_64() + p_ms * 1000LLU; }
+int64_t absolute_time_diff_us( absolute_time_t p_from, absolute_time_t p_to ) { return (int64_t)( p_to - p_from ); }
+bool best_effort_wfe_or_timeout( absolute_time_t p_time ) { sleep_until( p_time ); return true; }
+uint32_t clock_get_hz( enum clock_index p_clock ) { return 125000000; }
+
+
+/* Stdio; nobody's typing. */
+
+bool stdio_init_all( void ) { return true; }
+int getchar_timeout_us( uint32_t p_us ) { return PICO_ERROR_TIMEOUT; }
+bool stdio_usb_connected( void ) { return false; }
+void stdio_set_chars_available_callback( void (*p_callback)( void * ), void *p_param ) { }
+
+
+/* The second core, interrupts, alarms and DMA; none of them do anything. */
+
+void multicore_launch_core1( void (*p_entry)( void ) ) { }
+void multicore_reset_core1( void ) { }
+void multicore_fifo_push_blocking( uint32_t p_data ) { }
+uint32_t multicore_fifo_pop_blocking( void ) { return 0; }
+bool multicore_fifo_rvalid( void ) { return false; }
+bool multicore_fifo_wready( void ) { return true; }
+void multicore_fifo_drain( void ) { }
+bool multicore_fifo_pop_timeout_us( uint64_t p_us, uint32_t *p_data ) { return false; }
+uint32_t get_core_num( void ) { return 0; }
+void multicore_lockout_victim_init( void ) { }
+
+uint32_t save_and_disable_interrupts( void ) { return 0; }
+void restore_interrupts( uint32_t p_status ) { }
+void irq_set_exclusive_handler( unsigned p_irq, irq_handler_t p_handler ) { }
+void irq_remove_handler( unsigned p_irq, irq_handler_t p_handler ) { }
+void irq_set_enabled( unsigned p_irq, bool p_enabled ) { }
+void irq_set_priority( unsigned p_irq, uint8_t p_priority ) { }
+void gpio_set_irq_enabled( uint p_gpio, uint32_t p_events, bool p_enabled ) { }
+void gpio_set_irq_enabled_with_callback( uint p_gpio, uint32_t p_events, bool p_enabled, gpio_irq_callback_t p_callback ) { }
+int hardware_alarm_claim_unused( bool p_required ) { return -1; }
+void hardware_alarm_unclaim( unsigned p_alarm ) { }
+
+int dma_claim_unused_channel( bool p_required ) { return -1; }
+dma_channel_config dma_channel_get_default_config( unsigned p_channel ) { return dma_channel_config{ 0 }; }
+void channel_config_set_transfer_data_size( dma_channel_config *p_config, enum dma_channel_transfer_size p_size ) { }
+void channel_config_set_read_increment( dma_channel_config *p_config, bool p_increment ) { }
+void channel_config_set_write_increment( dma_channel_config *p_config, bool p_increment ) { }
+void dma_channel_configure( unsigned p_channel, const dma_channel_config *p_config, volatile void *p_dst,
+                            const volatile void *p_src, unsigned p_count, bool p_trigger ) { }
+void dma_channel_wait_for_finish_blocking( unsigned p_channel ) { }
+bool dma_channel_is_busy( unsigned p_channel ) { return false; }
+
+void watchdog_enable( uint32_t p_ms, bool p_pause ) { }
+void watchdog_update( void ) { }
+bool watchdog_caused_reboot( void ) { return false; }
+bool watchdog_enable_caused_reboot( void ) { return false; }
+void watchdog_reboot( uint32_t p_pc, uint32_t p_sp, uint32_t p_ms ) { }
+void watchdog_disable( void ) { }
+
+
+/* The RTC; it keeps whatever it's told. */
+
+static datetime_t g_rtc[HOST_NODES_MAX];
+
+void rtc_init( void ) { }
+bool rtc_set_datetime( datetime_t *p_time ) { g_rtc[g_host_node] = *p_time; return true; }
+bool rtc_get_datetime( datetime_t *p_time ) { *p_time = g_rtc[g_host_node]; return true; }
+bool rtc_running( void ) { return true; }
+void rtc_set_alarm( datetime_t *p_time, rtc_callback_t p_callback ) { }
+void rtc_enable_alarm( void ) { }
+void rtc_disable_alarm( void ) { }
+
+void pico_get_unique_board_id( pico_unique_board_id_t *p_id )
+{
+  memset( p_id->id, 0x5a, sizeof( p_id->id ) );
+  p_id->id[sizeof( p_id->id ) - 1] ^= g_host_node;
+}
+
+
+/* The radio; each node's is on between init and deinit, and takes time to join. */
+
+int cyw43_arch_init( void )
+{
+  hostnode_t *l_node = &g_host_nodes[g_host_node];
+
+  if ( !l_node->radio )
+  {
+    l_node->radio = true;
+    l_node->radio_since = g_host_time_us;
+    l_node->connect_us = g_host_time_us;
+  }
+  return 0;
+}
+
+void cyw43_arch_deinit( void )
+{
+  hostnode_t *l_node = &g_host_nodes[g_host_node];
+
+  if ( l_node->radio )
+  {
+    l_node->radio = false;
+    l_node->radio_us += g_host_time_us - l_node->radio_since;
+  }
+}
+
+void cyw43_arch_enable_sta_mode( void ) { }
+
+int cyw43_arch_wifi_connect_async( const char *p_ssid, const char *p_password, uint32_t p_auth )
+{
+  g_host_nodes[g_host_node].connect_us = g_host_time_us;
+  return 0;
+}
+
+void cyw43_arch_lwip_begin( void ) { }
+void cyw43_arch_lwip_end( void ) { }
+
+int cyw43_tcpip_link_status( cyw43_t *p_state, int p_itf )
+{
+  hostnode_t *l_node = &g_host_nodes[g_host_node];
+
+  if ( !l_node->radio )
+  {
+    return CYW43_LINK_DOWN;
+  }
+  if ( g_host_time_us - l_node->connect_us < l_node->join_us )
+  {
+    return CYW43_LINK_JOIN;
+  }
+  return l_node->link_status;
+}
+int cyw43_wifi_pm( cyw43_t *p_state, uint32_t p_mode ) { return 0; }
+
+int ipaddr_aton( const char *p_text, ip_addr_t *p_addr )
+{
+  unsigned  l_a, l_b, l_c, l_d;
+
+  if ( sscanf( p_text, "%u.%u.%u.%u", &l_a, &l_b, &l_c, &l_d ) != 4 )
+  {
+    return 0;
+  }
+  p_addr->addr = l_a | l_b << 8 | l_c << 16 | l_d << 24;
+  return 1;
+}
+
+char *ipaddr_ntoa( const ip_addr_t *p_addr )
+{
+  static char l_text[16];
+
+  snprintf( l_text, sizeof( l_text ), "%lu.%lu.%lu.%lu", (unsigned long)( p_addr->addr & 0xff ),
+            (unsigned long)( p_addr->addr >> 8 & 0xff ), (unsigned long)( p_addr->addr >> 16 & 0xff ),
+            (unsigned long)( p_addr->addr >> 24 ) );
+  return l_text;
+}
+
+char *ip4addr_ntoa( const ip4_addr_t *p_addr ) { return ipaddr_ntoa( p_addr ); }
+uint32_t lwip_ntohl( uint32_t p_value ) { return __builtin_bswap32( p_value ); }
+err_t dns_gethostbyname( const char *p_name, ip_addr_t *p_addr, dns_found_callback p_callback, void *p_arg ) { return ERR_INPROGRESS; }
+err_t igmp_joingroup( const ip4_addr_t *p_local, const ip4_addr_t *p_group ) { return ERR_OK; }
+err_t igmp_leavegroup( const ip4_addr_t *p_local, const ip4_addr_t *p_group ) { return ERR_OK; }
+
+struct pbuf *pbuf_alloc( pbuf_layer p_layer, uint16_t p_length, pbuf_type p_type )
+{
+  struct pbuf *l_buffer = (struct pbuf *)calloc( 1, sizeof( struct pbuf ) + p_length );
+
+  l_buffer->payload = l_buffer + 1;
+  l_buffer->tot_len = l_buffer->len = p_length;
+  return l_buffer;
+}
+
+uint8_t pbuf_free( struct pbuf *p_buffer ) { free( p_buffer ); return 1; }
+uint8_t pbuf_get_at( const struct pbuf *p_buffer, uint16_t p_offset ) { return ( (const uint8_t *)p_buffer->payload )[p_offset]; }
+
+uint16_t pbuf_copy_partial( const struct pbuf *p_buffer, void *p_data, uint16_t p_length, uint16_t p_offset )
+{
+  if ( p_offset >= p_buffer->tot_len )
+  {
+    return 0;
+  }
+  if ( p_length > p_buffer->tot_len - p_offset )
+  {
+    p_length = p_buffer->tot_len - p_offset;
+  }
+  memcpy( p_data, (const uint8_t *)p_buffer->payload + p_offset, p_length );
+  return p_length;
+}
+
+err_t pbuf_take( struct pbuf *p_buffer, const void *p_data, uint16_t p_length )
+{
+  memcpy( p_buffer->payload, p_data, p_length );
+  return ERR_OK;
+}
+
+void pbuf_realloc( struct pbuf *p_buffer, uint16_t p_length ) { p_buffer->tot_len = p_buffer->len = p_length; }
+
+struct udp_pcb *udp_new_ip_type( uint8_t p_type )
+{
+  struct udp_pcb *l_socket = (struct udp_pcb *)calloc( 1, sizeof( struct udp_pcb ) );
+
+  l_socket->node = g_host_node;
+  l_socket->next = g_sockets;
+  g_sockets = l_socket;
+  return l_socket;
+}
+
+struct udp_pcb *udp_new( void ) { return udp_new_ip_type( IPADDR_TYPE_ANY ); }
+
+void udp_remove( struct udp_pcb *p_socket )
+{
+  struct udp_pcb **l_link;
+
+  for ( l_link = &g_sockets; *l_link != nullptr; l_link = &( *l_link )->next )
+  {
+    if ( *l_link == p_socket )
+    {
+      *l_link = p_socket->next;
+      break;
+    }
+  }
+  free( p_socket );
+}
+
+void udp_recv( struct udp_pcb *p_socket, udp_recv_fn p_callback, void *p_arg )
+{
+  p_socket->recv = p_callback;
+  p_socket->recv_arg = p_arg;
+}
+
+err_t udp_bind( struct udp_pcb *p_socket, const ip_addr_t *p_addr, uint16_t p_port )
+{
+  p_socket->port = p_port;
+  return ERR_OK;
+}
+
+/* The socket a node has bound to a port, with a callback; nullptr if none. */
+static struct udp_pcb *host_udp_find( uint32_t p_node, uint16_t p_port )
+{
+  struct udp_pcb *l_socket;
+
+  if ( !g_host_nodes[p_node].radio )
+  {
+    return nullptr;
+  }
+  for ( l_socket = g_sockets; l_socket != nullptr; l_socket = l_socket->next )
+  {
+    if ( ( l_socket->node == p_node ) && ( l_socket->port == p_port ) && ( l_socket->recv != nullptr ) )
+    {
+      return l_socket;
+    }
+  }
+  return nullptr;
+}
+
+/* Just like lwIP, the callback owns (and must free) the buffer. */
+static void host_udp_receive( struct udp_pcb *p_socket, const void *p_data, uint16_t p_length,
+                              const ip_addr_t *p_from, uint16_t p_from_port )
+{
+  struct pbuf  *l_buffer = pbuf_alloc( PBUF_TRANSPORT, p_length, PBUF_RAM );
+
+  pbuf_take( l_buffer, p_data, p_length );
+  p_socket->recv( p_socket->recv_arg, p_socket, l_buffer, p_from, p_from_port );
+}
+
+/* Node n is at 192.168.0.(10+n); the test's own sender is 192.168.0.1. */
+static ip_addr_t host_node_addr( uint32_t p_node )
+{
+  return ip_addr_t{ 0x0000a8c0 | ( 10 + p_node ) << 24 };
+}
+
+bool host_udp_deliver( uint16_t p_port, const void *p_data, uint16_t p_length )
+{
+  struct udp_pcb *l_socket = host_udp_find( g_host_node, p_port );
+  ip_addr_t       l_from = { 0x0100a8c0 };
+
+  if ( ( l_socket == nullptr ) || ( cyw43_tcpip_link_status( &cyw43_state, CYW43_ITF_STA ) != CYW43_LINK_UP ) )
+  {
+    return false;
+  }
+  host_udp_receive( l_socket, p_data, p_length, &l_from, 50000 );
+  return true;
+}
+
+/* Multicast goes to every other node; anything else, to the one addressed. */
+err_t udp_sendto( struct udp_pcb *p_socket, struct pbuf *p_buffer, const ip_addr_t *p_addr, uint16_t p_port )
+{
+  hostdatagram_t  l_datagram;
+  uint32_t        l_node, l_latency;
+  bool            l_multicast = ( p_addr->addr & 0xf0 ) == 0xe0;
+
+  if ( cyw43_tcpip_link_status( &cyw43_state, CYW43_ITF_STA ) != CYW43_LINK_UP )
+  {
+    return ERR_OK;
+  }
+  if ( g_host_udp_fails > 0 )
+  {
+    g_host_udp_fails--;
+    return ERR_MEM;
+  }
+
+  l_datagram.port = p_port;
+  l_datagram.from = host_node_addr( g_host_node );
+  l_datagram.from_port = p_socket->port;
+  l_datagram.data.assign( (const uint8_t *)p_buffer->payload, (const uint8_t *)p_buffer->payload + p_buffer->tot_len );
+
+  for ( l_node = 0; l_node < HOST_NODES_MAX; l_node++ )
+  {
+    if ( l_multicast ? ( l_node == g_host_node ) : ( host_node_addr( l_node ).addr != p_addr->addr ) )
+    {
+      continue;
+    }
+    l_latency = g_host_latency ? g_host_latency() : 0;
+    if ( l_latency != HOST_LOST )
+    {
+      l_datagram.node = l_node;
+      g_in_flight.insert( { g_host_time_us + l_latency, l_datagram } );
+    }
+  }
+  return ERR_OK;
+}
+
+uint64_t host_udp_next( void )
+{
+  return g_in_flight.empty() ? UINT64_MAX : g_in_flight.begin()->first;
+}
+
+/* Each arrives on its node, at its time; just as an IRQ would. */
+void host_udp_run( uint64_t p_until )
+{
+  hostdatagram_t  l_datagram;
+  struct udp_pcb *l_socket;
+  uint32_t        l_current = g_host_node;
+
+  while ( !g_in_flight.empty() && ( g_in_flight.begin()->first <= p_until ) )
+  {
+    if ( g_in_flight.begin()->first > g_host_time_us )
+    {
+      g_host_time_us = g_in_flight.begin()->first;
+    }
+    l_datagram = g_in_flight.begin()->second;
+    g_in_flight.erase( g_in_flight.begin() );
+
+    g_host_node = l_datagram.node;
+    l_socket = host_udp_find( l_datagram.node, l_datagram.port );
+    if ( ( l_socket != nullptr ) && ( cyw43_tcpip_link_status( &cyw43_state, CYW43_ITF_STA ) == CYW43_LINK_UP ) )
+    {
+      host_udp_receive( l_socket, l_datagram.data.data(), l_datagram.data.size(),
+                        &l_datagram.from, l_datagram.from_port );
+    }
+  }
+  g_host_node = l_current;
+  if ( p_until > g_host_time_us )
+  {
+    g_host_time_us = p_until;
+  }
+}
+
+err_t udp_send( struct udp_pcb *p_socket, struct pbuf *p_buffer ) { return ERR_OK; }
+
+
+/*
+ * A font8 of sorts; every glyph but the space is five columns, made up from
+ * its character code, so that different characters look different.
+ */
+
+const bitmap::font_t font8 = { 8, 5 };
+
+namespace bitmap
+{
+  int32_t measure_character( const font_t *p_font, const char p_char, const uint8_t p_scale )
+  {
+    return ( p_char == ' ' ? 3 : p_font->max_width ) * p_scale;
+  }
+
+  void character( const font_t *p_font, rect_func p_rectangle, const char p_char,
+                  const int32_t p_x, const int32_t p_y, const uint8_t p_scale )
+  {
+    uint32_t  l_column, l_row, l_bits;
+
+    if ( p_char == ' ' )
+    {
+      return;
+    }
+    for ( l_column = 0; l_column < p_font->max_width; l_column++ )
+    {
+      l_bits = ( ( (uint8_t)p_char * ( l_column + 3 ) * 2654435761u ) >> 24 ) | 0x01;
+      for ( l_row = 0; l_row < p_font->height; l_row++ )
+      {
+        if ( l_bits & ( 1 << l_row ) )
+        {
+          p_rectangle( p_x + l_column * p_scale, p_y + l_row * p_scale, p_scale, p_scale );
+        }
+      }
+    }
+  }
+}
+
+
+/* The display; circles are counted rather than drawn. */
+
+namespace pimoroni
+{
+  void PicoGraphics::clear( void ) { }
+  void PicoGraphics::pixel( const Point &p_point ) { }
+  void PicoGraphics::pixel_span( const Point &p_point, int32_t p_length ) { }
+  void PicoGraphics::circle( const Point &p_point, int32_t p_radius ) { g_host_circles++; }
+  void PicoGraphics::rectangle( const Rect &p_rect ) { }
+  void PicoGraphics::set_clip( const Rect &p_rect ) { clip = p_rect; }
+  void PicoGraphics::remove_clip( void ) { clip = bounds; }
+  void PicoGraphics::text( const std::string &p_text, const Point &p_point, int32_t p_wrap, float p_scale ) { }
+  void PicoGraphics::set_font( const std::string &p_font ) { }
+
+  PicoGraphics_PenRGB565::PicoGraphics_PenRGB565( uint16_t p_width, uint16_t p_height, void *p_buffer )
+  {
+    pen_type = PEN_RGB565;
+    bounds = clip = Rect( 0, 0, p_width, p_height );
+    frame_buffer = p_buffer ? p_buffer : calloc( 1, buffer_size( p_width, p_height ) );
+  }
+
+  void GalacticUnicorn::init( void ) { }
+  void GalacticUnicorn::update( PicoGraphics *p_graphics ) { if ( g_host_present ) g_host_present( p_graphics ); }
+  void GalacticUnicorn::set_brightness( float p_value ) { }
+  float GalacticUnicorn::get_brightness( void ) { return 0.5f; }
+  void GalacticUnicorn::adjust_brightness( float p_delta ) { }
+  uint16_t GalacticUnicorn::light( void ) { return 0; }
+  bool GalacticUnicorn::is_pressed( uint8_t p_switch ) { return false; }
+  void GalacticUnicorn::clear( void ) { }
+  void GalacticUnicorn::set_pixel( int p_x, int p_y, uint8_t p_r, uint8_t p_g, uint8_t p_b ) { }
+}
+
+/* End of file host.cpp */
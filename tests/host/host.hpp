@@ -0,0 +1,100 @@
+/*
+ * host.hpp - from the Unicorn C(++) Examples collection
+ *
+ * The knobs the host tests have on the stand-in SDK (see host.cpp): the
+ * clock, which only moves when a test moves it (or, for the benchmarks, is
+ * the PC's own), a count of what has been drawn through PicoGraphics, a peek
+ * at each frame as it's presented, and a simulated network.
+ *
+ * The network has any number of nodes, each with its own timer (running from
+ * its boot, at its own crystal error), board ID, RTC and radio; SDK calls act
+ * on whichever node is current. Datagrams between them take as long as the
+ * test says, and only arrive at a node with its radio up. Tests with just the
+ * one node needn't care about any of that.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* Gate against multiple inclusion. #pragma once, but standard-compliant. */
+
+#ifndef HOST_HPP
+#define HOST_HPP
+
+
+/* System headers. */
+
+#include <stdio.h>
+#include <stdint.h>
+
+namespace pimoroni { class PicoGraphics; }
+
+
+/* Constants. */
+
+#define HOST_NODES_MAX  16
+#define HOST_LOST       UINT32_MAX
+
+
+/* Structs. */
+
+typedef struct
+{
+  uint64_t  boot_us;        /* when it started, on the simulation's clock */
+  double    ppm;            /* how fast its timer runs */
+  int       link_status;    /* what the WiFi says, once it's had time to join */
+  uint64_t  join_us;        /* which takes this long */
+  uint64_t  connect_us;     /* (since it started trying, at this time) */
+  bool      radio;          /* between cyw43_arch_init() and _deinit() */
+  uint64_t  radio_since, radio_us;
+} hostnode_t;
+
+
+/* Globals. */
+
+extern uint64_t   g_host_time_us;
+extern uint32_t   g_host_circles;
+extern hostnode_t g_host_nodes[HOST_NODES_MAX];
+extern uint32_t   g_host_node;
+
+/* Called from GalacticUnicorn::update(), with the frame being shown. */
+extern void     (*g_host_present)( pimoroni::PicoGraphics *p_graphics );
+
+/* How long each datagram takes to arrive, or HOST_LOST; instant if unset. */
+extern uint32_t (*g_host_latency)( void );
+
+/* The next so many udp_sendto()s fail, as if lwIP were out of buffers. */
+extern uint32_t   g_host_udp_fails;
+
+/* Benchmarks want the PC's own clock, rather than one that stands still. */
+extern bool       g_host_real_time;
+
+
+/* Functions. */
+
+/* Checks a condition, counting (and reporting) it if it doesn't hold. */
+extern uint32_t g_host_failures;
+
+#define HOST_CHECK( p_condition ) \
+  do { if ( !( p_condition ) ) { printf( "%s:%d: check failed: %s\n", __FILE__, __LINE__, #p_condition ); \
+                                 g_host_failures++; } } while ( 0 )
+
+/* Hands a datagram to whoever is listening on the port; false if nobody. */
+bool host_udp_deliver( uint16_t p_port, const void *p_data, uint16_t p_length );
+
+/* Delivers everything sent which is due by then, moving the clock along. */
+void host_udp_run( uint64_t p_until );
+
+/* When the next datagram is due, if there are any in flight. */
+uint64_t host_udp_next( void );
+
+/* A node's own timer, at a time on the simulation's clock. */
+uint64_t host_node_time( uint32_t p_node, uint64_t p_time );
+
+/* What a test's main() returns; non-zero if anything failed. */
+int host_result( const char *p_name );
+
+
+#endif /* HOST_HPP */
+
+/* End of file host.hpp */
@@ -0,0 +1,18 @@
+/*
+ * libraries/bitmap_fonts/bitmap_fonts.hpp - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_LIBRARIES_BITMAP_FONTS_BITMAP_FONTS_HPP
+#define HOST_LIBRARIES_BITMAP_FONTS_BITMAP_FONTS_HPP
+
+#include <stdint.h>
+#include <functional>
+namespace bitmap {
+ struct font_t { uint8_t height; uint8_t max_width; uint8_t widths[96]; uint8_t data[1]; };
+ typedef std::function<void(int32_t x, int32_t y, int32_t w, int32_t h)> rect_func;
+ int32_t measure_character(const font_t *font, const char c, const uint8_t scale);
+ void character(const font_t *font, rect_func rectangle, const char c, const int32_t x, const int32_t y, const uint8_t scale = 2);
+}
+
+#endif /* HOST_LIBRARIES_BITMAP_FONTS_BITMAP_FONTS_HPP */
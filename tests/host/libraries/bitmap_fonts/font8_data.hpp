@@ -0,0 +1,12 @@
+/*
+ * libraries/bitmap_fonts/font8_data.hpp - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_LIBRARIES_BITMAP_FONTS_FONT8_DATA_HPP
+#define HOST_LIBRARIES_BITMAP_FONTS_FONT8_DATA_HPP
+
+#include "bitmap_fonts.hpp"
+extern const bitmap::font_t font8;
+
+#endif /* HOST_LIBRARIES_BITMAP_FONTS_FONT8_DATA_HPP */
@@ -0,0 +1,20 @@
+/*
+ * libraries/galactic_unicorn/galactic_unicorn.hpp - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_LIBRARIES_GALACTIC_UNICORN_GALACTIC_UNICORN_HPP
+#define HOST_LIBRARIES_GALACTIC_UNICORN_GALACTIC_UNICORN_HPP
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+namespace pimoroni {
+ class GalacticUnicorn { public:
+  static const int WIDTH = 53; static const int HEIGHT = 11;
+  static const uint8_t SWITCH_A=0,SWITCH_B=1,SWITCH_C=3,SWITCH_D=6,SWITCH_SLEEP=27,SWITCH_VOLUME_UP=7,SWITCH_VOLUME_DOWN=8,SWITCH_BRIGHTNESS_UP=21,SWITCH_BRIGHTNESS_DOWN=26;
+  static const uint LIGHT_SENSOR=28;
+  void init(); void update(PicoGraphics*); void set_brightness(float); float get_brightness(); void adjust_brightness(float);
+  uint16_t light(); bool is_pressed(uint8_t); void clear(); void set_pixel(int,int,uint8_t,uint8_t,uint8_t);
+ };
+}
+
+#endif /* HOST_LIBRARIES_GALACTIC_UNICORN_GALACTIC_UNICORN_HPP */
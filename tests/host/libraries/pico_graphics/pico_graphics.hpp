@@ -0,0 +1,37 @@
+/*
+ * libraries/pico_graphics/pico_graphics.hpp - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_LIBRARIES_PICO_GRAPHICS_PICO_GRAPHICS_HPP
+#define HOST_LIBRARIES_PICO_GRAPHICS_PICO_GRAPHICS_HPP
+
+#include <stdint.h>
+#include <string>
+#include <math.h>
+#include <stdio.h>
+namespace pimoroni {
+ struct Point { int32_t x, y; Point(){} Point(int32_t a,int32_t b):x(a),y(b){} };
+ struct Rect { int32_t x,y,w,h; Rect(){} Rect(int32_t a,int32_t b,int32_t c,int32_t d):x(a),y(b),w(c),h(d){} };
+ class PicoGraphics { public:
+  enum PenType { PEN_1BIT, PEN_RGB565, PEN_RGB888 };
+  PenType pen_type; Rect bounds; Rect clip; void *frame_buffer;
+  virtual ~PicoGraphics(){}
+  virtual void set_pen(uint c){} virtual int create_pen(uint8_t,uint8_t,uint8_t){return 0;}
+  virtual int create_pen_hsv(float,float,float){return 0;}
+  void clear(); void pixel(const Point&); void pixel_span(const Point&, int32_t); void circle(const Point&, int32_t);
+  void rectangle(const Rect&); void set_clip(const Rect&); void remove_clip();
+  void text(const std::string&, const Point&, int32_t, float s=2.0f);
+  void set_font(const std::string&);
+  virtual void set_pixel(const Point&){} virtual void set_pixel_span(const Point&, uint){}
+ };
+ class PicoGraphics_PenRGB565 : public PicoGraphics { public:
+  typedef uint16_t RGB565; RGB565 color;
+  PicoGraphics_PenRGB565(uint16_t,uint16_t,void*);
+  int create_pen(uint8_t r,uint8_t g,uint8_t b) override {return ((r&0xf8)<<8)|((g&0xfc)<<3)|(b>>3);}
+  static size_t buffer_size(uint w, uint h){return w*h*2;}
+ };
+}
+typedef unsigned int uint;
+
+#endif /* HOST_LIBRARIES_PICO_GRAPHICS_PICO_GRAPHICS_HPP */
@@ -0,0 +1,13 @@
+/*
+ * lwip/dns.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_LWIP_DNS_H
+#define HOST_LWIP_DNS_H
+
+#include "lwip/ip_addr.h"
+typedef void (*dns_found_callback)(const char*, const ip_addr_t*, void*);
+err_t dns_gethostbyname(const char*, ip_addr_t*, dns_found_callback, void*);
+
+#endif /* HOST_LWIP_DNS_H */
@@ -0,0 +1,14 @@
+/*
+ * lwip/err.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_LWIP_ERR_H
+#define HOST_LWIP_ERR_H
+
+typedef signed char err_t;
+#define ERR_OK 0
+#define ERR_INPROGRESS -5
+#define ERR_MEM -1
+
+#endif /* HOST_LWIP_ERR_H */
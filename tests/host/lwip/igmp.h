@@ -0,0 +1,12 @@
+/*
+ * lwip/igmp.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_LWIP_IGMP_H
+#define HOST_LWIP_IGMP_H
+
+#include "lwip/ip_addr.h"
+err_t igmp_joingroup(const ip4_addr_t*, const ip4_addr_t*); err_t igmp_leavegroup(const ip4_addr_t*, const ip4_addr_t*);
+
+#endif /* HOST_LWIP_IGMP_H */
@@ -0,0 +1,26 @@
+/*
+ * lwip/ip_addr.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_LWIP_IP_ADDR_H
+#define HOST_LWIP_IP_ADDR_H
+
+#include <stdint.h>
+#include "lwip/err.h"
+typedef struct { uint32_t addr; } ip4_addr_t; typedef ip4_addr_t ip_addr_t;
+#define IPADDR_TYPE_ANY 46
+#define IPADDR_TYPE_V4 0
+#define IP_ADDR_ANY (&ip_addr_any)
+extern const ip_addr_t ip_addr_any;
+#define IP4_ADDR(a,b,c,d,e) do{}while(0)
+#define IP_ADDR4(ipaddr,a,b,c,d) do{}while(0)
+int ipaddr_aton(const char*, ip_addr_t*); char *ipaddr_ntoa(const ip_addr_t*);
+#define ip_addr_cmp(a,b) ((a)->addr==(b)->addr)
+#define ip_addr_copy(d,s) ((d)=(s))
+#define ip4_addr_get_u32(a) ((a)->addr)
+#define ip_2_ip4(a) (a)
+#define IP4_ADDR_ANY4 (&ip_addr_any)
+uint32_t lwip_ntohl(uint32_t);
+
+#endif /* HOST_LWIP_IP_ADDR_H */
@@ -0,0 +1,14 @@
+/*
+ * lwip/netif.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_LWIP_NETIF_H
+#define HOST_LWIP_NETIF_H
+
+#include "lwip/ip_addr.h"
+struct netif { ip4_addr_t ip_addr; };
+#define netif_ip4_addr(n) (&(n)->ip_addr)
+char *ip4addr_ntoa(const ip4_addr_t*);
+
+#endif /* HOST_LWIP_NETIF_H */
@@ -0,0 +1,19 @@
+/*
+ * lwip/pbuf.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_LWIP_PBUF_H
+#define HOST_LWIP_PBUF_H
+
+#include <stdint.h>
+#include "lwip/err.h"
+struct pbuf { struct pbuf *next; void *payload; uint16_t tot_len, len; };
+typedef enum { PBUF_TRANSPORT, PBUF_IP, PBUF_LINK, PBUF_RAW } pbuf_layer;
+typedef enum { PBUF_RAM, PBUF_ROM, PBUF_REF, PBUF_POOL } pbuf_type;
+struct pbuf *pbuf_alloc(pbuf_layer, uint16_t, pbuf_type); uint8_t pbuf_free(struct pbuf*);
+uint8_t pbuf_get_at(const struct pbuf*, uint16_t); uint16_t pbuf_copy_partial(const struct pbuf*, void*, uint16_t, uint16_t);
+err_t pbuf_take(struct pbuf*, const void*, uint16_t);
+void pbuf_realloc(struct pbuf*, uint16_t);
+
+#endif /* HOST_LWIP_PBUF_H */
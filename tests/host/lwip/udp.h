@@ -0,0 +1,18 @@
+/*
+ * lwip/udp.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_LWIP_UDP_H
+#define HOST_LWIP_UDP_H
+
+#include "lwip/pbuf.h"
+#include "lwip/ip_addr.h"
+typedef void (*udp_recv_fn)(void*, struct udp_pcb*, struct pbuf*, const ip_addr_t*, uint16_t);
+struct udp_pcb { uint32_t node; uint16_t port; udp_recv_fn recv; void *recv_arg; struct udp_pcb *next; };
+struct udp_pcb *udp_new_ip_type(uint8_t); struct udp_pcb *udp_new(void); void udp_remove(struct udp_pcb*);
+void udp_recv(struct udp_pcb*, udp_recv_fn, void*); err_t udp_sendto(struct udp_pcb*, struct pbuf*, const ip_addr_t*, uint16_t);
+err_t udp_bind(struct udp_pcb*, const ip_addr_t*, uint16_t);
+err_t udp_send(struct udp_pcb*, struct pbuf*);
+
+#endif /* HOST_LWIP_UDP_H */
@@ -0,0 +1,30 @@
+/*
+ * pico/cyw43_arch.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_PICO_CYW43_ARCH_H
+#define HOST_PICO_CYW43_ARCH_H
+
+#include <stdint.h>
+int cyw43_arch_init(void); void cyw43_arch_deinit(void); void cyw43_arch_enable_sta_mode(void);
+int cyw43_arch_wifi_connect_async(const char*, const char*, uint32_t);
+void cyw43_arch_lwip_begin(void); void cyw43_arch_lwip_end(void);
+#define CYW43_AUTH_WPA2_AES_PSK 0x00400004
+#define CYW43_ITF_STA 0
+#define CYW43_LINK_DOWN 0
+#define CYW43_LINK_JOIN 1
+#define CYW43_LINK_NOIP 2
+#define CYW43_LINK_UP 3
+#define CYW43_LINK_FAIL -1
+#define CYW43_LINK_NONET -2
+#define CYW43_LINK_BADAUTH -3
+#include "lwip/netif.h"
+typedef struct { struct netif netif[2]; } cyw43_t; extern cyw43_t cyw43_state;
+int cyw43_tcpip_link_status(cyw43_t*, int);
+int cyw43_wifi_pm(cyw43_t*, uint32_t);
+#define CYW43_DEFAULT_PM 0xa11142
+#define CYW43_PERFORMANCE_PM 0xa11142
+#define CYW43_AGGRESSIVE_PM 0xa11c82
+
+#endif /* HOST_PICO_CYW43_ARCH_H */
@@ -0,0 +1,17 @@
+/*
+ * pico/multicore.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_PICO_MULTICORE_H
+#define HOST_PICO_MULTICORE_H
+
+#include <stdint.h>
+void multicore_launch_core1(void (*)(void)); void multicore_reset_core1(void);
+void multicore_fifo_push_blocking(uint32_t); uint32_t multicore_fifo_pop_blocking(void);
+bool multicore_fifo_rvalid(void); bool multicore_fifo_wready(void); void multicore_fifo_drain(void);
+bool multicore_fifo_pop_timeout_us(uint64_t, uint32_t*);
+uint32_t get_core_num(void);
+void multicore_lockout_victim_init(void);
+
+#endif /* HOST_PICO_MULTICORE_H */
@@ -0,0 +1,12 @@
+/*
+ * pico/stdio_usb.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_PICO_STDIO_USB_H
+#define HOST_PICO_STDIO_USB_H
+
+#include <stdbool.h>
+bool stdio_usb_connected(void);
+
+#endif /* HOST_PICO_STDIO_USB_H */
@@ -0,0 +1,34 @@
+/*
+ * pico/stdlib.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+typedef uint64_t absolute_time_t;
+uint64_t time_us_64(void); uint32_t time_us_32(void);
+void sleep_ms(uint32_t); void sleep_us(uint64_t); void sleep_until(absolute_time_t);
+bool stdio_init_all(void); int getchar_timeout_us(uint32_t);
+#define PICO_ERROR_TIMEOUT -1
+absolute_time_t get_absolute_time(void); absolute_time_t make_timeout_time_us(uint64_t); absolute_time_t make_timeout_time_ms(uint32_t);
+static inline uint64_t to_us_since_boot(absolute_time_t t){return t;}
+static inline absolute_time_t from_us_since_boot(uint64_t t){return t;}
+int64_t absolute_time_diff_us(absolute_time_t, absolute_time_t);
+bool best_effort_wfe_or_timeout(absolute_time_t);
+static inline void tight_loop_contents(void){}
+static inline void __wfe(void){} static inline void __wfi(void){} static inline void __sev(void){} static inline void __dmb(void){}
+#define __not_in_flash_func(x) x
+#define __time_critical_func(x) x
+#define __scratch_x(x)
+#define __scratch_y(x)
+#define __isr
+typedef unsigned int uint;
+void busy_wait_until(absolute_time_t);
+void stdio_set_chars_available_callback(void (*)(void*), void*);
+
+#endif /* HOST_PICO_STDLIB_H */
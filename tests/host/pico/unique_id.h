@@ -0,0 +1,14 @@
+/*
+ * pico/unique_id.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_PICO_UNIQUE_ID_H
+#define HOST_PICO_UNIQUE_ID_H
+
+#include <stdint.h>
+#define PICO_UNIQUE_BOARD_ID_SIZE_BYTES 8
+typedef struct { uint8_t id[PICO_UNIQUE_BOARD_ID_SIZE_BYTES]; } pico_unique_board_id_t;
+void pico_get_unique_board_id(pico_unique_board_id_t*);
+
+#endif /* HOST_PICO_UNIQUE_ID_H */
@@ -0,0 +1,12 @@
+/*
+ * pico/util/datetime.h - a host stand-in for the SDK header of the same name;
+ * just enough of it for the tests to build (see host.cpp).
+ */
+
+#ifndef HOST_PICO_UTIL_DATETIME_H
+#define HOST_PICO_UTIL_DATETIME_H
+
+#include <stdint.h>
+typedef struct { int16_t year; int8_t month, day, dotw, hour, min, sec; } datetime_t;
+
+#endif /* HOST_PICO_UTIL_DATETIME_H */
@@ -0,0 +1,239 @@
+/*
+ * host_bench.cpp - from the Unicorn C(++) Examples collection
+ *
+ * The startup benchmarks, or as much of them as means anything on a PC; the
+ * clock's frame and its stages, NumericFont, and rain's canvas drawing, under
+ * the same suite and kernel names as on the Unicorn. The RGB565 kernels, and
+ * their references, are timed here alone. All of it goes through BenchRun,
+ * so the BENCH lines on stdout can go straight into tools/bench.py:
+ *
+ *   build-tests/host_bench | tools/bench.py capture - -o run.json
+ *
+ * The PicoGraphics paths are left out, as PicoGraphics is only a stand-in
+ * here; so is the second core. And the times are the PC's, so a run is only
+ * worth comparing against a baseline from the same machine; to keep the
+ * noise down, everything is run a few times over, and bench.py keeps the
+ * fastest of each.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include <stdint.h>
+
+#define uint_fast8_t uint32_t
+
+
+/* Local headers. */
+
+#include "host.hpp"
+#include "better_clock.cpp"
+#include "rain.cpp"
+#include "rgb565.hpp"
+
+
+/* Constants. */
+
+/* A PC gets through the Unicorn's frame counts far too quickly to time. */
+#define BENCH_FRAMES    ( BC_BENCHMARK_FRAMES * 100 )
+
+/* A PC is busy with other things too; bench.py keeps each kernel's best run. */
+#define BENCH_RUNS      5
+
+/* The RGB565 kernels go over a whole panel's worth of pixels, per op. */
+#define BENCH_PIXELS    ( pimoroni::GalacticUnicorn::WIDTH * pimoroni::GalacticUnicorn::HEIGHT )
+
+
+/* Functions. */
+
+/* The clock's canvas frame, and its stages on their own. */
+static void bench_clock( void )
+{
+  const uint8_t           l_digits[BC_DIGITS] = { 1, 2, 3, 4, 5, 6 };
+  uint16_t               *l_buffer = new uint16_t[UnicornCanvas::WIDTH * UnicornCanvas::HEIGHT];
+  UnicornCanvas           l_canvas( l_buffer );
+  PenCache<UnicornCanvas> *l_pens = new PenCache<UnicornCanvas>;
+  float                   l_mix;
+  uint_fast16_t           l_frame;
+  uint_fast8_t            l_index;
+
+  bc_gradient_init( &g_gradient );
+
+  BenchRun l_frame_run( "better_clock", "frame_canvas" );
+  for ( l_frame = 0; l_frame < BENCH_FRAMES; l_frame++ )
+  {
+    bc_draw( l_canvas, *l_pens, l_digits, l_canvas.create_pen( 0, 0, 0 ), l_canvas.create_pen( 255, 255, 255 ) );
+  }
+  l_frame_run.end( BENCH_FRAMES );
+
+  BenchRun l_clear_run( "better_clock", "clear" );
+  for ( l_frame = 0; l_frame < BENCH_FRAMES; l_frame++ )
+  {
+    l_canvas.fill( l_canvas.create_pen( 0, 0, 0 ) );
+  }
+  l_clear_run.end( BENCH_FRAMES );
+
+  BenchRun l_gradient_run( "better_clock", "gradient_background" );
+  for ( l_frame = 0; l_frame < BENCH_FRAMES; l_frame++ )
+  {
+    gradient_background( l_canvas, g_gradient, ( l_frame / 8 ) % ( LINEAR_LIGHT_MIX_ONE + 1 ), l_pens );
+  }
+  l_gradient_run.end( BENCH_FRAMES );
+
+  BenchRun l_uncached_run( "better_clock", "gradient_uncached" );
+  for ( l_frame = 0; l_frame < BENCH_FRAMES; l_frame++ )
+  {
+    gradient_background<UnicornCanvas>( l_canvas, g_gradient, ( l_frame / 8 ) % ( LINEAR_LIGHT_MIX_ONE + 1 ), nullptr );
+  }
+  l_uncached_run.end( BENCH_FRAMES );
+
+  BenchRun l_hsv_run( "better_clock", "gradient_hsv" );
+  for ( l_frame = 0; l_frame < BENCH_FRAMES; l_frame++ )
+  {
+    l_mix = ( ( l_frame / 8 ) % ( LINEAR_LIGHT_MIX_ONE + 1 ) ) / (float)LINEAR_LIGHT_MIX_ONE;
+    gradient_background_hsv( l_canvas, ( ( MIDDAY_HUE - MIDNIGHT_HUE ) * l_mix ) + MIDNIGHT_HUE,
+                             ( ( MIDDAY_SATURATION - MIDNIGHT_SATURATION ) * l_mix ) + MIDNIGHT_SATURATION,
+                             ( ( MIDDAY_VALUE - MIDNIGHT_VALUE ) * l_mix ) + MIDNIGHT_VALUE );
+  }
+  l_hsv_run.end( BENCH_FRAMES );
+
+  /* Glyphs are counted one at a time, as that's what NumericFont draws. */
+  BenchRun l_render_run( "numeric_font", "render" );
+  for ( l_frame = 0; l_frame < BENCH_FRAMES; l_frame++ )
+  {
+    for ( l_index = 0; l_index < BC_DIGITS; l_index++ )
+    {
+      NumericFont::render( l_canvas, 10 + l_index * 5, 2, l_digits[l_index], l_canvas.create_pen( 255, 255, 255 ) );
+    }
+  }
+  l_render_run.end( BENCH_FRAMES * BC_DIGITS );
+
+  BenchRun l_roll_run( "numeric_font", "roll" );
+  for ( l_frame = 0; l_frame < BENCH_FRAMES; l_frame++ )
+  {
+    for ( l_index = 0; l_index < BC_DIGITS; l_index++ )
+    {
+      NumericFont::roll( l_canvas, 10 + l_index * 5, 2, l_digits[l_index], ( l_digits[l_index] + 1 ) % 10,
+                         l_frame % NUMERIC_FONT_ROLL_FRAMES, l_canvas.create_pen( 255, 255, 255 ) );
+    }
+  }
+  l_roll_run.end( BENCH_FRAMES * BC_DIGITS );
+
+  BenchRun l_clipped_run( "numeric_font", "render_clipped" );
+  for ( l_frame = 0; l_frame < BENCH_FRAMES; l_frame++ )
+  {
+    for ( l_index = 0; l_index < BC_DIGITS; l_index++ )
+    {
+      NumericFont::render( l_canvas, UnicornCanvas::WIDTH - 2, 2 + l_index, l_digits[l_index],
+                           l_canvas.create_pen( 255, 255, 255 ) );
+    }
+  }
+  l_clipped_run.end( BENCH_FRAMES * BC_DIGITS );
+
+  /* The scaled glyphs only ever use a canvas, so run just as on the Unicorn. */
+  bc_benchmark_scaled();
+
+  delete l_pens;
+  delete[] l_buffer;
+  return;
+}
+
+/* Rain's dense and light scenes, drawn on the one core as rain_draw does. */
+static void bench_rain( void )
+{
+  const uint_fast8_t                l_counts[2] = { RAIN_BENCHMARK_DENSE, RAIN_BENCHMARK_LIGHT };
+  const char                       *l_kernels[2] = { "dense_single", "light_single" };
+  pimoroni::PicoGraphics_PenRGB565  l_graphics( RAIN_WIDTH, RAIN_HEIGHT, nullptr );
+  raindrop_t                        l_raindrops[RAIN_BENCHMARK_DENSE];
+  int                               l_palette[RAINDROP_LIFESPAN];
+  rainjob_t                         l_job = {};
+  uint_fast16_t                     l_index, l_frame;
+  uint_fast8_t                      l_scene;
+
+  /* A fixed spread of drops of every age, as on the Unicorn. */
+  for ( l_index = 0; l_index < RAIN_BENCHMARK_DENSE; l_index++ )
+  {
+    l_raindrops[l_index].x = rand()%RAIN_WIDTH;
+    l_raindrops[l_index].y = rand()%RAIN_HEIGHT;
+    l_raindrops[l_index].age = l_index % RAINDROP_LIFESPAN;
+    l_raindrops[l_index].alive = true;
+  }
+  pen_table( l_graphics, g_rain_colours, l_palette, RAINDROP_LIFESPAN );
+  l_job.graphics = &l_graphics;
+  l_job.raindrops = l_raindrops;
+  l_job.palette = l_palette;
+  l_job.black_pen = l_graphics.create_pen( 0, 0, 0 );
+
+  for ( l_scene = 0; l_scene < 2; l_scene++ )
+  {
+    l_job.count = l_counts[l_scene];
+    BenchRun l_run( "rain", l_kernels[l_scene] );
+    for ( l_frame = 0; l_frame < BENCH_FRAMES; l_frame++ )
+    {
+      rain_frame( &l_job, &l_job, false );
+    }
+    l_run.end( BENCH_FRAMES );
+  }
+  return;
+}
+
+/* Each RGB565 kernel over a panel of random pixels, and its reference. */
+static void bench_rgb565( void )
+{
+  const char    *l_kernels[6] = { "fade", "fade_reference", "blend", "blend_reference", "add", "add_reference" };
+  uint16_t      *l_dest = new uint16_t[BENCH_PIXELS];
+  uint16_t      *l_src = new uint16_t[BENCH_PIXELS];
+  uint_fast16_t  l_index, l_frame;
+  uint_fast8_t   l_kernel;
+
+  for ( l_index = 0; l_index < BENCH_PIXELS; l_index++ )
+  {
+    l_dest[l_index] = rand();
+    l_src[l_index] = rand();
+  }
+
+  for ( l_kernel = 0; l_kernel < 6; l_kernel++ )
+  {
+    BenchRun l_run( "rgb565", l_kernels[l_kernel] );
+    for ( l_frame = 0; l_frame < BENCH_FRAMES; l_frame++ )
+    {
+      switch( l_kernel )
+      {
+        case 0:  Rgb565::fade( l_dest, BENCH_PIXELS, 24 ); break;
+        case 1:  Rgb565::fade_reference( l_dest, BENCH_PIXELS, 24 ); break;
+        case 2:  Rgb565::blend( l_dest, l_src, BENCH_PIXELS, 12 ); break;
+        case 3:  Rgb565::blend_reference( l_dest, l_src, BENCH_PIXELS, 12 ); break;
+        case 4:  Rgb565::add( l_dest, l_src, BENCH_PIXELS ); break;
+        default: Rgb565::add_reference( l_dest, l_src, BENCH_PIXELS ); break;
+      }
+    }
+    l_run.end( BENCH_FRAMES );
+  }
+
+  delete[] l_src;
+  delete[] l_dest;
+  return;
+}
+
+
+int main()
+{
+  uint_fast8_t  l_run;
+
+  g_host_real_time = true;
+  srand( 67 );
+
+  for ( l_run = 0; l_run < BENCH_RUNS; l_run++ )
+  {
+    bench_clock();
+    bench_rain();
+    bench_rgb565();
+  }
+
+  BenchRun::finished();
+  return 0;
+}
+
+/* End of file host_bench.cpp */
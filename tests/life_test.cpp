@@ -0,0 +1,192 @@
+/*
+ * life_test.cpp - from the Unicorn C(++) Examples collection
+ *
+ * Checks life's bit-parallel step against patterns whose futures are known -
+ * a blinker, and a glider sailing off across both edges of the torus - and
+ * against a plain cell-by-cell step over random soup. Then runs it flat out
+ * for a while, on the PC's own clock, and says how many generations a second
+ * it managed.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define uint_fast8_t uint32_t
+
+
+/* Local headers. */
+
+#include "host.hpp"
+#include "life.cpp"
+
+
+/* Constants. */
+
+#define TEST_SOUPS        20
+#define TEST_SOUP_GENS    200
+#define TEST_TIMED_GENS   1000000
+
+
+/* Functions. */
+
+/* Sets the board to just the cells given, as (x, y) pairs. */
+static void test_place( lifeboard_t *p_board, const uint8_t p_cells[][2], uint32_t p_count,
+                        uint32_t p_x, uint32_t p_y )
+{
+  uint32_t  l_index;
+
+  life_seed( p_board );
+  memset( p_board->rows, 0, sizeof( p_board->rows ) );
+  for ( l_index = 0; l_index < p_count; l_index++ )
+  {
+    p_board->rows[( p_cells[l_index][1] + p_y ) % LIFE_HEIGHT] |= 1LLU << ( ( p_cells[l_index][0] + p_x ) % LIFE_WIDTH );
+  }
+  return;
+}
+
+/* The same step done the slow way, one cell and eight neighbours at a time. */
+static void test_reference_step( const uint64_t *p_rows, uint64_t *p_next )
+{
+  uint32_t  l_x, l_y, l_count;
+  int32_t   l_dx, l_dy;
+
+  for ( l_y = 0; l_y < LIFE_HEIGHT; l_y++ )
+  {
+    p_next[l_y] = 0;
+    for ( l_x = 0; l_x < LIFE_WIDTH; l_x++ )
+    {
+      l_count = 0;
+      for ( l_dy = -1; l_dy <= 1; l_dy++ )
+      {
+        for ( l_dx = -1; l_dx <= 1; l_dx++ )
+        {
+          if ( ( l_dx || l_dy ) &&
+               ( p_rows[( l_y + LIFE_HEIGHT + l_dy ) % LIFE_HEIGHT] >> ( ( l_x + LIFE_WIDTH + l_dx ) % LIFE_WIDTH ) & 1 ) )
+          {
+            l_count++;
+          }
+        }
+      }
+      if ( l_count == 3 || ( l_count == 2 && ( p_rows[l_y] >> l_x & 1 ) ) )
+      {
+        p_next[l_y] |= 1LLU << l_x;
+      }
+    }
+  }
+  return;
+}
+
+/*
+ * A blinker flips between across and down; the board it started from was
+ * never hashed, so it's the third generation that's spotted repeating.
+ */
+static void test_blinker( void )
+{
+  static const uint8_t  l_across[3][2] = { { 0, 1 }, { 1, 1 }, { 2, 1 } };
+  static const uint8_t  l_down[3][2] = { { 1, 0 }, { 1, 1 }, { 1, 2 } };
+  lifeboard_t           l_board, l_expected;
+
+  /* Straddling the corner, so it wraps both ways. */
+  test_place( &l_expected, l_down, 3, LIFE_WIDTH - 1, LIFE_HEIGHT - 1 );
+  test_place( &l_board, l_across, 3, LIFE_WIDTH - 1, LIFE_HEIGHT - 1 );
+
+  HOST_CHECK( life_step( &l_board ) );
+  HOST_CHECK( memcmp( l_board.rows, l_expected.rows, sizeof( l_board.rows ) ) == 0 );
+
+  test_place( &l_expected, l_across, 3, LIFE_WIDTH - 1, LIFE_HEIGHT - 1 );
+  HOST_CHECK( life_step( &l_board ) );
+  HOST_CHECK( memcmp( l_board.rows, l_expected.rows, sizeof( l_board.rows ) ) == 0 );
+
+  test_place( &l_expected, l_down, 3, LIFE_WIDTH - 1, LIFE_HEIGHT - 1 );
+  HOST_CHECK( !life_step( &l_board ) );
+  HOST_CHECK( memcmp( l_board.rows, l_expected.rows, sizeof( l_board.rows ) ) == 0 );
+  return;
+}
+
+/* A glider moves one cell down and right every four generations, forever. */
+static void test_glider( void )
+{
+  static const uint8_t  l_glider[5][2] = { { 1, 0 }, { 2, 1 }, { 0, 2 }, { 1, 2 }, { 2, 2 } };
+  lifeboard_t           l_board, l_expected;
+  uint32_t              l_generation;
+
+  test_place( &l_board, l_glider, 5, 0, 0 );
+  for ( l_generation = 1; l_generation <= LIFE_WIDTH * 4; l_generation++ )
+  {
+    HOST_CHECK( life_step( &l_board ) );
+    if ( l_generation % 4 == 0 )
+    {
+      test_place( &l_expected, l_glider, 5, l_generation / 4, l_generation / 4 );
+      HOST_CHECK( memcmp( l_board.rows, l_expected.rows, sizeof( l_board.rows ) ) == 0 );
+    }
+  }
+
+  /* All the way across, and back where it started. */
+  test_place( &l_expected, l_glider, 5, 0, LIFE_WIDTH % LIFE_HEIGHT );
+  HOST_CHECK( memcmp( l_board.rows, l_expected.rows, sizeof( l_board.rows ) ) == 0 );
+  return;
+}
+
+/* Random soup agrees with the slow step, generation after generation. */
+static void test_soup( void )
+{
+  lifeboard_t l_board;
+  uint64_t    l_expected[LIFE_HEIGHT];
+  uint32_t    l_soup, l_generation;
+
+  srand( 52 );
+  for ( l_soup = 0; l_soup < TEST_SOUPS; l_soup++ )
+  {
+    life_seed( &l_board );
+    for ( l_generation = 0; l_generation < TEST_SOUP_GENS; l_generation++ )
+    {
+      test_reference_step( l_board.rows, l_expected );
+      life_step( &l_board );
+      HOST_CHECK( memcmp( l_board.rows, l_expected, sizeof( l_expected ) ) == 0 );
+    }
+  }
+  return;
+}
+
+/* Flat out, reseeding as the Unicorn would; the time is only reported. */
+static void test_speed( void )
+{
+  lifeboard_t l_board;
+  uint64_t    l_start, l_elapsed;
+  uint32_t    l_generation;
+
+  g_host_real_time = true;
+  life_seed( &l_board );
+  l_start = time_us_64();
+  for ( l_generation = 0; l_generation < TEST_TIMED_GENS; l_generation++ )
+  {
+    if ( !life_step( &l_board ) )
+    {
+      life_seed( &l_board );
+    }
+  }
+  l_elapsed = time_us_64() - l_start;
+  g_host_real_time = false;
+
+  printf( "life: %d generations in %lluus (%.0f generations/sec)\n", TEST_TIMED_GENS,
+          (unsigned long long)l_elapsed, TEST_TIMED_GENS * 1000000.0 / ( l_elapsed ? l_elapsed : 1 ) );
+  return;
+}
+
+
+int main()
+{
+  test_blinker();
+  test_glider();
+  test_soup();
+  test_speed();
+  return host_result( "life" );
+}
+
+/* End of file life_test.cpp */
@@ -0,0 +1,149 @@
+/*
+ * rain_test.cpp - from the Unicorn C(++) Examples collection
+ *
+ * Checks that rain's band culling keeps every drop whose rings reach into the
+ * band being drawn, and only skips those which can't - in particular drops
+ * near the top edge, whose rings spread above row 0, and (on the canvases)
+ * those straddling the split between the halves, or the edge of a panel.
+ *
+ * On the Pico, uint_fast8_t is a full unsigned word (on a PC it's a byte, and
+ * promotes to int), so it's made one here too; otherwise arithmetic which
+ * goes unsigned on the target would quietly pass on the host.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include <stdint.h>
+
+#define uint_fast8_t uint32_t
+
+
+/* Local headers. */
+
+#include "host.hpp"
+#include "rain.cpp"
+
+
+/* Constants. */
+
+#define TEST_PEN_BLACK  0
+#define TEST_PEN_DROP   0xffff
+
+
+/* Globals. */
+
+static uint16_t g_frame[RAIN_WIDTH * RAIN_HEIGHT];
+static int      g_palette[RAINDROP_LIFESPAN];
+
+
+/* Functions. */
+
+/* How many circles rain_render draws for one drop, clipped to a band. */
+static uint32_t render_circles( const raindrop_t *p_drop, int32_t p_top, int32_t p_height )
+{
+  pimoroni::PicoGraphics_PenRGB565  l_graphics( RAIN_WIDTH, RAIN_HEIGHT, g_frame );
+  rainjob_t                         l_job = {};
+
+  l_job.graphics = &l_graphics;
+  l_job.raindrops = p_drop;
+  l_job.count = 1;
+  l_job.palette = g_palette;
+  l_job.black_pen = TEST_PEN_BLACK;
+  l_graphics.set_clip( pimoroni::Rect( 0, p_top, RAIN_WIDTH, p_height ) );
+
+  g_host_circles = 0;
+  rain_render( &l_job );
+  return g_host_circles;
+}
+
+/* How many pixels rain_draw lights for one drop, on a canvas for a band. */
+template <class C>
+static uint32_t draw_pixels( const raindrop_t *p_drop, int p_origin_y, int p_origin_x )
+{
+  pimoroni::PicoGraphics_PenRGB565  l_graphics( RAIN_WIDTH, RAIN_HEIGHT, g_frame );
+  C                                 l_canvas( g_frame + p_origin_y * RAIN_WIDTH );
+  rainjob_t                         l_job = {};
+  uint32_t                          l_index, l_lit = 0;
+
+  l_job.graphics = &l_graphics;
+  l_job.raindrops = p_drop;
+  l_job.count = 1;
+  l_job.palette = g_palette;
+  l_job.black_pen = TEST_PEN_BLACK;
+  l_job.origin_x = p_origin_x;
+
+  memset( g_frame, TEST_PEN_BLACK, sizeof( g_frame ) );
+  rain_draw( &l_job, l_canvas, p_origin_y );
+  for ( l_index = 0; l_index < RAIN_WIDTH * RAIN_HEIGHT; l_index++ )
+  {
+    l_lit += ( g_frame[l_index] == TEST_PEN_DROP );
+  }
+  return l_lit;
+}
+
+static void test_render_top_edge( void )
+{
+  const raindrop_t  l_young = { 10, 0, 1, true };
+  const raindrop_t  l_old = { 20, 1, 5, true };
+
+  /* Outer ring only, when young; outer, inner and a centre dot when old. */
+  HOST_CHECK( render_circles( &l_young, 0, RAIN_HEIGHT ) == 1 );
+  HOST_CHECK( render_circles( &l_old, 0, RAIN_HEIGHT ) == 3 );
+  HOST_CHECK( render_circles( &l_young, 0, RAIN_SPLIT_Y ) == 1 );
+  HOST_CHECK( render_circles( &l_old, 0, RAIN_SPLIT_Y ) == 3 );
+  return;
+}
+
+static void test_render_culls( void )
+{
+  const raindrop_t  l_young = { 10, 0, 1, true };
+  const raindrop_t  l_dead = { 10, 3, 2, false };
+  const raindrop_t  l_low = { 10, RAIN_HEIGHT - 1, 1, true };
+
+  /* Nowhere near the bottom half, dead, or nowhere near the top. */
+  HOST_CHECK( render_circles( &l_young, RAIN_SPLIT_Y, RAIN_HEIGHT - RAIN_SPLIT_Y ) == 0 );
+  HOST_CHECK( render_circles( &l_dead, 0, RAIN_HEIGHT ) == 0 );
+  HOST_CHECK( render_circles( &l_low, 0, RAIN_SPLIT_Y ) == 0 );
+  return;
+}
+
+static void test_draw_straddles( void )
+{
+  const raindrop_t  l_split = { 10, RAIN_SPLIT_Y - 2, 4, true };
+  const raindrop_t  l_top = { 10, 1, 3, true };
+  const raindrop_t  l_edge = { RAIN_WIDTH - 2, 1, 3, true };
+  const raindrop_t  l_low = { 10, RAIN_HEIGHT - 1, 1, true };
+
+  /* Centred above the bottom half, but the ring reaches down into it. */
+  HOST_CHECK( draw_pixels<RainBottomCanvas>( &l_split, RAIN_SPLIT_Y, 0 ) > 0 );
+  HOST_CHECK( draw_pixels<RainTopCanvas>( &l_split, 0, 0 ) > 0 );
+
+  /* Spreading above the top row, on the top half and on the whole panel. */
+  HOST_CHECK( draw_pixels<RainTopCanvas>( &l_top, 0, 0 ) > 0 );
+  HOST_CHECK( draw_pixels<RainCanvas>( &l_top, 0, 0 ) > 0 );
+
+  /* On the panel to the left of ours, but the ring crosses onto ours. */
+  HOST_CHECK( draw_pixels<RainCanvas>( &l_edge, 0, RAIN_WIDTH ) > 0 );
+  HOST_CHECK( draw_pixels<RainTopCanvas>( &l_edge, 0, RAIN_WIDTH ) > 0 );
+
+  /* And still nothing from a drop which doesn't reach the band at all. */
+  HOST_CHECK( draw_pixels<RainTopCanvas>( &l_low, 0, 0 ) == 0 );
+  HOST_CHECK( draw_pixels<RainBottomCanvas>( &l_top, RAIN_SPLIT_Y, 0 ) == 0 );
+  return;
+}
+
+
+int main()
+{
+  g_palette[1] = g_palette[3] = g_palette[4] = g_palette[5] = TEST_PEN_DROP;
+
+  test_render_top_edge();
+  test_render_culls();
+  test_draw_straddles();
+  return host_result( "rain" );
+}
+
+/* End of file rain_test.cpp */
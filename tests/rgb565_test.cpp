@@ -0,0 +1,142 @@
+/*
+ * rgb565_test.cpp - from the Unicorn C(++) Examples collection
+ *
+ * Checks the two-pixels-a-word RGB565 kernels against their one-channel-at-a-
+ * time references: every pixel value through fade, and random spans (of any
+ * length, at either alignment) through all three.
+ *
+ * As in rain_test, uint_fast8_t is a full word here, as it is on the Pico.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define uint_fast8_t uint32_t
+
+
+/* Local headers. */
+
+#include "host.hpp"
+#include "rgb565.hpp"
+
+
+/* Constants. */
+
+/* A panel's worth (53 x 11), with room for the misaligned starts. */
+#define TEST_PANEL    583
+#define TEST_PIXELS   ( TEST_PANEL + 2 )
+#define TEST_SPANS    3000
+
+
+/* Globals. */
+
+static uint16_t g_fast[TEST_PIXELS] __attribute__(( aligned( 4 ) ));
+static uint16_t g_reference[TEST_PIXELS] __attribute__(( aligned( 4 ) ));
+static uint16_t g_source[TEST_PIXELS + 1] __attribute__(( aligned( 4 ) ));
+
+
+/* Functions. */
+
+/* Every possible pixel, in pairs, faded by every factor. */
+static void test_fade_exhaustive( void )
+{
+  static uint16_t l_fast[65536] __attribute__(( aligned( 4 ) ));
+  static uint16_t l_reference[65536];
+  uint_fast8_t    l_scale;
+  uint32_t        l_index;
+
+  for ( l_scale = 0; l_scale <= RGB565_SCALE_ONE; l_scale++ )
+  {
+    for ( l_index = 0; l_index < 65536; l_index++ )
+    {
+      l_fast[l_index] = l_reference[l_index] = l_index;
+    }
+    Rgb565::fade( l_fast, 65536, l_scale );
+    Rgb565::fade_reference( l_reference, 65536, l_scale );
+    HOST_CHECK( memcmp( l_fast, l_reference, sizeof( l_fast ) ) == 0 );
+  }
+  return;
+}
+
+/* Random spans, offsets, lengths and factors. */
+static void test_spans( void )
+{
+  uint_fast16_t l_index, l_pixel, l_offset, l_source_offset, l_count;
+  uint_fast8_t  l_factor;
+  uint32_t      l_mismatches[3] = { 0, 0, 0 };
+
+  srand( 565 );
+  for ( l_index = 0; l_index < TEST_SPANS; l_index++ )
+  {
+    for ( l_pixel = 0; l_pixel < TEST_PIXELS; l_pixel++ )
+    {
+      g_fast[l_pixel] = g_reference[l_pixel] = rand();
+      g_source[l_pixel] = rand();
+    }
+    l_offset = rand() % 2;
+    l_source_offset = rand() % 2;
+    l_count = rand() % ( TEST_PANEL + 1 );
+    l_factor = rand() % ( RGB565_SCALE_ONE + 1 );
+
+    switch( l_index % 3 )
+    {
+      case 0:
+        Rgb565::fade( g_fast + l_offset, l_count, l_factor );
+        Rgb565::fade_reference( g_reference + l_offset, l_count, l_factor );
+        break;
+      case 1:
+        Rgb565::blend( g_fast + l_offset, g_source + l_source_offset, l_count, l_factor );
+        Rgb565::blend_reference( g_reference + l_offset, g_source + l_source_offset, l_count, l_factor );
+        break;
+      case 2:
+        Rgb565::add( g_fast + l_offset, g_source + l_source_offset, l_count );
+        Rgb565::add_reference( g_reference + l_offset, g_source + l_source_offset, l_count );
+        break;
+    }
+
+    /* Including the pixels either side of the span, which mustn't change. */
+    if ( memcmp( g_fast, g_reference, sizeof( g_fast ) ) != 0 )
+    {
+      l_mismatches[l_index % 3]++;
+    }
+  }
+
+  HOST_CHECK( l_mismatches[0] == 0 );
+  HOST_CHECK( l_mismatches[1] == 0 );
+  HOST_CHECK( l_mismatches[2] == 0 );
+  return;
+}
+
+/* A few which are easy to reason about; white plus anything stays white. */
+static void test_saturation( void )
+{
+  uint16_t  l_white[2] __attribute__(( aligned( 4 ) )) = { 0xffff, 0xffff };
+  uint16_t  l_other[2] __attribute__(( aligned( 4 ) )) = { 0x1234, 0xffff };
+  uint16_t  l_black[2] __attribute__(( aligned( 4 ) )) = { 0x0000, 0x0000 };
+
+  Rgb565::add( l_white, l_other, 2 );
+  HOST_CHECK( ( l_white[0] == 0xffff ) && ( l_white[1] == 0xffff ) );
+  Rgb565::add( l_black, l_other, 2 );
+  HOST_CHECK( ( l_black[0] == 0x1234 ) && ( l_black[1] == 0xffff ) );
+  Rgb565::fade( l_other, 2, RGB565_SCALE_ONE );
+  HOST_CHECK( ( l_other[0] == 0x1234 ) && ( l_other[1] == 0xffff ) );
+  Rgb565::fade( l_other, 2, 0 );
+  HOST_CHECK( ( l_other[0] == 0x0000 ) && ( l_other[1] == 0x0000 ) );
+  return;
+}
+
+
+int main()
+{
+  test_fade_exhaustive();
+  test_spans();
+  test_saturation();
+  return host_result( "rgb565" );
+}
+
+/* End of file rgb565_test.cpp */
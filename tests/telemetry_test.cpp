@@ -0,0 +1,208 @@
+/*
+ * telemetry_test.cpp - from the Unicorn C(++) Examples collection
+ *
+ * Sends telemetry (telemetry.hpp) from one node to a collector on another,
+ * and checks what arrives: every metric, once, with all that was recorded
+ * against it. Some of the sends are made to fail, as lwIP does when it's out
+ * of buffers; the metrics in those datagrams have to be held over for the
+ * next flush, not lost. So do any that won't fit in the hour's budget.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define uint_fast8_t uint32_t
+
+
+/* Local headers. */
+
+#include "host.hpp"
+#include "telemetry.hpp"
+
+
+/* Constants. */
+
+#define TEST_PORT         8089
+#define TEST_COLLECTOR    "192.168.0.11"
+#define TEST_SETTLE_US    10000
+
+/* Enough in every bucket that no two histograms' lines share a datagram. */
+#define TEST_REPEATS      10000
+
+
+/* Globals. */
+
+static std::vector<std::string> g_received;
+
+static const telemetrymetric_t g_simple[] = {
+  { "syncs", TELEMETRY_COUNTER },
+  { "brightness", TELEMETRY_GAUGE }
+};
+
+static const telemetrymetric_t g_histograms[] = {
+  { "histogram_number_zero", TELEMETRY_HISTOGRAM },
+  { "histogram_number_one", TELEMETRY_HISTOGRAM },
+  { "histogram_number_two", TELEMETRY_HISTOGRAM }
+};
+
+
+/* Functions. */
+
+/* The collector, on node 1; it just keeps every datagram. */
+static void test_collect( void *p_arg, struct udp_pcb *p_socket, struct pbuf *p_buffer,
+                          const ip_addr_t *p_addr, uint16_t p_port )
+{
+  g_received.push_back( std::string( (const char *)p_buffer->payload, p_buffer->tot_len ) );
+  pbuf_free( p_buffer );
+  return;
+}
+
+/* Both nodes on the network, and the collector listening. */
+static void test_network( void )
+{
+  struct udp_pcb *l_socket;
+
+  g_host_nodes[0].link_status = g_host_nodes[1].link_status = CYW43_LINK_UP;
+  g_host_node = 1;
+  cyw43_arch_init();
+  l_socket = udp_new_ip_type( IPADDR_TYPE_ANY );
+  udp_bind( l_socket, IP_ADDR_ANY, TEST_PORT );
+  udp_recv( l_socket, test_collect, nullptr );
+
+  g_host_node = 0;
+  cyw43_arch_init();
+  return;
+}
+
+/* Flushes, and collects whatever that sent. */
+static uint32_t test_flush( Telemetry *p_telemetry )
+{
+  uint32_t  l_sent;
+
+  g_received.clear();
+  g_host_node = 0;
+  l_sent = p_telemetry->flush();
+  host_udp_run( g_host_time_us + TEST_SETTLE_US );
+  g_host_node = 0;
+  return l_sent;
+}
+
+/* How many of the datagrams received have this in them. */
+static uint32_t test_count( const char *p_text )
+{
+  uint32_t  l_count = 0;
+
+  for ( const std::string &l_datagram : g_received )
+  {
+    if ( l_datagram.find( p_text ) != std::string::npos )
+    {
+      l_count++;
+    }
+  }
+  return l_count;
+}
+
+/* A datagram that doesn't go keeps its metrics, which carry on adding up. */
+static void test_failed_send( void )
+{
+  Telemetry l_telemetry;
+
+  l_telemetry.init( g_simple, 2, TEST_COLLECTOR, TEST_PORT );
+  l_telemetry.count( 0, 3 );
+  l_telemetry.record( 1, 7 );
+
+  g_host_udp_fails = 1;
+  HOST_CHECK( test_flush( &l_telemetry ) == 0 );
+  HOST_CHECK( g_received.empty() );
+
+  l_telemetry.count( 0, 2 );
+  HOST_CHECK( test_flush( &l_telemetry ) > 0 );
+  HOST_CHECK( g_received.size() == 1 );
+  HOST_CHECK( test_count( "syncs,unit=" ) == 1 );
+  HOST_CHECK( test_count( " n=5i\n" ) == 1 );
+  HOST_CHECK( test_count( "last=7i,min=7i,max=7i" ) == 1 );
+
+  /* And once it has gone, it's gone. */
+  HOST_CHECK( test_flush( &l_telemetry ) == 0 );
+  HOST_CHECK( g_received.empty() );
+  return;
+}
+
+/* Only the metrics in the datagram that failed are held; the rest are done. */
+static void test_failed_datagram( void )
+{
+  Telemetry l_telemetry;
+  uint32_t  l_index, l_bit, l_repeat;
+
+  l_telemetry.init( g_histograms, 3, TEST_COLLECTOR, TEST_PORT );
+  for ( l_index = 0; l_index < 3; l_index++ )
+  {
+    for ( l_bit = 0; l_bit < TELEMETRY_BUCKETS; l_bit++ )
+    {
+      for ( l_repeat = 0; l_repeat < TEST_REPEATS; l_repeat++ )
+      {
+        l_telemetry.record( l_index, 1 << l_bit );
+      }
+    }
+  }
+
+  g_host_udp_fails = 1;
+  HOST_CHECK( test_flush( &l_telemetry ) > 0 );
+  HOST_CHECK( g_received.size() == 2 );
+  HOST_CHECK( test_count( "histogram_number_zero," ) == 0 );
+  HOST_CHECK( test_count( "histogram_number_one," ) == 1 );
+  HOST_CHECK( test_count( "histogram_number_two," ) == 1 );
+
+  HOST_CHECK( test_flush( &l_telemetry ) > 0 );
+  HOST_CHECK( g_received.size() == 1 );
+  HOST_CHECK( test_count( "histogram_number_zero,unit=" ) == 1 );
+  HOST_CHECK( test_count( " n=160000i," ) == 1 );
+  HOST_CHECK( test_count( ",lt2=10000i," ) == 1 );
+  HOST_CHECK( test_count( ",ge16384=20000i\n" ) == 1 );
+  return;
+}
+
+/* Over the hour's budget, metrics wait for the next hour; whole. */
+static void test_budget( void )
+{
+  Telemetry l_telemetry;
+  uint32_t  l_sent, l_total = 0, l_flushes;
+
+  l_telemetry.init( g_simple, 2, TEST_COLLECTOR, TEST_PORT );
+  for ( l_flushes = 0; l_flushes < 1000; l_flushes++ )
+  {
+    l_telemetry.count( 0 );
+    l_sent = test_flush( &l_telemetry );
+    if ( l_sent == 0 )
+    {
+      break;
+    }
+    l_total += l_sent;
+  }
+  HOST_CHECK( ( l_total <= TELEMETRY_HOURLY_BYTES ) && ( l_total > TELEMETRY_HOURLY_BYTES / 2 ) );
+  HOST_CHECK( g_received.empty() );
+
+  l_telemetry.count( 0 );
+  g_host_time_us += TELEMETRY_HOUR_USECS;
+  HOST_CHECK( test_flush( &l_telemetry ) > 0 );
+  HOST_CHECK( test_count( " n=2i\n" ) == 1 );
+  return;
+}
+
+
+int main()
+{
+  test_network();
+  test_failed_send();
+  test_failed_datagram();
+  test_budget();
+  return host_result( "telemetry" );
+}
+
+/* End of file telemetry_test.cpp */
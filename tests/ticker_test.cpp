@@ -0,0 +1,304 @@
+/*
+ * ticker_test.cpp - from the Unicorn C(++) Examples collection
+ *
+ * Runs the ticker app itself, through the same AppRunner its main() uses,
+ * against the host stand-ins; the WiFi comes up a few seconds in, and
+ * messages are then sent to it as tools/ticker_send.py would. Every frame it shows has to be a clean window
+ * onto the message we expect, a little further along than the last one; and
+ * each message has to scroll fully in and out, in order, at the right speed.
+ *
+ * Along the way, it overfills the queue (one message should be dropped) and
+ * sends text that needs sanitising, or truncating. The blending between
+ * columns is also checked on its own, a sixteenth of a pixel at a time.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include <stdint.h>
+
+#define uint_fast8_t uint32_t
+
+
+/* Local headers. */
+
+#include "host.hpp"
+#include "ticker.cpp"
+
+
+/* Constants. */
+
+#define TEST_LINK_UP_US   3000000LLU
+#define TEST_LIMIT_US     300000000LLU
+#define TEST_MESSAGES     8
+#define TEST_SEARCH       ( 2 << TICKER_SUBPIXEL_BITS )
+
+/* At 60fps, each frame moves the strip on by 20 * 256 / 60 sixteenths. */
+#define TEST_STEP         ( ( 1000000 / TICKER_FPS ) * TICKER_SPEED * 256 / 1000000 )
+
+
+/* Structs. */
+
+typedef struct
+{
+  const char     *text;
+  tickerstrip_t   strip;
+  bool            seen;
+  uint32_t        repeats;
+  uint32_t        position;
+  uint32_t        first_frame, last_frame;
+  uint32_t        first_position, last_position;
+} testmsg_t;
+
+
+/* Globals. */
+
+static testmsg_t  g_messages[TEST_MESSAGES];
+static uint_fast8_t g_current;
+static uint32_t   g_frames, g_unmatched;
+static uint64_t   g_start_us;
+
+static pimoroni::PicoGraphics_PenRGB565 *g_reference;
+
+static char       g_long[200];
+static char       g_long_shown[TICKER_MAX_TEXT+1];
+
+
+/* Functions. */
+
+/* Sends a message to the ticker, as ticker_send.py would. */
+static void test_send( const char *p_text )
+{
+  HOST_CHECK( host_udp_deliver( TICKER_PORT, p_text, strlen( p_text ) ) );
+  return;
+}
+
+/* Does the frame show this message, at this position? */
+static bool test_matches( pimoroni::PicoGraphics *p_graphics, testmsg_t *p_message, uint32_t p_position )
+{
+  p_message->strip.position = p_position;
+  ticker_render( &p_message->strip, g_reference );
+  return memcmp( g_reference->frame_buffer, p_graphics->frame_buffer,
+                 TICKER_WIDTH * TICKER_HEIGHT * sizeof( uint16_t ) ) == 0;
+}
+
+/* Finds where in a message the frame is, between two positions (if it is). */
+static bool test_find( pimoroni::PicoGraphics *p_graphics, uint_fast8_t p_index,
+                       uint32_t p_from, uint32_t *p_position )
+{
+  uint32_t  l_position;
+
+  /* Positions within the same sixteenth of a pixel all look the same. */
+  for ( l_position = p_from & ~0x0f; l_position <= p_from + TEST_SEARCH; l_position += 16 )
+  {
+    if ( test_matches( p_graphics, &g_messages[p_index], l_position ) )
+    {
+      *p_position = l_position;
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Notes that a message is on the screen, and does whatever that calls for. */
+static void test_showing( uint_fast8_t p_index, uint32_t p_position )
+{
+  testmsg_t  *l_message = &g_messages[p_index];
+
+  if ( !l_message->seen )
+  {
+    l_message->seen = true;
+    l_message->first_frame = g_frames;
+    l_message->first_position = p_position;
+
+    /* Once we're listening, send more than the queue can hold. */
+    if ( p_index == 1 )
+    {
+      test_send( "One" );
+      test_send( "Two" );
+      test_send( "Three" );
+      test_send( "Four" );
+      test_send( "Five" );
+    }
+
+    /* And once that's drained, a couple of awkward ones. */
+    if ( p_index == 5 )
+    {
+      test_send( "Tab\there\x01\x7f!" );
+      test_send( g_long );
+    }
+  }
+
+  /* Where it is now; but it's only timed on its first time through. */
+  g_current = p_index;
+  l_message->position = p_position;
+  if ( l_message->repeats == 0 )
+  {
+    l_message->last_frame = g_frames;
+    l_message->last_position = p_position;
+  }
+  return;
+}
+
+/* Called with every frame the ticker presents. */
+static void test_present( pimoroni::PicoGraphics *p_graphics )
+{
+  const uint16_t *l_buffer = (const uint16_t *)p_graphics->frame_buffer;
+  uint32_t        l_position;
+  uint_fast16_t   l_index;
+  bool            l_blank = true;
+
+  g_frames++;
+  if ( g_host_time_us - g_start_us > TEST_LINK_UP_US )
+  {
+    g_host_nodes[0].link_status = CYW43_LINK_UP;
+  }
+  if ( g_host_time_us - g_start_us > TEST_LIMIT_US )
+  {
+    throw 0;
+  }
+
+  /* Blank frames, between messages, could belong to any of them. */
+  for ( l_index = 0; l_index < TICKER_WIDTH * TICKER_HEIGHT; l_index++ )
+  {
+    if ( l_buffer[l_index] != g_messages[0].strip.palette[0] )
+    {
+      l_blank = false;
+      break;
+    }
+  }
+  if ( l_blank )
+  {
+    return;
+  }
+
+  /* Either we're further along this message, or onto the next, or again. */
+  if ( test_find( p_graphics, g_current, g_messages[g_current].position, &l_position ) )
+  {
+    test_showing( g_current, l_position );
+  }
+  else if ( ( g_current + 1 < TEST_MESSAGES ) && test_find( p_graphics, g_current + 1, 0, &l_position ) )
+  {
+    test_showing( g_current + 1, l_position );
+  }
+  else if ( test_find( p_graphics, g_current, 0, &l_position ) )
+  {
+    g_messages[g_current].repeats++;
+    test_showing( g_current, l_position );
+  }
+  else
+  {
+    g_unmatched++;
+  }
+
+  /* Once the last message comes round again, we've seen all we need to. */
+  if ( g_messages[TEST_MESSAGES - 1].repeats > 0 )
+  {
+    throw 0;
+  }
+  return;
+}
+
+/* The ticker's frame loop, fed by the sender, checked frame by frame. */
+static void test_simulate( void )
+{
+  static const char *l_texts[TEST_MESSAGES] = {
+    "Connecting...", "Listening on 0.0.0.0:4242", "One", "Two", "Three", "Four",
+    "Tab here  !", g_long_shown
+  };
+  UnicornApp   *l_apps[] = { ticker_app() };
+  uint_fast8_t  l_index;
+  uint32_t      l_steps;
+
+  /* A long message, only the start of which should make it through. */
+  for ( l_index = 0; l_index < sizeof( g_long ) - 1; l_index++ )
+  {
+    g_long[l_index] = 'A' + l_index % 26;
+  }
+  memcpy( g_long_shown, g_long, TICKER_MAX_TEXT );
+
+  g_reference = new pimoroni::PicoGraphics_PenRGB565( TICKER_WIDTH, TICKER_HEIGHT, nullptr );
+  for ( l_index = 0; l_index < TEST_MESSAGES; l_index++ )
+  {
+    g_messages[l_index].text = l_texts[l_index];
+    ticker_palette( &g_messages[l_index].strip, g_reference );
+    ticker_build( &g_messages[l_index].strip, l_texts[l_index] );
+  }
+
+  g_start_us = g_host_time_us;
+  g_host_present = test_present;
+  try
+  {
+    AppRunner::run( l_apps, 1 );
+  }
+  catch ( int )
+  {
+  }
+  g_host_present = nullptr;
+
+  printf( "%lu frames in %.1fs of simulated time\n", (unsigned long)g_frames,
+          ( g_host_time_us - g_start_us ) / 1000000.0f );
+  HOST_CHECK( g_unmatched == 0 );
+  HOST_CHECK( g_messages[TEST_MESSAGES - 1].repeats > 0 );
+  HOST_CHECK( g_queue.dropped() == 1 );
+
+  /* Every message came in from the right, and went fully off to the left. */
+  for ( l_index = 0; l_index < TEST_MESSAGES; l_index++ )
+  {
+    testmsg_t *l_message = &g_messages[l_index];
+
+    HOST_CHECK( l_message->seen );
+    HOST_CHECK( l_message->first_position < ( 1 << TICKER_SUBPIXEL_BITS ) );
+    HOST_CHECK( l_message->last_position >=
+                ( l_message->strip.length - TICKER_WIDTH - 3u ) << TICKER_SUBPIXEL_BITS );
+
+    /* At the steady pace we asked for; found to within a sixteenth. */
+    l_steps = l_message->last_frame - l_message->first_frame;
+    HOST_CHECK( ( l_steps > 0 ) &&
+                ( l_message->last_position - l_message->first_position + 16 >= l_steps * TEST_STEP ) &&
+                ( l_message->last_position - l_message->first_position <= l_steps * TEST_STEP + 16 ) );
+  }
+  return;
+}
+
+/* A single lit column, slid across the right hand edge. */
+static void test_blend( void )
+{
+  pimoroni::PicoGraphics_PenRGB565  l_graphics( TICKER_WIDTH, TICKER_HEIGHT, nullptr );
+  tickerstrip_t                    *l_strip = new tickerstrip_t();
+  const uint16_t                   *l_buffer = (const uint16_t *)l_graphics.frame_buffer;
+  uint32_t                          l_level;
+
+  ticker_palette( l_strip, &l_graphics );
+  l_strip->columns[TICKER_WIDTH] = ( 1 << TICKER_HEIGHT ) - 1;
+  l_strip->length = TICKER_WIDTH * 2 + 1;
+
+  for ( l_level = 0; l_level <= TICKER_LEVELS; l_level++ )
+  {
+    l_strip->position = l_level << ( TICKER_SUBPIXEL_BITS - 4 );
+    ticker_render( l_strip, &l_graphics );
+    HOST_CHECK( l_buffer[TICKER_WIDTH - 1] == l_strip->palette[l_level] );
+    HOST_CHECK( l_buffer[TICKER_WIDTH * TICKER_HEIGHT - 1] == l_strip->palette[l_level] );
+    HOST_CHECK( l_buffer[TICKER_WIDTH - 2] == l_strip->palette[0] );
+  }
+
+  /* One second is twenty columns; and it's done when the blanks are reached. */
+  l_strip->position = 0;
+  HOST_CHECK( !ticker_update( l_strip, 1000000 ) );
+  HOST_CHECK( l_strip->position == TICKER_SPEED << TICKER_SUBPIXEL_BITS );
+  HOST_CHECK( ticker_update( l_strip, 2000000 ) );
+  delete l_strip;
+  return;
+}
+
+
+int main()
+{
+  test_blend();
+  test_simulate();
+  return host_result( "ticker" );
+}
+
+/* End of file ticker_test.cpp */
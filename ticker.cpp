@@ -0,0 +1,468 @@
+/*
+ * ticker.cpp - from the Unicorn C(++) Examples collection
+ *
+ * A scrolling text ticker, fed over the network; send a short UDP message
+ * to port 4242 and it'll scroll across the Unicorn (tools/ticker_send.py does
+ * exactly that, from any host on the same network).
+ *
+ * The lwIP receive callback runs from an interrupt, so it doesn't touch the
+ * display at all; it just drops each message into a lock-free queue, which
+ * the main loop picks up from once the current message has scrolled past.
+ *
+ * Messages are rendered just the once, into a strip of column bitmasks; each
+ * frame then only has to copy a panel-sized window out of the strip. Motion
+ * is sub-pixel, blending each pixel between the two columns it sits across.
+ *
+ * Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+ * Released under the MIT License; see LICENSE for details.
+ */
+
+/* System headers. */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+
+
+/* Local headers. */
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+#include "libraries/galactic_unicorn/galactic_unicorn.hpp"
+#include "libraries/bitmap_fonts/bitmap_fonts.hpp"
+#include "libraries/bitmap_fonts/font8_data.hpp"
+#include "instrument.hpp"
+#include "spsc_queue.hpp"
+#include "app.hpp"
+
+
+/* Constants. */
+
+#define TICKER_WIDTH          pimoroni::GalacticUnicorn::WIDTH
+#define TICKER_HEIGHT         pimoroni::GalacticUnicorn::HEIGHT
+#define TICKER_PORT           4242
+#define TICKER_MAX_TEXT       120
+#define TICKER_QUEUE_SIZE     4
+#define TICKER_STRIP_COLUMNS  1024
+#define TICKER_SPEED          20
+#define TICKER_FPS            60
+
+/* Sub-pixel positions are 8.8 fixed point, but blended in 1/16ths. */
+#define TICKER_SUBPIXEL_BITS  8
+#define TICKER_LEVELS         16
+
+
+/* Enums. */
+
+typedef enum
+{
+  TICKER_STAGE_NETWORK,
+  TICKER_STAGE_UPDATE,
+  TICKER_STAGE_RENDER,
+  TICKER_STAGE_PRESENT
+} ticker_stage_t;
+
+
+/* Structs. */
+
+typedef struct
+{
+  char            text[TICKER_MAX_TEXT+1];
+} tickermsg_t;
+
+typedef struct
+{
+  bool            active;
+  bool            connecting;
+  struct udp_pcb *socket;
+} tickernet_t;
+
+typedef struct
+{
+  uint16_t        columns[TICKER_STRIP_COLUMNS];
+  uint_fast16_t   length;
+  uint32_t        position;
+  uint16_t        palette[TICKER_LEVELS+1];
+} tickerstrip_t;
+
+
+/* Globals. */
+
+/* Filled by the lwIP callback, emptied by the main loop. */
+static SpscQueue<tickermsg_t, TICKER_QUEUE_SIZE> g_queue;
+
+
+/* Functions. */
+
+/*
+ * tickercb_recv - lwIP callback for incoming messages; copies the text into
+ *                 the next free queue slot (if there is one) and that's all.
+ */
+
+void tickercb_recv( void *p_arg, struct udp_pcb *p_socket, struct pbuf *p_buffer,
+                    const ip_addr_t *p_addr, uint16_t p_port )
+{
+  tickermsg_t  *l_message;
+  uint16_t      l_length, l_index;
+
+  l_message = g_queue.claim();
+  if ( l_message != nullptr )
+  {
+    l_length = pbuf_copy_partial( p_buffer, l_message->text, TICKER_MAX_TEXT, 0 );
+    l_message->text[l_length] = '\0';
+
+    /* We only have glyphs for printable ASCII; anything else is a space. */
+    for ( l_index = 0; l_index < l_length; l_index++ )
+    {
+      if ( ( l_message->text[l_index] < ' ' ) || ( l_message->text[l_index] > '~' ) )
+      {
+        l_message->text[l_index] = ' ';
+      }
+    }
+    g_queue.publish();
+  }
+
+  /* The buffer is ours to free, whether or not we had room for it. */
+  pbuf_free( p_buffer );
+  return;
+}
+
+
+/*
+ * ticker_network - brings up the WiFi and the listening socket, a step at a
+ *                  time so as not to hold up the frame. Returns true once
+ *                  we're listening.
+ */
+
+bool ticker_network( tickernet_t *p_net )
+{
+  int   l_link_status;
+
+  /* If the wireless isn't currently active, we need to kick that off. */
+  if ( !p_net->active )
+  {
+    cyw43_arch_init();
+    cyw43_arch_enable_sta_mode();
+    cyw43_arch_wifi_connect_async( WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK );
+    p_net->connecting = true;
+    p_net->active = true;
+    p_net->socket = nullptr;
+  }
+
+  /* Still connecting? Then see if it's up yet (or has failed). */
+  if ( p_net->connecting )
+  {
+    l_link_status = cyw43_tcpip_link_status( &cyw43_state, CYW43_ITF_STA );
+    if ( ( l_link_status == CYW43_LINK_FAIL ) || ( l_link_status == CYW43_LINK_BADAUTH ) ||
+         ( l_link_status == CYW43_LINK_NONET ) )
+    {
+      printf( "Failed to initialise WiFi (err %d)\n", l_link_status );
+      cyw43_arch_deinit();
+      p_net->active = false;
+      return false;
+    }
+
+    if ( l_link_status != CYW43_LINK_UP )
+    {
+      return false;
+    }
+    p_net->connecting = false;
+  }
+
+  /* Connected, so we just need somewhere to listen. */
+  if ( p_net->socket == nullptr )
+  {
+    cyw43_arch_lwip_begin();
+    p_net->socket = udp_new_ip_type( IPADDR_TYPE_ANY );
+    if ( p_net->socket != nullptr )
+    {
+      udp_bind( p_net->socket, IP_ADDR_ANY, TICKER_PORT );
+      udp_recv( p_net->socket, tickercb_recv, nullptr );
+    }
+    cyw43_arch_lwip_end();
+
+    if ( p_net->socket == nullptr )
+    {
+      printf( "Failed to create UDP PCB socket\n" );
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+/*
+ * ticker_release - lets go of the socket and the WiFi, for when another app
+ *                  wants it; ticker_network() brings it all back up again.
+ */
+
+void ticker_release( tickernet_t *p_net )
+{
+  if ( !p_net->active )
+  {
+    return;
+  }
+
+  if ( p_net->socket != nullptr )
+  {
+    cyw43_arch_lwip_begin();
+    udp_remove( p_net->socket );
+    cyw43_arch_lwip_end();
+    p_net->socket = nullptr;
+  }
+  cyw43_arch_deinit();
+  p_net->active = p_net->connecting = false;
+  return;
+}
+
+
+/*
+ * ticker_palette - works out the pens for each blend level, from off up to
+ *                  fully lit. Only done once, at startup.
+ */
+
+void ticker_palette( tickerstrip_t *p_strip, pimoroni::PicoGraphics *p_graphics )
+{
+  uint_fast8_t  l_level;
+
+  for ( l_level = 0; l_level <= TICKER_LEVELS; l_level++ )
+  {
+    p_strip->palette[l_level] = p_graphics->create_pen( 255 * l_level / TICKER_LEVELS,
+                                                        160 * l_level / TICKER_LEVELS,
+                                                        0 );
+  }
+
+  return;
+}
+
+
+/*
+ * ticker_build - renders a message into the strip, with a panel's width of
+ *                blank columns either side so it scrolls fully in and out.
+ *                This is the only place glyphs are drawn.
+ */
+
+void ticker_build( tickerstrip_t *p_strip, const char *p_text )
+{
+  int32_t       l_x, l_y;
+
+  memset( p_strip->columns, 0, sizeof( p_strip->columns ) );
+  l_x = TICKER_WIDTH;
+  l_y = ( TICKER_HEIGHT - font8.height ) / 2;
+
+  /* Each set pixel in a glyph arrives as a (tiny) rectangle. */
+  auto l_plot = [p_strip]( int32_t p_x, int32_t p_y, int32_t p_w, int32_t p_h )
+  {
+    int32_t   l_column;
+
+    for ( l_column = p_x; ( l_column < p_x + p_w ) && ( l_column < TICKER_STRIP_COLUMNS ); l_column++ )
+    {
+      p_strip->columns[l_column] |= ( ( 1 << p_h ) - 1 ) << p_y;
+    }
+  };
+
+  /* Leave room for the trailing blanks, and one more column to blend into. */
+  for ( ; *p_text != '\0'; p_text++ )
+  {
+    if ( l_x + font8.max_width + TICKER_WIDTH + 1 >= TICKER_STRIP_COLUMNS )
+    {
+      break;
+    }
+    bitmap::character( &font8, l_plot, *p_text, l_x, l_y, 1 );
+    l_x += bitmap::measure_character( &font8, *p_text, 1 ) + 1;
+  }
+
+  p_strip->length = l_x + TICKER_WIDTH;
+  p_strip->position = 0;
+  return;
+}
+
+
+/*
+ * ticker_update - moves the strip along by however long it's been since the
+ *                 last frame. Returns true once the message has scrolled off.
+ */
+
+bool ticker_update( tickerstrip_t *p_strip, uint32_t p_elapsed_us )
+{
+  p_strip->position += ( (uint64_t)p_elapsed_us * TICKER_SPEED << TICKER_SUBPIXEL_BITS ) / 1000000;
+
+  return ( p_strip->position >> TICKER_SUBPIXEL_BITS ) >= ( p_strip->length - TICKER_WIDTH );
+}
+
+
+/*
+ * ticker_render - copies the current window of the strip straight into the
+ *                 frame buffer, blending each pixel between the column it's
+ *                 on and the next by how far we are between them.
+ */
+
+void ticker_render( const tickerstrip_t *p_strip, pimoroni::PicoGraphics *p_graphics )
+{
+  uint16_t             *l_buffer = (uint16_t *)p_graphics->frame_buffer;
+  const uint16_t       *l_columns;
+  uint_fast16_t         l_x, l_y, l_left, l_right;
+  uint_fast8_t          l_next;
+
+  l_columns = &p_strip->columns[p_strip->position >> TICKER_SUBPIXEL_BITS];
+  l_next = ( p_strip->position & ( ( 1 << TICKER_SUBPIXEL_BITS ) - 1 ) ) >>
+           ( TICKER_SUBPIXEL_BITS - 4 );
+
+  for ( l_x = 0; l_x < TICKER_WIDTH; l_x++ )
+  {
+    l_left = l_columns[l_x];
+    l_right = l_columns[l_x + 1];
+    for ( l_y = 0; l_y < TICKER_HEIGHT; l_y++ )
+    {
+      l_buffer[l_y * TICKER_WIDTH + l_x] =
+        p_strip->palette[( ( l_left >> l_y ) & 0x01 ) * ( TICKER_LEVELS - l_next ) +
+                         ( ( l_right >> l_y ) & 0x01 ) * l_next];
+    }
+  }
+
+  return;
+}
+
+
+/*
+ * TickerApp - keeps the network moving, and scrolls whatever it's been sent.
+ */
+
+class TickerApp : public UnicornApp
+{
+  private:
+    bool                              m_listening, m_received, m_announced;
+    char                              m_text[TICKER_MAX_TEXT+1];
+    uint64_t                          m_last_tick;
+    tickernet_t                       m_net;
+    tickerstrip_t                     m_strip;
+
+  public:
+    void init( appcontext_t *p_context )
+    {
+      /* Until we've been sent something, we just show our own status. */
+      ticker_palette( &m_strip, p_context->graphics );
+      strcpy( m_text, "Connecting..." );
+      ticker_build( &m_strip, m_text );
+      m_listening = m_received = m_announced = false;
+      m_net.active = false;
+      m_last_tick = time_us_64();
+      return;
+    }
+
+    void resume( appcontext_t *p_context )
+    {
+      Instrument::name_stage( TICKER_STAGE_NETWORK, "network" );
+      Instrument::name_stage( TICKER_STAGE_UPDATE, "update" );
+      Instrument::name_stage( TICKER_STAGE_RENDER, "render" );
+      Instrument::name_stage( TICKER_STAGE_PRESENT, "present" );
+
+      /* Carry on from where we left off, rather than leaping ahead. */
+      m_last_tick = time_us_64();
+      return;
+    }
+
+    /* Other apps in the image may want the WiFi; it's back up on our next frame. */
+    void suspend( appcontext_t *p_context )
+    {
+      ticker_release( &m_net );
+      return;
+    }
+
+    void update( appcontext_t *p_context )
+    {
+      uint32_t           l_stage_tick;
+      uint64_t           l_current_tick = time_us_64();
+      const tickermsg_t *l_message;
+
+      /* Keep the network moving along. */
+      l_stage_tick = Instrument::start( TICKER_STAGE_NETWORK );
+      m_listening = ticker_network( &m_net );
+      Instrument::record( TICKER_STAGE_NETWORK, time_us_32() - l_stage_tick );
+
+      /* Scroll; once we're off the end, move onto the next message (if any). */
+      l_stage_tick = Instrument::start( TICKER_STAGE_UPDATE );
+      if ( ticker_update( &m_strip, l_current_tick - m_last_tick ) )
+      {
+        l_message = g_queue.front();
+        if ( l_message != nullptr )
+        {
+          strcpy( m_text, l_message->text );
+          g_queue.pop();
+          m_received = true;
+          ticker_build( &m_strip, m_text );
+        }
+        else if ( !m_received && m_listening && !m_announced )
+        {
+          /* Nothing to show yet, so tell people where to send it. */
+          snprintf( m_text, sizeof( m_text ), "Listening on %s:%d",
+                    ip4addr_ntoa( netif_ip4_addr( &cyw43_state.netif[CYW43_ITF_STA] ) ),
+                    TICKER_PORT );
+          m_announced = true;
+          ticker_build( &m_strip, m_text );
+        }
+        else
+        {
+          /* Same message again, so the strip we have is still good. */
+          m_strip.position = 0;
+        }
+      }
+      m_last_tick = l_current_tick;
+      Instrument::record( TICKER_STAGE_UPDATE, time_us_32() - l_stage_tick );
+      return;
+    }
+
+    void render( appcontext_t *p_context )
+    {
+      uint32_t  l_stage_tick;
+
+      /* Every pixel is written, so there's no need to clear the screen first. */
+      l_stage_tick = Instrument::start( TICKER_STAGE_RENDER );
+      ticker_render( &m_strip, p_context->graphics );
+      Instrument::record( TICKER_STAGE_RENDER, time_us_32() - l_stage_tick );
+
+      /* The text is drawn - so, we ask the Unicorn to update. */
+      l_stage_tick = Instrument::start( TICKER_STAGE_PRESENT );
+      p_context->unicorn->update( p_context->graphics );
+      Instrument::record( TICKER_STAGE_PRESENT, time_us_32() - l_stage_tick );
+
+      /* And the next frame is due at our usual rate. */
+      p_context->scheduler->next_fps( TICKER_FPS );
+      return;
+    }
+};
+
+
+/*
+ * ticker_app - hands out the ticker, for whoever is running it.
+ */
+
+UnicornApp *ticker_app( void )
+{
+  static TickerApp  l_ticker;
+  return &l_ticker;
+}
+
+
+/*
+ * main - entry point; when we're built on our own, we're the only app.
+ */
+
+#ifndef UNICORN_LAUNCHER
+int main()
+{
+  UnicornApp *l_apps[] = { ticker_app() };
+
+  AppRunner::run( l_apps, 1 );
+
+  /* We'll never get here! */
+  return 0;
+}
+#endif
+
+/* End of file ticker.cpp */
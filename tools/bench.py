@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+#
+# bench.py - from the Unicorn C(++) Examples collection
+#
+# Collects the machine-readable benchmark results (see bench.hpp) which an
+# instrumented build prints over USB at startup, adds the flash and RAM size
+# of each image from its ELF, and saves the lot as JSON; and compares one of
+# those runs against a stored baseline, flagging any regressions.
+#
+#   bench.py capture <port, log or -> [--elf better_clock.elf ...] [-o run.json]
+#   bench.py compare <run.json> <baseline.json> [--threshold 5] [--size-threshold 1]
+#
+# Capturing from a port waits for it to appear, so start it and then plug in
+# (or reset) the Unicorn; it stops once every app has reported. A saved log
+# of the USB output works just as well, as does "-" for standard input; that's
+# how the host benchmark (tests/host_bench.cpp) gets in, so that CI can run
+# it against a baseline from the same machine. A kernel reported more than
+# once keeps its fastest run. Comparing exits non-zero if any kernel got
+# slower by more than the threshold (in percent), allocated more, or an image
+# grew by more than the size threshold; kernels are compared in nanoseconds
+# if both runs were at the same clock, and in cycles if not.
+#
+# Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+# Released under the MIT License; see LICENSE for details.
+
+import argparse
+import json
+import os
+import sys
+import time
+
+from flash_report import flash_size, ram_size
+
+BENCH_PREFIX = "BENCH "
+
+
+def read_lines(path, timeout):
+    """Lines from a log file, stdin, or a serial port as and when it turns up."""
+    deadline = time.time() + timeout
+    while path != "-" and not os.path.exists(path):
+        if time.time() > deadline:
+            raise SystemExit("{} never appeared".format(path))
+        time.sleep(0.1)
+    with open(sys.stdin.fileno() if path == "-" else path, "rb", buffering=0, closefd=path != "-") as source:
+        line = b""
+        while time.time() < deadline:
+            byte = source.read(1)
+            if not byte:
+                break
+            if byte == b"\n":
+                yield line.decode("utf-8", "replace").strip()
+                line = b""
+            else:
+                line += byte
+        if line:
+            yield line.decode("utf-8", "replace").strip()
+
+
+def capture(args):
+    run = {"kernels": {}, "images": {}}
+    finished = False
+    for line in read_lines(args.source, args.timeout):
+        if not line.startswith(BENCH_PREFIX):
+            continue
+        result = json.loads(line[len(BENCH_PREFIX):])
+        if result.get("end"):
+            run["mhz"] = result.get("mhz")
+            finished = True
+            break
+        name = "{}/{}".format(result.pop("suite"), result.pop("kernel"))
+        if name in run["kernels"] and run["kernels"][name]["ns_per_op"] <= result["ns_per_op"]:
+            continue
+        run["kernels"][name] = result
+
+    for name, result in run["kernels"].items():
+        print("{:<36} {:>10} ns/op {:>8} cycles/op".format(name, result["ns_per_op"], result["cycles_per_op"]))
+    if not finished:
+        print("warning: never saw the end of the benchmarks; results may be partial")
+    for path in args.elf:
+        name = os.path.splitext(os.path.basename(path))[0]
+        run["images"][name] = {"flash": flash_size(path), "ram": ram_size(path)}
+        print("{:<36} {:>10} bytes flash {:>8} bytes RAM".format(name, run["images"][name]["flash"],
+                                                                   run["images"][name]["ram"]))
+
+    with open(args.output, "w") as output:
+        json.dump(run, output, indent=2, sort_keys=True)
+    print("saved {} kernels to {}".format(len(run["kernels"]), args.output))
+    return 0 if run["kernels"] else 1
+
+
+def change(new, old):
+    return 100.0 * (new - old) / old if old else (0.0 if new == old else float("inf"))
+
+
+def compare(args):
+    with open(args.run) as source:
+        run = json.load(source)
+    with open(args.baseline) as source:
+        baseline = json.load(source)
+    regressions = 0
+
+    # Nanoseconds are finer-grained than cycles, but only mean the same at the same clock.
+    measure = "ns_per_op"
+    if run.get("mhz") != baseline.get("mhz"):
+        print("note: clock speed differs ({} vs {} MHz); comparing cycles, not time".format(
+            run.get("mhz"), baseline.get("mhz")))
+        measure = "cycles_per_op"
+
+    print("{:<36} {:>10} {:>10} {:>8}".format("kernel ({})".format(measure), "baseline", "now", "change"))
+    for name in sorted(set(baseline["kernels"]) | set(run["kernels"])):
+        old, new = baseline["kernels"].get(name), run["kernels"].get(name)
+        if old is None or new is None:
+            print("{:<36} {}".format(name, "new" if old is None else "MISSING"))
+            continue
+        delta = change(new[measure], old[measure])
+        flags = []
+        if delta > args.threshold:
+            flags.append("REGRESSION")
+        if new["alloc_bytes"] > old["alloc_bytes"]:
+            flags.append("ALLOCATES {} bytes more".format(new["alloc_bytes"] - old["alloc_bytes"]))
+        regressions += len(flags)
+        print("{:<36} {:>10} {:>10} {:>+7.1f}% {}".format(name, old[measure], new[measure],
+                                                          delta, " ".join(flags)))
+
+    for name in sorted(set(baseline["images"]) & set(run["images"])):
+        for kind in ("flash", "ram"):
+            old, new = baseline["images"][name][kind], run["images"][name][kind]
+            delta = change(new, old)
+            flag = "REGRESSION" if delta > args.size_threshold else ""
+            regressions += 1 if flag else 0
+            print("{:<36} {:>10} {:>10} {:>+7.1f}% {}".format("{} ({})".format(name, kind), old, new, delta, flag))
+
+    print("{} regression{}".format(regressions, "" if regressions == 1 else "s"))
+    return 1 if regressions else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Collect and compare Unicorn benchmark results")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    parser_capture = commands.add_parser("capture", help="collect a run from USB (or a log)")
+    parser_capture.add_argument("source", help="serial port, a saved log, or - for stdin")
+    parser_capture.add_argument("--elf", action="append", default=[], help="image to size; repeat for more")
+    parser_capture.add_argument("-o", "--output", default="bench.json")
+    parser_capture.add_argument("--timeout", type=float, default=120, help="seconds to wait for it all")
+
+    parser_compare = commands.add_parser("compare", help="diff a run against a baseline")
+    parser_compare.add_argument("run")
+    parser_compare.add_argument("baseline")
+    parser_compare.add_argument("--threshold", type=float, default=5, help="slowdown allowed, in percent")
+    parser_compare.add_argument("--size-threshold", type=float, default=1, help="growth allowed, in percent")
+
+    args = parser.parse_args()
+    return capture(args) if args.command == "capture" else compare(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
+
+# End of file bench.py
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+#
+# flash_report.py - from the Unicorn C(++) Examples collection
+#
+# Reports how much flash the launcher image saves over flashing each of its
+# apps as a separate image; `make flash_report` runs this for you.
+#
+#   flash_report.py <launcher.elf> <app.elf> [<app.elf> ...]
+#
+# Flash use is the size of every loadable segment whose load address is in
+# the RP2040's XIP flash window; that's code, read-only data and the initial
+# values of anything copied into RAM.
+#
+# Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+# Released under the MIT License; see LICENSE for details.
+
+import os
+import struct
+import sys
+
+FLASH_BASE = 0x10000000
+FLASH_END = 0x11000000
+SRAM_BASE = 0x20000000
+SRAM_END = 0x20042000
+PT_LOAD = 1
+
+
+def flash_size(path):
+    with open(path, "rb") as elf:
+        data = elf.read()
+
+    if data[:4] != b"\x7fELF" or data[4] != 1:
+        raise ValueError("{} is not a 32-bit ELF file".format(path))
+
+    phoff, = struct.unpack_from("<I", data, 28)
+    phentsize, phnum = struct.unpack_from("<HH", data, 42)
+
+    total = 0
+    for index in range(phnum):
+        (p_type, p_offset, p_vaddr, p_paddr,
+         p_filesz, p_memsz, p_flags, p_align) = struct.unpack_from("<8I", data, phoff + index * phentsize)
+        if p_type == PT_LOAD and FLASH_BASE <= p_paddr < FLASH_END:
+            total += p_filesz
+    return total
+
+
+def ram_size(path):
+    """Static RAM use; every loadable segment which lives in SRAM (data and bss)."""
+    with open(path, "rb") as elf:
+        data = elf.read()
+
+    phoff, = struct.unpack_from("<I", data, 28)
+    phentsize, phnum = struct.unpack_from("<HH", data, 42)
+
+    total = 0
+    for index in range(phnum):
+        (p_type, p_offset, p_vaddr, p_paddr,
+         p_filesz, p_memsz, p_flags, p_align) = struct.unpack_from("<8I", data, phoff + index * phentsize)
+        if p_type == PT_LOAD and SRAM_BASE <= p_vaddr < SRAM_END:
+            total += p_memsz
+    return total
+
+
+def main():
+    if len(sys.argv) < 3:
+        print("usage: {} <launcher.elf> <app.elf> [<app.elf> ...]".format(sys.argv[0]))
+        return 1
+
+    separate = 0
+    for path in sys.argv[2:]:
+        size = flash_size(path)
+        separate += size
+        print("{:>24} {:>8} bytes".format(os.path.basename(path), size))
+
+    combined = flash_size(sys.argv[1])
+    print("{:>24} {:>8} bytes".format("(separate, total)", separate))
+    print("{:>24} {:>8} bytes".format(os.path.basename(sys.argv[1]), combined))
+    print("{:>24} {:>8} bytes ({:.0f}%)".format("saved", separate - combined,
+                                                 100.0 * (separate - combined) / separate))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
+
+# End of file flash_report.py
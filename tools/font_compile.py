@@ -0,0 +1,297 @@
+#!/usr/bin/env python3
+#
+# font_compile.py - from the Unicorn C(++) Examples collection
+#
+# Turns a bitmap font - a BDF file, or a PNG strip of equal-width glyphs side
+# by side - into a header of constexpr tables, so that adding a glyph means
+# drawing it rather than typing hex. CMake runs this at build time, and the
+# fonts (numeric_font.hpp, for one) include what it writes.
+#
+#   font_compile.py fonts/numeric.bdf --name numeric_font --chars "0123456789UTC+-=" -o numeric_font_data.hpp
+#   font_compile.py strip.png --width 4 --chars "0123456789" --name my_font -o my_font_data.hpp
+#
+# Each glyph is written out two ways:
+#
+#  - column-major, one byte per column with bit 0 the top row; the layout
+#    the existing renderers (and the rolling digits) work with.
+#
+#  - row spans, for blitting; each row is the runs of lit pixels along it,
+#    a byte apiece (start in the top nibble, length in the bottom), padded
+#    with zeros. A row is then a handful of span fills, not a pixel each.
+#
+# It also reports which of the asked-for characters it found (failing if any
+# are missing, or only drawn blank), and how much flash the tables will take.
+#
+# Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+# Released under the MIT License; see LICENSE for details.
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+# Spans pack start and length into a nibble each; columns are a byte.
+MAX_WIDTH = 15
+MAX_HEIGHT = 8
+
+
+class Glyph:
+    """A glyph, as rows of booleans, top to bottom."""
+
+    def __init__(self, char, rows):
+        self.char = char
+        self.rows = rows
+
+    def columns(self, width):
+        return [sum(1 << y for y, row in enumerate(self.rows) if row[x]) for x in range(width)]
+
+    def spans(self):
+        result = []
+        for row in self.rows:
+            runs, start = [], None
+            for x, lit in enumerate(row + [False]):
+                if lit and start is None:
+                    start = x
+                elif not lit and start is not None:
+                    runs.append((start, x - start))
+                    start = None
+            result.append(runs)
+        return result
+
+    def pixels(self):
+        return sum(sum(row) for row in self.rows)
+
+
+def read_bdf(path):
+    """Every glyph in a BDF file, placed in the font's bounding box."""
+    glyphs, width, height, xoff, yoff = {}, 0, 0, 0, 0
+    with open(path) as source:
+        lines = iter(source.read().splitlines())
+    for line in lines:
+        words = line.split()
+        if not words:
+            continue
+        if words[0] == "FONTBOUNDINGBOX":
+            width, height, xoff, yoff = (int(w) for w in words[1:5])
+        elif words[0] == "STARTCHAR":
+            code, bbx, bitmap = None, None, []
+            for line in lines:
+                words = line.split()
+                if words[0] == "ENCODING":
+                    code = int(words[1])
+                elif words[0] == "BBX":
+                    bbx = [int(w) for w in words[1:5]]
+                elif words[0] == "BITMAP":
+                    for line in lines:
+                        if line.strip() == "ENDCHAR":
+                            break
+                        bitmap.append(int(line.strip(), 16))
+                    break
+            if code is None or code < 0 or bbx is None:
+                continue
+
+            # Place the glyph's own box within the font's, top-left aligned.
+            rows = [[False] * width for _ in range(height)]
+            bits = ((bbx[0] + 7) // 8) * 8
+            top = (height + yoff) - (bbx[1] + bbx[3])
+            for y, value in enumerate(bitmap):
+                for x in range(bbx[0]):
+                    cx, cy = x + bbx[2] - xoff, y + top
+                    if value & (1 << (bits - 1 - x)) and 0 <= cx < width and 0 <= cy < height:
+                        rows[cy][cx] = True
+            glyphs[chr(code)] = Glyph(chr(code), rows)
+    return width, height, glyphs
+
+
+def read_png(path):
+    """A PNG, as rows of lit (bright, and opaque) pixels; no PIL needed."""
+    with open(path, "rb") as source:
+        data = source.read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise SystemExit("{}: not a PNG".format(path))
+
+    offset, idat, palette = 8, b"", []
+    while offset < len(data):
+        length, kind = struct.unpack(">I4s", data[offset:offset + 8])
+        chunk = data[offset + 8:offset + 8 + length]
+        offset += 12 + length
+        if kind == b"IHDR":
+            width, height, depth, colour, _, _, interlace = struct.unpack(">IIBBBBB", chunk)
+        elif kind == b"PLTE":
+            palette = [tuple(chunk[i:i + 3]) for i in range(0, len(chunk), 3)]
+        elif kind == b"IDAT":
+            idat += chunk
+    if interlace or (depth != 8 and colour not in (0, 3)):
+        raise SystemExit("{}: only non-interlaced PNGs, 8 bits per channel (or fewer, paletted/grey)".format(path))
+
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[colour]
+    stride = (width * channels * depth + 7) // 8
+    step = max(1, channels * depth // 8)
+    raw, previous, rows = zlib.decompress(idat), bytearray(stride), []
+    for y in range(height):
+        kind, line = raw[y * (stride + 1)], bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for i in range(stride):
+            left = line[i - step] if i >= step else 0
+            up, corner = previous[i], previous[i - step] if i >= step else 0
+            if kind == 1:
+                line[i] = (line[i] + left) & 0xff
+            elif kind == 2:
+                line[i] = (line[i] + up) & 0xff
+            elif kind == 3:
+                line[i] = (line[i] + (left + up) // 2) & 0xff
+            elif kind == 4:
+                guess = left + up - corner
+                nearest = min((abs(guess - left), 0, left), (abs(guess - up), 1, up), (abs(guess - corner), 2, corner))
+                line[i] = (line[i] + nearest[2]) & 0xff
+        previous = line
+
+        row = []
+        for x in range(width):
+            if depth < 8:
+                bit = x * depth
+                value = (line[bit // 8] >> (8 - depth - bit % 8)) & ((1 << depth) - 1)
+                grey = palette[value] if colour == 3 else (value * 255 // ((1 << depth) - 1),) * 3
+                alpha = 255
+            else:
+                pixel = line[x * channels:(x + 1) * channels]
+                grey = palette[pixel[0]] if colour == 3 else (tuple(pixel[:3]) if channels >= 3 else (pixel[0],) * 3)
+                alpha = pixel[-1] if colour in (4, 6) else 255
+            row.append(alpha >= 128 and sum(grey) >= 3 * 128)
+        rows.append(row)
+    return width, height, rows
+
+
+def read_strip(path, width, gap, chars):
+    """A PNG strip; glyph n starts at n * (width + gap), in the order given."""
+    image_width, height, rows = read_png(path)
+    glyphs = {}
+    for index, char in enumerate(chars):
+        left = index * (width + gap)
+        if left + width > image_width:
+            break
+        glyphs[char] = Glyph(char, [row[left:left + width] for row in rows])
+    return width, height, glyphs
+
+
+def footprint(name, glyph_count, width, height, span_max):
+    """The tables' sizes, in bytes; all of it is const, so lands in flash."""
+    return [("{}_columns".format(name), glyph_count * width),
+            ("{}_spans".format(name), glyph_count * height * span_max),
+            ("{}_chars".format(name), glyph_count + 1)]
+
+
+def describe(char):
+    return repr(char) if char.isprintable() else "U+{:04X}".format(ord(char))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile a BDF or PNG strip font into constexpr tables")
+    parser.add_argument("font", help="a .bdf file, or a .png strip")
+    parser.add_argument("--name", required=True, help="prefix for everything generated, e.g. numeric_font")
+    parser.add_argument("--chars", help="which glyphs, in which order (default: all of a BDF)")
+    parser.add_argument("--width", type=int, help="glyph width, for a PNG strip")
+    parser.add_argument("--gap", type=int, default=0, help="columns between glyphs in a PNG strip")
+    parser.add_argument("-o", "--output", required=True)
+    args = parser.parse_args()
+
+    if args.font.lower().endswith(".png"):
+        if not args.width or not args.chars:
+            raise SystemExit("a PNG strip needs --width and --chars")
+        width, height, glyphs = read_strip(args.font, args.width, args.gap, args.chars)
+    else:
+        width, height, glyphs = read_bdf(args.font)
+    chars = args.chars if args.chars else "".join(glyphs)
+
+    if width > MAX_WIDTH or height > MAX_HEIGHT:
+        raise SystemExit("{}: glyphs are {}x{}; at most {}x{} fit the tables".format(
+            args.font, width, height, MAX_WIDTH, MAX_HEIGHT))
+
+    # Coverage; which of the characters asked for are there, and drawn?
+    print("{}: {}x{}, {} glyphs in the source, {} asked for".format(
+        os.path.basename(args.font), width, height, len(glyphs), len(chars)))
+    missing = [c for c in chars if c not in glyphs]
+    blank = [c for c in chars if c in glyphs and glyphs[c].pixels() == 0]
+    for char in chars:
+        if char in glyphs:
+            print("  {:<8} {:>3} pixels".format(describe(char), glyphs[char].pixels()))
+        else:
+            print("  {:<8} MISSING".format(describe(char)))
+    unused = sorted(set(glyphs) - set(chars))
+    if unused:
+        print("  (in the source but not asked for: {})".format(" ".join(describe(c) for c in unused)))
+    if missing or blank:
+        for kind, which in (("missing", missing), ("blank", blank)):
+            if which:
+                print("error: {}: {}".format(kind, " ".join(describe(c) for c in which)), file=sys.stderr)
+        return 1
+
+    ordered = [glyphs[c] for c in chars]
+    span_max = max(1, max(len(runs) for g in ordered for runs in g.spans()))
+    upper = args.name.upper()
+    sizes = footprint("g_" + args.name, len(ordered), width, height, span_max)
+    for table, size in sizes:
+        print("  {:<28} {:>5} bytes".format(table, size))
+    print("  {:<28} {:>5} bytes of flash".format("total", sum(size for _, size in sizes)))
+
+    # And out it all goes.
+    guard = os.path.basename(args.output).upper().replace(".", "_")
+    out = []
+    out.append("/*")
+    out.append(" * {} - generated by tools/font_compile.py from {}".format(
+        os.path.basename(args.output), os.path.basename(args.font)))
+    out.append(" *")
+    out.append(" * Don't edit this; change the font and rebuild. {} glyphs of {}x{}, taking".format(
+        len(ordered), width, height))
+    out.append(" * {} bytes of flash:".format(sum(size for _, size in sizes)))
+    out.append(" *")
+    for table, size in sizes:
+        out.append(" *   {:<28} {:>5} bytes".format(table, size))
+    out.append(" */")
+    out.append("")
+    out.append("#ifndef {}".format(guard))
+    out.append("#define {}".format(guard))
+    out.append("")
+    out.append("#include <stdint.h>")
+    out.append("")
+    out.append("#define {}_WIDTH {}".format(upper, width))
+    out.append("#define {}_HEIGHT {}".format(upper, height))
+    out.append("#define {}_GLYPHS {}".format(upper, len(ordered)))
+    out.append("#define {}_SPANS {}".format(upper, span_max))
+    out.append("")
+    out.append("/* Columns, left to right; bit 0 is the top row. */")
+    out.append("static constexpr uint8_t g_{}_columns[{}][{}] = {{".format(args.name, len(ordered), width))
+    for index, glyph in enumerate(ordered):
+        out.append("  {{ {} }}{}  /* {} */".format(",".join("0x{:02x}".format(c) for c in glyph.columns(width)),
+                                                   "," if index < len(ordered) - 1 else " ",
+                                                   describe(glyph.char).replace("*/", "* /")))
+    out.append("};")
+    out.append("")
+    out.append("/* Runs along each row, top to bottom; start << 4 | length, zero padded. */")
+    out.append("static constexpr uint8_t g_{}_spans[{}][{}][{}] = {{".format(
+        args.name, len(ordered), height, span_max))
+    for index, glyph in enumerate(ordered):
+        rows = []
+        for runs in glyph.spans():
+            packed = [(start << 4) | length for start, length in runs] + [0] * (span_max - len(runs))
+            rows.append("{{{}}}".format(",".join("0x{:02x}".format(p) for p in packed)))
+        out.append("  {{ {} }}{}".format(",".join(rows), "," if index < len(ordered) - 1 else ""))
+    out.append("};")
+    out.append("")
+    out.append("/* Which character each glyph is, in order. */")
+    out.append("static constexpr char g_{}_chars[] = \"{}\";".format(
+        args.name, "".join(c if c not in "\\\"" else "\\" + c for c in chars)))
+    out.append("")
+    out.append("#endif /* {} */".format(guard))
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, "w") as output:
+        output.write("\n".join(out) + "\n")
+    print("wrote {}".format(args.output))
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
+
+# End of file font_compile.py
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+#
+# gradient_compare.py - from the Unicorn C(++) Examples collection
+#
+# Compares better_clock's background through the day, as it was (blending
+# hue, saturation and value in gamma-encoded HSV) and as it is now (blending
+# the midnight and midday colours in linear light, via linear_light.hpp's
+# tables). It works each frame out just as the clock does, RGB565 and all,
+# and writes them to an image (one row per time of day, old on the left and
+# new on the right) along with how evenly the brightness changes.
+#
+#   gradient_compare.py [--steps 96] [--scale 4] [-o gradient_compare.ppm]
+#
+# Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+# Released under the MIT License; see LICENSE for details.
+
+import argparse
+import math
+
+# These match better_clock.cpp and linear_light.hpp.
+WIDTH, HEIGHT = 53, 11
+MIDDAY_HUE, MIDNIGHT_HUE, HUE_OFFSET = 1.1, 0.8, -0.1
+MIDDAY_SATURATION, MIDNIGHT_SATURATION = 1.0, 1.0
+MIDDAY_VALUE, MIDNIGHT_VALUE = 0.8, 0.3
+LINEAR_LIGHT_BITS = 12
+
+
+def decode(value):
+    return value / 12.92 if value <= 0.04045 else ((value + 0.055) / 1.055) ** 2.4
+
+
+TO_LINEAR = [int(decode(code / 255) * 65535 + 0.5) for code in range(256)]
+
+
+def build_to_srgb():
+    table, code = [], 0
+    for index in range(1 << LINEAR_LIGHT_BITS):
+        value = (index << (16 - LINEAR_LIGHT_BITS)) + (1 << (15 - LINEAR_LIGHT_BITS))
+        while code < 255 and TO_LINEAR[code] + TO_LINEAR[code + 1] < 2 * value:
+            code += 1
+        table.append(code)
+    return table
+
+
+TO_SRGB = build_to_srgb()
+
+
+def from_hsv(h, s, v):
+    """As the C version, truncating floats into bytes on the way out."""
+    i = math.floor(h * 6)
+    f = h * 6 - i
+    v *= 255
+    p, q, t = int(v * (1 - s)), int(v * (1 - f * s)), int(v * (1 - (1 - f) * s))
+    v = int(v)
+    return [(v, t, p), (q, v, p), (p, v, t), (p, q, v), (t, p, v), (v, p, q)][int(i) % 6]
+
+
+def rgb565(colour):
+    """What the panel actually gets, expanded back out to 8 bits."""
+    r, g, b = colour[0] & 0xf8, colour[1] & 0xfc, colour[2] & 0xf8
+    return r | r >> 5, g | g >> 6, b | b >> 5
+
+
+def columns_hsv(mix):
+    hue = (MIDDAY_HUE - MIDNIGHT_HUE) * mix + MIDNIGHT_HUE
+    sat = (MIDDAY_SATURATION - MIDNIGHT_SATURATION) * mix + MIDNIGHT_SATURATION
+    val = (MIDDAY_VALUE - MIDNIGHT_VALUE) * mix + MIDNIGHT_VALUE
+    half = WIDTH // 2
+    return [from_hsv(HUE_OFFSET * x / half + hue, sat, val) for x in range(half + 1)]
+
+
+def columns_linear(mix):
+    half = WIDTH // 2
+    mix = int(mix * 256)
+    result = []
+    for x in range(half + 1):
+        night = from_hsv(HUE_OFFSET * x / half + MIDNIGHT_HUE, MIDNIGHT_SATURATION, MIDNIGHT_VALUE)
+        day = from_hsv(HUE_OFFSET * x / half + MIDDAY_HUE, MIDDAY_SATURATION, MIDDAY_VALUE)
+        result.append(tuple(TO_SRGB[(TO_LINEAR[a] + (((TO_LINEAR[b] - TO_LINEAR[a]) * mix) >> 8))
+                                    >> (16 - LINEAR_LIGHT_BITS)] for a, b in zip(night, day)))
+    return result
+
+
+def row(columns):
+    """A full row of the panel, with the right half mirroring the left."""
+    half = WIDTH // 2
+    return [rgb565(columns[x if x <= half else WIDTH - x]) for x in range(WIDTH)]
+
+
+def luminance(colour):
+    r, g, b = (decode(c / 255) for c in colour)
+    return 0.2126 * r + 0.7152 * g + 0.0722 * b
+
+
+def midpercent(step, steps):
+    daypcnt = step / steps
+    return 1 - ((math.cos(daypcnt * math.pi * 2) + 1) / 2)
+
+
+def evenness(rows):
+    """How the panel's average brightness moves from one step to the next."""
+    levels = [sum(luminance(colour) for colour in r) / len(r) for r in rows]
+    steps = [b - a for a, b in zip(levels, levels[1:])]
+    reversals = sum(1 for a, b in zip(steps, steps[1:]) if a * b < 0) - 1
+    biggest = max(abs(s) for s in steps)
+    mean = sum(abs(s) for s in steps) / len(steps)
+    return levels, biggest / mean if mean else 0, max(0, reversals)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare HSV and linear-light day gradients")
+    parser.add_argument("--steps", type=int, default=96, help="times of day to show")
+    parser.add_argument("--scale", type=int, default=4)
+    parser.add_argument("-o", "--output", default="gradient_compare.ppm")
+    args = parser.parse_args()
+
+    # Midnight to midday; the afternoon is the same, backwards.
+    half = args.steps // 2
+    old = [row(columns_hsv(midpercent(step, args.steps))) for step in range(half + 1)]
+    new = [row(columns_linear(midpercent(step, args.steps))) for step in range(half + 1)]
+
+    gap = [(0, 0, 0)] * 4
+    with open(args.output, "wb") as image:
+        image.write("P6 {} {} 255\n".format((WIDTH * 2 + 4) * args.scale, len(old) * args.scale).encode())
+        for left, right in zip(old, new):
+            line = b"".join(bytes(colour) * args.scale for colour in left + gap + right)
+            image.write(line * args.scale)
+
+    for name, rows in (("HSV (as was)", old), ("linear light", new)):
+        levels, ratio, reversals = evenness(rows)
+        mid = levels[len(levels) // 2]
+        print("{:<14} midnight {:.3f}, halfway {:.3f}, midday {:.3f} (linear luminance);"
+              " biggest step x{:.1f} the average, {} reversals".format(
+                  name, levels[0], mid, levels[-1], ratio, reversals))
+    print("wrote {} (HSV on the left, linear light on the right; midnight at the top)".format(args.output))
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
+
+# End of file gradient_compare.py
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+#
+# profile.py - from the Unicorn C(++) Examples collection
+#
+# Collects a sampling profile (see profiler.hpp) from a Unicorn built with
+# UNICORN_PROFILE, and works out which functions the samples landed in, from
+# the symbol table of the ELF it was built from.
+#
+#   profile.py <port or log> <image.elf> [--top 30] [--folded profile.folded]
+#
+# Given a serial port, it asks for the dump itself ('profile dump') and reads
+# it back; a saved log of the USB output works just as well. It prints a flat
+# profile - the share of samples in each function - and can also write the
+# samples out as folded stacks (caller;function count), which flamegraph.pl
+# or speedscope will draw as a flame graph.
+#
+# Each sample is the interrupted PC and LR. LR is only the caller while the
+# function hasn't yet called anything else, so the "stacks" are two deep at
+# best; where LR lands in the same function as PC, it's left off.
+#
+# Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+# Released under the MIT License; see LICENSE for details.
+
+import argparse
+import bisect
+import os
+import stat
+import struct
+import subprocess
+import sys
+
+from bench import read_lines
+
+PROFILER_PREFIX = "PROFILE "
+BOOTROM_END = 0x00004000
+SHT_SYMTAB = 2
+STT_FUNC = 2
+
+
+def functions(path):
+    """Every function in the ELF, as sorted (start, end, name) tuples."""
+    with open(path, "rb") as elf:
+        data = elf.read()
+    if data[:4] != b"\x7fELF" or data[4] != 1:
+        raise SystemExit("{} is not a 32-bit ELF file".format(path))
+
+    shoff, = struct.unpack_from("<I", data, 32)
+    shentsize, shnum = struct.unpack_from("<HH", data, 46)
+    sections = [struct.unpack_from("<IIIIIIIIII", data, shoff + i * shentsize) for i in range(shnum)]
+
+    result = []
+    for section in sections:
+        if section[1] != SHT_SYMTAB:
+            continue
+        strings = sections[section[6]]
+        for offset in range(section[4], section[4] + section[5], 16):
+            name, value, size, info, _, shndx = struct.unpack_from("<IIIBBH", data, offset)
+            if info & 0x0f != STT_FUNC or shndx == 0:
+                continue
+            start = strings[4] + name
+            label = data[start:data.index(b"\0", start)].decode("utf-8", "replace")
+            result.append((value & ~1, (value & ~1) + max(size, 2), label))
+    result.sort()
+    return result
+
+
+def demangle(names):
+    """Nicer C++ names, if c++filt is about; otherwise as they are."""
+    names = list(names)
+    for tool in ("arm-none-eabi-c++filt", "c++filt"):
+        try:
+            output = subprocess.run([tool], input="\n".join(names), capture_output=True, text=True, check=True)
+            return dict(zip(names, output.stdout.splitlines()))
+        except (OSError, subprocess.CalledProcessError):
+            continue
+    return {name: name for name in names}
+
+
+class Symboliser:
+    def __init__(self, path):
+        self.table = functions(path)
+        self.starts = [start for start, _, _ in self.table]
+
+    def name(self, address):
+        address &= ~1
+        if address < BOOTROM_END:
+            return "[bootrom]"
+        index = bisect.bisect_right(self.starts, address) - 1
+        if index >= 0 and address < self.table[index][1]:
+            return self.table[index][2]
+        return "[0x{:08x}]".format(address)
+
+
+def capture(source, timeout):
+    """The header, and the (pc, caller, count) samples, from a dump."""
+    try:
+        if stat.S_ISCHR(os.stat(source).st_mode):
+            with open(source, "wb", buffering=0) as port:
+                port.write(b"profile dump\r\n")
+    except FileNotFoundError:
+        pass
+
+    header, samples = {}, []
+    for line in read_lines(source, timeout):
+        if not line.startswith(PROFILER_PREFIX):
+            continue
+        words = line[len(PROFILER_PREFIX):].split()
+        if words[0] == "begin":
+            header = dict(word.split("=", 1) for word in words[1:])
+            samples = []
+        elif words[0] == "end":
+            return header, samples
+        elif header:
+            samples.append((int(words[0], 16), int(words[1], 16), int(words[2])))
+    raise SystemExit("never saw a complete profile dump from {}".format(source))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Symbolise a Unicorn sampling profile")
+    parser.add_argument("source", help="serial port, or a saved log")
+    parser.add_argument("elf", help="the image the Unicorn is running")
+    parser.add_argument("--top", type=int, default=30, help="how many functions to list")
+    parser.add_argument("--folded", help="also write folded stacks here, for a flame graph")
+    parser.add_argument("--timeout", type=float, default=30, help="seconds to wait for the dump")
+    args = parser.parse_args()
+
+    header, samples = capture(args.source, args.timeout)
+    symbols = Symboliser(args.elf)
+    total = sum(count for _, _, count in samples)
+    if not total:
+        raise SystemExit("no samples in the dump")
+
+    flat, stacks = {}, {}
+    for pc, caller, count in samples:
+        function, calling = symbols.name(pc), symbols.name(caller)
+        flat[function] = flat.get(function, 0) + count
+        stack = function if calling in (function, "[bootrom]") or calling.startswith("[0x") else \
+            "{};{}".format(calling, function)
+        stacks[stack] = stacks.get(stack, 0) + count
+    names = demangle(set(flat) | {part for stack in stacks for part in stack.split(";")})
+
+    print("{} samples at {}Hz ({} dropped), profiler overhead {}".format(
+        header.get("samples"), header.get("hz"), header.get("dropped"), header.get("overhead")))
+    if float(header.get("overhead", "0%").rstrip("%")) >= 1.0:
+        print("warning: the profiler cost 1% or more; try a lower rate")
+    print("{:>8} {:>7}  {}".format("samples", "share", "function"))
+    for function, count in sorted(flat.items(), key=lambda item: -item[1])[:args.top]:
+        print("{:>8} {:>6.1f}%  {}".format(count, 100.0 * count / total, names.get(function, function)))
+
+    if args.folded:
+        with open(args.folded, "w") as output:
+            for stack, count in sorted(stacks.items()):
+                output.write("{} {}\n".format(";".join(names.get(part, part) for part in stack.split(";")), count))
+        print("wrote folded stacks to {} (flamegraph.pl {} > profile.svg)".format(args.folded, args.folded))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
+
+# End of file profile.py
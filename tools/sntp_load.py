@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+#
+# sntp_load.py - from the Unicorn C(++) Examples collection
+#
+# Load tests a better_clock serving time to the LAN (see sntp_server.hpp);
+# fires SNTP client requests at it at a steady rate, and reports how many it
+# answered a second, how long the answers took, and whether they made sense
+# (mode, stratum, our originate time echoed back, timestamps in order).
+#
+#   sntp_load.py <unicorn address> [--rate 50] [--seconds 10] [--port 123]
+#
+# Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+# Released under the MIT License; see LICENSE for details.
+
+import argparse
+import select
+import socket
+import struct
+import time
+
+NTP_EPOCH_OFFSET = 2208988800
+NTP_PACKET_LEN = 48
+
+
+def to_ntp(seconds):
+    seconds += NTP_EPOCH_OFFSET
+    return int(seconds) << 32 | int((seconds % 1) * (1 << 32))
+
+
+def from_ntp(stamp):
+    return (stamp >> 32) - NTP_EPOCH_OFFSET + (stamp & 0xffffffff) / (1 << 32)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Load test a Unicorn's SNTP server")
+    parser.add_argument("address")
+    parser.add_argument("--port", type=int, default=123)
+    parser.add_argument("--rate", type=float, default=50, help="requests per second")
+    parser.add_argument("--seconds", type=float, default=10)
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setblocking(False)
+
+    # Every request carries its own send time, which comes back as the originate.
+    pending = {}
+    latencies, offsets, problems = [], [], {}
+    stratum, sent, late = None, 0, 0
+
+    def problem(name):
+        problems[name] = problems.get(name, 0) + 1
+
+    start = time.time()
+    interval = 1 / args.rate
+    next_send = start
+    finish = start + args.seconds
+    while True:
+        now = time.time()
+        if now >= finish + 1:
+            break
+        if now < finish and now >= next_send:
+            stamp = to_ntp(now)
+            request = struct.pack(">B39xQ", 0x23, stamp)
+            sock.sendto(request, (args.address, args.port))
+            pending[stamp] = now
+            sent += 1
+            next_send += interval
+
+        wait = max(0, min(next_send, finish + 1) - time.time())
+        if not select.select([sock], [], [], wait)[0]:
+            continue
+        while True:
+            try:
+                reply, _ = sock.recvfrom(512)
+            except BlockingIOError:
+                break
+            received = time.time()
+            if len(reply) != NTP_PACKET_LEN:
+                problem("wrong length")
+                continue
+            mode, stratum, _, _, _, _, _, reference, originate, rx, tx = struct.unpack(">BBbbIIIQQQQ", reply)
+            if originate not in pending:
+                late += 1
+                continue
+            sent_at = pending.pop(originate)
+            if mode & 0x07 != 4:
+                problem("not a server reply")
+            if mode >> 6 == 3:
+                problem("server not synchronised")
+            if not 1 <= stratum <= 15:
+                problem("bad stratum")
+            if rx > tx or reference > rx:
+                problem("timestamps out of order")
+            latencies.append(received - sent_at)
+            offsets.append(((from_ntp(rx) - sent_at) + (from_ntp(tx) - received)) / 2)
+
+    elapsed = args.seconds
+    print("sent %d requests to %s:%d over %.1fs (%.0f/s)" % (sent, args.address, args.port, elapsed, sent / elapsed))
+    print("answered %d (%.0f/s), %d unanswered, %d stray"
+          % (len(latencies), len(latencies) / elapsed, len(pending), late))
+    if latencies:
+        latencies.sort()
+        offsets.sort()
+
+        def pct(values, p):
+            return values[min(len(values) - 1, int(len(values) * p))]
+
+        print("latency: median %.2fms, 99%% %.2fms, worst %.2fms"
+              % (pct(latencies, 0.5) * 1000, pct(latencies, 0.99) * 1000, latencies[-1] * 1000))
+        print("stratum %d; its clock is %+.3fs from ours (median)" % (stratum, pct(offsets, 0.5)))
+    for name, count in sorted(problems.items()):
+        print("PROBLEM: %s (%d replies)" % (name, count))
+    return 1 if problems or not latencies else 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
+
+# End of file sntp_load.py
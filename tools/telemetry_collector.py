@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+#
+# telemetry_collector.py - from the Unicorn C(++) Examples collection
+#
+# A stand-in for a proper metrics collector (Telegraf's socket listener takes
+# the same thing), for seeing what the clocks send (see telemetry.hpp): listens
+# for the batched InfluxDB line protocol datagrams, prints each line as it
+# comes in, stamped with the time it arrived, and keeps a summary per unit.
+#
+#   telemetry_collector.py [--port 8089] [--seconds 0] [--budget 4096] [--log lines.txt]
+#
+# It also counts the bytes each unit sends per hour (from its first datagram,
+# counting the IP and UDP headers, as the clock does) and warns if any unit
+# goes over the budget. Stop it with ^C, or give it --seconds, and it prints
+# the summary.
+#
+# Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+# Released under the MIT License; see LICENSE for details.
+
+import argparse
+import select
+import socket
+import time
+
+HEADER_BYTES = 28
+HOUR_SECS = 3600
+
+
+def parse(line):
+    """The measurement, tags and fields of one line, or None if it isn't one."""
+    try:
+        series, fieldset = line.split(" ", 1)
+        parts = series.split(",")
+        tags = dict(part.split("=", 1) for part in parts[1:])
+        fields = {}
+        for field in fieldset.split(" ", 1)[0].split(","):
+            name, value = field.split("=", 1)
+            fields[name] = int(value[:-1]) if value.endswith("i") else float(value)
+    except ValueError:
+        return None
+    return parts[0], tags, fields
+
+
+class Unit:
+    def __init__(self, now):
+        self.datagrams = 0
+        self.bytes = 0
+        self.hour_start = now
+        self.hour_bytes = 0
+        self.worst_hour = 0
+        self.metrics = {}
+
+    def received(self, now, length):
+        if now - self.hour_start >= HOUR_SECS:
+            self.hour_start = now
+            self.hour_bytes = 0
+        self.datagrams += 1
+        self.bytes += length + HEADER_BYTES
+        self.hour_bytes += length + HEADER_BYTES
+        self.worst_hour = max(self.worst_hour, self.hour_bytes)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Collect and summarise Unicorn telemetry")
+    parser.add_argument("--port", type=int, default=8089)
+    parser.add_argument("--seconds", type=float, default=0, help="how long to listen (0 for ever)")
+    parser.add_argument("--budget", type=int, default=4096, help="bytes per unit per hour")
+    parser.add_argument("--log", help="also append every line received here")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("", args.port))
+    print("listening on UDP port %d" % args.port)
+
+    log = open(args.log, "a") if args.log else None
+    units, bad = {}, 0
+    finish = time.time() + args.seconds if args.seconds else None
+    try:
+        while finish is None or time.time() < finish:
+            ready, _, _ = select.select([sock], [], [], 0.5)
+            if not ready:
+                continue
+            payload, (address, _) = sock.recvfrom(2048)
+            now = time.time()
+            stamp = time.strftime("%H:%M:%S", time.localtime(now))
+            sender = None
+            for line in payload.decode("utf-8", "replace").splitlines():
+                parsed = parse(line)
+                if parsed is None:
+                    bad += 1
+                    continue
+                measurement, tags, fields = parsed
+                sender = tags.get("unit", address)
+                unit = units.setdefault(sender, Unit(now))
+                unit.metrics.setdefault(measurement, []).append(fields)
+                print("%s %s %s" % (stamp, address, line))
+                if log:
+                    log.write("%d %s\n" % (now, line))
+            # Each datagram comes from just the one unit; charge it the lot.
+            if sender is not None:
+                unit = units[sender]
+                unit.received(now, len(payload))
+                if unit.hour_bytes > args.budget:
+                    print("WARNING: unit %s has sent %d bytes this hour, over the %d budget"
+                          % (sender, unit.hour_bytes, args.budget))
+    except KeyboardInterrupt:
+        pass
+    if log:
+        log.close()
+
+    print()
+    for unit_name, unit in sorted(units.items()):
+        print("unit %s: %d datagrams, %d bytes; worst hour %d bytes (budget %d)"
+              % (unit_name, unit.datagrams, unit.bytes, unit.worst_hour, args.budget))
+        for measurement, samples in sorted(unit.metrics.items()):
+            if "last" in samples[0]:
+                print("  %-16s %d sends, last %d, range %d..%d" % (
+                    measurement, len(samples), samples[-1]["last"],
+                    min(sample["min"] for sample in samples), max(sample["max"] for sample in samples)))
+            elif "sum" in samples[0]:
+                count = sum(sample["n"] for sample in samples)
+                print("  %-16s %d values, mean %.1f, range %d..%d" % (
+                    measurement, count, sum(sample["sum"] for sample in samples) / count,
+                    min(sample["min"] for sample in samples), max(sample["max"] for sample in samples)))
+            else:
+                print("  %-16s %d in all" % (measurement, sum(sample["n"] for sample in samples)))
+    if bad:
+        print("PROBLEM: %d lines that weren't line protocol" % bad)
+    worst = max((unit.worst_hour for unit in units.values()), default=0)
+    return 1 if bad or worst > args.budget else 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
+
+# End of file telemetry_collector.py
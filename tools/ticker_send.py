@@ -0,0 +1,27 @@
+#!/usr/bin/env python3
+#
+# ticker_send.py - from the Unicorn C(++) Examples collection
+#
+# Sends a message to the ticker example; it's just a plain UDP datagram, so
+# this is as much documentation as it is a tool.
+#
+#   ticker_send.py <unicorn address> "Hello, World"
+#
+# Copyright (C) 2023 Pete Favelle <ahnlak@ahnlak.com>
+# Released under the MIT License; see LICENSE for details.
+
+import socket
+import sys
+
+TICKER_PORT = 4242
+TICKER_MAX_TEXT = 120
+
+if len(sys.argv) < 3:
+    print("usage: {} <address> <message...>".format(sys.argv[0]))
+    sys.exit(1)
+
+message = " ".join(sys.argv[2:]).encode("ascii", "replace")[:TICKER_MAX_TEXT]
+sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+sock.sendto(message, (sys.argv[1], TICKER_PORT))
+
+# End of file ticker_send.py